@@ -110,6 +110,20 @@ public class CompilationPass
 		return optCmd ;
 	}
 	
+	// Only matches the whole name at the start of a line, as OperatorSharing
+	//  is also part of BranchOperatorSharing
+	private static boolean isLowOptSelected(String lowOpts, String name)
+	{
+		String[] lines = lowOpts.split("\n") ;
+		for (int i = 0 ; i < lines.length ; ++i)
+		{
+			String[] words = lines[i].trim().split("\\s+") ;
+			if (words.length > 0 && words[0].equals(name))
+				return true ;
+		}
+		return false ;
+	}
+	
 	public static String CreatePasses(String lowOpts)
 	{
 		String passes = "" ;
@@ -123,13 +137,33 @@ public class CompilationPass
 		passes += "-removeExtends " ;
 		passes += "-ROCCCfloat " ;
 		passes += "-lutDependency " ;
+		// Check for Reassociation
+		if (lowOpts.contains("Reassociation"))
+		{
+			passes += "-rocccReassociate -dce " ;
+		}
 		// Check for Arithmetic Balancing
 		if (lowOpts.contains("ArithmeticBalancing"))
 		{
 			passes += "-rocccFunctionInfo -flattenOperations -dce " ;
 		}
+		// Check for Parallel Selects
+		if (lowOpts.contains("ParallelSelects"))
+		{
+			passes += "-parallelSelects -dce " ;
+		}
+		// Check for Branch Operator Sharing
+		if (lowOpts.contains("BranchOperatorSharing"))
+		{
+			passes += "-shareBranchOperators -dce " ;
+		}
 		passes += "-undefDetect " ;
 		passes += "-functionVerify " ;
+		// Check for Bit Width Minimization
+		if (lowOpts.contains("BitWidthMinimization"))
+		{
+			passes += "-valueRange " ;
+		}
 		passes += "-rocccCFGtoDFG " ;
 		passes += "-detectLoops " ;
 		// Check for FanoutTreeGeneration
@@ -138,13 +172,34 @@ public class CompilationPass
 			passes += "-fanoutTree " ;
 		}
 		passes += "-fanoutAnalysis " ;
+		// Check for DSPMapping
+		if (lowOpts.contains("DSPMapping"))
+		{
+			passes += "-dspMapping " ;
+		}
 		passes += "-pipeline " ;
 		passes += "-retime " ;
+		// Check for PipelineStageMerging
+		if (lowOpts.contains("PipelineStageMerging"))
+		{
+			passes += "-mergeStages " ;
+		}
 		// Check for CopyReduction
 		if (lowOpts.contains("CopyReduction"))
 		{
 			passes += "-minimizeCopies " ;
 		}
+		// Check for ModuloScheduling, which OperatorSharing also needs to set
+		//  the throughput of the datapath
+		if (isLowOptSelected(lowOpts, "ModuloScheduling") || isLowOptSelected(lowOpts, "OperatorSharing"))
+		{
+			passes += "-moduloSchedule " ;
+		}
+		// Check for TimingReport
+		if (lowOpts.contains("TimingReport"))
+		{
+			passes += "-timingReport " ;
+		}
 		passes += "-insertCopy " ;
 		passes += "-arrayNorm " ;
 		passes += "-vhdl " ;
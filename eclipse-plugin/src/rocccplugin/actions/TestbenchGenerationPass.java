@@ -37,6 +37,7 @@ public class TestbenchGenerationPass
 	static int maxChannelBitwidth = 0;
 	static String maxStreamMemory;
 	static boolean isSystem;
+	static boolean isElasticPipeline;
 	
 	public static void run(File sourceFile)
 	{
@@ -46,6 +47,16 @@ public class TestbenchGenerationPass
 		
 		oneBitStreamChannels = new Vector<String>();
 		
+		//The elastic pipeline needs its back-pressure exercised by the testbench.
+		isElasticPipeline = false;
+		File optloFile = new File(sourceFile.getAbsolutePath().replace(sourceFile.getName(), ".ROCCC/.optlo"));
+		if(optloFile.exists())
+		{
+			StringBuffer lowOpts = new StringBuffer();
+			FileUtils.addFileContentsToBuffer(lowOpts, optloFile.getAbsolutePath());
+			isElasticPipeline = lowOpts.toString().contains("ElasticPipeline");
+		}
+		
 		MessageUtils.printlnConsoleMessage("Beginning testbench generation for " + fileToGenerateTestbenchFor.getName() + "...");
 		if(getTestBenchInfo() == false)
 		{
@@ -517,6 +528,7 @@ public class TestbenchGenerationPass
 				buffer.append(tab + tab + tab + "channel_in : in STD_LOGIC_VECTOR((NUM_CHANNELS * CHANNEL_BITWIDTH) - 1 downto 0);\n");
 				buffer.append(tab + tab + tab + "address_in : in STD_LOGIC_VECTOR(NUM_CHANNELS * 32 - 1 downto 0);\n");
 				buffer.append(tab + tab + tab + "read_in : in STD_LOGIC;\n");
+				buffer.append(tab + tab + tab + "enable_in : in STD_LOGIC_VECTOR(NUM_CHANNELS - 1 downto 0) := (others => '1');\n");
 				buffer.append(tab + tab + tab + "OUTPUT_CORRECT : in t_1D_output_memory_type(0 to NUM_MEMORY_ELEMENTS - 1)\n");
 				
 				buffer.append(tab + tab + tab + ");\n");
@@ -665,6 +677,10 @@ public class TestbenchGenerationPass
 				int channelSize = DatabaseInterface.getStreamPortSize(componentName, outputStreams[i], streamChannels[0]);
 				int numChannels = DatabaseInterface.getNumStreamChannels(componentName, outputStreams[i]);
 				
+				//Packed streams carry each element's enable above its data
+				if(hasElementEnable(componentName, outputStreams[i]))
+					++channelSize;
+				
 				for(int j = 0; j < numChannels; ++j)
 			    {
 					buffer.append(tab + "signal " + outputStreams[i] + "_" + j + "_address_side_valid : std_logic;\n");
@@ -883,6 +899,13 @@ public class TestbenchGenerationPass
 		buffer.append(tab + tab + tab + ");\n\n");		
 	}
 	
+	//Packed output streams have an element enable port, with a bit for each channel
+	static private boolean hasElementEnable(String component, String stream)
+	{
+		String[] elementEnables = DatabaseInterface.getStreamPortsOfType(component, stream, "STREAM_ELEMENT_ENABLE");
+		return elementEnables != null && elementEnables.length > 0;
+	}
+	
 	static private void generateSynchInterfacePortMaps(StringBuffer buffer, String component)
 	{
 		String[] outputStreams = DatabaseInterface.getOutputStreams(component);
@@ -894,6 +917,12 @@ public class TestbenchGenerationPass
 			String[] streamChannels = DatabaseInterface.getStreamChannels(component, stream);
 			String[] nonChannelPorts = DatabaseInterface.getNonChannelStreamPorts(component, stream);
 			int streamChannelWidth = DatabaseInterface.getStreamBitSize(component, stream);
+			String[] elementEnables = DatabaseInterface.getStreamPortsOfType(component, stream, "STREAM_ELEMENT_ENABLE");
+			boolean hasEnable = hasElementEnable(component, stream);
+			
+			//Each element's enable goes through the synch interface with its data
+			if(hasEnable)
+				++streamChannelWidth;
 			
 			for(int j = 0; j < numChannels; ++j)
 			{
@@ -904,7 +933,10 @@ public class TestbenchGenerationPass
 				buffer.append(tab + ") port map(\n");
 				buffer.append(tab + tab + "clk => clk,\n");
 				buffer.append(tab + tab + "rst => rst,\n");
-				buffer.append(tab + tab + "data_in => " + streamChannels[j] + ",\n");
+				if(hasEnable)
+					buffer.append(tab + tab + "data_in => " + elementEnables[0] + "(" + j + " downto " + j + ") & " + streamChannels[j] + ",\n");
+				else
+					buffer.append(tab + tab + "data_in => " + streamChannels[j] + ",\n");
 				buffer.append(tab + tab + "data_empty => " + nonChannelPorts[DatabaseInterface.STOP_ACCESS_PORT] + ",\n");
 				buffer.append(tab + tab + "data_read => " + nonChannelPorts[DatabaseInterface.ENABLE_ACCESS_PORT] + ",\n");
 				buffer.append(tab + tab + "address_in => " + stream + "_" + j + "_address_fifo_data_out,\n");
@@ -1031,13 +1063,27 @@ public class TestbenchGenerationPass
 				//buffer.append(" and " + outputStreams[i] + "_" + j + "_stream_read_enable_out");
 				buffer.append(",\n");
 				
-				buffer.append(tab + tab + "channel_in => " + outputStreams[i] + "_" + 0 + "_mc_data_out");
+				boolean hasEnable = hasElementEnable(componentName, outputStreams[i]);
+				int channelSize = DatabaseInterface.getStreamPortSize(componentName, outputStreams[i], streamChannels[0]);
+				String channelSlice = hasEnable ? "(" + (channelSize - 1) + " downto 0)" : "";
+				
+				buffer.append(tab + tab + "channel_in => " + outputStreams[i] + "_" + 0 + "_mc_data_out" + channelSlice);
 				
 				for(int j = 1; j < streamChannels.length; ++j)
-					buffer.append(" & " + outputStreams[i] + "_" + j + "_mc_data_out");
+					buffer.append(" & " + outputStreams[i] + "_" + j + "_mc_data_out" + channelSlice);
 				
 				buffer.append(",\n");
 				
+				if(hasEnable)
+				{
+					buffer.append(tab + tab + "enable_in => " + outputStreams[i] + "_" + 0 + "_mc_data_out(" + channelSize + " downto " + channelSize + ")");
+					
+					for(int j = 1; j < streamChannels.length; ++j)
+						buffer.append(" & " + outputStreams[i] + "_" + j + "_mc_data_out(" + channelSize + " downto " + channelSize + ")");
+					
+					buffer.append(",\n");
+				}
+				
 				buffer.append(tab + tab + "address_in => " + outputStreams[i] + "_0_address_fifo_data_out_2");
 				for(int j = 1; j < streamChannels.length; ++j)
 					buffer.append(" & " + outputStreams[i] + "_" + j + "_address_fifo_data_out_2");
@@ -1205,7 +1251,8 @@ public class TestbenchGenerationPass
 		buffer.append(tab + tab + "begin\n");
 		buffer.append(tab + tab + tab + "wait until clk'event and clk = '1';\n");
 		buffer.append(tab + tab + tab + "inputReady <= " + (isSystem? "'1'" : "'0'") + ";\n");
-		buffer.append(tab + tab + tab + "stall <= '0';\n");
+		if(!(isSystem && isElasticPipeline))
+			buffer.append(tab + tab + tab + "stall <= '0';\n");
 		buffer.append(tab + tab + tab + "wait for clk_period * 10;\n");
 		buffer.append(tab + tab + tab + "rst <= '1';\n");
 		buffer.append(tab + tab + tab + "wait for clk_period * 10;\n");
@@ -1230,6 +1277,27 @@ public class TestbenchGenerationPass
 		buffer.append(tab + tab + tab + "wait;\n");
 		buffer.append(tab + tab + "end process;\n\n");
 		
+		if(isSystem && isElasticPipeline)
+		{
+			//Stall the system for longer than its pipeline every few cycles, so
+			//the first stage is still receiving data when its skid buffer fills up.
+			//Every output is still checked, so a dropped element shows up as an error.
+			buffer.append(tab + tab + "-- Elastic Pipeline Stall Process\n");
+			buffer.append(tab + tab + "stall_proc : process\n");
+			buffer.append(tab + tab + "begin\n");
+			buffer.append(tab + tab + tab + "stall <= '0';\n");
+			buffer.append(tab + tab + tab + "wait until clk'event and clk = '1' and rst = '1';\n");
+			buffer.append(tab + tab + tab + "wait until clk'event and clk = '1' and rst = '0';\n");
+			buffer.append(tab + tab + tab + "while done /= '1' loop\n");
+			buffer.append(tab + tab + tab + tab + "wait for clk_period * 7;\n");
+			buffer.append(tab + tab + tab + tab + "stall <= '1';\n");
+			buffer.append(tab + tab + tab + tab + "wait for clk_period * 9;\n");
+			buffer.append(tab + tab + tab + tab + "stall <= '0';\n");
+			buffer.append(tab + tab + tab + "end loop;\n");
+			buffer.append(tab + tab + tab + "wait;\n");
+			buffer.append(tab + tab + "end process;\n\n");
+		}
+		
 		if(!isSystem || outputScalarValues.size() > 0)
 		{
 			//Output checking
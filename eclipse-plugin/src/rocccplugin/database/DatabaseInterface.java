@@ -2657,6 +2657,14 @@ public class DatabaseInterface
 				stat.executeUpdate(sql);
 			}
 			
+			//fused multiply-adds take the addend c after the factors
+			if(type.equals("FP_FMA"))
+			{
+				sql = "INSERT INTO Ports(id,type,portNum,vhdlName,direction,bitWidth) ";
+				sql += "VALUES('" + ID + "','REGISTER'," + (portNum++) + ",'c','IN'," + bitSize + ");";
+				stat.executeUpdate(sql);
+			}
+			
 			sql = "INSERT INTO Ports(id,type,portNum,vhdlName,direction,bitWidth) ";
 			
 			if(type.equals("INT_TO_FP"))
@@ -204,12 +204,11 @@ public class GenerationFunctions
 			
 			for(int j = 1; j < dataChannels.get(i); ++j)
 			{
-				//ONLY WORKS FOR CHANNELS < 9!!!
-				buffer.append(tab + tab + tab + tab + tab + tab + "address_channel" + j + "_out <= ROCCCADD(cur_address, x\"0000000" + j + "\", 32);\n");
+				buffer.append(tab + tab + tab + tab + tab + tab + "address_channel" + j + "_out <= ROCCCADD(cur_address, " + String.format("x\"%08X\"", j) + ", 32);\n");
 			}
 			
-			buffer.append(tab + tab + tab + tab + tab + tab + "cur_address <= ROCCCADD(cur_address, x\"0000000" + dataChannels.get(i) + "\", 32);\n");
-			buffer.append(tab + tab + tab + tab + tab + tab + "if(ROCCCADD(cur_address, x\"0000000" + dataChannels.get(i) + "\", 32) >= end_address) then\n");
+			buffer.append(tab + tab + tab + tab + tab + tab + "cur_address <= ROCCCADD(cur_address, " + String.format("x\"%08X\"", dataChannels.get(i)) + ", 32);\n");
+			buffer.append(tab + tab + tab + tab + tab + tab + "if(ROCCCADD(cur_address, " + String.format("x\"%08X\"", dataChannels.get(i)) + ", 32) >= end_address) then\n");
 			buffer.append(tab + tab + tab + tab + tab + tab + "if(micro_empty_out = '0') then\n");
 			buffer.append(tab + tab + tab + tab + tab + tab + tab + "state <= S_POP;\n");
 			buffer.append(tab + tab + tab + tab + tab + tab + tab + "micro_read_enable_in <= '1';\n");
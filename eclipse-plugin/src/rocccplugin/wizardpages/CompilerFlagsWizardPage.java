@@ -126,6 +126,7 @@ public class CompilerFlagsWizardPage extends WizardPage
 			
 			if(componentType.equals("SYSTEM"))
 			{
+				optimizationSelector.addFlags("ArrayPartitioning", null, null, new String[]{"Split internal arrays into separate memories or registers so that the accesses of an unrolled loop", "body can be performed in parallel."}, null, null, false, false);
 				optimizationSelector.addFlags("LoopFusion", null, null, new String[]{"Merge successive loops with the same bounds.", ""}, null, null, false, false);
 				optimizationSelector.addFlags("LoopInterchange", new String[]{"First Loop Label", "Second Loop Label"}, new String[]{"/*Label1*/", "/*Label2*/"}, new String[]{"Switch the order of two nested loops, which must be identified in the C code with labels.", ""}, new OptimizationValueType[]{OptimizationValueType.SELECTION, OptimizationValueType.SELECTION}, new String[][]{labels, labels}, true, false);
 				optimizationSelector.addFlags("LoopUnrolling", new String[]{"Loop Label", "Number of Loop Bodies After Unrolling"}, new String[]{"/*Label*/", "/*Enter a positive integer or enter FULLY to fully unroll*/"}, new String[]{"Unroll the loop at the given C label amount. If the loop has constant bounds, the loop can be fully unrolled.", ""}, new OptimizationValueType[]{OptimizationValueType.SELECTION, OptimizationValueType.AMOUNT}, new String[][]{labels, null}, true, false);	
@@ -135,6 +136,7 @@ public class CompilerFlagsWizardPage extends WizardPage
 
 			if(componentType.equals("SYSTEM"))
 			{
+				optimizationSelector.addFlags("ScalarReplacementBudget", new String[]{"Register Bits", "Block RAMs"}, new String[]{"/*Enter a positive integer or 0 for no limit*/", "/*Enter a positive integer or 0 for no limit*/"}, new String[]{"Limit the registers and block RAMs used to reuse stream elements across loop iterations. The", "streams that save the most memory accesses per register are reused first, and the rest are read from memory."}, new OptimizationValueType[]{OptimizationValueType.AMOUNT, OptimizationValueType.AMOUNT}, null, false, false);
 				optimizationSelector.addFlags("SystolicArrayGeneration", new String[]{"Outer Loop Label"}, new String[]{"/*Label*/"}, new String[]{"Transform a wavefront algorithm that works over a two-dimensional array into a one-dimensional hardware", "structure with feedback at every stage in order to increase the throughput while reducing hardware."}, new OptimizationValueType[]{OptimizationValueType.SELECTION}, new String[][]{labels}, false, true);
 				optimizationSelector.addFlags("TemporalCommonSubExpressionElimination", null, null, new String[]{"Detect and remove common code across loop iterations to reduce the size of the generated code,", "requiring initial values for each piece of hardware eliminated."}, null, null, false, false);
 			
@@ -505,7 +507,7 @@ public class CompilerFlagsWizardPage extends WizardPage
 				   flag.equals("FP_DIV") || flag.equals("FP_GREATER_THAN") || flag.equals("FP_LESS_THAN") ||
 				   flag.equals("FP_EQUAL") || flag.equals("FP_GREATER_THAN_EQUAL") || flag.equals("FP_LESS_THAN_EQUAL") ||
 				   flag.equals("FP_NOT_EQUAL") || flag.equals("FP_TO_INT") || flag.equals("INT_TO_FP") ||
-				   flag.equals("FP_TO_FP"))// || (flag.equals("LoopFusion") && isLastFlag))
+				   flag.equals("FP_TO_FP") || flag.equals("FP_FMA"))// || (flag.equals("LoopFusion") && isLastFlag))
 					continue;
 				
 				setValues(flag, value1, value2);
@@ -80,6 +80,7 @@ public class CreateNewIntrinsicWizardPage extends WizardPage
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_add");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_sub");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_div");
+		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_fma");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_greater_than");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_less_than");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_equal");
@@ -87,6 +87,7 @@ public class ImportIntrinsicWizardPage extends WizardPage
 		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_to_fp");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("double_vote");
 		new TableItem(intrinsicTypes, SWT.NONE).setText("triple_vote");
+		new TableItem(intrinsicTypes, SWT.NONE).setText("fp_fma");
 		
 		intrinsicTypes.addSelectionListener(new SelectionListener()
 		{
@@ -47,10 +47,28 @@ public class LoCompilerFlagsWizardPage extends WizardPage
 		
 			//Add which flags are available and their values and descriptions.
 			optimizationSelector.addFlags("ArithmeticBalancing", null, null, new String[]{"Parallelizing optimization that converts chains of arithmetic operations into parallel arithmetic operations.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("BitWidthMinimization", null, null, new String[]{"Shrinks each operation and copy to the bits needed by the range of values it can take.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("BoundaryPadding", new String[]{"Border Mode"}, new String[]{"/* 1 = zero, 2 = clamp, 3 = mirror */"}, new String[]{"Streams two dimensional windowed inputs without their border padding and fills in the borders of the windows in the smart buffer.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("BranchOperatorSharing", null, null, new String[]{"When both sides of an if compute the same multiply or floating point operation, computes it once on the selected operands instead of computing both sides and selecting the result.", ""}, null, null, false, false);
 			optimizationSelector.addFlags("CopyReduction", null, null, new String[]{"Reschedules pipelined operations in an attempt to minimize registers created.", ""}, null, null, false, false);
 			//optimizationSelector.addFlags("CreateDataflowGraph", null, null, new String[]{"Generates a dataflow graph image of the component for analyzation.", ""}, null, null, true, false);
+			optimizationSelector.addFlags("DSPMapping", new String[]{"Multiplier Width A", "Multiplier Width B"}, new String[]{"/* Width in bits of the wide multiplier input, 25 by default */", "/* Width in bits of the narrow multiplier input, 18 by default */"}, new String[]{"Gives every multiply that fits in a DSP block, along with its pre-adder and accumulate, its own pipeline stage so the synthesis tool can absorb the registers into the DSP block.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT, OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("ElasticPipeline", null, null, new String[]{"Replaces the global pipeline stall of a system with ready/valid handshakes and a skid buffer between every pipeline stage.", ""}, null, null, false, false);
 			optimizationSelector.addFlags("FanoutTreeGeneration", new String[]{"Max Fanout"}, new String[]{"/* The maximum fanout of any value in the tree */"}, new String[]{"Guarantees that no variable will have a higher fanout than the specified max fanout.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("FusedMultiplyAdd", null, null, new String[]{"Replaces each floating point multiply that only feeds an add with a single fused multiply-add intrinsic, when one of the right size is in the database.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("GatherCacheLines", new String[]{"Cache Lines"}, new String[]{"/* The number of elements kept on chip for each gathered stream */"}, new String[]{"Keeps the most recently gathered elements of every indirectly indexed stream in a small direct mapped cache, and does not request them from memory again.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("LineBufferMaxWidth", new String[]{"Max Row Width"}, new String[]{"/* The longest row any input window will step across */"}, new String[]{"Allows smart buffers for two dimensional windows to keep the rows between the lines of the window in block ram when the row length is only known at run time.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("MaxBurstLength", new String[]{"Max Burst Length"}, new String[]{"/* The most elements requested by a single address */"}, new String[]{"Combines the contiguous address requests of every stream into bursts of up to the given number of elements.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
 			optimizationSelector.addFlags("MaximizePrecision", null, null, new String[]{"Temporary arithmetic results use maximum precision when enabled and possibly truncate at every step when not.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("ModuloScheduling", null, null, new String[]{"Shortens the pipeline stages that loop carried values span and throttles the input so that a new iteration only starts once the previous one has written them back.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("OperatorSharing", new String[]{"Cycles Per Result"}, new String[]{"/* The number of cycles between results of the datapath */"}, new String[]{"Lowers the throughput of the datapath to one result every N cycles, and shares multipliers between pipeline stages that are never active at the same time.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("OutputWriteCombining", new String[]{"Burst Length"}, new String[]{"/* The most elements a merged write request covers */"}, new String[]{"Merges the write requests of contiguous output stream elements into burst requests, so memory writes them back to back.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("ParallelSelects", null, null, new String[]{"Turns the chain of muxes that a switch statement or an if-else chain with exclusive conditions becomes into a balanced tree of muxes, whose depth grows with the log of the number of cases.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("PingPongBuffers", new String[]{"Bank Size"}, new String[]{"/* The number of elements in each bank */"}, new String[]{"Connects modules of a system through two banks of block ram instead of a stream, so the producer fills one bank while the consumer reads the other in any order.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("PipelineStageMerging", null, null, new String[]{"Merges neighboring pipeline stages whenever their combined delay still meets the desired clock period, reducing latency and pipeline registers.", ""}, null, null, false, false);
+			optimizationSelector.addFlags("Reassociation", new String[]{"Floating Point"}, new String[]{"/* 0 = integers only, 1 = also floating point */"}, new String[]{"Reorders chains of additions and subtractions so the operands that are ready last are added last.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("StreamPackingWidth", new String[]{"Bus Width"}, new String[]{"/* The width in bits of each stream's memory bus */"}, new String[]{"Packs as many elements of every stream as fit into each word of the memory bus, and unpacks and repacks them in the smart buffers.", ""}, new OptimizationValueType[]{OptimizationValueType.AMOUNT}, null, false, false);
+			optimizationSelector.addFlags("TimingReport", null, null, new String[]{"Writes the arrival time, required time and slack of every operation, and the chain of operations that sets the delay of each pipeline stage, to <name>_timing.txt and <name>_timing.json.", ""}, null, null, false, false);
 
 			//Give the preference that houses the default flags for this page.
 			optimizationSelector.setDefaultsPreference(PreferenceConstants.DEFAULT_LOW_OPTIMIZATIONS);
@@ -66,6 +66,7 @@ public class ViewIntrinsicsWizardPage extends WizardPage
 	final int FP_TO_FP_ROW = 14;
 	final int DOUBLE_VOTE_ROW = 15;
 	final int TRIPLE_VOTE_ROW = 16;
+	final int FP_FMA_ROW = 17;
 	
 	final int NAME_COLUMN = 0;
 	final int BITSIZE_COLUMN = 1;
@@ -132,6 +133,7 @@ public class ViewIntrinsicsWizardPage extends WizardPage
 		new TableItem(types, SWT.NONE).setText(new String("fp_to_fp"));
 		new TableItem(types, SWT.NONE).setText(new String("double_vote"));
 		new TableItem(types, SWT.NONE).setText(new String("triple_vote"));
+		new TableItem(types, SWT.NONE).setText(new String("fp_fma"));
 		
 		CompositeUtilities.setCompositeSize(parent, types, types.getItemHeight() * 7, types.getItemHeight() * 10);
 	}
@@ -490,6 +492,7 @@ public class ViewIntrinsicsWizardPage extends WizardPage
 		intrinsicValues.add(new Vector<String[]>());
 		intrinsicValues.add(new Vector<String[]>());
 		intrinsicValues.add(new Vector<String[]>());
+		intrinsicValues.add(new Vector<String[]>());
 		
 		String[][] components = DatabaseInterface.getComponentsOfType("INT_DIV");
 		for(int i = 0; i < components.length; ++i)
@@ -614,6 +617,13 @@ public class ViewIntrinsicsWizardPage extends WizardPage
 			String bitSize2 = DatabaseInterface.getBitSizeOfIntrinsic2(components[i][0]);
 			intrinsicValues.get(TRIPLE_VOTE_ROW).add(new String[]{components[i][0], bitSize2, bitSize2, components[i][1], components[i][2], components[i][3]});
 		}
+		
+		components = DatabaseInterface.getComponentsOfType("FP_FMA");
+		for(int i = 0; i < components.length; ++i)
+		{
+			String bitSize = DatabaseInterface.getBitSizeOfIntrinsic(components[i][0]);
+			intrinsicValues.get(FP_FMA_ROW).add(new String[]{components[i][0], bitSize, "NA", components[i][1], components[i][2], components[i][3]});
+		}
 	}
 	
 	private void updateIntrinsicTable()
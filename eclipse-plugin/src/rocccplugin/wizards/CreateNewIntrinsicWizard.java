@@ -106,6 +106,8 @@ public class CreateNewIntrinsicWizard extends Wizard implements INewWizard
 		
 		if(type.equals("int_div"))
 			ports = new String[]{"dividend", "divisor", "quotient"};
+		else if(type.equals("fp_fma"))
+			ports = new String[]{"a", "b", "c", "result"};
 		
 		String tab = "  ";
 		StringBuffer buffer = new StringBuffer();
@@ -160,6 +162,17 @@ public class CreateNewIntrinsicWizard extends Wizard implements INewWizard
 			buffer.append(tab + "//outputs\n");
 			buffer.append(tab + "ROCCC_int" + 1 + " " + ports[2] + "_out ;\n");
 		}
+		else if(type.equals("fp_fma"))
+		{
+			buffer.append("\n");
+			buffer.append("typedef struct\n{\n");
+			buffer.append(tab + "//inputs\n");
+			buffer.append(tab + "ROCCC_float" + bitSize + " " + ports[0] + "_in ;\n");
+			buffer.append(tab + "ROCCC_float" + bitSize + " " + ports[1] + "_in ;\n");
+			buffer.append(tab + "ROCCC_float" + bitSize + " " + ports[2] + "_in ;\n");
+			buffer.append(tab + "//outputs\n");
+			buffer.append(tab + "ROCCC_float" + bitSize + " " + ports[3] + "_out ;\n");
+		}
 		else if(type.startsWith("fp"))
 		{
 			buffer.append("\n");
@@ -56,7 +56,7 @@ public class ImportIntrinsicWizard extends Wizard implements INewWizard
 		type = sel == 0 ? "INT_DIV" : sel == 1 ? "INT_MOD" :  sel == 2 ? "FP_ADD" : sel == 3 ? "FP_SUB" : sel == 4 ? "FP_MUL" : 
 			  		  sel == 5 ? "FP_DIV"  : sel == 6 ? "FP_GREATER_THAN" : sel == 7 ? "FP_LESS_THAN" : sel == 8 ? "FP_EQUAL" :
 				      sel == 9 ? "FP_GREATER_THAN_EQUAL" : sel == 10 ? "FP_LESS_THAN_EQUAL" : sel == 11? "FP_NOT_EQUAL" : 
-				      sel == 12 ? "FP_TO_INT" : sel == 13? "INT_TO_FP" : sel == 14? "FP_TO_FP" : sel == 15? "DOUBLE_VOTE" : "TRIPLE_VOTE";
+				      sel == 12 ? "FP_TO_INT" : sel == 13? "INT_TO_FP" : sel == 14? "FP_TO_FP" : sel == 15? "DOUBLE_VOTE" : sel == 16? "TRIPLE_VOTE" : "FP_FMA";
 		
 		row = sel;
 		
@@ -106,7 +106,7 @@ public class ViewIntrinsicsWizard extends Wizard implements INewWizard
 				String type = i == 0 ? "INT_DIV" : i == 1 ? "INT_MOD" : i == 2 ? "FP_ADD" : i == 3 ? "FP_SUB" : i == 4 ? "FP_MUL" : 
 							  i == 5 ? "FP_DIV"  : i == 6 ? "FP_GREATER_THAN" : i == 7 ? "FP_LESS_THAN" : i == 8 ? "FP_EQUAL" :
 							  i == 9 ? "FP_GREATER_THAN_EQUAL" : i == 10 ? "FP_LESS_THAN_EQUAL" : i == 11? "FP_NOT_EQUAL" : 
-							  i == 12 ? "FP_TO_INT" : i == 13? "INT_TO_FP" : i == 14? "FP_TO_FP" : i == 15? "DOUBLE_VOTE" : "TRIPLE_VOTE";
+							  i == 12 ? "FP_TO_INT" : i == 13? "INT_TO_FP" : i == 14? "FP_TO_FP" : i == 15? "DOUBLE_VOTE" : i == 16? "TRIPLE_VOTE" : "FP_FMA";
 				
 				if(type.contains("VOTE"))
 					DatabaseInterface.addVoterIntrinsic(name, type, bitSize, delay, active, description);
@@ -0,0 +1,722 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+#include <cassert>
+#include <cstdlib>
+#include <sstream>
+#include <set>
+#include <map>
+
+#include <basicnodes/basic.h>
+#include <basicnodes/basic_factory.h>
+
+#include <suifnodes/suif.h>
+#include <suifnodes/suif_factory.h>
+
+#include <cfenodes/cfe.h>
+#include <cfenodes/cfe_factory.h>
+
+#include "roccc_utils/roccc2.0_utils.h"
+#include "roccc_utils/warning_utils.h"
+
+#include "arrayPartitioningPass.h"
+
+// The largest number of banks any array will be split into
+static const int MAX_BANKS = 16 ;
+
+// Arrays with more elements than this are never turned into registers
+static const int MAX_COMPLETE_ELEMENTS = 64 ;
+
+// Division and modulo that round toward negative infinity, so offsets
+//  below the start of a bank are handled correctly.
+static int FloorDivide(int a, int b)
+{
+  int q = a / b ;
+  if ((a % b != 0) && ((a < 0) != (b < 0)))
+  {
+    --q ;
+  }
+  return q ;
+}
+
+static int Modulo(int a, int b)
+{
+  int m = a % b ;
+  if (m < 0)
+  {
+    m += b ;
+  }
+  return m ;
+}
+
+static int LogBase2(int x)
+{
+  int log = 0 ;
+  while (x > 1)
+  {
+    x >>= 1 ;
+    ++log ;
+  }
+  return log ;
+}
+
+ArrayPartitioningPass::ArrayPartitioningPass(SuifEnv* pEnv) :
+  PipelinablePass(pEnv, "ArrayPartitioning")
+{
+  theEnv = pEnv ;
+  procDef = NULL ;
+}
+
+ArrayPartitioningPass::~ArrayPartitioningPass()
+{
+  ; // Nothing to delete yet
+}
+
+void ArrayPartitioningPass::do_procedure_definition(ProcedureDefinition* p)
+{
+  procDef = p ;
+  assert(procDef != NULL) ;
+
+  if (isLegacy(procDef))
+  {
+    return ;
+  }
+
+  OutputInformation("Array Partitioning pass begins") ;
+
+  // Collect the lookup tables first, as partitioning changes the symbol table
+  list<VariableSymbol*> candidates ;
+  SymbolTable* symTab = procDef->get_symbol_table() ;
+  for (int i = 0 ; i < symTab->get_symbol_table_object_count() ; ++i)
+  {
+    VariableSymbol* currentVar =
+      dynamic_cast<VariableSymbol*>(symTab->get_symbol_table_object(i)) ;
+    if (currentVar != NULL && IsCandidate(currentVar))
+    {
+      candidates.push_back(currentVar) ;
+    }
+  }
+
+  list<VariableSymbol*>::iterator candIter = candidates.begin() ;
+  while (candIter != candidates.end())
+  {
+    PartitionArray(*candIter) ;
+    ++candIter ;
+  }
+
+  OutputInformation("Array Partitioning pass ends") ;
+}
+
+bool ArrayPartitioningPass::IsCandidate(VariableSymbol* v)
+{
+  assert(v != NULL) ;
+  if (!IsLookupTable(v) || GetDimensionality(v) != 1)
+  {
+    return false ;
+  }
+
+  // The initial values of a table cannot be split, so only arrays
+  //  without a definition are partitioned.
+  DefinitionBlock* procDefBlock = procDef->get_definition_block() ;
+  assert(procDefBlock != NULL) ;
+  Iter<VariableDefinition*> varDefIter =
+    procDefBlock->get_variable_definition_iterator() ;
+  while (varDefIter.is_valid())
+  {
+    if (varDefIter.current()->get_variable_symbol() == v)
+    {
+      return false ;
+    }
+    varDefIter.next() ;
+  }
+  return true ;
+}
+
+// Subscripts must be either a constant, the index variable, or the
+//  index variable plus or minus a constant.
+bool ArrayPartitioningPass::ParseSubscript(Expression* e,
+					   VariableSymbol*& index,
+					   int& offset)
+{
+  index = NULL ;
+  offset = 0 ;
+
+  if (dynamic_cast<IntConstant*>(e) != NULL)
+  {
+    offset = dynamic_cast<IntConstant*>(e)->get_value().c_int() ;
+    return true ;
+  }
+  if (dynamic_cast<LoadVariableExpression*>(e) != NULL)
+  {
+    index = dynamic_cast<LoadVariableExpression*>(e)->get_source() ;
+    return true ;
+  }
+
+  BinaryExpression* binExp = dynamic_cast<BinaryExpression*>(e) ;
+  if (binExp == NULL)
+  {
+    return false ;
+  }
+  LString opcode = binExp->get_opcode() ;
+  if (opcode != LString("add") && opcode != LString("subtract"))
+  {
+    return false ;
+  }
+
+  LoadVariableExpression* leftVar =
+    dynamic_cast<LoadVariableExpression*>(binExp->get_source1()) ;
+  LoadVariableExpression* rightVar =
+    dynamic_cast<LoadVariableExpression*>(binExp->get_source2()) ;
+  IntConstant* leftConst = dynamic_cast<IntConstant*>(binExp->get_source1()) ;
+  IntConstant* rightConst = dynamic_cast<IntConstant*>(binExp->get_source2());
+
+  if (leftVar != NULL && rightConst != NULL)
+  {
+    index = leftVar->get_source() ;
+    offset = rightConst->get_value().c_int() ;
+    if (opcode == LString("subtract"))
+    {
+      offset = -offset ;
+    }
+    return true ;
+  }
+  if (leftConst != NULL && rightVar != NULL && opcode == LString("add"))
+  {
+    index = rightVar->get_source() ;
+    offset = leftConst->get_value().c_int() ;
+    return true ;
+  }
+  return false ;
+}
+
+bool ArrayPartitioningPass::CollectAccesses(VariableSymbol* v,
+					    list<PartitionedAccess>& accesses)
+{
+  ArrayType* arrayType = dynamic_cast<ArrayType*>(v->get_type()->get_base_type());
+  assert(arrayType != NULL) ;
+  int elementSize =
+    GetQualifiedTypeOfElement(v)->get_base_type()->get_bit_size().c_int() ;
+  int elements = arrayType->get_bit_size().c_int() / elementSize ;
+
+  list<ArrayReferenceExpression*>* allRefs =
+    collect_objects<ArrayReferenceExpression>(procDef->get_body()) ;
+  list<ArrayReferenceExpression*>::iterator refIter = allRefs->begin() ;
+  bool valid = true ;
+  while (refIter != allRefs->end() && valid)
+  {
+    if (GetArrayVariable(*refIter) == v)
+    {
+      LoadExpression* parentLoad =
+	dynamic_cast<LoadExpression*>((*refIter)->get_parent()) ;
+      StoreStatement* parentStore =
+	dynamic_cast<StoreStatement*>((*refIter)->get_parent()) ;
+      bool isLoad = (parentLoad != NULL &&
+		     parentLoad->get_source_address() == (*refIter)) ;
+      bool isStore = (parentStore != NULL &&
+		      parentStore->get_destination_address() == (*refIter)) ;
+
+      PartitionedAccess nextAccess ;
+      nextAccess.ref = (*refIter) ;
+      if ((!isLoad && !isStore) ||
+	  dynamic_cast<SymbolAddressExpression*>((*refIter)->get_base_array_address()) == NULL ||
+	  !ParseSubscript((*refIter)->get_index(),
+			  nextAccess.index,
+			  nextAccess.offset))
+      {
+	valid = false ;
+      }
+      else if (nextAccess.index == NULL &&
+	       (nextAccess.offset < 0 || nextAccess.offset >= elements))
+      {
+	valid = false ;
+      }
+      else
+      {
+	accesses.push_back(nextAccess) ;
+      }
+    }
+    ++refIter ;
+  }
+  delete allRefs ;
+
+  if (!valid)
+  {
+    return false ;
+  }
+
+  // The array must not be used anywhere other than these accesses
+  int addressCount = 0 ;
+  list<SymbolAddressExpression*>* allAddresses =
+    collect_objects<SymbolAddressExpression>(procDef->get_body()) ;
+  list<SymbolAddressExpression*>::iterator addrIter = allAddresses->begin() ;
+  while (addrIter != allAddresses->end())
+  {
+    if ((*addrIter)->get_addressed_symbol() == v)
+    {
+      ++addressCount ;
+    }
+    ++addrIter ;
+  }
+  delete allAddresses ;
+
+  list<LoadVariableExpression*>* allLoadVars =
+    collect_objects<LoadVariableExpression>(procDef->get_body()) ;
+  list<LoadVariableExpression*>::iterator loadVarIter = allLoadVars->begin() ;
+  while (loadVarIter != allLoadVars->end())
+  {
+    if ((*loadVarIter)->get_source() == v)
+    {
+      valid = false ;
+    }
+    ++loadVarIter ;
+  }
+  delete allLoadVars ;
+
+  return valid && addressCount == (int)accesses.size() ;
+}
+
+// Find the closest enclosing loop that steps the index variable
+CForStatement* ArrayPartitioningPass::FindLoop(VariableSymbol* index,
+					       SuifObject* child)
+{
+  SuifObject* currentParent = child->get_parent() ;
+  while (currentParent != NULL)
+  {
+    CForStatement* c = dynamic_cast<CForStatement*>(currentParent) ;
+    if (c != NULL)
+    {
+      StoreVariableStatement* storeStep =
+	dynamic_cast<StoreVariableStatement*>(c->get_step()) ;
+      if (storeStep != NULL && storeStep->get_destination() == index)
+      {
+	return c ;
+      }
+    }
+    currentParent = currentParent->get_parent() ;
+  }
+  return NULL ;
+}
+
+// The lower bound and step must be constants.  The upper bound is only
+//  required for block partitioning, and is the last value the index
+//  actually takes.
+bool ArrayPartitioningPass::GetLoopBounds(CForStatement* c,
+					  VariableSymbol* index,
+					  int& lower, int& upper,
+					  bool& upperKnown, int& step)
+{
+  assert(c != NULL) ;
+
+  StoreVariableStatement* storeBefore =
+    dynamic_cast<StoreVariableStatement*>(c->get_before()) ;
+  if (storeBefore == NULL || storeBefore->get_destination() != index ||
+      dynamic_cast<IntConstant*>(storeBefore->get_value()) == NULL)
+  {
+    return false ;
+  }
+  lower =
+    dynamic_cast<IntConstant*>(storeBefore->get_value())->get_value().c_int();
+
+  StoreVariableStatement* storeStep =
+    dynamic_cast<StoreVariableStatement*>(c->get_step()) ;
+  assert(storeStep != NULL) ;
+  BinaryExpression* increment =
+    dynamic_cast<BinaryExpression*>(storeStep->get_value()) ;
+  if (increment == NULL || increment->get_opcode() != LString("add"))
+  {
+    return false ;
+  }
+  VariableSymbol* stepIndex = NULL ;
+  if (!ParseSubscript(increment, stepIndex, step) || stepIndex != index ||
+      step <= 0)
+  {
+    return false ;
+  }
+
+  upperKnown = false ;
+  BinaryExpression* test = dynamic_cast<BinaryExpression*>(c->get_test()) ;
+  if (test != NULL)
+  {
+    LoadVariableExpression* testVar =
+      dynamic_cast<LoadVariableExpression*>(test->get_source1()) ;
+    IntConstant* testBound = dynamic_cast<IntConstant*>(test->get_source2()) ;
+    if (testVar != NULL && testVar->get_source() == index &&
+	testBound != NULL)
+    {
+      if (test->get_opcode() == LString("is_less_than"))
+      {
+	upper = testBound->get_value().c_int() - 1 ;
+	upperKnown = true ;
+      }
+      else if (test->get_opcode() == LString("is_less_than_or_equal_to"))
+      {
+	upper = testBound->get_value().c_int() ;
+	upperKnown = true ;
+      }
+    }
+  }
+  if (upperKnown)
+  {
+    if (upper < lower)
+    {
+      upper = lower ;
+    }
+    upper = lower + ((upper - lower) / step) * step ;
+  }
+  return true ;
+}
+
+int ArrayPartitioningPass::GetBank(PartitionMode mode, int banks,
+				   int elements, int lower,
+				   PartitionedAccess& a)
+{
+  int first = (a.index == NULL) ? a.offset : lower + a.offset ;
+  if (mode == CYCLIC)
+  {
+    return Modulo(first, banks) ;
+  }
+  assert(mode == BLOCK) ;
+  return FloorDivide(first, elements / banks) ;
+}
+
+// For constant subscripts this is the position in the bank.  Otherwise it
+//  is the constant that is added to the (possibly shifted) index.
+int ArrayPartitioningPass::GetPosition(PartitionMode mode, int banks,
+				       int elements, int lower,
+				       PartitionedAccess& a)
+{
+  if (mode == CYCLIC)
+  {
+    if (a.index == NULL)
+    {
+      return a.offset / banks ;
+    }
+    return FloorDivide(Modulo(lower, banks) + a.offset, banks) ;
+  }
+  assert(mode == BLOCK) ;
+  int blockSize = elements / banks ;
+  return a.offset - GetBank(mode, banks, elements, lower, a) * blockSize ;
+}
+
+int ArrayPartitioningPass::CountBanksUsed(PartitionMode mode, int banks,
+					  int elements, int lower,
+					  list<PartitionedAccess>& accesses)
+{
+  std::set<int> used ;
+  list<PartitionedAccess>::iterator accessIter = accesses.begin() ;
+  while (accessIter != accesses.end())
+  {
+    used.insert(GetBank(mode, banks, elements, lower, *accessIter)) ;
+    ++accessIter ;
+  }
+  return used.size() ;
+}
+
+// Every access has to stay inside of one block for the whole loop
+bool ArrayPartitioningPass::FitsInBlocks(int banks, int elements,
+					 int lower, int upper,
+					 list<PartitionedAccess>& accesses)
+{
+  int blockSize = elements / banks ;
+  list<PartitionedAccess>::iterator accessIter = accesses.begin() ;
+  while (accessIter != accesses.end())
+  {
+    if ((*accessIter).index != NULL)
+    {
+      int firstBlock = FloorDivide(lower + (*accessIter).offset, blockSize) ;
+      int lastBlock = FloorDivide(upper + (*accessIter).offset, blockSize) ;
+      if (firstBlock != lastBlock || firstBlock < 0 || firstBlock >= banks)
+      {
+	return false ;
+      }
+    }
+    ++accessIter ;
+  }
+  return true ;
+}
+
+VariableSymbol* ArrayPartitioningPass::CreateBank(VariableSymbol* v,
+						  int bank, int elements)
+{
+  ArrayType* originalType =
+    dynamic_cast<ArrayType*>(v->get_type()->get_base_type()) ;
+  assert(originalType != NULL) ;
+  QualifiedType* elementType = originalType->get_element_type() ;
+  int elementSize = elementType->get_base_type()->get_bit_size().c_int() ;
+
+  ArrayType* bankType =
+    create_array_type(theEnv,
+		      IInteger(elements * elementSize),
+		      0, // bit alignment
+		      elementType,
+		      create_int_constant(theEnv, GetBaseInt(theEnv),
+					  IInteger(0)),
+		      create_int_constant(theEnv, GetBaseInt(theEnv),
+					  IInteger(elements - 1)),
+		      TempName(originalType->get_name())) ;
+  procDef->get_symbol_table()->append_symbol_table_object(bankType) ;
+
+  LString bankName = v->get_name() ;
+  bankName = bankName + "_bank" ;
+  bankName = bankName + LString(bank) ;
+
+  VariableSymbol* bankSymbol =
+    create_variable_symbol(theEnv,
+			   create_qualified_type(theEnv,
+						 bankType,
+						 TempName(LString("qualType"))),
+			   bankName) ;
+  bankSymbol->append_annote(create_brick_annote(theEnv, "LUT")) ;
+  procDef->get_symbol_table()->append_symbol_table_object(bankSymbol) ;
+  return bankSymbol ;
+}
+
+Expression* ArrayPartitioningPass::CreateOffsetExpression(Expression* base,
+							  int offset)
+{
+  if (offset == 0)
+  {
+    return base ;
+  }
+  IntConstant* offsetConst =
+    create_int_constant(theEnv, GetBaseInt(theEnv), IInteger(abs(offset))) ;
+  return create_binary_expression(theEnv,
+				  base->get_result_type(),
+				  offset > 0 ? LString("add") : LString("subtract"),
+				  base,
+				  offsetConst) ;
+}
+
+// Every element is accessed with a constant, so each one becomes a
+//  separate variable.
+void ArrayPartitioningPass::PartitionCompletely(VariableSymbol* v,
+					      list<PartitionedAccess>& accesses)
+{
+  std::map<int, VariableSymbol*> elementVars ;
+  list<PartitionedAccess>::iterator accessIter = accesses.begin() ;
+  while (accessIter != accesses.end())
+  {
+    int offset = (*accessIter).offset ;
+    if (elementVars.find(offset) == elementVars.end())
+    {
+      LString elementName = v->get_name() ;
+      elementName = elementName + "_" ;
+      elementName = elementName + LString(offset) ;
+      elementName = elementName + "_" ;
+      VariableSymbol* elementVar =
+	create_variable_symbol(theEnv,
+			       GetQualifiedTypeOfElement(v),
+			       TempName(elementName)) ;
+      procDef->get_symbol_table()->append_symbol_table_object(elementVar) ;
+      elementVars[offset] = elementVar ;
+    }
+    VariableSymbol* elementVar = elementVars[offset] ;
+
+    ArrayReferenceExpression* ref = (*accessIter).ref ;
+    LoadExpression* parentLoad = dynamic_cast<LoadExpression*>(ref->get_parent());
+    StoreStatement* parentStore =
+      dynamic_cast<StoreStatement*>(ref->get_parent()) ;
+    if (parentLoad != NULL)
+    {
+      LoadVariableExpression* replacement =
+	create_load_variable_expression(theEnv,
+					parentLoad->get_result_type(),
+					elementVar) ;
+      parentLoad->get_parent()->replace(parentLoad, replacement) ;
+    }
+    else
+    {
+      assert(parentStore != NULL) ;
+      Expression* value = parentStore->get_value() ;
+      value->set_parent(NULL) ;
+      StoreVariableStatement* replacement =
+	create_store_variable_statement(theEnv, elementVar, value) ;
+      parentStore->get_parent()->replace(parentStore, replacement) ;
+    }
+    ++accessIter ;
+  }
+}
+
+void ArrayPartitioningPass::PartitionIntoBanks(VariableSymbol* v,
+					     list<PartitionedAccess>& accesses,
+					     PartitionMode mode, int banks,
+					     int lower)
+{
+  ArrayType* arrayType = dynamic_cast<ArrayType*>(v->get_type()->get_base_type());
+  assert(arrayType != NULL) ;
+  int elementSize =
+    GetQualifiedTypeOfElement(v)->get_base_type()->get_bit_size().c_int() ;
+  int elements = arrayType->get_bit_size().c_int() / elementSize ;
+
+  std::map<int, VariableSymbol*> bankVars ;
+  list<PartitionedAccess>::iterator accessIter = accesses.begin() ;
+  while (accessIter != accesses.end())
+  {
+    int bank = GetBank(mode, banks, elements, lower, *accessIter) ;
+    int position = GetPosition(mode, banks, elements, lower, *accessIter) ;
+    if (bankVars.find(bank) == bankVars.end())
+    {
+      bankVars[bank] = CreateBank(v, bank, elements / banks) ;
+    }
+    VariableSymbol* bankVar = bankVars[bank] ;
+
+    ArrayReferenceExpression* ref = (*accessIter).ref ;
+    Expression* oldIndex = ref->get_index() ;
+    Expression* newIndex = NULL ;
+    if ((*accessIter).index == NULL)
+    {
+      newIndex = create_int_constant(theEnv, oldIndex->get_result_type(),
+				     IInteger(position)) ;
+    }
+    else
+    {
+      VariableSymbol* index = (*accessIter).index ;
+      Expression* base =
+	create_load_variable_expression(theEnv,
+					index->get_type()->get_base_type(),
+					index) ;
+      if (mode == CYCLIC)
+      {
+	IntConstant* shift =
+	  create_int_constant(theEnv, GetBaseInt(theEnv),
+			      IInteger(LogBase2(banks))) ;
+	base = create_binary_expression(theEnv,
+					base->get_result_type(),
+					LString("right_shift"),
+					base,
+					shift) ;
+      }
+      newIndex = CreateOffsetExpression(base, position) ;
+    }
+    oldIndex->set_parent(NULL) ;
+    ref->set_index(newIndex) ;
+    delete oldIndex ;
+
+    SymbolAddressExpression* oldAddress =
+      dynamic_cast<SymbolAddressExpression*>(ref->get_base_array_address()) ;
+    assert(oldAddress != NULL) ;
+    oldAddress->set_parent(NULL) ;
+    ref->set_base_array_address(create_symbol_address_expression(theEnv,
+				   bankVar->get_type()->get_base_type(),
+				   bankVar)) ;
+    delete oldAddress ;
+
+    ++accessIter ;
+  }
+}
+
+void ArrayPartitioningPass::PartitionArray(VariableSymbol* v)
+{
+  list<PartitionedAccess> accesses ;
+  if (!CollectAccesses(v, accesses) || accesses.empty())
+  {
+    return ;
+  }
+
+  ArrayType* arrayType = dynamic_cast<ArrayType*>(v->get_type()->get_base_type());
+  assert(arrayType != NULL) ;
+  int elementSize =
+    GetQualifiedTypeOfElement(v)->get_base_type()->get_bit_size().c_int() ;
+  int elements = arrayType->get_bit_size().c_int() / elementSize ;
+
+  // All of the non-constant subscripts must use the same loop index
+  VariableSymbol* index = NULL ;
+  CForStatement* loop = NULL ;
+  std::set<std::pair<VariableSymbol*, int> > subscripts ;
+  list<PartitionedAccess>::iterator accessIter = accesses.begin() ;
+  while (accessIter != accesses.end())
+  {
+    subscripts.insert(std::pair<VariableSymbol*, int>((*accessIter).index,
+						      (*accessIter).offset)) ;
+    if ((*accessIter).index != NULL)
+    {
+      CForStatement* currentLoop =
+	FindLoop((*accessIter).index, (*accessIter).ref) ;
+      if (currentLoop == NULL ||
+	  (index != NULL && (index != (*accessIter).index ||
+			     loop != currentLoop)))
+      {
+	return ;
+      }
+      index = (*accessIter).index ;
+      loop = currentLoop ;
+    }
+    ++accessIter ;
+  }
+
+  std::stringstream info ;
+  info << "Array " << v->get_name() << ": " ;
+
+  if (index == NULL && elements <= MAX_COMPLETE_ELEMENTS)
+  {
+    PartitionCompletely(v, accesses) ;
+    procDef->get_symbol_table()->remove_symbol_table_object(v) ;
+    info << "completely partitioned into registers" ;
+    OutputInformation(info.str().c_str()) ;
+    return ;
+  }
+
+  // Partitioning only helps if different subscripts exist
+  if (subscripts.size() < 2)
+  {
+    return ;
+  }
+
+  int lower = 0 ;
+  int upper = 0 ;
+  int step = 0 ;
+  bool upperKnown = false ;
+  if (loop != NULL &&
+      !GetLoopBounds(loop, index, lower, upper, upperKnown, step))
+  {
+    return ;
+  }
+
+  PartitionMode bestMode = NONE ;
+  int bestBanks = 0 ;
+  int bestUsed = 1 ;
+  for (int banks = 2 ;
+       banks <= MAX_BANKS && banks <= elements &&
+	 bestUsed < (int)subscripts.size() ;
+       banks *= 2)
+  {
+    if (elements % banks != 0)
+    {
+      continue ;
+    }
+    if (index == NULL || (step % banks == 0 && lower >= 0))
+    {
+      int used = CountBanksUsed(CYCLIC, banks, elements, lower, accesses) ;
+      if (used > bestUsed)
+      {
+	bestMode = CYCLIC ;
+	bestBanks = banks ;
+	bestUsed = used ;
+      }
+    }
+    if ((index == NULL || upperKnown) &&
+	FitsInBlocks(banks, elements, lower, upper, accesses))
+    {
+      int used = CountBanksUsed(BLOCK, banks, elements, lower, accesses) ;
+      if (used > bestUsed)
+      {
+	bestMode = BLOCK ;
+	bestBanks = banks ;
+	bestUsed = used ;
+      }
+    }
+  }
+
+  if (bestMode == NONE)
+  {
+    return ;
+  }
+
+  PartitionIntoBanks(v, accesses, bestMode, bestBanks, lower) ;
+  procDef->get_symbol_table()->remove_symbol_table_object(v) ;
+
+  info << (bestMode == CYCLIC ? "cyclic" : "block") << " partitioned into "
+       << bestBanks << " banks (" << bestUsed << " used)" ;
+  OutputInformation(info.str().c_str()) ;
+}
@@ -0,0 +1,95 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+  The purpose of this pass is to split internal arrays (lookup tables) into
+   several independent banks so that the accesses of an unrolled loop body
+   no longer have to share a single memory.
+
+  Each subscript is analyzed as either a constant or the loop index plus a
+   constant offset.  Three partitionings are considered:
+
+   Complete - Every access uses a constant subscript, so each element
+               becomes its own scalar register.
+   Cyclic   - Element e is placed in bank (e mod B) at position (e / B).
+               This is chosen when the loop step is a multiple of B, which
+               is exactly the case after the loop has been unrolled B times.
+   Block    - Element e is placed in bank (e / S) at position (e mod S),
+               where S is the number of elements divided by B.  This
+               requires constant loop bounds so that every access can be
+               shown to stay in a single block.
+
+  The partitioning that puts the most distinct subscripts into separate banks
+   is chosen.  Each bank is a new array marked as a lookup table, so the
+   lookup table transformation gives it its own reads and writes and the
+   Lo-CIRRF creates a separate memory for each bank.
+
+  Arrays with an initialization, arrays passed as a whole, and arrays with
+   more than one dimension are left alone.
+
+  This pass must run after lookup table identification and before the
+   lookup table transformation.
+*/
+
+#ifndef ARRAY_PARTITIONING_PASS_DOT_H
+#define ARRAY_PARTITIONING_PASS_DOT_H
+
+#include <suifpasses/suifpasses.h>
+#include <suifnodes/suif.h>
+#include <cfenodes/cfe.h>
+
+// Each access is described as (index + offset), where the index is NULL
+//  for constant subscripts.
+class PartitionedAccess
+{
+ public:
+  ArrayReferenceExpression* ref ;
+  VariableSymbol* index ;
+  int offset ;
+} ;
+
+class ArrayPartitioningPass : public PipelinablePass
+{
+ private:
+  SuifEnv* theEnv ;
+  ProcedureDefinition* procDef ;
+
+  enum PartitionMode { NONE, COMPLETE, CYCLIC, BLOCK } ;
+
+  bool IsCandidate(VariableSymbol* v) ;
+  bool CollectAccesses(VariableSymbol* v, list<PartitionedAccess>& accesses);
+  bool ParseSubscript(Expression* e, VariableSymbol*& index, int& offset) ;
+
+  CForStatement* FindLoop(VariableSymbol* index, SuifObject* child) ;
+  bool GetLoopBounds(CForStatement* c, VariableSymbol* index,
+		     int& lower, int& upper, bool& upperKnown, int& step) ;
+
+  int GetBank(PartitionMode mode, int banks, int elements, int lower,
+	      PartitionedAccess& a) ;
+  int GetPosition(PartitionMode mode, int banks, int elements, int lower,
+		  PartitionedAccess& a) ;
+  int CountBanksUsed(PartitionMode mode, int banks, int elements, int lower,
+		     list<PartitionedAccess>& accesses) ;
+  bool FitsInBlocks(int banks, int elements, int lower, int upper,
+		    list<PartitionedAccess>& accesses) ;
+
+  VariableSymbol* CreateBank(VariableSymbol* v, int bank, int elements) ;
+  Expression* CreateOffsetExpression(Expression* base, int offset) ;
+
+  void PartitionCompletely(VariableSymbol* v,
+			   list<PartitionedAccess>& accesses) ;
+  void PartitionIntoBanks(VariableSymbol* v,
+			  list<PartitionedAccess>& accesses,
+			  PartitionMode mode, int banks, int lower) ;
+
+  void PartitionArray(VariableSymbol* v) ;
+
+ public:
+  ArrayPartitioningPass(SuifEnv* pEnv) ;
+  ~ArrayPartitioningPass() ;
+  Module* clone() const { return (Module*) this ; }
+  void do_procedure_definition(ProcedureDefinition* p) ;
+} ;
+
+#endif
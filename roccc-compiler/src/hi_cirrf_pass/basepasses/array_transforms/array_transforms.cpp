@@ -17,6 +17,7 @@
 #include "constantArrayPropagationPass.h"
 #include "lutDetectionPass.h"
 #include "lutTransformationPass.h"
+#include "arrayPartitioningPass.h"
 
 extern "C" void init_suifnodes(SuifEnv *);
 extern "C" void init_cfenodes(SuifEnv *);
@@ -39,4 +40,5 @@ extern "C" void init_array_transforms( SuifEnv* suif_env )
   module_subsystem->register_module( new ConstantArrayPropagationPass(suif_env));
   module_subsystem->register_module(new LUTDetectionPass(suif_env)) ;
   module_subsystem->register_module(new LUTTransformationPass(suif_env)) ;
+  module_subsystem->register_module(new ArrayPartitioningPass(suif_env)) ;
 }
@@ -1,7 +1,12 @@
 
 #include <cassert>
+#include <algorithm>
+#include <sstream>
+#include <vector>
+#include <set>
 
 #include <suifkernel/utilities.h>
+#include <suifkernel/command_line_parsing.h>
 #include <basicnodes/basic.h>
 #include <basicnodes/basic_factory.h>
 #include <suifnodes/suif.h>
@@ -12,11 +17,25 @@
 
 #include "scalar_replacement_pass2.h"
 
+// The number of bits in one block ram
+static const int BRAM_BITS = 18432 ;
+
+// Groups that save the most memory reads for each register they add
+//  are kept first.
+static bool MoreProfitable(const ReuseGroup& a, const ReuseGroup& b)
+{
+  double aSaved = a.registerReused + a.lineReused ;
+  double bSaved = b.registerReused + b.lineReused ;
+  return aSaved * (b.registerBits + 1) > bSaved * (a.registerBits + 1) ;
+}
+
 ScalarReplacementPass2::ScalarReplacementPass2(SuifEnv* pEnv) :
   PipelinablePass(pEnv, "ScalarReplacementPass2")
 {
   theEnv = pEnv ;
   procDef = NULL ;
+  registerBudget = 0 ;
+  bramBudget = 0 ;
 }
 
 ScalarReplacementPass2::~ScalarReplacementPass2()
@@ -24,6 +43,19 @@ ScalarReplacementPass2::~ScalarReplacementPass2()
   ; // Nothing to delete yet
 }
 
+void ScalarReplacementPass2::initialize()
+{
+  PipelinablePass::initialize() ;
+  _command_line->set_description("Replaces stream accesses with scalars") ;
+  OptionInt* registerOption = new OptionInt("RegisterBudget", 
+					    &registerBudget) ;
+  OptionInt* bramOption = new OptionInt("BramBudget", &bramBudget) ;
+  OptionList* arguments = new OptionList() ;
+  arguments->add(registerOption) ;
+  arguments->add(bramOption) ;
+  _command_line->add(arguments) ;
+}
+
 void ScalarReplacementPass2::do_procedure_definition(ProcedureDefinition* p)
 {
   procDef = p ;
@@ -34,6 +66,10 @@ void ScalarReplacementPass2::do_procedure_definition(ProcedureDefinition* p)
   VerifyArrayReferences() ;
   CollectArrayReferences() ;
 
+  AnalyzeReuse() ;
+  SelectReuse() ;
+  ReportReuse() ;
+
   ProcessLoads() ;
   ProcessStores() ;
 
@@ -367,3 +403,441 @@ void ScalarReplacementPass2::AppendStores()
     ++storeIter ;
   }
 }
+
+bool ScalarReplacementPass2::ParseSubscript(Expression* e,
+					    VariableSymbol*& index,
+					    int& offset)
+{
+  index = NULL ;
+  offset = 0 ;
+
+  if (dynamic_cast<NonLvalueExpression*>(e) != NULL)
+  {
+    e = dynamic_cast<NonLvalueExpression*>(e)->get_addressed_expression() ;
+  }
+  if (dynamic_cast<IntConstant*>(e) != NULL)
+  {
+    offset = dynamic_cast<IntConstant*>(e)->get_value().c_int() ;
+    return true ;
+  }
+  if (dynamic_cast<LoadVariableExpression*>(e) != NULL)
+  {
+    index = dynamic_cast<LoadVariableExpression*>(e)->get_source() ;
+    return true ;
+  }
+
+  BinaryExpression* binExp = dynamic_cast<BinaryExpression*>(e) ;
+  if (binExp == NULL)
+  {
+    return false ;
+  }
+  LString opcode = binExp->get_opcode() ;
+  if (opcode != LString("add") && opcode != LString("subtract"))
+  {
+    return false ;
+  }
+
+  LoadVariableExpression* leftVar =
+    dynamic_cast<LoadVariableExpression*>(binExp->get_source1()) ;
+  LoadVariableExpression* rightVar =
+    dynamic_cast<LoadVariableExpression*>(binExp->get_source2()) ;
+  IntConstant* leftConst = dynamic_cast<IntConstant*>(binExp->get_source1()) ;
+  IntConstant* rightConst = dynamic_cast<IntConstant*>(binExp->get_source2());
+
+  if (leftVar != NULL && rightConst != NULL)
+  {
+    index = leftVar->get_source() ;
+    offset = rightConst->get_value().c_int() ;
+    if (opcode == LString("subtract"))
+    {
+      offset = -offset ;
+    }
+    return true ;
+  }
+  if (leftConst != NULL && rightVar != NULL && opcode == LString("add"))
+  {
+    index = rightVar->get_source() ;
+    offset = leftConst->get_value().c_int() ;
+    return true ;
+  }
+  return false ;
+}
+
+// The topmost array reference holds the innermost dimension, so the
+//  subscripts are collected from the inside out and returned outermost
+//  dimension first.
+bool ScalarReplacementPass2::ParseOffsets(ArrayReferenceExpression* a,
+					  std::vector<VariableSymbol*>& indicies,
+					  std::vector<int>& offsets)
+{
+  while (a != NULL)
+  {
+    VariableSymbol* index = NULL ;
+    int offset = 0 ;
+    if (!ParseSubscript(a->get_index(), index, offset))
+    {
+      return false ;
+    }
+    indicies.push_back(index) ;
+    offsets.push_back(offset) ;
+    a = dynamic_cast<ArrayReferenceExpression*>(a->get_base_array_address()) ;
+  }
+  std::reverse(indicies.begin(), indicies.end()) ;
+  std::reverse(offsets.begin(), offsets.end()) ;
+  return true ;
+}
+
+bool ScalarReplacementPass2::GetInnermostStep(CForStatement* c,
+					      VariableSymbol*& index,
+					      int& step)
+{
+  assert(c != NULL) ;
+  StoreVariableStatement* storeStep =
+    dynamic_cast<StoreVariableStatement*>(c->get_step()) ;
+  if (storeStep == NULL)
+  {
+    return false ;
+  }
+  VariableSymbol* stepIndex = NULL ;
+  if (!ParseSubscript(storeStep->get_value(), stepIndex, step) ||
+      stepIndex != storeStep->get_destination() || step == 0)
+  {
+    return false ;
+  }
+  index = stepIndex ;
+  return true ;
+}
+
+// The number of elements of one row a line buffer has to hold, which is
+//  only known when the innermost loop has constant bounds.  Returns -1
+//  otherwise.
+int ScalarReplacementPass2::GetRowLength(CForStatement* c, 
+					 VariableSymbol* index,
+					 int span)
+{
+  assert(c != NULL) ;
+  StoreVariableStatement* storeBefore =
+    dynamic_cast<StoreVariableStatement*>(c->get_before()) ;
+  if (storeBefore == NULL || storeBefore->get_destination() != index ||
+      dynamic_cast<IntConstant*>(storeBefore->get_value()) == NULL)
+  {
+    return -1 ;
+  }
+  int lower =
+    dynamic_cast<IntConstant*>(storeBefore->get_value())->get_value().c_int();
+
+  BinaryExpression* test = dynamic_cast<BinaryExpression*>(c->get_test()) ;
+  if (test == NULL)
+  {
+    return -1 ;
+  }
+  LoadVariableExpression* testVar =
+    dynamic_cast<LoadVariableExpression*>(test->get_source1()) ;
+  IntConstant* testBound = dynamic_cast<IntConstant*>(test->get_source2()) ;
+  if (testVar == NULL || testVar->get_source() != index || testBound == NULL)
+  {
+    return -1 ;
+  }
+  int upper = testBound->get_value().c_int() ;
+  if (test->get_opcode() == LString("is_less_than"))
+  {
+    upper = upper - 1 ;
+  }
+  else if (test->get_opcode() != LString("is_less_than_or_equal_to"))
+  {
+    return -1 ;
+  }
+  if (upper < lower)
+  {
+    upper = lower ;
+  }
+  return (upper - lower) + span ;
+}
+
+// Reuse is only carried across the iterations of the innermost loop, which
+//  is where the smart buffer slides its window.  Modules have no loop and
+//  nothing to analyze.
+void ScalarReplacementPass2::AnalyzeReuse()
+{
+  assert(procDef != NULL) ;
+  reuseGroups.clear() ;
+  CForStatement* innermost = InnermostLoop(procDef) ;
+  if (innermost == NULL)
+  {
+    return ;
+  }
+
+  std::set<VariableSymbol*> analyzed ;
+  list<std::pair<Expression*, VariableSymbol*> >::iterator loadIter = 
+    IdentifiedLoads.begin() ;
+  while (loadIter != IdentifiedLoads.end())
+  {
+    ArrayReferenceExpression* ref = 
+      dynamic_cast<ArrayReferenceExpression*>((*loadIter).first) ;
+    VariableSymbol* arrayVar = GetArrayVariable(ref) ;
+    if (arrayVar != NULL && analyzed.find(arrayVar) == analyzed.end())
+    {
+      analyzed.insert(arrayVar) ;
+      AnalyzeGroup(arrayVar, innermost) ;
+    }
+    ++loadIter ;
+  }
+}
+
+// A load is reused in registers when another load of the same row reads
+//  its element a whole number of steps earlier; the reuse distance is that
+//  number of iterations.  The window it needs holds rows by span elements,
+//  which costs the registers beyond the one each load is replaced with
+//  anyway.  A load of an earlier row that is not reused in registers was
+//  read when the loop passed over that row, so keeping it means holding
+//  the earlier rows in line buffers.  This assumes the outer loops move
+//  one row at a time.
+void ScalarReplacementPass2::AnalyzeGroup(VariableSymbol* v,
+					  CForStatement* innermost)
+{
+  assert(v != NULL) ;
+  assert(innermost != NULL) ;
+
+  ReuseGroup group ;
+  group.array = v ;
+  group.references = 0 ;
+  group.registerReused = 0 ;
+  group.lineReused = 0 ;
+  group.distance = 0 ;
+  group.rows = 1 ;
+  group.span = 0 ;
+  group.registerBits = 0 ;
+  group.lineBufferBits = -1 ;
+  group.keptInRegisters = false ;
+  group.keptInLineBuffers = false ;
+
+  int elementBits = 
+    GetQualifiedTypeOfElement(v)->get_base_type()->get_bit_size().c_int() ;
+
+  VariableSymbol* loopIndex = NULL ;
+  int step = 0 ;
+  bool analyzable = GetInnermostStep(innermost, loopIndex, step) ;
+
+  std::vector<std::vector<int> > accesses ;
+  int innerDimension = -1 ;
+  list<std::pair<Expression*, VariableSymbol*> >::iterator loadIter = 
+    IdentifiedLoads.begin() ;
+  while (loadIter != IdentifiedLoads.end())
+  {
+    ArrayReferenceExpression* ref = 
+      dynamic_cast<ArrayReferenceExpression*>((*loadIter).first) ;
+    if (GetArrayVariable(ref) != v)
+    {
+      ++loadIter ;
+      continue ;
+    }
+    ++group.references ;
+    std::vector<VariableSymbol*> indicies ;
+    std::vector<int> offsets ;
+    if (!analyzable || !ParseOffsets(ref, indicies, offsets) ||
+	(!accesses.empty() && offsets.size() != accesses[0].size()))
+    {
+      analyzable = false ;
+      ++loadIter ;
+      continue ;
+    }
+    for (unsigned int d = 0 ; d < indicies.size() ; ++d)
+    {
+      if (indicies[d] == loopIndex)
+      {
+	if (innerDimension != -1 && innerDimension != (int)d)
+	{
+	  analyzable = false ;
+	}
+	innerDimension = d ;
+      }
+    }
+    accesses.push_back(offsets) ;
+    ++loadIter ;
+  }
+
+  if (!analyzable || innerDimension == -1 || accesses.empty())
+  {
+    group.span = group.references ;
+    reuseGroups.push_back(group) ;
+    return ;
+  }
+
+  int dimensions = accesses[0].size() ;
+  std::vector<int> lowest(accesses[0]) ;
+  std::vector<int> highest(accesses[0]) ;
+  for (unsigned int i = 1 ; i < accesses.size() ; ++i)
+  {
+    for (int d = 0 ; d < dimensions ; ++d)
+    {
+      lowest[d] = std::min(lowest[d], accesses[i][d]) ;
+      highest[d] = std::max(highest[d], accesses[i][d]) ;
+    }
+  }
+  for (int d = 0 ; d < dimensions ; ++d)
+  {
+    if (d == innerDimension)
+    {
+      group.span = highest[d] - lowest[d] + 1 ;
+    }
+    else
+    {
+      group.rows *= highest[d] - lowest[d] + 1 ;
+    }
+  }
+
+  for (unsigned int i = 0 ; i < accesses.size() ; ++i)
+  {
+    int distance = 0 ;
+    for (unsigned int j = 0 ; j < accesses.size() ; ++j)
+    {
+      bool sameRow = true ;
+      for (int d = 0 ; d < dimensions ; ++d)
+      {
+	if (d != innerDimension && accesses[i][d] != accesses[j][d])
+	{
+	  sameRow = false ;
+	}
+      }
+      int difference = accesses[j][innerDimension] - 
+	               accesses[i][innerDimension] ;
+      if (!sameRow || difference == 0 || difference % step != 0 ||
+	  difference / step < 0)
+      {
+	continue ;
+      }
+      if (distance == 0 || difference / step < distance)
+      {
+	distance = difference / step ;
+      }
+    }
+    if (distance > 0)
+    {
+      ++group.registerReused ;
+      group.distance = std::max(group.distance, distance) ;
+    }
+    else if (innerDimension > 0 && 
+	     accesses[i][innerDimension - 1] < highest[innerDimension - 1])
+    {
+      ++group.lineReused ;
+    }
+  }
+
+  int windowElements = group.rows * group.span ;
+  if (windowElements > group.references)
+  {
+    group.registerBits = (windowElements - group.references) * elementBits ;
+  }
+  if (group.lineReused > 0)
+  {
+    int rowLength = GetRowLength(innermost, loopIndex, group.span) ;
+    if (rowLength > 0)
+    {
+      group.lineBufferBits = (group.rows - 1) * rowLength * elementBits ;
+    }
+  }
+  reuseGroups.push_back(group) ;
+}
+
+// Each window is kept in registers, its earlier rows in line buffers, or
+//  its loads are read from memory, whichever the budgets left allow.  The
+//  line buffers only feed a window kept in registers.
+void ScalarReplacementPass2::SelectReuse()
+{
+  std::sort(reuseGroups.begin(), reuseGroups.end(), MoreProfitable) ;
+  int registersUsed = 0 ;
+  int bramsUsed = 0 ;
+  std::vector<ReuseGroup>::iterator groupIter = reuseGroups.begin() ;
+  while (groupIter != reuseGroups.end())
+  {
+    if ((*groupIter).registerReused + (*groupIter).lineReused == 0)
+    {
+      ++groupIter ;
+      continue ;
+    }
+    if (registerBudget > 0 && 
+	registersUsed + (*groupIter).registerBits > registerBudget)
+    {
+      std::stringstream warning ;
+      warning << "Warning: The " << (*groupIter).rows << "x" 
+	      << (*groupIter).span << " window of " 
+	      << (*groupIter).array->get_name() << " needs " 
+	      << (*groupIter).registerBits << " bits of registers, but " 
+	      << registerBudget - registersUsed << " bits of the register" 
+	      << " budget of " << registerBudget << " are left.  Its loads" 
+	      << " are read from memory." ;
+      OutputWarning(warning.str().c_str()) ;
+      ++groupIter ;
+      continue ;
+    }
+    (*groupIter).keptInRegisters = true ;
+    registersUsed += (*groupIter).registerBits ;
+
+    if ((*groupIter).lineReused > 0 && (*groupIter).lineBufferBits > 0)
+    {
+      int brams = ((*groupIter).lineBufferBits + BRAM_BITS - 1) / BRAM_BITS ;
+      if (bramBudget > 0 && bramsUsed + brams > bramBudget)
+      {
+	std::stringstream warning ;
+	warning << "Warning: Buffering the rows of " 
+		<< (*groupIter).array->get_name() << " needs " << brams 
+		<< " block rams, but " << bramBudget - bramsUsed 
+		<< " of the block ram budget of " << bramBudget 
+		<< " are left.  The loads of its earlier rows are read from" 
+		<< " memory." ;
+	OutputWarning(warning.str().c_str()) ;
+      }
+      else
+      {
+	(*groupIter).keptInLineBuffers = true ;
+	bramsUsed += brams ;
+      }
+    }
+    ++groupIter ;
+  }
+}
+
+void ScalarReplacementPass2::ReportReuse()
+{
+  int totalReads = 0 ;
+  int totalSaved = 0 ;
+  std::vector<ReuseGroup>::iterator groupIter = reuseGroups.begin() ;
+  while (groupIter != reuseGroups.end())
+  {
+    int inRegisters = 0 ;
+    int inLineBuffers = 0 ;
+    if ((*groupIter).keptInRegisters)
+    {
+      inRegisters = (*groupIter).registerReused ;
+    }
+    if ((*groupIter).keptInLineBuffers)
+    {
+      inLineBuffers = (*groupIter).lineReused ;
+    }
+    int fromMemory = (*groupIter).references - inRegisters - inLineBuffers ;
+    totalReads += (*groupIter).references ;
+    totalSaved += inRegisters + inLineBuffers ;
+
+    std::stringstream info ;
+    info << "Stream " << (*groupIter).array->get_name() << ": " 
+	 << (*groupIter).references << " loads per iteration, " 
+	 << inRegisters << " reused in registers" ;
+    if (inRegisters > 0)
+    {
+      info << " (reuse distance " << (*groupIter).distance << ", " 
+	   << (*groupIter).rows << "x" << (*groupIter).span << " window)" ;
+    }
+    info << ", " << inLineBuffers << " reused from line buffers, " 
+	 << fromMemory << " read from memory" ;
+    OutputInformation(info.str().c_str()) ;
+    ++groupIter ;
+  }
+
+  if (totalReads > 0)
+  {
+    std::stringstream info ;
+    info << "Predicted memory accesses saved per iteration: " << totalSaved 
+	 << " of " << totalReads ;
+    OutputInformation(info.str().c_str()) ;
+  }
+}
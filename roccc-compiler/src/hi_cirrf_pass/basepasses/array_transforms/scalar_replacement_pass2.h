@@ -3,9 +3,30 @@
 #define SCALAR_REPLACEMENT_TWO_DOT_H
 
 #include <map>
+#include <vector>
 
 #include <suifpasses/suifpasses.h>
 #include <suifnodes/suif.h>
+#include <cfenodes/cfe.h>
+
+// The loads of one stream that are carried from iteration to iteration.
+//  The window is the rows by span block of elements the smart buffer keeps,
+//  and each load is described by its offsets from the loop indicies.
+class ReuseGroup
+{
+ public:
+  VariableSymbol* array ;
+  int references ;      // Distinct loads in one iteration
+  int registerReused ;  // Loads read by another load in an earlier iteration
+  int lineReused ;      // Loads read in an earlier row
+  int distance ;        // Longest reuse distance, in iterations
+  int rows ;
+  int span ;
+  int registerBits ;
+  int lineBufferBits ;  // -1 when the rows are not of constant length
+  bool keptInRegisters ;
+  bool keptInLineBuffers ;
+} ;
 
 class ScalarReplacementPass2 : public PipelinablePass
 {
@@ -31,11 +52,30 @@ class ScalarReplacementPass2 : public PipelinablePass
 
   void PrependLoads() ;
   void AppendStores() ;
+
+  // Reuse analysis.  The register budget is in bits and the block ram
+  //  budget is in block rams; 0 leaves either unlimited.
+  int registerBudget ;
+  int bramBudget ;
+  std::vector<ReuseGroup> reuseGroups ;
+
+  bool ParseSubscript(Expression* e, VariableSymbol*& index, int& offset) ;
+  bool ParseOffsets(ArrayReferenceExpression* a, 
+		    std::vector<VariableSymbol*>& indicies,
+		    std::vector<int>& offsets) ;
+  bool GetInnermostStep(CForStatement* c, VariableSymbol*& index, int& step);
+  int GetRowLength(CForStatement* c, VariableSymbol* index, int span) ;
+
+  void AnalyzeReuse() ;
+  void AnalyzeGroup(VariableSymbol* v, CForStatement* innermost) ;
+  void SelectReuse() ;
+  void ReportReuse() ;
   
  public:
   ScalarReplacementPass2(SuifEnv* pEnv) ;
   ~ScalarReplacementPass2() ;
   Module* clone() const { return (Module*) this ; }
+  void initialize() ;
   void do_procedure_definition(ProcedureDefinition* p) ;  
 } ;
 
@@ -187,6 +187,39 @@ Constant* FifoIdentificationPass::DetermineOffset(Expression* e)
   return NULL ; // Just to avoid any compiler warnings
 }
 
+// Indirect accesses, A[B[i]], have been scalar replaced into a load of B[i]
+//  into a temporary followed by a load of A[temporary].  If the index of
+//  this one dimensional access is a temporary holding an element of another
+//  stream, return the access of that other stream, otherwise return NULL.
+ArrayReferenceExpression* 
+FifoIdentificationPass::GatherIndexReference(ArrayReferenceExpression* a,
+		     std::map<VariableSymbol*, ArrayReferenceExpression*>& streamElements)
+{
+  assert(a != NULL) ;
+  if (dynamic_cast<ArrayReferenceExpression*>(a->get_base_array_address()) != NULL)
+  {
+    return NULL ;
+  }
+  Expression* index = a->get_index() ;
+  if (dynamic_cast<NonLvalueExpression*>(index) != NULL)
+  {
+    index = dynamic_cast<NonLvalueExpression*>(index)->get_addressed_expression() ;
+  }
+  LoadVariableExpression* indexLoad = 
+    dynamic_cast<LoadVariableExpression*>(index) ;
+  if (indexLoad == NULL)
+  {
+    return NULL ;
+  }
+  std::map<VariableSymbol*, ArrayReferenceExpression*>::iterator elementIter =
+    streamElements.find(indexLoad->get_source()) ;
+  if (elementIter == streamElements.end())
+  {
+    return NULL ;
+  }
+  return (*elementIter).second ;
+}
+
 void FifoIdentificationPass::do_procedure_definition(ProcedureDefinition* p)
 {
   procDef = p ;
@@ -266,6 +299,25 @@ void FifoIdentificationPass::IdentifyInputFifos(CForStatement* c)
 
   assert(loadExpList != NULL) ;
 
+  // Find the temporaries that hold a single element of a one dimensional
+  //  stream, so that streams indexed by them can be read as gathers.
+  std::map<VariableSymbol*, ArrayReferenceExpression*> streamElements ;
+  list<LoadExpression*>::iterator elementIt = loadExpList->begin() ;
+  while (elementIt != loadExpList->end())
+  {
+    ArrayReferenceExpression* elementRef = 
+      dynamic_cast<ArrayReferenceExpression*>((*elementIt)->get_source_address()) ;
+    StoreVariableStatement* elementStore = 
+      dynamic_cast<StoreVariableStatement*>((*elementIt)->get_destination()) ;
+    if (elementRef != NULL && elementStore != NULL &&
+	dynamic_cast<SymbolAddressExpression*>(elementRef->get_base_array_address()) != NULL &&
+	GetArrayVariable(elementRef)->lookup_annote_by_name("LUT") == NULL)
+    {
+      streamElements[elementStore->get_destination()] = elementRef ;
+    }
+    ++elementIt ;
+  }
+
   list<LoadExpression*>::iterator replaceIt ;
   replaceIt = loadExpList->begin() ;
   while (replaceIt != loadExpList->end())
@@ -309,6 +361,35 @@ void FifoIdentificationPass::IdentifyInputFifos(CForStatement* c)
     symbolAddress = dynamic_cast<SymbolAddressExpression*>(baseAddress) ;
     assert(symbolAddress != NULL) ;
     Symbol* baseSymbol = symbolAddress->get_addressed_symbol() ; 
+
+    // A gathered stream, A[B[i]], is read one element per B[i] in the
+    //  order of B, so its index variables and offsets are those of B[i].
+    //  The addresses of A come from the elements of B.
+    ArrayReferenceExpression* indexSource = topLevel ;
+    ArrayReferenceExpression* gatherRef = 
+      GatherIndexReference(topLevel, streamElements) ;
+    BrickAnnote* gatherMark = 
+      dynamic_cast<BrickAnnote*>(baseSymbol->lookup_annote_by_name("GatherIndex")) ;
+    if (gatherRef != NULL)
+    {
+      if (gatherMark != NULL || 
+	  baseSymbol->lookup_annote_by_name("InputFifo") != NULL)
+      {
+	OutputError("A gathered stream can only be read once per iteration!") ;
+	assert(0) ;
+      }
+      gatherMark = create_brick_annote(theEnv, "GatherIndex") ;
+      gatherMark->append_brick(create_suif_object_brick(theEnv, 
+							GetArrayVariable(gatherRef))) ;
+      baseSymbol->append_annote(gatherMark) ;
+      indexSource = gatherRef ;
+    }
+    else if (gatherMark != NULL)
+    {
+      OutputError("A gathered stream cannot also be read directly!") ;
+      assert(0) ;
+    }
+
     BrickAnnote* inputFifoMark ;
     inputFifoMark = dynamic_cast<BrickAnnote*>(baseSymbol->lookup_annote_by_name("InputFifo")) ;
     if (inputFifoMark == NULL)
@@ -316,7 +397,7 @@ void FifoIdentificationPass::IdentifyInputFifos(CForStatement* c)
       inputFifoMark = create_brick_annote(theEnv, "InputFifo") ;
       baseSymbol->append_annote(inputFifoMark) ;
       // Add a brick that states what the index variables are
-      ArrayReferenceExpression* currentIndex = topLevel ;
+      ArrayReferenceExpression* currentIndex = indexSource ;
       for(int k = 0 ; k < dimensionality; ++k)
       {
 	SuifObjectBrick* indexVariableAnnote ;
@@ -372,7 +453,7 @@ void FifoIdentificationPass::IdentifyInputFifos(CForStatement* c)
 
     // Add the variable symbols of all the offset variables.
     //  There should be as many as the dimensionality.
-    ArrayReferenceExpression* currentOffset = topLevel ;
+    ArrayReferenceExpression* currentOffset = indexSource ;
     for(int i = 0 ; i < dimensionality; ++i)
     {
       // Find the i'th index variable.  Add them to the indexAnnote
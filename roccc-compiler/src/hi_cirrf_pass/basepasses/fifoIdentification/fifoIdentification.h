@@ -11,6 +11,7 @@
 #define __FIFO_IDENTIFICATION_DOT_H__
 
 #include <string>
+#include <map>
 
 #include "suifpasses/suifpasses.h"
 #include "suifnodes/suif.h"
@@ -29,6 +30,10 @@ class FifoIdentificationPass : public PipelinablePass
   VariableSymbol* DetermineIndex(Expression* e) ;
   Constant* DetermineOffset(Expression* e) ;
 
+  ArrayReferenceExpression* 
+    GatherIndexReference(ArrayReferenceExpression* a,
+			 std::map<VariableSymbol*, ArrayReferenceExpression*>& streamElements) ;
+
   void HandleComposedSystems() ;
 
   void IdentifyInputFifos(CForStatement* c) ;
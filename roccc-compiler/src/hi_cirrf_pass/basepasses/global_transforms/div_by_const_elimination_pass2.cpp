@@ -1,6 +1,9 @@
 
 #include <cassert>
+#include <sstream>
 
+#include <basicnodes/basic_factory.h>
+#include <suifnodes/suif_factory.h>
 #include <suifkernel/utilities.h>
 
 #include "roccc_utils/warning_utils.h"
@@ -12,6 +15,7 @@ DivByConstEliminationPass2::DivByConstEliminationPass2(SuifEnv* pEnv) :
 {
   theEnv = pEnv ;
   procDef = NULL ;
+  divisionsReplaced = 0 ;
 }
 
 void DivByConstEliminationPass2::do_procedure_definition(ProcedureDefinition* p)
@@ -20,6 +24,7 @@ void DivByConstEliminationPass2::do_procedure_definition(ProcedureDefinition* p)
   assert(procDef != NULL) ;
 
   OutputInformation("Division by constant elimination pass 2.0 begins") ;
+  divisionsReplaced = 0 ;
   list<BinaryExpression*>* allBinary = 
     collect_objects<BinaryExpression>(procDef->get_body()) ;
   list<BinaryExpression*>::iterator binIter = allBinary->begin() ;
@@ -29,6 +34,13 @@ void DivByConstEliminationPass2::do_procedure_definition(ProcedureDefinition* p)
     ++binIter ;
   }
   delete allBinary ;
+  if (divisionsReplaced > 0)
+  {
+    std::stringstream info ;
+    info << "Replaced " << divisionsReplaced 
+	 << " divisions and remainders by constants" ;
+    OutputInformation(info.str().c_str()) ;
+  }
   OutputInformation("Division by constant elimination pass 2.0 ends") ;
 }
 
@@ -38,7 +50,7 @@ void DivByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression* b)
   Expression* rightSide = b->get_source2() ;
   LString opcode = b->get_opcode() ;
 
-  if (opcode != LString("divide"))
+  if (opcode != LString("divide") && opcode != LString("remainder"))
   {
     return ;
   }
@@ -55,14 +67,238 @@ void DivByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression* b)
     return ;
   }
 
-  int pow = PowerOfTwo(rightConst) ;
+  // The width and signedness of the value being divided decide which
+  //  sequence is exact, so only plain integers are handled
+  IntegerType* leftType = dynamic_cast<IntegerType*>(leftSide->get_result_type()) ;
+  if (leftType == NULL)
+  {
+    return ;
+  }
 
-  if (pow >= 0)
+  long long divisor = rightConst->get_value().c_long() ;
+  if (divisor == 0 || (divisor < 0 && !leftType->get_is_signed()))
+  {
+    return ;
+  }
+
+  Expression* replacement = NULL ;
+  if (opcode == LString("divide"))
+  {
+    replacement = CreateQuotient(leftSide, leftType, divisor, 
+				 b->get_result_type()) ;
+  }
+  else
+  {
+    replacement = CreateRemainder(leftSide, leftType, divisor,
+				  b->get_result_type()) ;
+  }
+
+  if (replacement == NULL)
+  {
+    // Left for the divider core
+    return ;
+  }
+  b->get_parent()->replace(b, replacement) ;
+  ++divisionsReplaced ;
+}
+
+Expression* DivByConstEliminationPass2::CreateConstant(DataType* t, 
+						       long long value)
+{
+  return create_int_constant(theEnv, t, IInteger((long)value)) ;
+}
+
+// C division rounds toward zero.  Signed values are divided by the
+//  magnitude of the divisor and negated afterwards if the divisor was 
+//  negative.
+Expression* DivByConstEliminationPass2::CreateQuotient(Expression* n,
+						       IntegerType* nType,
+						       long long d,
+						       DataType* resultType)
+{
+  int bits = nType->get_bit_size().c_int() ;
+  bool isSigned = nType->get_is_signed() ;
+  long long magnitude = (d < 0) ? -d : d ;
+  int pow = PowerOfTwo(magnitude) ;
+
+  Expression* quotient = NULL ;
+  if (pow >= 0 && !isSigned)
   {
     // Exactly a power of two, replace with a shift
-    b->set_opcode(LString("right_shift")) ;
-    rightConst->set_value(IInteger(pow)) ;
+    quotient = create_binary_expression(theEnv,
+					resultType,
+					LString("right_shift"),
+				    dynamic_cast<Expression*>(n->deep_clone()),
+					CreateConstant(nType, pow)) ;
+  }
+  else if (pow >= 0)
+  {
+    // A shift rounds down, so negative values are first moved up by one
+    //  less than the divisor.  The sign, spread across every bit, masked
+    //  by the divisor minus one is exactly that amount.
+    Expression* signBits = 
+      create_binary_expression(theEnv,
+			       nType,
+			       LString("right_shift"),
+			       dynamic_cast<Expression*>(n->deep_clone()),
+			       CreateConstant(nType, bits - 1)) ;
+    Expression* bias = 
+      create_binary_expression(theEnv,
+			       nType,
+			       LString("bitwise_and"),
+			       signBits,
+			       CreateConstant(nType, magnitude - 1)) ;
+    Expression* biased = 
+      create_binary_expression(theEnv,
+			       nType,
+			       LString("add"),
+			       dynamic_cast<Expression*>(n->deep_clone()),
+			       bias) ;
+    quotient = create_binary_expression(theEnv,
+					resultType,
+					LString("right_shift"),
+					biased,
+					CreateConstant(nType, pow)) ;
+  }
+  else
+  {
+    // Multiply by a rounded up reciprocal and keep the high bits
+    long long maxMagnitude = isSigned ? (1LL << (bits - 1)) : (1LL << bits) - 1 ;
+    long long multiplier ;
+    int shift ;
+    if (bits > 61 || 
+	!ComputeMultiplier(magnitude, bits, maxMagnitude, multiplier, shift))
+    {
+      return NULL ;
+    }
+    int multiplierBits = 0 ;
+    while ((multiplier >> multiplierBits) != 0)
+    {
+      ++multiplierBits ;
+    }
+    int productBits = bits + multiplierBits + (isSigned ? 1 : 0) ;
+    if (productBits > 64)
+    {
+      return NULL ;
+    }
+    IntegerType* productType = 
+      create_integer_type(theEnv, productBits, 0, isSigned) ;
+    Expression* widened = 
+      create_unary_expression(theEnv,
+			      productType,
+			      LString("convert"),
+			      dynamic_cast<Expression*>(n->deep_clone())) ;
+    Expression* product = 
+      create_binary_expression(theEnv,
+			       productType,
+			       LString("multiply"),
+			       widened,
+			       CreateConstant(productType, multiplier)) ;
+    Expression* high = 
+      create_binary_expression(theEnv,
+			       productType,
+			       LString("right_shift"),
+			       product,
+			       CreateConstant(productType, shift)) ;
+    if (isSigned)
+    {
+      // The high bits round negative values down; subtracting the sign 
+      //  (-1 for negative values) rounds them toward zero instead
+      Expression* signBit = 
+	create_binary_expression(theEnv,
+				 nType,
+				 LString("right_shift"),
+				 dynamic_cast<Expression*>(n->deep_clone()),
+				 CreateConstant(nType, bits - 1)) ;
+      high = create_binary_expression(theEnv,
+				      productType,
+				      LString("subtract"),
+				      high,
+				      signBit) ;
+    }
+    quotient = create_unary_expression(theEnv,
+				       resultType,
+				       LString("convert"),
+				       high) ;
+  }
+
+  if (d < 0)
+  {
+    quotient = create_unary_expression(theEnv,
+				       resultType,
+				       LString("negate"),
+				       quotient) ;
+  }
+  return quotient ;
+}
+
+// The remainder has the sign of the value divided, so it is the same for
+//  the divisor and its negation
+Expression* DivByConstEliminationPass2::CreateRemainder(Expression* n,
+							IntegerType* nType,
+							long long d,
+							DataType* resultType)
+{
+  long long magnitude = (d < 0) ? -d : d ;
+  if (PowerOfTwo(magnitude) >= 0 && !nType->get_is_signed())
+  {
+    return create_binary_expression(theEnv,
+				    resultType,
+				    LString("bitwise_and"),
+				    dynamic_cast<Expression*>(n->deep_clone()),
+				    CreateConstant(nType, magnitude - 1)) ;
   }
+  Expression* quotient = CreateQuotient(n, nType, magnitude, resultType) ;
+  if (quotient == NULL)
+  {
+    return NULL ;
+  }
+  Expression* multiple = 
+    create_binary_expression(theEnv,
+			     resultType,
+			     LString("multiply"),
+			     quotient,
+			     CreateConstant(nType, magnitude)) ;
+  return create_binary_expression(theEnv,
+				  resultType,
+				  LString("subtract"),
+				  dynamic_cast<Expression*>(n->deep_clone()),
+				  multiple) ;
+}
+
+// With multiplier = ceil(2^shift / d) and error = multiplier * d - 2^shift,
+//  floor(n * multiplier / 2^shift) = floor(n / d) whenever n * error < 2^shift,
+//  since the error then never carries into the next whole quotient.  Negative
+//  values are rounded the same way from below, which the caller corrects.
+//  Some shift no more than bits + ceil(log2(d)) always works.
+bool DivByConstEliminationPass2::ComputeMultiplier(long long d, int bits,
+						   long long maxMagnitude,
+						   long long& multiplier,
+						   int& shift)
+{
+  assert(d > 1) ;
+  int log = 0 ;
+  while ((1LL << log) < d)
+  {
+    ++log ;
+  }
+  for (int p = bits ; p <= bits + log ; ++p)
+  {
+    if (p > 61)
+    {
+      return false ;
+    }
+    long long power = 1LL << p ;
+    long long m = (power + d - 1) / d ;
+    long long error = m * d - power ;
+    if (error == 0 || maxMagnitude <= (power - 1) / error)
+    {
+      multiplier = m ;
+      shift = p ;
+      return true ;
+    }
+  }
+  return false ;
 }
 
 bool DivByConstEliminationPass2::IsIntegerType(Type* t)
@@ -82,10 +318,9 @@ bool DivByConstEliminationPass2::IsIntegerType(Type* t)
   return false ;
 }
 
-int DivByConstEliminationPass2::PowerOfTwo(IntConstant* i)
+int DivByConstEliminationPass2::PowerOfTwo(long long value)
 {
-  int value = i->get_value().c_int() ;
-  if (value < 0)
+  if (value <= 0)
   {
     return -1 ;
   }
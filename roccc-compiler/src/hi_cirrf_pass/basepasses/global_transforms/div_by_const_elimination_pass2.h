@@ -14,9 +14,22 @@ class DivByConstEliminationPass2 : public PipelinablePass
   SuifEnv* theEnv ;
   ProcedureDefinition* procDef ;
 
+  int divisionsReplaced ;
+
   bool IsIntegerType(Type* t) ;
 
-  int PowerOfTwo(IntConstant* i) ;
+  int PowerOfTwo(long long value) ;
+
+  // Finds the multiplier and shift that divide every value of "bits" bits
+  //  with a magnitude up to maxMagnitude by d with exact rounding
+  bool ComputeMultiplier(long long d, int bits, long long maxMagnitude,
+			 long long& multiplier, int& shift) ;
+
+  Expression* CreateConstant(DataType* t, long long value) ;
+  Expression* CreateQuotient(Expression* n, IntegerType* nType,
+			     long long d, DataType* resultType) ;
+  Expression* CreateRemainder(Expression* n, IntegerType* nType,
+			      long long d, DataType* resultType) ;
 
   void ProcessBinaryExpression(BinaryExpression* b) ;
 
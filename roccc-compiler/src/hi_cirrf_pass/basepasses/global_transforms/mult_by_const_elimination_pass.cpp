@@ -1,5 +1,7 @@
 
 #include <cassert>
+#include <map>
+#include <sstream>
 
 #include <basicnodes/basic.h>
 #include <basicnodes/basic_factory.h>
@@ -8,15 +10,81 @@
 #include <suifnodes/suif_factory.h>
 
 #include <suifkernel/utilities.h>
+#include <utils/expression_utils.h>
+#include <utils/symbol_utils.h>
+#include <utils/type_utils.h>
 
 #include "mult_by_const_elimination_pass.h"
 #include "roccc_utils/warning_utils.h"
 
+// A pair of digits, second at "shift" places above first, that appears in
+//  more than one place and can be computed once
+class CSDPattern
+{
+ public:
+  int first ;
+  int second ;
+  int shift ;
+  int sign ;
+  bool operator<(const CSDPattern& other) const
+  {
+    if (first != other.first) return first < other.first ;
+    if (second != other.second) return second < other.second ;
+    if (shift != other.shift) return shift < other.shift ;
+    return sign < other.sign ;
+  }
+} ;
+
+// Count, and if a new symbol is passed replace, the occurrences of a pattern
+//  in the digits of one constant.  Each digit is used at most once.
+static int MatchPattern(std::vector<CSDTerm>& terms, CSDPattern& pattern,
+			int newSymbol)
+{
+  std::vector<bool> used(terms.size(), false) ;
+  std::vector<CSDTerm> replaced ;
+  int count = 0 ;
+  for (unsigned int i = 0 ; i < terms.size() ; ++i)
+  {
+    if (used[i] || terms[i].symbol != pattern.first)
+    {
+      continue ;
+    }
+    for (unsigned int j = 0 ; j < terms.size() ; ++j)
+    {
+      if (i == j || used[j] || terms[j].symbol != pattern.second ||
+	  terms[j].shift != terms[i].shift + pattern.shift ||
+	  terms[j].sign != terms[i].sign * pattern.sign)
+      {
+	continue ;
+      }
+      used[i] = true ;
+      used[j] = true ;
+      ++count ;
+      replaced.push_back(CSDTerm(newSymbol, terms[i].shift, terms[i].sign)) ;
+      break ;
+    }
+  }
+  if (newSymbol > 0 && count > 0)
+  {
+    for (unsigned int i = 0 ; i < terms.size() ; ++i)
+    {
+      if (!used[i])
+      {
+	replaced.push_back(terms[i]) ;
+      }
+    }
+    terms = replaced ;
+  }
+  return count ;
+}
+
 MultiplyByConstEliminationPass2::MultiplyByConstEliminationPass2(SuifEnv* pEnv)
   : PipelinablePass(pEnv, "MultiplyByConstEliminationPass")
 {
   theEnv = pEnv ;
   procDef = NULL ;
+  addersBefore = 0 ;
+  addersAfter = 0 ;
 }
 
 void MultiplyByConstEliminationPass2::do_procedure_definition(ProcedureDefinition* p)
@@ -24,7 +92,23 @@ void MultiplyByConstEliminationPass2::do_procedure_definition(ProcedureDefinitio
   procDef = p ;
   assert(procDef != NULL) ;
   OutputInformation("Multiply by const elimination pass 2 begins") ;
-  list<BinaryExpression*>* allBin = 
+  addersBefore = 0 ;
+  addersAfter = 0 ;
+
+  // First, share the work between all of the products of the same variable
+  //  in each list of statements
+  list<StatementList*>* allLists =
+    collect_objects<StatementList>(procDef->get_body()) ;
+  list<StatementList*>::iterator listIter = allLists->begin() ;
+  while (listIter != allLists->end())
+  {
+    ProcessStatementList(*listIter) ;
+    ++listIter ;
+  }
+  delete allLists ;
+
+  // Any multiplications that are left are replaced one at a time
+  list<BinaryExpression*>* allBin =
     collect_objects<BinaryExpression>(procDef->get_body()) ;
   list<BinaryExpression*>::iterator binIter = allBin->begin() ;
   while (binIter != allBin->end())
@@ -32,15 +116,100 @@ void MultiplyByConstEliminationPass2::do_procedure_definition(ProcedureDefinitio
     ProcessBinaryExpression(*binIter) ;
     ++binIter ;
   }
+  delete allBin ;
+
+  if (addersBefore > 0)
+  {
+    std::stringstream info ;
+    info << "Constant multiplications use " << addersAfter
+	 << " adders instead of " << addersBefore ;
+    OutputInformation(info.str().c_str()) ;
+  }
   OutputInformation("Multiply by const elimination pass 2 ends") ;
 }
 
-void MultiplyByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression* b)
+// Finds all of the multiplications of one variable by constants that are
+//  not separated by a write to that variable.  Statements other than stores
+//  end every group, as they may write anything.
+void MultiplyByConstEliminationPass2::ProcessStatementList(StatementList* s)
+{
+  assert(s != NULL) ;
+  std::map<VariableSymbol*, std::vector<ConstantProduct> > openGroups ;
+  std::map<VariableSymbol*, Statement*> firstUse ;
+  std::vector<std::vector<ConstantProduct> > closedGroups ;
+  std::vector<Statement*> closedFirst ;
+
+  for (int i = 0 ; i < s->get_statement_count() ; ++i)
+  {
+    Statement* currentStatement = s->get_statement(i) ;
+    StoreVariableStatement* storeVar =
+      dynamic_cast<StoreVariableStatement*>(currentStatement) ;
+    if (storeVar != NULL || dynamic_cast<StoreStatement*>(currentStatement) != NULL)
+    {
+      list<BinaryExpression*>* allBin =
+	collect_objects<BinaryExpression>(currentStatement) ;
+      list<BinaryExpression*>::iterator binIter = allBin->begin() ;
+      while (binIter != allBin->end())
+      {
+	ConstantProduct p ;
+	LoadVariableExpression* load = NULL ;
+	if (IsConstantProduct(*binIter, p))
+	{
+	  load = dynamic_cast<LoadVariableExpression*>(p.operand) ;
+	}
+	if (load != NULL)
+	{
+	  if (openGroups.find(load->get_source()) == openGroups.end())
+	  {
+	    firstUse[load->get_source()] = currentStatement ;
+	  }
+	  openGroups[load->get_source()].push_back(p) ;
+	}
+	++binIter ;
+      }
+      delete allBin ;
+    }
+
+    std::map<VariableSymbol*, std::vector<ConstantProduct> >::iterator
+      groupIter = openGroups.begin() ;
+    while (groupIter != openGroups.end())
+    {
+      if (storeVar == NULL || storeVar->get_destination() == (*groupIter).first)
+      {
+	closedGroups.push_back((*groupIter).second) ;
+	closedFirst.push_back(firstUse[(*groupIter).first]) ;
+	openGroups.erase(groupIter++) ;
+      }
+      else
+      {
+	++groupIter ;
+      }
+    }
+  }
+  std::map<VariableSymbol*, std::vector<ConstantProduct> >::iterator
+    groupIter = openGroups.begin() ;
+  while (groupIter != openGroups.end())
+  {
+    closedGroups.push_back((*groupIter).second) ;
+    closedFirst.push_back(firstUse[(*groupIter).first]) ;
+    ++groupIter ;
+  }
+
+  // The statements computing shared values are only inserted once all of
+  //  the groups have been found, so the list is not changed while walking it
+  for (unsigned int i = 0 ; i < closedGroups.size() ; ++i)
+  {
+    ProcessGroup(closedGroups[i], closedFirst[i]) ;
+  }
+}
+
+bool MultiplyByConstEliminationPass2::IsConstantProduct(BinaryExpression* b,
+							ConstantProduct& p)
 {
   assert(b != NULL) ;
   if (b->get_opcode() != LString("multiply"))
   {
-    return ;
+    return false ;
   }
   Expression* leftSide = b->get_source1() ;
   Expression* rightSide = b->get_source2() ;
@@ -52,7 +221,7 @@ void MultiplyByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression*
 
   IntConstant* originalConstant = NULL ;
   Expression* nonConstantSrc = NULL ;
-  
+
   if (leftConstant != NULL && rightConstant == NULL)
   {
     // Verify that the right side is an integer type
@@ -60,7 +229,7 @@ void MultiplyByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression*
     IntegerType* rightIntType = dynamic_cast<IntegerType*>(rightType) ;
     if (rightIntType == NULL)
     {
-      return ;
+      return false ;
     }
     originalConstant = leftConstant ;
     nonConstantSrc = rightSide ;
@@ -72,7 +241,7 @@ void MultiplyByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression*
     IntegerType* leftIntType = dynamic_cast<IntegerType*>(leftType) ;
     if (leftIntType == NULL)
     {
-      return ;
+      return false ;
     }
     originalConstant = rightConstant ;
     nonConstantSrc = leftSide ;
@@ -80,95 +249,294 @@ void MultiplyByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression*
   else
   {
     // No replacement to perform
-    return ;
+    return false ;
   }
 
   assert(originalConstant != NULL) ;
   assert(nonConstantSrc != NULL) ;
 
-  int constantValue = originalConstant->get_value().c_int() ;
+  long long constantValue = originalConstant->get_value().c_long() ;
   if (constantValue == 0)
   {
     // Cannot replace multiply of 0 with any shifts
+    return false ;
+  }
+
+  p.multiply = b ;
+  p.operand = nonConstantSrc ;
+  p.constant = originalConstant ;
+  p.negative = (constantValue < 0) ;
+  p.terms = ComputeCSD(p.negative ? -constantValue : constantValue) ;
+  return true ;
+}
+
+void MultiplyByConstEliminationPass2::ProcessBinaryExpression(BinaryExpression* b)
+{
+  ConstantProduct p ;
+  if (!IsConstantProduct(b, p))
+  {
     return ;
   }
-  int sign ;
-  if (constantValue < 0)
+  std::vector<ConstantProduct> group ;
+  group.push_back(p) ;
+  ProcessGroup(group, NULL) ;
+}
+
+// Replaces every product in the group with shifts and adds of its canonical
+//  signed digits.  If there is a statement to put them in front of, the
+//  digit pairs that appear more than once are computed once and shared.
+void MultiplyByConstEliminationPass2::ProcessGroup(std::vector<ConstantProduct>& group,
+						   Statement* first)
+{
+  assert(!group.empty()) ;
+
+  // The shared values are kept in the widest type of all of the products
+  DataType* widestType = group[0].multiply->get_result_type() ;
+  for (unsigned int i = 0 ; i < group.size() ; ++i)
   {
-    sign = -1 ;
+    DataType* currentType = group[i].multiply->get_result_type() ;
+    if (currentType->get_bit_size().c_int() > widestType->get_bit_size().c_int())
+    {
+      widestType = currentType ;
+    }
+    // The binary expansion needed one adder for every bit past the first
+    long long value = group[i].constant->get_value().c_long() ;
+    if (value < 0)
+    {
+      value = -value ;
+    }
+    while (value != 0)
+    {
+      if ((value & 0x1) != 0)
+      {
+	++addersBefore ;
+      }
+      value >>= 1 ;
+    }
+    --addersBefore ;
   }
-  else
+
+  std::vector<CSDSubexpression> shared ;
+  if (first != NULL)
   {
-    sign = 1 ;
+    ShareSubexpressions(group, shared) ;
   }
 
-  // Now, perform the actual replacement
-  list<int> powerSeries = ComputePowerSeries(constantValue * sign) ;
+  for (unsigned int i = 0 ; i < shared.size() ; ++i)
+  {
+    CSDTerm firstTerm(shared[i].first, 0, 1) ;
+    CSDTerm secondTerm(shared[i].second, shared[i].shift, 1) ;
+    Expression* value =
+      create_binary_expression(theEnv,
+			       widestType,
+			       shared[i].sign > 0 ? LString("add") : LString("subtract"),
+			       BuildTerm(firstTerm, group[0], shared, widestType),
+			       BuildTerm(secondTerm, group[0], shared, widestType)) ;
+    shared[i].variable =
+      new_unique_variable(theEnv, find_scope(first),
+			  retrieve_qualified_type(widestType)) ;
+    StoreVariableStatement* computeShared =
+      create_store_variable_statement(theEnv, shared[i].variable, value) ;
+    insert_statement_before(first, computeShared) ;
+    ++addersAfter ;
+  }
 
-  // Create a replacement expression that consists of adding all of the
-  //  appropriate shifts together.
+  for (unsigned int i = 0 ; i < group.size() ; ++i)
+  {
+    addersAfter += group[i].terms.size() - 1 ;
+    ReplaceProduct(group[i], shared) ;
+  }
+}
 
-  Expression* replacement = NULL ;  
+// Repeatedly finds the pair of digits that appears most often across all of
+//  the constants and replaces each occurrence with a single new digit that
+//  stands for the pair.
+void MultiplyByConstEliminationPass2::ShareSubexpressions(std::vector<ConstantProduct>& group,
+							  std::vector<CSDSubexpression>& shared)
+{
+  while (true)
+  {
+    std::map<CSDPattern, int> candidates ;
+    for (unsigned int i = 0 ; i < group.size() ; ++i)
+    {
+      std::vector<CSDTerm>& terms = group[i].terms ;
+      for (unsigned int j = 0 ; j < terms.size() ; ++j)
+      {
+	for (unsigned int k = 0 ; k < terms.size() ; ++k)
+	{
+	  if (j == k || terms[k].shift < terms[j].shift ||
+	      (terms[k].shift == terms[j].shift && terms[k].symbol <= terms[j].symbol))
+	  {
+	    continue ;
+	  }
+	  CSDPattern pattern ;
+	  pattern.first = terms[j].symbol ;
+	  pattern.second = terms[k].symbol ;
+	  pattern.shift = terms[k].shift - terms[j].shift ;
+	  pattern.sign = terms[j].sign * terms[k].sign ;
+	  candidates[pattern] = 0 ;
+	}
+      }
+    }
+
+    CSDPattern best ;
+    int bestCount = 1 ;
+    std::map<CSDPattern, int>::iterator candIter = candidates.begin() ;
+    while (candIter != candidates.end())
+    {
+      CSDPattern pattern = (*candIter).first ;
+      int count = 0 ;
+      for (unsigned int i = 0 ; i < group.size() ; ++i)
+      {
+	count += MatchPattern(group[i].terms, pattern, 0) ;
+      }
+      if (count > bestCount)
+      {
+	best = pattern ;
+	bestCount = count ;
+      }
+      ++candIter ;
+    }
+    if (bestCount < 2)
+    {
+      return ;
+    }
 
-  list<int>::iterator powerIter = powerSeries.begin() ;
-  while (powerIter != powerSeries.end())
+    CSDSubexpression subexpression ;
+    subexpression.first = best.first ;
+    subexpression.second = best.second ;
+    subexpression.shift = best.shift ;
+    subexpression.sign = best.sign ;
+    subexpression.variable = NULL ;
+    shared.push_back(subexpression) ;
+    for (unsigned int i = 0 ; i < group.size() ; ++i)
+    {
+      MatchPattern(group[i].terms, best, shared.size()) ;
+    }
+  }
+}
+
+Expression* MultiplyByConstEliminationPass2::BuildTerm(CSDTerm& t,
+						       ConstantProduct& p,
+						       std::vector<CSDSubexpression>& shared,
+						       DataType* resultType)
+{
+  Expression* base = NULL ;
+  if (t.symbol == 0)
   {
-    IntConstant* shiftAmount = 
-      create_int_constant(theEnv,
-			  originalConstant->get_result_type(),
-			  IInteger(*powerIter)) ;
-    BinaryExpression* nextShift = 
-      create_binary_expression(theEnv,
-			       b->get_result_type(),
-			       LString("left_shift"),
-		       dynamic_cast<Expression*>(nonConstantSrc->deep_clone()),
-			       shiftAmount) ;
-    if (replacement == NULL)
+    base = dynamic_cast<Expression*>(p.operand->deep_clone()) ;
+  }
+  else
+  {
+    assert(shared[t.symbol - 1].variable != NULL) ;
+    base = create_load_variable_expression(theEnv,
+					   resultType,
+					   shared[t.symbol - 1].variable) ;
+  }
+  if (t.shift == 0)
+  {
+    return base ;
+  }
+  IntConstant* shiftAmount =
+    create_int_constant(theEnv,
+			p.constant->get_result_type(),
+			IInteger(t.shift)) ;
+  return create_binary_expression(theEnv,
+				  resultType,
+				  LString("left_shift"),
+				  base,
+				  shiftAmount) ;
+}
+
+// Adds the values as a balanced tree, so the adders can be pipelined in as
+//  few stages as possible
+Expression* MultiplyByConstEliminationPass2::BuildSum(std::vector<Expression*>& values,
+						      int low, int high,
+						      DataType* resultType)
+{
+  if (high - low <= 0)
+  {
+    return NULL ;
+  }
+  if (high - low == 1)
+  {
+    return values[low] ;
+  }
+  int middle = low + (high - low) / 2 ;
+  return create_binary_expression(theEnv,
+				  resultType,
+				  LString("add"),
+				  BuildSum(values, low, middle, resultType),
+				  BuildSum(values, middle, high, resultType)) ;
+}
+
+void MultiplyByConstEliminationPass2::ReplaceProduct(ConstantProduct& p,
+						     std::vector<CSDSubexpression>& shared)
+{
+  DataType* resultType = p.multiply->get_result_type() ;
+  std::vector<Expression*> positive ;
+  std::vector<Expression*> negative ;
+  for (unsigned int i = 0 ; i < p.terms.size() ; ++i)
+  {
+    // A negative constant just swaps which digits are added and subtracted
+    bool isPositive = (p.terms[i].sign > 0) != p.negative ;
+    if (isPositive)
     {
-      replacement = nextShift ;
+      positive.push_back(BuildTerm(p.terms[i], p, shared, resultType)) ;
     }
     else
     {
-      BinaryExpression* addAllShifts = 
-	create_binary_expression(theEnv,
-				 b->get_result_type(),
-				 LString("add"),
-				 replacement,
-				 nextShift) ;
-      replacement = addAllShifts ;
+      negative.push_back(BuildTerm(p.terms[i], p, shared, resultType)) ;
     }
-    ++powerIter ;
   }
+  Expression* added = BuildSum(positive, 0, positive.size(), resultType) ;
+  Expression* subtracted = BuildSum(negative, 0, negative.size(), resultType) ;
 
-  assert(replacement != NULL) ;
-
-  if (sign == -1)
+  Expression* replacement = NULL ;
+  if (added != NULL && subtracted != NULL)
   {
-    replacement = 
-      create_unary_expression(theEnv, 
-			      b->get_result_type(),
+    replacement =
+      create_binary_expression(theEnv,
+			       resultType,
+			       LString("subtract"),
+			       added,
+			       subtracted) ;
+  }
+  else if (added != NULL)
+  {
+    replacement = added ;
+  }
+  else
+  {
+    assert(subtracted != NULL) ;
+    replacement =
+      create_unary_expression(theEnv,
+			      resultType,
 			      LString("negate"),
-			      replacement) ;
+			      subtracted) ;
   }
 
-  b->get_parent()->replace(b, replacement) ;
-    
+  p.multiply->get_parent()->replace(p.multiply, replacement) ;
 }
 
-list<int> MultiplyByConstEliminationPass2::ComputePowerSeries(int n)
+// Canonical signed digit form: no two nonzero digits are next to each other,
+//  so there are never more nonzero digits than in the binary form
+std::vector<CSDTerm> MultiplyByConstEliminationPass2::ComputeCSD(long long n)
 {
-  list<int> toReturn ;
-  
-  // Break n into the sum of all of its powers
+  std::vector<CSDTerm> toReturn ;
+  assert(n > 0) ;
+
   int power = 0 ;
-  while (power < 32)
+  while (n != 0)
   {
-    if ( ((n >> power) & 0x1) != 0)
+    if ((n & 0x1) != 0)
     {
-      toReturn.push_front(power) ;
+      int digit = ((n & 0x3) == 0x1) ? 1 : -1 ;
+      toReturn.push_back(CSDTerm(0, power, digit)) ;
+      n -= digit ;
     }
+    n >>= 1 ;
     ++power ;
   }
   return toReturn ;
- 
 }
@@ -1,17 +1,69 @@
-
 #ifndef MULTIPLY_BY_CONST_DOT_H
 #define MULTIPLY_BY_CONST_DOT_H
 
+#include <vector>
+
 #include <suifpasses/suifpasses.h>
 #include <suifnodes/suif.h>
 
+// One nonzero digit of a constant, scaled by a power of two.  The digit
+//  multiplies either the original operand (symbol 0) or one of the shared
+//  subexpressions built from it (symbols 1 and up).
+class CSDTerm
+{
+ public:
+  int symbol ;
+  int shift ;
+  int sign ;
+  CSDTerm(int sym, int sh, int si) : symbol(sym), shift(sh), sign(si) { ; }
+} ;
+
+// A subexpression shared between products: first + sign * (second << shift)
+class CSDSubexpression
+{
+ public:
+  int first ;
+  int second ;
+  int shift ;
+  int sign ;
+  VariableSymbol* variable ;
+} ;
+
+// A multiplication of an operand by a constant, along with the digits that
+//  will replace it
+class ConstantProduct
+{
+ public:
+  BinaryExpression* multiply ;
+  Expression* operand ;
+  IntConstant* constant ;
+  bool negative ;
+  std::vector<CSDTerm> terms ;
+} ;
+
 class MultiplyByConstEliminationPass2 : public PipelinablePass
 {
  private:
   SuifEnv* theEnv ;
   ProcedureDefinition* procDef ;
 
-  list<int> ComputePowerSeries(int n) ;
+  int addersBefore ;
+  int addersAfter ;
+
+  std::vector<CSDTerm> ComputeCSD(long long n) ;
+
+  bool IsConstantProduct(BinaryExpression* b, ConstantProduct& p) ;
+  void ProcessStatementList(StatementList* s) ;
+  void ProcessGroup(std::vector<ConstantProduct>& group, Statement* first) ;
+  void ShareSubexpressions(std::vector<ConstantProduct>& group,
+			   std::vector<CSDSubexpression>& shared) ;
+  Expression* BuildTerm(CSDTerm& t, ConstantProduct& p,
+			std::vector<CSDSubexpression>& shared,
+			DataType* resultType) ;
+  Expression* BuildSum(std::vector<Expression*>& values, int low, int high,
+		       DataType* resultType) ;
+  void ReplaceProduct(ConstantProduct& p,
+		      std::vector<CSDSubexpression>& shared) ;
 
   void ProcessBinaryExpression(BinaryExpression* b) ;
  public:
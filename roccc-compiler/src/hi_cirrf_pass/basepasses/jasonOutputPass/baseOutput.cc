@@ -86,6 +86,7 @@ void HiCirrfGenerator::OutputDotH()
   rocccOut << "void ROCCCNumDataChannels(int, ...) ;"        << std::endl ;
   rocccOut << "void ROCCCNumAddressChannels(int, ...) ; "    << std::endl ;
   rocccOut << "void ROCCCNumMemReq(int, ...) ;"              << std::endl ;
+  rocccOut << "void ROCCCGatherIndex(int, ...) ;"            << std::endl ;
   rocccOut << "void ROCCCSize(int, ...) ;"                   << std::endl ;
   rocccOut << "void ROCCCStep(int, int) ;"                   << std::endl ;
   rocccOut << "int ROCCCFPToInt(float, int) ;"               << std::endl ;
@@ -594,6 +594,34 @@ void SystemGenerator::OutputNumChannels()
   }
 }
 
+// Gathered streams, A[B[i]], are identified by the stream whose elements
+//  are the indexes into them.  The first argument is the number of index
+//  streams that follow the gathered stream.
+void SystemGenerator::OutputGatherIndexes()
+{
+  std::list<VariableSymbol*>::iterator streamIter = inputArrays.begin() ;
+  while (streamIter != inputArrays.end())
+  {
+    BrickAnnote* gatherBrick = 
+      dynamic_cast<BrickAnnote*>((*streamIter)->lookup_annote_by_name("GatherIndex")) ;
+    if (gatherBrick != NULL)
+    {
+      SuifObjectBrick* indexBrick = 
+	dynamic_cast<SuifObjectBrick*>(gatherBrick->get_brick(0)) ;
+      assert(indexBrick != NULL) ;
+      VariableSymbol* indexStream = 
+	dynamic_cast<VariableSymbol*>(indexBrick->get_object()) ;
+      assert(indexStream != NULL) ;
+      fout << "ROCCCGatherIndex(" ;
+      fout << gatherBrick->get_brick_count() ;
+      fout << ", " << (*streamIter)->get_name() ;
+      fout << ", " << indexStream->get_name() ;
+      fout << ") ;" << std::endl ;
+    }
+    ++streamIter ;
+  }
+}
+
 // When generating systems, we print out a normalized loop as opposed to 
 //  a loop as it appears in the original C code.  The actual information
 //  such as step size and number of channels is passed through
@@ -638,6 +666,7 @@ void SystemGenerator::PrintForStatement(CForStatement* s)
     OutputSizes() ;
     OutputSteps() ;
     OutputNumChannels() ;
+    OutputGatherIndexes() ;
 
     PrintTemporalStores() ;
     PrintStoreToNext() ;
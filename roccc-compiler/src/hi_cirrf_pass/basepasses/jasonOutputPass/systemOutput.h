@@ -51,6 +51,7 @@ class SystemGenerator : public HiCirrfGenerator
   void OutputNumChannels() ;
   void OutputNumChannelsWorkhorse(VariableSymbol* v, bool isInput) ;
   void OutputSteps() ;
+  void OutputGatherIndexes() ;
 
   void OutputInputArrays() ;
   void OutputOutputArrays() ;
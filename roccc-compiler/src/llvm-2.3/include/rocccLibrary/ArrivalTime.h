@@ -0,0 +1,46 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+ArrivalTime estimates when each value of a function is ready, using the
+delays in the same timing information the pipelining uses. Times count from
+the inputs, registers, and library cores a value depends on, which are all
+ready at 0. BoolSelects are counted as muxes.
+
+Arrival times are remembered as they are found, so a pass that changes the
+datapath has to set the time of each value it creates and erase each value it
+removes.
+
+*/
+
+#ifndef _ARRIVAL_TIME_DOT_H__
+#define _ARRIVAL_TIME_DOT_H__
+
+#include <map>
+
+#include "llvm/Value.h"
+#include "llvm/Instruction.h"
+
+#include "rocccLibrary/TimingInfo.h"
+
+namespace ROCCC {
+
+class ArrivalTime {
+  TimingInfo timing;
+  std::map<llvm::Value*, int> arrival;
+public:
+  TimingInfo& getTimingInfo();
+  //the delay of the instruction itself
+  int getDelay(llvm::Instruction* I);
+  //the time the value is ready
+  int get(llvm::Value* v);
+  void set(llvm::Value* v, int time);
+  void erase(llvm::Value* v);
+  void clear();
+};
+
+}
+
+#endif
@@ -19,6 +19,9 @@ namespace llvm
       bool marked ;
       
       bool isSynch ;
+      
+      int arrivalTime ;
+      int requiredTime ;
             
     public:
       
@@ -49,6 +52,14 @@ namespace llvm
       void setDataflowLevel(int d) { dataflowLevel = d ; }
       void setPipelineLevel(int p) { pipelineLevel = p ; } 
       
+      // Timing inside of the pipeline stage, filled in by the timing report.
+      //  Both are -1 if the timing has not been computed.
+      inline int getArrivalTime() { return arrivalTime ; }
+      inline int getRequiredTime() { return requiredTime ; }
+      
+      void setArrivalTime(int a) { arrivalTime = a ; }
+      void setRequiredTime(int r) { requiredTime = r ; }
+      
       void AddUse(DFBasicBlock* u) ; // This block is the definition
       
       void RemoveUse(DFBasicBlock* u) ; // This block used to be the definition
@@ -32,6 +32,11 @@ namespace llvm
       //  clock cycles required to get data through the component.  This
       //  number can be exported to the VHDL library and other system code.
       int delay ;
+      // The number of clock cycles between successive iterations entering
+      //  the pipeline.  This is 1 unless a loop carried value needs more
+      //  than a single cycle to make it back around, and is set during the
+      //  modulo scheduling phase.
+      int initiationInterval ;
       // Hmmm..  It appears that there is no default Function constructor, 
       //  so I won't be creating a default DFFunction constructor.
       DFFunction(const FunctionType* Ty, LinkageTypes Linkage,
@@ -55,6 +60,9 @@ namespace llvm
       int getDelay();
       void setDelay(int d);
       
+      int getInitiationInterval();
+      void setInitiationInterval(int ii);
+      
       int getFunctionType();
       void setFunctionType(int t);
       
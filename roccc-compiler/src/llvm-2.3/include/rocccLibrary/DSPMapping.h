@@ -0,0 +1,41 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+Recognizes the operations that can be absorbed into a DSP block when the
+DSPMapping low level optimization is selected. A DSP block is a multiplier
+with an optional pre-adder on one input and an optional post-adder on the
+output, and registers in between each of them:
+
+  A, D regs -> pre-adder -> AD reg -> multiply -> M reg -> post-adder -> P reg
+
+The values given to DSPMapping are the widths of the two multiplier inputs;
+by default these are 25 and 18 bits.
+
+*/
+
+#ifndef _DSP_MAPPING_DOT_H__
+#define _DSP_MAPPING_DOT_H__
+
+#include "llvm/Instruction.h"
+
+namespace ROCCC {
+
+//returns true if inst is a multiply of two variables that fits in a DSP block
+bool isDSPMultiply(llvm::Instruction* inst);
+
+//returns true if inst is an add or subtract whose only use is a DSP multiply
+bool isDSPPreAdder(llvm::Instruction* inst);
+
+//returns true if inst adds or subtracts a DSP multiply that is used nowhere
+//  else, forming a multiply-accumulate
+bool isDSPPostAdder(llvm::Instruction* inst);
+
+//returns true if inst is any of the above
+bool isDSPMapped(llvm::Instruction* inst);
+
+}
+
+#endif
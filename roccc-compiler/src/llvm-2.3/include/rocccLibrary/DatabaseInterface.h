@@ -54,6 +54,7 @@ namespace Database
     std::list<Port*> address_channels_base;
     std::list<Port*> address_channels_count;
     std::list<Port*> data_channels;
+    Port* element_enable; //null, unless a packed output stream
   public:
     Stream(std::list<Port*> ports); //takes a list of ports all related to the stream, and puts them in the correct place
     std::string getName() const;
@@ -68,6 +69,7 @@ namespace Database
     const std::list<Port*>& getDataChannels() const;
     const std::list<Port*>& getAddressChannelsBase() const;
     const std::list<Port*>& getAddressChannelsCount() const;
+    Port* getElementEnable() const;
   };
   
   //TODO - implement
@@ -88,7 +90,7 @@ namespace Database
   public:
     enum TYPE {MODULE, SYSTEM, 
                INT_DIV, INT_MOD, 
-               FP_ADD, FP_SUB, FP_MUL, FP_DIV,
+               FP_ADD, FP_SUB, FP_MUL, FP_DIV, FP_FMA,
                FP_EQ, FP_NEQ, FP_GT, FP_LT, FP_GTE, FP_LTE,
                FP_TO_INT, INT_TO_FP, FP_TO_FP, INT_TO_INT, DOUBLE_VOTE, TRIPLE_VOTE, MONSTER_VOTE, STREAM_SPLITTER, STREAM_DOUBLE_VOTE, STREAM_TRIPLE_VOTE};
   private:
@@ -0,0 +1,52 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+Sizes a fifo from the rates and latencies of the producer that writes it and
+the consumer that reads it. All amounts are in fifo words and in cycles.
+
+Full has to be raised while there is still room for every word the producer
+writes before it reacts to full: everything it has already requested, plus
+whatever it writes during the latency of the full flag.
+
+Above that slack, the fifo has to hold:
+  - a whole burst, so that a consumer that waits for a burst can start and
+    the producer can write the next burst while the last one drains;
+  - when the consumer is slower than the producer, the backlog each burst
+    leaves behind, burst * (1 - producer_interval / consumer_interval);
+  - enough words to keep the consumer busy over the round trip after it
+    frees space: the full flag, the producer's pipeline and the consumer's
+    pipeline all have to be traversed before the freed space is refilled.
+
+*/
+
+#ifndef _FIFO_SIZING_DOT_H__
+#define _FIFO_SIZING_DOT_H__
+
+namespace ROCCC {
+
+struct FifoRates {
+  int burst_words;        //words written, or waited for, at once
+  int in_flight_words;    //words the producer writes even after it sees full
+  int producer_latency;   //cycles from the producer being let go to its next write
+  int producer_interval;  //cycles between two writes of the producer
+  int consumer_latency;   //cycles from a word being written to the consumer using it
+  int consumer_interval;  //cycles between two reads of the consumer
+  int full_flag_latency;  //cycles from the fifo filling up to the producer seeing full
+  FifoRates(int burst, int in_flight, int producer_lat, int producer_int, int consumer_lat, int consumer_int, int flag_lat);
+};
+
+//the number of words that are still free when full is raised
+int getFifoFullSlack(const FifoRates& rates);
+
+//the number of words the fifo has to hold, including the full slack
+int getFifoDepth(const FifoRates& rates);
+
+//the number of address bits of a fifo that holds at least depth words
+int getFifoAddressWidth(int depth);
+
+}
+
+#endif
@@ -6,5 +6,10 @@
 int getIVStepSize(llvm::Value* inst);
 int getIVStartValue(llvm::Value* inst);
 int getIVEndValue(llvm::Value* inst);
+//finds the lowest and highest values a loop induction variable can take,
+//  from its start value, its step, and the constant it is compared to in the
+//  loop header. Returns false if the variable is not an induction variable
+//  with constant bounds.
+bool getIVRange(llvm::Value* inst, long long& low, long long& high);
 
 #endif
@@ -0,0 +1,32 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+Provides access to the low level optimizations that were selected for the
+current compile. These are stored in .ROCCC/.optlo, one optimization per
+line, optionally followed by the values given to that optimization:
+
+  CopyReduction
+  FanoutTreeGeneration 50
+
+*/
+
+#ifndef _LO_OPTIMIZATION_FLAGS_DOT_H__
+#define _LO_OPTIMIZATION_FLAGS_DOT_H__
+
+#include <string>
+
+namespace ROCCC {
+
+//returns whether the named low level optimization was selected
+bool isLoOptimizationSelected(std::string name);
+
+//returns the n-th value given to the named low level optimization, or
+//  defaultValue if the optimization was not selected or has no such value
+float getLoOptimizationValue(std::string name, float defaultValue, unsigned int n = 0);
+
+}
+
+#endif
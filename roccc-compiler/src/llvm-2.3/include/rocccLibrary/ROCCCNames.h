@@ -82,6 +82,7 @@ static const std::string InfiniteLoopCondition;
 static const std::string NumberOfOutstandingMemoryRequests;
 static const std::string NumberOfDataChannels;
 static const std::string NumberOfAddressChannels;
+static const std::string GatherIndex;
 };
 
 #endif
@@ -72,6 +72,7 @@ entity OutputStream is
       channel_in : in STD_LOGIC_VECTOR((NUM_CHANNELS * CHANNEL_BITWIDTH) - 1 downto 0);
       address_in : in STD_LOGIC_VECTOR(NUM_CHANNELS * 32 - 1 downto 0);
       read_in : in STD_LOGIC;
+      enable_in : in STD_LOGIC_VECTOR(NUM_CHANNELS - 1 downto 0) := (others => '1');
       OUTPUT_CORRECT : in t_1D_output_memory_type(0 to NUM_MEMORY_ELEMENTS - 1)
       );
 end entity;
@@ -113,7 +114,9 @@ begin
 		if( read_in = '1' ) then
 		  for n in 1 to NUM_CHANNELS
 		  loop
-		    if( conv_integer(address_in(n * 32 - 1 downto (n-1) * 32)) < NUM_MEMORY_ELEMENTS ) then
+		    if( enable_in(n-1) = '0' ) then
+			   null;
+		    elsif( conv_integer(address_in(n * 32 - 1 downto (n-1) * 32)) < NUM_MEMORY_ELEMENTS ) then
 			   OUTPUT_MEMORY(conv_integer(address_in(n * 32 - 1 downto (n-1) * 32))) := channel_in(n * CHANNEL_BITWIDTH - 1 downto (n-1) * CHANNEL_BITWIDTH);
 			 else
 			   report "Address too large in "&STREAM_NAME&"["&integer'image(conv_integer(address_in(n * 32 - 1 downto (n-1) * 32)))&"]";
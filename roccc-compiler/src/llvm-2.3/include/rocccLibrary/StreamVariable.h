@@ -21,8 +21,11 @@ struct StreamVariable {
   VHDLInterface::Variable* address_rdy;
   //address_channels is now the pair <base,count>
   std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > address_channels;
+  //one bit per data channel of a packed output stream, set for the elements
+  //  of each word that are written; NULL if the stream is not packed
+  VHDLInterface::Variable* element_enable;
   
-  StreamVariable(std::string rn="", llvm::Value* v=NULL) : readableName(rn), value(v), cross_clk(NULL), stop_access(NULL), enable_access(NULL), address_clk(NULL), address_stall(NULL), address_rdy(NULL) {}
+  StreamVariable(std::string rn="", llvm::Value* v=NULL) : readableName(rn), value(v), cross_clk(NULL), stop_access(NULL), enable_access(NULL), address_clk(NULL), address_stall(NULL), address_rdy(NULL), element_enable(NULL) {}
 };
 
 }
@@ -0,0 +1,47 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+TimingInfo provides an easy interface to the timing configuration file,
+.ROCCC/.timingInfo, which gives the delay of each type of operation and the
+number of operations to place in each pipeline stage:
+
+  Add 1
+  Mult 4
+  OperationsPerPipelineStage 2.5
+
+*/
+
+#ifndef _TIMING_INFO_DOT_H__
+#define _TIMING_INFO_DOT_H__
+
+#include <string>
+#include <map>
+
+namespace ROCCC {
+
+class TimingInfo {
+  std::map<std::string, int> timing;
+  float operationsPerPipelineStage;
+  int getDelayOfType(std::string type);
+public:
+  TimingInfo();
+  int getCopyDelay();
+  int getAddDelay();
+  int getSubDelay();
+  int getMulDelay();
+  int getShiftDelay();
+  int getAndDelay();
+  int getOrDelay();
+  int getXorDelay();
+  int getCmpDelay();
+  int getMuxDelay();
+  int getMaximumDelay();
+  float getOperationsPerPipelineStage();
+};
+
+}
+
+#endif
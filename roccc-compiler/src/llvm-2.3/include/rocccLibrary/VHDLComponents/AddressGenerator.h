@@ -30,6 +30,13 @@ protected:
 public:
   AddressGenerator(llvm::Value* v);
   void initializeVHDLInterface(VHDLInterface::Variable* rdy, VHDLInterface::Variable* stall, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > base_count_pair);
+  //request whole words of the given number of elements; valid, offset, and
+  //  count are written with every request, and hold the request's element
+  //  offset into its first word and its element count
+  void setWordRequests(int elements, VHDLInterface::Variable* valid, VHDLInterface::Variable* offset, VHDLInterface::Variable* count);
+  //merge contiguous requests into bursts of up to the given number of
+  //  elements; the MaxBurstLength flag can only lengthen them
+  void setMaxBurstLength(int length);
   virtual void createVHDL(VHDLInterface::Entity* parent, LoopInductionVariableHandler* livHandler, BufferSpaceAccesser window_accesser, BufferSpaceAccesser step_accesser, VHDLInterface::Variable* clk)=0;
 };
 
@@ -9,7 +9,14 @@ class BRAMFifo : public VHDLInterface::ComponentDeclaration {
   class BRAMFifo_impl;
   BRAMFifo_impl* impl;
 public:
-  BRAMFifo(int data_width, int data_depth); //search database for bram with width and depth
+  //search database for bram with width and depth; full is raised once fewer
+  //  than full_slack words are free. Shallow fifos are built from
+  //  distributed ram instead.
+  BRAMFifo(int data_width, int data_depth, int full_slack = 128);
+  static int getMaximumDepth();
+  //cycles from the fifo filling up to a writer with a registered write
+  //  enable having seen full
+  static int getFullFlagLatency();
   VHDLInterface::Port* getRst();
   VHDLInterface::Port* getRClk();
   VHDLInterface::Port* getEmptyOut();
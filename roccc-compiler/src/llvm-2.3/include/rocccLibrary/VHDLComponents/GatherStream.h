@@ -0,0 +1,66 @@
+#ifndef _GATHER_STREAM_H__
+#define _GATHER_STREAM_H__
+
+#include "rocccLibrary/VHDLInterface.h"
+#include <string>
+
+//reads a gathered stream, A[B[i]], one element per index. The indexes are
+//  read from a fifo holding the elements of B, and each one is sent to
+//  memory as a request for a single element without waiting for the data
+//  of the requests before it; a queue of tags, in index order, bounds the
+//  requests in flight to DEPTH. When CACHE_LINES is not 0, the most recent
+//  element of each line of a small direct mapped cache is kept on chip, and
+//  indexes that hit in it are not requested again. The elements are
+//  presented to the smart buffer, in index order, as a fifo.
+class GatherStream {
+  int INDEX_WIDTH;
+  int DATA_WIDTH;
+  int DEPTH;
+  int CACHE_LINES;
+  VHDLInterface::Variable* clk;
+  VHDLInterface::Variable* rst;
+  //the index side, which runs on the address clock
+  VHDLInterface::Variable* address_clk;
+  VHDLInterface::Variable* index_empty_in;
+  VHDLInterface::Variable* index_read_enable_out;
+  VHDLInterface::Variable* index_data_in;
+  VHDLInterface::Variable* address_rdy_out;
+  VHDLInterface::Variable* address_stall_in;
+  VHDLInterface::Variable* address_base_out;
+  VHDLInterface::Variable* address_count_out;
+  //the data side, which reads the elements returned by memory
+  VHDLInterface::Variable* data_empty_in;
+  VHDLInterface::Variable* data_read_enable_out;
+  VHDLInterface::Variable* data_in;
+  //the side presented to the smart buffer
+  VHDLInterface::Variable* output_read_enable_in;
+  VHDLInterface::Variable* output_empty_out;
+  VHDLInterface::Variable* output_data_out;
+  std::string name;
+public:
+  GatherStream(std::string n);
+  static int getMaximumDepth();
+  int getLineWidth();
+  void mapIndexWidth(int iw);
+  void mapDataWidth(int dw);
+  void mapDepth(int d);
+  void mapCacheLines(int l);
+  void mapClk(VHDLInterface::Variable* c);
+  void mapRst(VHDLInterface::Variable* r);
+  void mapAddressClk(VHDLInterface::Variable* c);
+  void mapIndexEmptyIn(VHDLInterface::Variable* e);
+  void mapIndexReadEnableOut(VHDLInterface::Variable* r);
+  void mapIndexDataIn(VHDLInterface::Variable* dat);
+  void mapAddressRdyOut(VHDLInterface::Variable* r);
+  void mapAddressStallIn(VHDLInterface::Variable* s);
+  void mapAddressOut(VHDLInterface::Variable* base, VHDLInterface::Variable* count);
+  void mapDataEmptyIn(VHDLInterface::Variable* e);
+  void mapDataReadEnableOut(VHDLInterface::Variable* r);
+  void mapDataIn(VHDLInterface::Variable* dat);
+  void mapOutputReadEnableIn(VHDLInterface::Variable* r);
+  void mapOutputEmptyOut(VHDLInterface::Variable* e);
+  void mapOutputDataOut(VHDLInterface::Variable* dat);
+  void generateCode(VHDLInterface::Entity* e);
+};
+
+#endif
@@ -19,9 +19,12 @@ class InputSmartBuffer : public FifoInterfaceBlock<llvm::Value*,int> {
     AddressVariables();
   };
   std::map<llvm::Value*, AddressVariables> addressVariables;
+  std::map<llvm::Value*, int> packingFactors;
 public:
   InputSmartBuffer();
   void setAddressVariables(llvm::Value* stream, VHDLInterface::Variable* rdy, VHDLInterface::Variable* stall, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > base_count_pair, VHDLInterface::Variable* clk);
+  //each word read from the stream's fifo holds this many elements
+  void setPackingFactor(llvm::Value* stream, int factor);
   void generateVHDL(VHDLInterface::Entity* e, llvm::ROCCCLoopInformation &loopInfo);
 };
 
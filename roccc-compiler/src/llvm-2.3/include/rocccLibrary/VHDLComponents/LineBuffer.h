@@ -0,0 +1,34 @@
+#ifndef _LINE_BUFFER_H__
+#define _LINE_BUFFER_H__
+
+#include "rocccLibrary/VHDLInterface.h"
+#include <string>
+
+//delays a stream by one row of an image, keeping the row in an inferred
+//  block RAM instead of registers. Every time enable_in is high, data_in is
+//  written and the element written last_address_in+1 enables ago is read out.
+class LineBuffer {
+  int DATA_WIDTH;
+  int DEPTH;
+  VHDLInterface::Variable* rst;
+  VHDLInterface::Variable* clk;
+  VHDLInterface::Variable* enable_in;
+  VHDLInterface::Variable* last_address_in;
+  VHDLInterface::Variable* data_in;
+  VHDLInterface::Variable* data_out;
+  std::string name;
+public:
+  LineBuffer(std::string n);
+  int getAddressWidth();
+  void mapDataWidth(int dw);
+  void mapDepth(int d);
+  void mapRst(VHDLInterface::Variable* r);
+  void mapClk(VHDLInterface::Variable* c);
+  void mapEnableIn(VHDLInterface::Variable* e);
+  void mapLastAddressIn(VHDLInterface::Variable* l);
+  void mapDataIn(VHDLInterface::Variable* dat);
+  void mapDataOut(VHDLInterface::Variable* dat);
+  void generateCode(VHDLInterface::Entity* e);
+};
+
+#endif
@@ -18,9 +18,13 @@ class OutputSmartBuffer : public FifoInterfaceBlock<int,llvm::Value*> {
     AddressVariables();
   };
   std::map<llvm::Value*, AddressVariables> addressVariables;
+  std::map<llvm::Value*, int> packingFactors;
 public:
   OutputSmartBuffer();
   void setAddressVariables(llvm::Value* stream, VHDLInterface::Variable* rdy, VHDLInterface::Variable* stall, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > base_count_pair, VHDLInterface::Variable* clk);
+  //each word written to the stream's fifo holds this many elements, followed by
+  //  an enable for each of them
+  void setPackingFactor(llvm::Value* stream, int factor);
   void generateVHDL(VHDLInterface::Entity* e, llvm::ROCCCLoopInformation &loopInfo);
 };
 
@@ -0,0 +1,64 @@
+#ifndef _PING_PONG_BUFFER_H__
+#define _PING_PONG_BUFFER_H__
+
+#include "rocccLibrary/VHDLInterface.h"
+#include <string>
+
+//connects the output stream of one module to the input stream of another
+//  through two banks of block RAM, so that the consumer can read a block in
+//  any order. The producer fills one bank while the consumer reads the
+//  other; a bank is handed over once the producer has written DEPTH
+//  elements to it (or fewer, when the producer is done), and handed back
+//  once the consumer has read as many elements as were written. Each side
+//  hands over blocks of DEPTH consecutive addresses, starting at the first
+//  address it is given, and elements are placed in a bank by their offset
+//  from the start of their block. The address requests of each side are
+//  queued, and no request may be longer than DEPTH, so that each one ends
+//  within the two blocks in use.
+class PingPongBuffer {
+  int DATA_WIDTH;
+  int DEPTH;
+  VHDLInterface::Variable* clk;
+  VHDLInterface::Variable* rst;
+  VHDLInterface::Variable* producer_done_in;
+  //the producer side, which reads from the producer's output stream
+  VHDLInterface::Variable* input_empty_in;
+  VHDLInterface::Variable* input_read_enable_out;
+  VHDLInterface::Variable* input_data_in;
+  VHDLInterface::Variable* input_address_rdy_in;
+  VHDLInterface::Variable* input_address_stall_out;
+  VHDLInterface::Variable* input_address_base_in;
+  VHDLInterface::Variable* input_address_count_in;
+  //the consumer side, which writes into the consumer's input stream
+  VHDLInterface::Variable* output_full_in;
+  VHDLInterface::Variable* output_write_enable_out;
+  VHDLInterface::Variable* output_data_out;
+  VHDLInterface::Variable* output_address_rdy_in;
+  VHDLInterface::Variable* output_address_stall_out;
+  VHDLInterface::Variable* output_address_base_in;
+  VHDLInterface::Variable* output_address_count_in;
+  std::string name;
+public:
+  PingPongBuffer(std::string n);
+  int getAddressWidth();
+  void mapDataWidth(int dw);
+  void mapDepth(int d);
+  void mapClk(VHDLInterface::Variable* c);
+  void mapRst(VHDLInterface::Variable* r);
+  void mapProducerDoneIn(VHDLInterface::Variable* d);
+  void mapInputEmptyIn(VHDLInterface::Variable* e);
+  void mapInputReadEnableOut(VHDLInterface::Variable* r);
+  void mapInputDataIn(VHDLInterface::Variable* dat);
+  void mapInputAddressRdyIn(VHDLInterface::Variable* r);
+  void mapInputAddressStallOut(VHDLInterface::Variable* s);
+  void mapInputAddressIn(VHDLInterface::Variable* base, VHDLInterface::Variable* count);
+  void mapOutputFullIn(VHDLInterface::Variable* f);
+  void mapOutputWriteEnableOut(VHDLInterface::Variable* w);
+  void mapOutputDataOut(VHDLInterface::Variable* dat);
+  void mapOutputAddressRdyIn(VHDLInterface::Variable* r);
+  void mapOutputAddressStallOut(VHDLInterface::Variable* s);
+  void mapOutputAddressIn(VHDLInterface::Variable* base, VHDLInterface::Variable* count);
+  void generateCode(VHDLInterface::Entity* e);
+};
+
+#endif
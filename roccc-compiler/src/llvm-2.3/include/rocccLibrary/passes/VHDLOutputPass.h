@@ -45,6 +45,10 @@ namespace llvm
     VHDLInterface::ComponentDefinition* loopComponent;
     VHDLInterface::ComponentDefinition* inputComponent;
     VHDLInterface::ComponentDefinition* outputComponent;
+    //when the elastic pipeline is used, the stall of the inputController
+    //  is driven by the skid buffers of the first pipeline stage
+    bool elasticPipeline;
+    VHDLInterface::Signal* elasticInputStall;
 
     // These are the main entry points for outputting all VHDL
     void OutputBlock(DFFunction* f) ;
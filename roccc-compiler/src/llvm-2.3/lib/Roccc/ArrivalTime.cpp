@@ -0,0 +1,88 @@
+#include "rocccLibrary/ArrivalTime.h"
+
+#include "llvm/Instructions.h"
+#include "llvm/InstrTypes.h"
+
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/CopyValue.h"
+
+namespace ROCCC {
+
+TimingInfo& ArrivalTime::getTimingInfo()
+{
+  return timing;
+}
+
+int ArrivalTime::getDelay(llvm::Instruction* I)
+{
+  llvm::CallInst* CI = dynamic_cast<llvm::CallInst*>(I);
+  if( isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+    return timing.getMuxDelay();
+  if( dynamic_cast<llvm::CmpInst*>(I) )
+    return timing.getCmpDelay();
+  if( dynamic_cast<llvm::CastInst*>(I) or isCopyValue(I) )
+    return timing.getCopyDelay();
+  llvm::BinaryOperator* BO = dynamic_cast<llvm::BinaryOperator*>(I);
+  if( !BO )
+    return 0;
+  switch(BO->getOpcode())
+  {
+    case llvm::BinaryOperator::Add:
+      return timing.getAddDelay();
+    case llvm::BinaryOperator::Sub:
+      return timing.getSubDelay();
+    case llvm::BinaryOperator::Mul:
+      return timing.getMulDelay();
+    case llvm::BinaryOperator::Shl:
+    case llvm::BinaryOperator::LShr:
+    case llvm::BinaryOperator::AShr:
+      return timing.getShiftDelay();
+    case llvm::BinaryOperator::And:
+      return timing.getAndDelay();
+    case llvm::BinaryOperator::Or:
+      return timing.getOrDelay();
+    case llvm::BinaryOperator::Xor:
+      return timing.getXorDelay();
+    default:
+      return 0;
+  }
+}
+
+int ArrivalTime::get(llvm::Value* v)
+{
+  llvm::Instruction* I = dynamic_cast<llvm::Instruction*>(v);
+  if( !I or dynamic_cast<llvm::PHINode*>(I) or dynamic_cast<llvm::LoadInst*>(I) )
+    return 0;
+  llvm::CallInst* CI = dynamic_cast<llvm::CallInst*>(I);
+  if( CI and !isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+    return 0;
+  std::map<llvm::Value*,int>::iterator found = arrival.find(v);
+  if( found != arrival.end() )
+    return found->second;
+  arrival[v] = 0; //guards against cycles
+  int latest = 0;
+  for(llvm::User::op_iterator OI = I->op_begin(); OI != I->op_end(); ++OI)
+  {
+    int t = get(*OI);
+    if( t > latest )
+      latest = t;
+  }
+  return (arrival[v] = latest + getDelay(I));
+}
+
+void ArrivalTime::set(llvm::Value* v, int time)
+{
+  arrival[v] = time;
+}
+
+void ArrivalTime::erase(llvm::Value* v)
+{
+  arrival.erase(v);
+}
+
+void ArrivalTime::clear()
+{
+  arrival.clear();
+}
+
+}
@@ -3,6 +3,7 @@
 #include "rocccLibrary/DatabaseHelpers.h"
 #include <sstream>
 #include <fstream>
+#include <iomanip>
 #include <cstdlib>
 
 using namespace VHDLInterface;
@@ -11,9 +12,45 @@ class BRAMFifo::BRAMFifo_impl {
 public:
   int data_width;
   int data_depth;
-  BRAMFifo_impl(int dw, int dd) : data_width(dw), data_depth(dd) {}
+  int full_slack;
+  BRAMFifo_impl(int dw, int dd, int fs) : data_width(dw), data_depth(dd), full_slack(fs) {}
 };
 
+//Fifos that are at most this deep are built from distributed ram instead
+//  of a block ram primitive, as a FIFO18E1 per 36 bit slice is the smallest
+//  block ram fifo there is.
+static const int DISTRIBUTED_MAXIMUM_DEPTH = 32;
+static bool isDistributed(int data_depth)
+{
+  return data_depth <= DISTRIBUTED_MAXIMUM_DEPTH;
+}
+//Distributed fifos are a power of two deep. Each 36 bit slice of a block
+//  ram fifo is one FIFO18E1 (512 deep) or, when that is not deep enough, one
+//  FIFO36E1 (1024 deep).
+static int getPrimitiveDepth(int data_depth)
+{
+  if( isDistributed(data_depth) )
+  {
+    int depth = 4;
+    while( depth < data_depth )
+      depth *= 2;
+    return depth;
+  }
+  return (data_depth <= 512) ? 512 : 1024;
+}
+//The almost full offset of the primitives must stay between 4 and 4 less
+//  than the depth; a distributed fifo only needs one word on either side.
+static int getPrimitiveFullSlack(int data_depth, int full_slack)
+{
+  int primitive_depth = getPrimitiveDepth(data_depth);
+  int margin = isDistributed(data_depth) ? 1 : 4;
+  if( full_slack < margin )
+    return margin;
+  if( full_slack > primitive_depth - margin )
+    return primitive_depth - margin;
+  return full_slack;
+}
+
 class BRAMDriverOwner : public VHDLInterface::ValueOwner {
 public:
   virtual std::string getName(); //from ValueOwner
@@ -28,8 +65,146 @@ std::string int2str(int data_width)
   ss << data_width;
   return ss.str();
 }
-BRAMFifo::BRAMFifo(int data_width, int data_depth) : ComponentDeclaration("InferredBRAMFifo"+int2str(data_width)), impl(new BRAMFifo::BRAMFifo_impl(data_width, data_depth))
+//fifos that are not the default 512 deep with 128 words of slack get their
+//  own entity, as the primitives are configured inside the entity
+static std::string getBRAMFifoName(int data_width, int data_depth, int full_slack)
+{
+  if( isDistributed(data_depth) )
+    return "InferredLUTFifo"+int2str(data_width)+"_"+int2str(getPrimitiveDepth(data_depth))+"_"+int2str(getPrimitiveFullSlack(data_depth, full_slack));
+  std::string name = "InferredBRAMFifo"+int2str(data_width);
+  if( getPrimitiveDepth(data_depth) != 512 or getPrimitiveFullSlack(data_depth, full_slack) != 128 )
+    name += "_"+int2str(getPrimitiveDepth(data_depth))+"_"+int2str(getPrimitiveFullSlack(data_depth, full_slack));
+  return name;
+}
+//the fifo is held in reset until Clear_in has been high for five cycles
+static std::string getResetProcess()
+{
+  return "\
+process( WClk )\n\
+variable rst_buffer : STD_LOGIC_VECTOR(4 downto 0);\n\
+begin\n\
+  if( WClk'event and WClk = '1' )\n\
+  then\n\
+    rst_buffer(4 downto 0) := rst_buffer(3 downto 0) & Clear_in;\n\
+    fifo_rst <= rst_buffer(4) and rst_buffer(3) and rst_buffer(2) and rst_buffer(1) and rst_buffer(0);\n\
+  end if;\n\
+end process;\n";
+}
+/*
+A distributed fifo is an array of data_depth words with gray coded pointers
+that cross between the two clock domains through two registers each. Like
+the FIFO18E1 in standard mode, Data_out is valid the cycle after ReadEn_in,
+and Full_out is the registered almost full flag.
+*/
+static void writeDistributedArchitecture(std::ofstream& fout, int data_width, int data_depth, int full_slack)
 {
+  int aw = 0;
+  while( (1 << aw) < data_depth )
+    ++aw;
+  fout << "\
+type fifo_memory_type is array(0 to " << data_depth-1 << ") of STD_LOGIC_VECTOR(" << data_width-1 << " downto 0);\n\
+signal fifo_memory : fifo_memory_type;\n\
+attribute ram_style : string;\n\
+attribute ram_style of fifo_memory : signal is \"distributed\";\n\
+signal data_in_vector : STD_LOGIC_VECTOR(" << data_width-1 << " downto 0);\n\
+signal data_out_vector : STD_LOGIC_VECTOR(" << data_width-1 << " downto 0);\n\
+signal write_pointer, write_pointer_gray : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+signal read_pointer, read_pointer_gray : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+signal write_pointer_gray_sync0, write_pointer_gray_sync1 : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+signal read_pointer_gray_sync0, read_pointer_gray_sync1 : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+signal write_count : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+signal empty : STD_LOGIC;\n\
+function gray_to_binary(g : STD_LOGIC_VECTOR) return STD_LOGIC_VECTOR is\n\
+  variable b : STD_LOGIC_VECTOR(g'range);\n\
+begin\n\
+  b(g'high) := g(g'high);\n\
+  for i in g'high-1 downto g'low loop\n\
+    b(i) := b(i+1) xor g(i);\n\
+  end loop;\n\
+  return b;\n\
+end function;\n\
+begin\n" << getResetProcess();
+  if( data_width > 1 )
+    fout << "data_in_vector <= Data_in;\nData_out <= data_out_vector;\n";
+  else
+    fout << "data_in_vector(0) <= Data_in;\nData_out <= data_out_vector(0);\n";
+  fout << "\
+write_count <= write_pointer - gray_to_binary(read_pointer_gray_sync1);\n\
+process( WClk, fifo_rst )\n\
+  variable next_pointer : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+begin\n\
+  if( fifo_rst = '1' )\n\
+  then\n\
+    write_pointer <= (others => '0');\n\
+    write_pointer_gray <= (others => '0');\n\
+    read_pointer_gray_sync0 <= (others => '0');\n\
+    read_pointer_gray_sync1 <= (others => '0');\n\
+    Full_out <= '1';\n\
+  elsif( WClk'event and WClk = '1' )\n\
+  then\n\
+    read_pointer_gray_sync0 <= read_pointer_gray;\n\
+    read_pointer_gray_sync1 <= read_pointer_gray_sync0;\n\
+    if( WriteEn_in = '1' and write_count < " << data_depth << " )\n\
+    then\n\
+      fifo_memory(conv_integer(write_pointer(" << aw-1 << " downto 0))) <= data_in_vector;\n\
+      next_pointer := write_pointer + 1;\n\
+      write_pointer <= next_pointer;\n\
+      write_pointer_gray <= next_pointer xor ('0' & next_pointer(" << aw << " downto 1));\n\
+    end if;\n\
+    if( write_count >= " << data_depth - full_slack << " )\n\
+    then\n\
+      Full_out <= '1';\n\
+    else\n\
+      Full_out <= '0';\n\
+    end if;\n\
+  end if;\n\
+end process;\n\
+empty <= '1' when read_pointer_gray = write_pointer_gray_sync1 else '0';\n\
+Empty_out <= empty;\n\
+process( RClk, fifo_rst )\n\
+  variable next_pointer : STD_LOGIC_VECTOR(" << aw << " downto 0);\n\
+begin\n\
+  if( fifo_rst = '1' )\n\
+  then\n\
+    read_pointer <= (others => '0');\n\
+    read_pointer_gray <= (others => '0');\n\
+    write_pointer_gray_sync0 <= (others => '0');\n\
+    write_pointer_gray_sync1 <= (others => '0');\n\
+  elsif( RClk'event and RClk = '1' )\n\
+  then\n\
+    write_pointer_gray_sync0 <= write_pointer_gray;\n\
+    write_pointer_gray_sync1 <= write_pointer_gray_sync0;\n\
+    if( ReadEn_in = '1' and empty = '0' )\n\
+    then\n\
+      data_out_vector <= fifo_memory(conv_integer(read_pointer(" << aw-1 << " downto 0)));\n\
+      next_pointer := read_pointer + 1;\n\
+      read_pointer <= next_pointer;\n\
+      read_pointer_gray <= next_pointer xor ('0' & next_pointer(" << aw << " downto 1));\n\
+    end if;\n\
+  end if;\n\
+end process;\n\
+end architecture;\n";
+}
+
+int BRAMFifo::getMaximumDepth()
+{
+  return 1024;
+}
+int BRAMFifo::getFullFlagLatency()
+{
+  return 8;
+}
+BRAMFifo::BRAMFifo(int data_width, int data_depth, int full_slack) : ComponentDeclaration(getBRAMFifoName(data_width, data_depth, full_slack)), impl(new BRAMFifo::BRAMFifo_impl(data_width, data_depth, getPrimitiveFullSlack(data_depth, full_slack)))
+{
+  assert( data_depth <= getMaximumDepth() and "BRAM fifo is deeper than the largest fifo primitive!" );
+  //the primitive used for each slice, and the widths of its data ports
+  bool use_fifo36 = (getPrimitiveDepth(data_depth) > 512);
+  std::string primitive = use_fifo36 ? "FIFO36E1" : "FIFO18E1";
+  int di_width = use_fifo36 ? 64 : 32;
+  int dip_width = use_fifo36 ? 8 : 4;
+  std::string inst = primitive + "_inst";
+  std::stringstream full_offset;
+  full_offset << std::hex << std::uppercase << std::setw(4) << std::setfill('0') << impl->full_slack;
   //delete all the builtin ports
   this->getPorts().clear();
   //add in the new ports
@@ -100,27 +275,22 @@ entity " << this->getName() << " is\n\
 end entity;\n\
 architecture rtl of " << this->getName() << " is\n\
 signal fifo_rst : STD_LOGIC;\n";
+  if( isDistributed(data_depth) )
+  {
+    writeDistributedArchitecture(fout, data_width, getPrimitiveDepth(data_depth), impl->full_slack);
+    return;
+  }
   for(int fifo_count = 0; fifo_count * 36 < data_width; ++fifo_count)
   {
     fout << "\
-signal FIFO18E1_inst" << fifo_count << "_DI : STD_LOGIC_VECTOR(31 downto 0);\n\
-signal FIFO18E1_inst" << fifo_count << "_DO : STD_LOGIC_VECTOR(31 downto 0);\n\
-signal FIFO18E1_inst" << fifo_count << "_DIP : STD_LOGIC_VECTOR(3 downto 0);\n\
-signal FIFO18E1_inst" << fifo_count << "_DOP : STD_LOGIC_VECTOR(3 downto 0);\n\
-signal FIFO18E1_inst" << fifo_count << "_FULL : STD_LOGIC;\n\
-signal FIFO18E1_inst" << fifo_count << "_EMPTY : STD_LOGIC;\n";
+signal " << inst << fifo_count << "_DI : STD_LOGIC_VECTOR(" << di_width-1 << " downto 0);\n\
+signal " << inst << fifo_count << "_DO : STD_LOGIC_VECTOR(" << di_width-1 << " downto 0);\n\
+signal " << inst << fifo_count << "_DIP : STD_LOGIC_VECTOR(" << dip_width-1 << " downto 0);\n\
+signal " << inst << fifo_count << "_DOP : STD_LOGIC_VECTOR(" << dip_width-1 << " downto 0);\n\
+signal " << inst << fifo_count << "_FULL : STD_LOGIC;\n\
+signal " << inst << fifo_count << "_EMPTY : STD_LOGIC;\n";
   }
-fout << "\
-begin\n\
-process( WClk )\n\
-variable rst_buffer : STD_LOGIC_VECTOR(4 downto 0);\n\
-begin\n\
-  if( WClk'event and WClk = '1' )\n\
-  then\n\
-    rst_buffer(4 downto 0) := rst_buffer(3 downto 0) & Clear_in;\n\
-    fifo_rst <= rst_buffer(4) and rst_buffer(3) and rst_buffer(2) and rst_buffer(1) and rst_buffer(0);\n\
-  end if;\n\
-end process;\n";
+fout << "begin\n" << getResetProcess();
   for(int fifo_count = 0; fifo_count * 36 < data_width; ++fifo_count)
   {
     int cur_start = fifo_count * 36;
@@ -137,19 +307,24 @@ end process;\n";
     }
     if( cur_end - cur_start > 0 )
     {
-      fout << "FIFO18E1_inst" << fifo_count << "_DI(" << cur_end - cur_start - 1 << " downto 0) <= Data_in";
+      fout << inst << fifo_count << "_DI(" << cur_end - cur_start - 1 << " downto 0) <= Data_in";
       if( data_width > 1 )
         fout << "(" << cur_end - 1 << " downto " << cur_start << ")";
       fout << ";\n";
       fout << "Data_out";
       if( data_width > 1 )
         fout << "(" << cur_end - 1 << " downto " << cur_start << ")";
-      fout << " <= FIFO18E1_inst" << fifo_count << "_DO(" << cur_end - cur_start - 1 << " downto 0);\n"; 
+      fout << " <= " << inst << fifo_count << "_DO(" << cur_end - cur_start - 1 << " downto 0);\n"; 
     }
+    //the data ports are wider than the slice; tie off what it does not use
+    if( cur_end - cur_start < di_width )
+      fout << inst << fifo_count << "_DI(" << di_width - 1 << " downto " << cur_end - cur_start << ") <= (others => '0');\n";
+    if( size_of_parity < dip_width )
+      fout << inst << fifo_count << "_DIP(" << dip_width - 1 << " downto " << size_of_parity << ") <= (others => '0');\n";
     if( size_of_parity > 0 )
     {
-      fout << "FIFO18E1_inst" << fifo_count << "_DIP(" << size_of_parity - 1 << " downto 0) <= Data_in(" << cur_end + size_of_parity - 1 << " downto " << cur_end << ");\n";
-      fout << "Data_out(" << cur_end + size_of_parity - 1 << " downto " << cur_end << ") <= FIFO18E1_inst" << fifo_count << "_DOP(" << size_of_parity - 1 << " downto 0);\n";
+      fout << inst << fifo_count << "_DIP(" << size_of_parity - 1 << " downto 0) <= Data_in(" << cur_end + size_of_parity - 1 << " downto " << cur_end << ");\n";
+      fout << "Data_out(" << cur_end + size_of_parity - 1 << " downto " << cur_end << ") <= " << inst << fifo_count << "_DOP(" << size_of_parity - 1 << " downto 0);\n";
     }
   }
   fout << "\
@@ -162,7 +337,7 @@ begin\n\
   {
     if( fifo_count != 0 )
       fout << " or ";
-    fout << "FIFO18E1_inst" << fifo_count << "_FULL";
+    fout << inst << fifo_count << "_FULL";
   }
   fout << ";\n";
   fout << "\
@@ -173,29 +348,29 @@ end process;\n";
   {
     if( fifo_count != 0 )
       fout << " or ";
-    fout << "FIFO18E1_inst" << fifo_count << "_EMPTY";
+    fout << inst << fifo_count << "_EMPTY";
   }
   fout << ";\n";
   for(int fifo_count = 0; fifo_count * 36 < data_width; ++fifo_count)
   {
     fout << "\
-FIFO18E1_inst" << fifo_count << " : FIFO18E1 \
+" << inst << fifo_count << " : " << primitive << " \
 generic map (\n\
   DO_REG => 1, \n\
   EN_SYN => FALSE, \n\
-  FIFO_MODE => \"FIFO18_36\", \n\
-  ALMOST_FULL_OFFSET => X\"0080\", \n\
+  FIFO_MODE => \"" << (use_fifo36 ? "FIFO36" : "FIFO18_36") << "\", \n\
+  ALMOST_FULL_OFFSET => X\"" << full_offset.str() << "\", \n\
   ALMOST_EMPTY_OFFSET => X\"0080\", \n\
   DATA_WIDTH => 36, \n\
   FIRST_WORD_FALL_THROUGH => FALSE) \n\
 port map (\n\
   ALMOSTEMPTY => open, \n\
-  ALMOSTFULL => FIFO18E1_inst" << fifo_count << "_FULL, \n\
-  DI => FIFO18E1_inst" << fifo_count << "_DI,\n\
-  DO => FIFO18E1_inst" << fifo_count << "_DO,\n\
-  DIP => FIFO18E1_inst" << fifo_count << "_DIP,\n\
-  DOP => FIFO18E1_inst" << fifo_count << "_DOP,\n\
-  EMPTY => FIFO18E1_inst" << fifo_count << "_EMPTY, \n\
+  ALMOSTFULL => " << inst << fifo_count << "_FULL, \n\
+  DI => " << inst << fifo_count << "_DI,\n\
+  DO => " << inst << fifo_count << "_DO,\n\
+  DIP => " << inst << fifo_count << "_DIP,\n\
+  DOP => " << inst << fifo_count << "_DOP,\n\
+  EMPTY => " << inst << fifo_count << "_EMPTY, \n\
   FULL => open,\n\
   RDCOUNT => open, \n\
   RDERR => open, \n\
@@ -207,8 +382,17 @@ port map (\n\
   RDEN => ReadEn_in and not fifo_rst, \n\
   RST => fifo_rst, \n\
   WRCLK => WClk, \n\
-  WREN => WriteEn_in and not fifo_rst\n\
-);\n";
+  WREN => WriteEn_in and not fifo_rst";
+    if( use_fifo36 )
+    {
+      fout << ",\n\
+  DBITERR => open, \n\
+  ECCPARITY => open, \n\
+  SBITERR => open, \n\
+  INJECTDBITERR => '0', \n\
+  INJECTSBITERR => '0'";
+    }
+    fout << "\n);\n";
   }
   fout << "end architecture;\n";
 }
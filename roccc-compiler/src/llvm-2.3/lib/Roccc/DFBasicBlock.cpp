@@ -24,6 +24,8 @@ BasicBlock(Name, Parent, InsertBefore)
   pipelineLevel = -1 ;
   marked = false ;
   isSynch = false ;
+  arrivalTime = -1 ;
+  requiredTime = -1 ;
   new UnreachableInst( this );
 }
 
@@ -25,6 +25,7 @@ DFFunction::DFFunction(const FunctionType* Ty,
   source = NULL ;
   sink = NULL ;
   delay = -1 ;
+  initiationInterval = 1 ;
   functionType = -1 ;
 }
 // No destructor so the only destructor that gets called is the Function
@@ -71,6 +72,14 @@ void DFFunction::setDelay(int d)
 {
   delay = d ;
 }
+int DFFunction::getInitiationInterval()
+{
+  return initiationInterval ;
+}
+void DFFunction::setInitiationInterval(int ii)
+{
+  initiationInterval = ii ;
+}
 int DFFunction::getFunctionType()
 {
   return functionType;
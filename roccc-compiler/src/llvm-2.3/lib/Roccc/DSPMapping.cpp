@@ -0,0 +1,83 @@
+#include "rocccLibrary/DSPMapping.h"
+
+#include "llvm/Instructions.h"
+#include "llvm/Constants.h"
+
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/SizeInBits.h"
+#include "rocccLibrary/ROCCCNames.h"
+
+using namespace llvm;
+
+namespace ROCCC {
+
+//the only use of inst that is not a name, size, or signed call, or NULL if
+//  there are more than one
+static Instruction* getOnlyRealUse(Instruction* inst)
+{
+  Instruction* ret = NULL;
+  for(Value::use_iterator UI = inst->use_begin(); UI != inst->use_end(); ++UI)
+  {
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( isROCCCFunctionCall(CI, ROCCCNames::VariableName) or
+        isROCCCFunctionCall(CI, ROCCCNames::VariableSize) or
+        isROCCCFunctionCall(CI, ROCCCNames::VariableSigned) )
+      continue;
+    if( ret != NULL or !dynamic_cast<Instruction*>(*UI) )
+      return NULL;
+    ret = dynamic_cast<Instruction*>(*UI);
+  }
+  return ret;
+}
+
+static bool isIntegerAddOrSub(Instruction* inst)
+{
+  BinaryOperator* BO = dynamic_cast<BinaryOperator*>(inst);
+  return ( BO and BO->getType()->isInteger() and
+           (BO->getOpcode() == Instruction::Add or BO->getOpcode() == Instruction::Sub) );
+}
+
+bool isDSPMultiply(Instruction* inst)
+{
+  if( !isLoOptimizationSelected("DSPMapping") )
+    return false;
+  BinaryOperator* BO = dynamic_cast<BinaryOperator*>(inst);
+  if( !BO or BO->getOpcode() != Instruction::Mul or !BO->getType()->isInteger() )
+    return false;
+  //multiplies by constants are turned into shifts and adds
+  if( dynamic_cast<Constant*>(BO->getOperand(0)) or dynamic_cast<Constant*>(BO->getOperand(1)) )
+    return false;
+  int a = static_cast<int>(getLoOptimizationValue("DSPMapping", 25, 0));
+  int b = static_cast<int>(getLoOptimizationValue("DSPMapping", 18, 1));
+  int lhs = getSizeInBits(BO->getOperand(0));
+  int rhs = getSizeInBits(BO->getOperand(1));
+  return ( (lhs <= a and rhs <= b) or (lhs <= b and rhs <= a) );
+}
+
+bool isDSPPreAdder(Instruction* inst)
+{
+  if( !isIntegerAddOrSub(inst) )
+    return false;
+  Instruction* use = getOnlyRealUse(inst);
+  return ( use and isDSPMultiply(use) );
+}
+
+bool isDSPPostAdder(Instruction* inst)
+{
+  if( !isIntegerAddOrSub(inst) )
+    return false;
+  for(int op = 0; op < 2; ++op)
+  {
+    Instruction* mul = dynamic_cast<Instruction*>(inst->getOperand(op));
+    if( mul and isDSPMultiply(mul) and getOnlyRealUse(mul) == inst )
+      return true;
+  }
+  return false;
+}
+
+bool isDSPMapped(Instruction* inst)
+{
+  return ( isDSPMultiply(inst) or isDSPPreAdder(inst) or isDSPPostAdder(inst) );
+}
+
+}
@@ -14,7 +14,7 @@
 
 using namespace Database;
 
-Stream::Stream(std::list<Port*> ports) : cross_clk(NULL), stop_access(NULL), enable_access(NULL), address_clk(NULL), address_rdy(NULL), address_stall(NULL)
+Stream::Stream(std::list<Port*> ports) : cross_clk(NULL), stop_access(NULL), enable_access(NULL), address_clk(NULL), address_rdy(NULL), address_stall(NULL), element_enable(NULL)
 {
   assert(ports.begin() != ports.end() and "Cannot have empty port list when creating stream!");
   std::string readableName = (*ports.begin())->getReadableName();
@@ -88,6 +88,15 @@ Stream::Stream(std::list<Port*> ports) : cross_clk(NULL), stop_access(NULL), ena
     {
       data_channels.push_back(*PI);
     }
+    else if( type == "STREAM_ELEMENT_ENABLE" )
+    {
+      if( element_enable != NULL )
+      {
+        INTERNAL_ERROR("Element enable port " << (*PI)->getName() << " found for stream " << readableName << ", but element enable port " << element_enable->getName() << " already found!\n");
+      }
+      assert( element_enable == NULL and "More than one element enable port found for stream!" );
+      element_enable = (*PI);
+    }
     else
     {
       INTERNAL_ERROR("Type " << type << " of port " << (*PI)->getName() << " is unknown!\n");
@@ -154,6 +163,10 @@ const std::list<Port*>& Stream::getAddressChannelsCount() const
 {
   return address_channels_count;
 }
+Port* Stream::getElementEnable() const
+{
+  return element_enable;
+}
 
 LibraryEntry::LibraryEntry()
 {
@@ -196,6 +209,8 @@ name(n), delay(d), allPorts(p), type(MODULE), id(_id)
     type = LibraryEntry::FP_MUL;
   else if( st_type == "FP_DIV" )
     type = LibraryEntry::FP_DIV;
+  else if( st_type == "FP_FMA" )
+    type = LibraryEntry::FP_FMA;
   else if( st_type == "FP_EQUAL" )
     type = LibraryEntry::FP_EQ;
   else if( st_type == "FP_NOT_EQUAL" )
@@ -331,6 +346,7 @@ std::string LibraryEntry::convTypeToString(TYPE t)
     case LibraryEntry::FP_SUB:             return "FP_SUB";
     case LibraryEntry::FP_MUL:             return "FP_MUL";
     case LibraryEntry::FP_DIV:             return "FP_DIV";
+    case LibraryEntry::FP_FMA:             return "FP_FMA";
     case LibraryEntry::FP_EQ:              return "FP_EQUAL";
     case LibraryEntry::FP_NEQ:             return "FP_NOT_EQUAL";
     case LibraryEntry::FP_LT:              return "FP_LESS_THAN";
@@ -0,0 +1,47 @@
+#include "rocccLibrary/FifoSizing.h"
+
+#include <cassert>
+#include <algorithm>
+
+namespace ROCCC {
+
+static int divideRoundingUp(int n, int d)
+{
+  assert( d > 0 );
+  return (n + d - 1) / d;
+}
+
+FifoRates::FifoRates(int burst, int in_flight, int producer_lat, int producer_int, int consumer_lat, int consumer_int, int flag_lat) : burst_words(burst), in_flight_words(in_flight), producer_latency(producer_lat), producer_interval(producer_int), consumer_latency(consumer_lat), consumer_interval(consumer_int), full_flag_latency(flag_lat)
+{
+  assert( burst_words > 0 and in_flight_words >= 0 );
+  assert( producer_latency >= 0 and consumer_latency >= 0 and full_flag_latency >= 0 );
+  assert( producer_interval > 0 and consumer_interval > 0 );
+}
+
+int getFifoFullSlack(const FifoRates& rates)
+{
+  return rates.in_flight_words + divideRoundingUp(rates.full_flag_latency, rates.producer_interval);
+}
+
+int getFifoDepth(const FifoRates& rates)
+{
+  int backlog = 0;
+  if( rates.consumer_interval > rates.producer_interval )
+  {
+    backlog = divideRoundingUp(rates.burst_words * (rates.consumer_interval - rates.producer_interval), rates.consumer_interval);
+  }
+  int round_trip = rates.full_flag_latency + rates.producer_latency + rates.consumer_latency;
+  int refill = divideRoundingUp(round_trip, std::max(rates.consumer_interval, rates.producer_interval));
+  return getFifoFullSlack(rates) + std::max(rates.burst_words + backlog, refill);
+}
+
+int getFifoAddressWidth(int depth)
+{
+  assert( depth > 0 );
+  int width = 0;
+  while( (1 << width) < depth )
+    ++width;
+  return width;
+}
+
+}
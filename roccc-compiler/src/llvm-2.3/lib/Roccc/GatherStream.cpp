@@ -0,0 +1,345 @@
+#include "rocccLibrary/VHDLComponents/GatherStream.h"
+
+#include "rocccLibrary/VHDLComponents/VHDLComponents.h"
+#include "rocccLibrary/VHDLComponents/ArraySignal.h"
+#include "rocccLibrary/VHDLComponents/BRAMFifo.h"
+#include "rocccLibrary/VHDLComponents/MicroFifo.h"
+#include <assert.h>
+#include <sstream>
+#include <fstream>
+
+//the tags are queued in a single fifo primitive, which raises full once
+//  DEPTH tags are in it
+static const int TAG_QUEUE_DEPTH = 512;
+
+GatherStream::GatherStream(std::string n) : INDEX_WIDTH(0), DATA_WIDTH(0), DEPTH(0), CACHE_LINES(0), clk(NULL), rst(NULL),
+  address_clk(NULL), index_empty_in(NULL), index_read_enable_out(NULL), index_data_in(NULL), address_rdy_out(NULL), address_stall_in(NULL), address_base_out(NULL), address_count_out(NULL),
+  data_empty_in(NULL), data_read_enable_out(NULL), data_in(NULL),
+  output_read_enable_in(NULL), output_empty_out(NULL), output_data_out(NULL),
+  name(n)
+{
+}
+int GatherStream::getMaximumDepth()
+{
+  return TAG_QUEUE_DEPTH - 4;
+}
+//the number of bits of the index that select a line of the cache
+int GatherStream::getLineWidth()
+{
+  int width = 0;
+  while( (1 << width) < CACHE_LINES )
+    ++width;
+  return width;
+}
+void GatherStream::mapIndexWidth(int iw)
+{
+  INDEX_WIDTH = iw;
+}
+void GatherStream::mapDataWidth(int dw)
+{
+  DATA_WIDTH = dw;
+}
+void GatherStream::mapDepth(int d)
+{
+  assert( d > 0 );
+  DEPTH = (d > getMaximumDepth()) ? getMaximumDepth() : d;
+}
+//lines are selected by the low bits of the index, so the number of lines is
+//  rounded up to a power of two; 0 turns the cache off
+void GatherStream::mapCacheLines(int l)
+{
+  assert( l >= 0 );
+  CACHE_LINES = 0;
+  if( l > 0 )
+  {
+    CACHE_LINES = 2;
+    while( CACHE_LINES < l )
+      CACHE_LINES *= 2;
+  }
+}
+void GatherStream::mapClk(VHDLInterface::Variable* c)
+{
+  clk = c;
+}
+void GatherStream::mapRst(VHDLInterface::Variable* r)
+{
+  rst = r;
+}
+void GatherStream::mapAddressClk(VHDLInterface::Variable* c)
+{
+  address_clk = c;
+}
+void GatherStream::mapIndexEmptyIn(VHDLInterface::Variable* e)
+{
+  index_empty_in = e;
+}
+void GatherStream::mapIndexReadEnableOut(VHDLInterface::Variable* r)
+{
+  index_read_enable_out = r;
+}
+void GatherStream::mapIndexDataIn(VHDLInterface::Variable* dat)
+{
+  index_data_in = dat;
+  assert( index_data_in );
+  assert( index_data_in->getSize() == INDEX_WIDTH );
+}
+void GatherStream::mapAddressRdyOut(VHDLInterface::Variable* r)
+{
+  address_rdy_out = r;
+}
+void GatherStream::mapAddressStallIn(VHDLInterface::Variable* s)
+{
+  address_stall_in = s;
+}
+void GatherStream::mapAddressOut(VHDLInterface::Variable* base, VHDLInterface::Variable* count)
+{
+  address_base_out = base;
+  address_count_out = count;
+}
+void GatherStream::mapDataEmptyIn(VHDLInterface::Variable* e)
+{
+  data_empty_in = e;
+}
+void GatherStream::mapDataReadEnableOut(VHDLInterface::Variable* r)
+{
+  data_read_enable_out = r;
+}
+void GatherStream::mapDataIn(VHDLInterface::Variable* dat)
+{
+  data_in = dat;
+  assert( data_in );
+  assert( data_in->getSize() == DATA_WIDTH );
+}
+void GatherStream::mapOutputReadEnableIn(VHDLInterface::Variable* r)
+{
+  output_read_enable_in = r;
+}
+void GatherStream::mapOutputEmptyOut(VHDLInterface::Variable* e)
+{
+  output_empty_out = e;
+}
+void GatherStream::mapOutputDataOut(VHDLInterface::Variable* dat)
+{
+  output_data_out = dat;
+  assert( output_data_out );
+  assert( output_data_out->getSize() == DATA_WIDTH );
+}
+void GatherStream::generateCode(VHDLInterface::Entity* e)
+{
+  assert( clk );
+  assert( rst );
+  assert( address_clk );
+  assert( index_empty_in and index_read_enable_out and index_data_in );
+  assert( address_rdy_out and address_stall_in and address_base_out and address_count_out );
+  assert( data_empty_in and data_read_enable_out and data_in );
+  assert( output_read_enable_in and output_empty_out and output_data_out );
+  assert( INDEX_WIDTH > 0 and DATA_WIDTH > 0 and DEPTH > 0 );
+  assert( e );
+#ifndef INLINE_VHDL
+  //instead of using the values directly, lets create a GatherStream component and output it
+  std::stringstream ss;
+  ss << "GatherStream" << INDEX_WIDTH << "_" << DATA_WIDTH << "_" << DEPTH << "_" << CACHE_LINES;
+  VHDLInterface::Entity* ent = new VHDLInterface::Entity(ss.str());
+  VHDLInterface::ComponentDeclaration* dec = ent->getDeclaration();
+  dec->getPorts().clear();
+  VHDLInterface::ComponentDefinition* def = e->createComponent(name, dec);
+  VHDLInterface::Port* tmp;
+  tmp = dec->addPort("clk", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(clk, tmp); clk = tmp;
+  tmp = dec->addPort("rst", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(rst, tmp); rst = tmp;
+  tmp = dec->addPort("address_clk", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(address_clk, tmp); address_clk = tmp;
+  tmp = dec->addPort("index_empty_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(index_empty_in, tmp); index_empty_in = tmp;
+  tmp = dec->addPort("index_read_enable_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(index_read_enable_out, tmp); index_read_enable_out = tmp;
+  tmp = dec->addPort("index_data_in", INDEX_WIDTH, VHDLInterface::Port::INPUT, index_data_in->getLLVMValue(), false);
+  def->map(index_data_in, tmp); index_data_in = tmp;
+  tmp = dec->addPort("address_rdy_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(address_rdy_out, tmp); address_rdy_out = tmp;
+  tmp = dec->addPort("address_stall_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(address_stall_in, tmp); address_stall_in = tmp;
+  tmp = dec->addPort("address_base_out", address_base_out->getSize(), VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(address_base_out, tmp); address_base_out = tmp;
+  tmp = dec->addPort("address_count_out", address_count_out->getSize(), VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(address_count_out, tmp); address_count_out = tmp;
+  tmp = dec->addPort("data_empty_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(data_empty_in, tmp); data_empty_in = tmp;
+  tmp = dec->addPort("data_read_enable_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(data_read_enable_out, tmp); data_read_enable_out = tmp;
+  tmp = dec->addPort("data_in", DATA_WIDTH, VHDLInterface::Port::INPUT, data_in->getLLVMValue(), false);
+  def->map(data_in, tmp); data_in = tmp;
+  tmp = dec->addPort("output_read_enable_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(output_read_enable_in, tmp); output_read_enable_in = tmp;
+  tmp = dec->addPort("output_empty_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(output_empty_out, tmp); output_empty_out = tmp;
+  tmp = dec->addPort("output_data_out", DATA_WIDTH, VHDLInterface::Port::OUTPUT, output_data_out->getLLVMValue(), false);
+  def->map(output_data_out, tmp); output_data_out = tmp;
+  e = ent;
+#endif
+  bool cached = (CACHE_LINES > 0);
+  int lw = getLineWidth();
+  //each tag says whether its element hit in the cache, and which line holds it
+  VHDLInterface::BRAMFifo* tagDecl = new VHDLInterface::BRAMFifo(1 + lw, TAG_QUEUE_DEPTH, TAG_QUEUE_DEPTH - DEPTH);
+  VHDLInterface::ComponentDefinition* tagDef = tagDecl->getInstantiation(e);
+  tagDef->map(rst, tagDecl->getRst());
+  tagDef->map(address_clk, tagDecl->getWClk());
+  tagDef->map(clk, tagDecl->getRClk());
+  VHDLInterface::Variable* tag_full = e->getVariableMappedTo(tagDef, tagDecl->getFullOut());
+  VHDLInterface::Variable* tag_write = e->getVariableMappedTo(tagDef, tagDecl->getWriteEnIn());
+  VHDLInterface::Variable* tag_in = e->getVariableMappedTo(tagDef, tagDecl->getDataIn());
+  VHDLInterface::Variable* tag_empty = e->getVariableMappedTo(tagDef, tagDecl->getEmptyOut());
+  VHDLInterface::Variable* tag_read = e->getVariableMappedTo(tagDef, tagDecl->getReadEnIn());
+  VHDLInterface::Variable* tag_out = e->getVariableMappedTo(tagDef, tagDecl->getDataOut());
+  //the index side; the fifo holds its data out until the next read, so the
+  //  index being issued is the last one read
+  VHDLInterface::Signal* index_valid = e->createSignal<VHDLInterface::Signal>(name+"_index_valid", 1);
+  VHDLInterface::Signal* issue = e->createSignal<VHDLInterface::Signal>(name+"_issue", 1);
+  VHDLInterface::Signal* hit = e->createSignal<VHDLInterface::Signal>(name+"_hit", 1);
+  //the data side; the tag being merged is also held in the data out of the
+  //  tag queue, and the element it stands for is written to the output in the
+  //  cycle after it is merged
+  VHDLInterface::Signal* tag_valid = e->createSignal<VHDLInterface::Signal>(name+"_tag_valid", 1);
+  VHDLInterface::Signal* merge = e->createSignal<VHDLInterface::Signal>(name+"_merge", 1);
+  VHDLInterface::Signal* tag_hit = e->createSignal<VHDLInterface::Signal>(name+"_tag_hit", 1);
+  VHDLInterface::Signal* output_valid = e->createSignal<VHDLInterface::Signal>(name+"_output_valid", 1);
+  VHDLInterface::Signal* output_full = e->createSignal<VHDLInterface::Signal>(name+"_output_full", 1);
+  VHDLInterface::Signal* output_value = e->createSignal<VHDLInterface::Signal>(name+"_output_value", DATA_WIDTH);
+  e->createSynchronousStatement(tag_hit, VHDLInterface::BitRange::get(tag_out, lw, lw));
+  VHDLInterface::AssignmentStatement* issue_ass = e->createSynchronousStatement(issue);
+  issue_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(index_valid) == VHDLInterface::ConstantInt::get(0) or VHDLInterface::Wrap(tag_full) == VHDLInterface::ConstantInt::get(1));
+  VHDLInterface::AssignmentStatement* index_read_ass = e->createSynchronousStatement(index_read_enable_out);
+  index_read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(index_empty_in) == VHDLInterface::ConstantInt::get(1));
+  index_read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(index_valid) == VHDLInterface::ConstantInt::get(0) or VHDLInterface::Wrap(issue) == VHDLInterface::ConstantInt::get(1));
+  index_read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::AssignmentStatement* merge_ass = e->createSynchronousStatement(merge);
+  merge_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(tag_valid) == VHDLInterface::ConstantInt::get(0) or VHDLInterface::Wrap(output_full) == VHDLInterface::ConstantInt::get(1));
+  merge_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(tag_hit) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(data_empty_in) == VHDLInterface::ConstantInt::get(0));
+  merge_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::AssignmentStatement* tag_read_ass = e->createSynchronousStatement(tag_read);
+  tag_read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(tag_empty) == VHDLInterface::ConstantInt::get(1));
+  tag_read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(tag_valid) == VHDLInterface::ConstantInt::get(0) or VHDLInterface::Wrap(merge) == VHDLInterface::ConstantInt::get(1));
+  tag_read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //only the elements that missed were requested from memory
+  VHDLInterface::AssignmentStatement* data_read_ass = e->createSynchronousStatement(data_read_enable_out);
+  data_read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(merge) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(tag_hit) == VHDLInterface::ConstantInt::get(0));
+  data_read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::MultiStatementProcess* pi = e->createProcess<VHDLInterface::MultiStatementProcess>(address_clk);
+  VHDLInterface::MultiStatementProcess* pd = e->createProcess<VHDLInterface::MultiStatementProcess>(clk);
+  pi->addStatement(new VHDLInterface::IfStatement(pi, VHDLInterface::Wrap(index_read_enable_out) == VHDLInterface::ConstantInt::get(1),
+                    new VHDLInterface::AssignmentStatement(index_valid, VHDLInterface::ConstantInt::get(1), pi),
+                    new VHDLInterface::IfStatement(pi, VHDLInterface::Wrap(issue) == VHDLInterface::ConstantInt::get(1),
+                         new VHDLInterface::AssignmentStatement(index_valid, VHDLInterface::ConstantInt::get(0), pi)
+                    )
+                 ));
+  //a miss is requested as a single element at the index
+  pi->addStatement((new VHDLInterface::AssignmentStatement(address_rdy_out, pi))
+                    ->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(issue) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(hit) == VHDLInterface::ConstantInt::get(0))
+                    ->addCase(VHDLInterface::ConstantInt::get(0))
+                 );
+  pi->addStatement(new VHDLInterface::IfStatement(pi, VHDLInterface::Wrap(issue) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(pi))->addStatement(
+                         new VHDLInterface::AssignmentStatement(address_base_out, index_data_in, pi)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(address_count_out, VHDLInterface::ConstantInt::get(1), pi)
+                    )
+                 ));
+  pi->addStatement(new VHDLInterface::AssignmentStatement(tag_write, issue, pi));
+  pd->addStatement(new VHDLInterface::IfStatement(pd, VHDLInterface::Wrap(tag_read) == VHDLInterface::ConstantInt::get(1),
+                    new VHDLInterface::AssignmentStatement(tag_valid, VHDLInterface::ConstantInt::get(1), pd),
+                    new VHDLInterface::IfStatement(pd, VHDLInterface::Wrap(merge) == VHDLInterface::ConstantInt::get(1),
+                         new VHDLInterface::AssignmentStatement(tag_valid, VHDLInterface::ConstantInt::get(0), pd)
+                    )
+                 ));
+  pd->addStatement(new VHDLInterface::AssignmentStatement(output_valid, merge, pd));
+  if( !cached )
+  {
+    //every index is requested, and every element comes from memory
+    e->createSynchronousStatement(hit, VHDLInterface::ConstantInt::get(0));
+    issue_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(address_stall_in) == VHDLInterface::ConstantInt::get(0));
+    issue_ass->addCase(VHDLInterface::ConstantInt::get(0));
+    pi->addStatement(new VHDLInterface::AssignmentStatement(tag_in, hit, pi));
+    e->createSynchronousStatement(output_value, data_in);
+  }
+  else
+  {
+    //the tags and valid bits are kept on the index side, and the elements on
+    //  the data side; an element is written to its line before any tag that
+    //  hits on it is merged, as tags are merged in order
+    Array* tags = e->createSignal<Array>(name+"_cache_tags", INDEX_WIDTH);
+    tags->setNumElements(CACHE_LINES);
+    Array* valid = e->createSignal<Array>(name+"_cache_valid", 1);
+    valid->setNumElements(CACHE_LINES);
+    Array* elements = e->createSignal<Array>(name+"_cache_elements", DATA_WIDTH);
+    elements->setNumElements(CACHE_LINES);
+    VHDLInterface::Signal* line = e->createSignal<VHDLInterface::Signal>(name+"_line", lw);
+    VHDLInterface::Signal* cleared = e->createSignal<VHDLInterface::Signal>(name+"_cleared", 1);
+    VHDLInterface::Signal* clear_line = e->createSignal<VHDLInterface::Signal>(name+"_clear_line", lw);
+    VHDLInterface::Signal* tag_line = e->createSignal<VHDLInterface::Signal>(name+"_tag_line", lw);
+    VHDLInterface::Signal* merged_hit = e->createSignal<VHDLInterface::Signal>(name+"_merged_hit", 1);
+    VHDLInterface::Signal* merged_line = e->createSignal<VHDLInterface::Signal>(name+"_merged_line", lw);
+    VHDLInterface::Signal* cached_element = e->createSignal<VHDLInterface::Signal>(name+"_cached_element", DATA_WIDTH);
+    e->createSynchronousStatement(line, VHDLInterface::BitRange::get(index_data_in, lw-1, 0));
+    e->createSynchronousStatement(tag_line, VHDLInterface::BitRange::get(tag_out, lw-1, 0));
+    VHDLInterface::AssignmentStatement* hit_ass = e->createSynchronousStatement(hit);
+    hit_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(valid->getElement(line)) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(tags->getElement(line)) == VHDLInterface::Wrap(index_data_in));
+    hit_ass->addCase(VHDLInterface::ConstantInt::get(0));
+    //nothing is issued until the valid bits have been cleared after reset
+    issue_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(cleared) == VHDLInterface::ConstantInt::get(0));
+    issue_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(hit) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(address_stall_in) == VHDLInterface::ConstantInt::get(0));
+    issue_ass->addCase(VHDLInterface::ConstantInt::get(0));
+    pi->addStatement(new VHDLInterface::AssignmentStatement(tag_in, VHDLInterface::bitwise_concat(hit, line), pi));
+    pi->addStatement(new VHDLInterface::IfStatement(pi, VHDLInterface::Wrap(cleared) == VHDLInterface::ConstantInt::get(0),
+                      (new VHDLInterface::MultiStatement(pi))->addStatement(
+                           new VHDLInterface::AssignmentStatement(valid->getElement(clear_line), VHDLInterface::ConstantInt::get(0), pi)
+                      )->addStatement(
+                           new VHDLInterface::AssignmentStatement(clear_line, VHDLInterface::Wrap(clear_line) + VHDLInterface::ConstantInt::get(1), pi)
+                      )->addStatement(
+                           new VHDLInterface::IfStatement(pi, VHDLInterface::Wrap(clear_line) == VHDLInterface::ConstantInt::get(CACHE_LINES-1),
+                                new VHDLInterface::AssignmentStatement(cleared, VHDLInterface::ConstantInt::get(1), pi)
+                           )
+                      ),
+                      new VHDLInterface::IfStatement(pi, VHDLInterface::Wrap(issue) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(hit) == VHDLInterface::ConstantInt::get(0),
+                      (new VHDLInterface::MultiStatement(pi))->addStatement(
+                           new VHDLInterface::AssignmentStatement(valid->getElement(line), VHDLInterface::ConstantInt::get(1), pi)
+                      )->addStatement(
+                           new VHDLInterface::AssignmentStatement(tags->getElement(line), index_data_in, pi)
+                      ))
+                   ));
+    //the element of the tag merged last cycle is not in its line yet, so it
+    //  is forwarded to a hit on the same line
+    pd->addStatement(new VHDLInterface::AssignmentStatement(merged_hit, tag_hit, pd));
+    pd->addStatement(new VHDLInterface::AssignmentStatement(merged_line, tag_line, pd));
+    pd->addStatement((new VHDLInterface::AssignmentStatement(cached_element, pd))
+                      ->addCase(data_in, VHDLInterface::Wrap(output_valid) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(merged_hit) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(merged_line) == VHDLInterface::Wrap(tag_line))
+                      ->addCase(elements->getElement(tag_line))
+                   );
+    pd->addStatement(new VHDLInterface::IfStatement(pd, VHDLInterface::Wrap(output_valid) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(merged_hit) == VHDLInterface::ConstantInt::get(0),
+                      new VHDLInterface::AssignmentStatement(elements->getElement(merged_line), data_in, pd)
+                   ));
+    VHDLInterface::AssignmentStatement* value_ass = e->createSynchronousStatement(output_value);
+    value_ass->addCase(cached_element, VHDLInterface::Wrap(merged_hit) == VHDLInterface::ConstantInt::get(1));
+    value_ass->addCase(data_in);
+  }
+  //the merged elements are pushed onto a small fifo, which leaves room for
+  //  the element merged while it raises full
+  MicroFifo mfifo(name+"_micro_fifo");
+  mfifo.mapAddressWidth(3);
+  mfifo.mapAlmostFullCount(2);
+  mfifo.mapAlmostEmptyCount(0);
+  mfifo.mapDataWidth(DATA_WIDTH);
+  mfifo.mapClk(clk);
+  mfifo.mapRst(rst);
+  mfifo.mapDataIn(output_value);
+  mfifo.mapValidIn(output_valid);
+  mfifo.mapFullOut(output_full);
+  mfifo.mapDataOut(output_data_out);
+  mfifo.mapReadEnableIn(output_read_enable_in);
+  mfifo.mapEmptyOut(output_empty_out);
+  mfifo.generateCode(e);
+#ifndef INLINE_VHDL
+  std::ofstream fout((e->getDeclaration()->getName()+".vhdl").c_str());
+  fout << e->generateCode();
+#endif
+}
@@ -2,6 +2,7 @@
 
 #include "llvm/Constants.h"
 #include "llvm/Function.h"
+#include "llvm/Instructions.h"
 
 #include <map>
 
@@ -89,3 +90,90 @@ int getIVEndValue(llvm::Value* v)
   assert(0 and "getEndValue() not implemented!");
   return 0;
 }
+
+//the loop header ends with a branch on (cmp != 0), where cmp is either the
+//  comparison of the induction variable itself or a cast of it
+static ICmpInst* getLoopComparison(PHINode* phi)
+{
+  BranchInst* BI = dynamic_cast<BranchInst*>(phi->getParent()->getTerminator());
+  if( !BI or !BI->isConditional() )
+    return NULL;
+  Value* cond = BI->getCondition();
+  for(int depth = 0; depth < 4 and cond; ++depth)
+  {
+    if( ICmpInst* cmp = dynamic_cast<ICmpInst*>(cond) )
+    {
+      ConstantInt* zero = dynamic_cast<ConstantInt*>(cmp->getOperand(1));
+      if( cmp->getPredicate() == ICmpInst::ICMP_NE and zero and zero->isZero() and
+          !dynamic_cast<Constant*>(cmp->getOperand(0)) and
+          cmp->getOperand(0) != phi )
+      {
+        cond = cmp->getOperand(0);
+        continue;
+      }
+      return cmp;
+    }
+    else if( CastInst* cast = dynamic_cast<CastInst*>(cond) )
+      cond = cast->getOperand(0);
+    else
+      return NULL;
+  }
+  return NULL;
+}
+
+bool getIVRange(Value* v, long long& low, long long& high)
+{
+  PHINode* phi = dynamic_cast<PHINode*>(v);
+  if( !phi or phi->getNumIncomingValues() != 2 )
+    return false;
+  //one incoming value is the start, the other is the variable plus the step
+  ConstantInt* start = NULL;
+  BinaryOperator* increment = NULL;
+  for(unsigned i = 0; i < 2; ++i)
+  {
+    if( ConstantInt* CI = dynamic_cast<ConstantInt*>(phi->getIncomingValue(i)) )
+      start = CI;
+    else
+      increment = dynamic_cast<BinaryOperator*>(phi->getIncomingValue(i));
+  }
+  if( !start or !increment )
+    return false;
+  long long step = 0;
+  if( increment->getOpcode() == BinaryOperator::Add and increment->getOperand(0) == phi and
+      dynamic_cast<ConstantInt*>(increment->getOperand(1)) )
+    step = dynamic_cast<ConstantInt*>(increment->getOperand(1))->getSExtValue();
+  else if( increment->getOpcode() == BinaryOperator::Add and increment->getOperand(1) == phi and
+      dynamic_cast<ConstantInt*>(increment->getOperand(0)) )
+    step = dynamic_cast<ConstantInt*>(increment->getOperand(0))->getSExtValue();
+  else if( increment->getOpcode() == BinaryOperator::Sub and increment->getOperand(0) == phi and
+      dynamic_cast<ConstantInt*>(increment->getOperand(1)) )
+    step = -dynamic_cast<ConstantInt*>(increment->getOperand(1))->getSExtValue();
+  if( step == 0 )
+    return false;
+  //the end value is the constant the variable, or its increment, is compared to
+  ICmpInst* cmp = getLoopComparison(phi);
+  if( !cmp )
+    return false;
+  ConstantInt* end = NULL;
+  if( cmp->getOperand(0) == phi or cmp->getOperand(0) == increment )
+    end = dynamic_cast<ConstantInt*>(cmp->getOperand(1));
+  else if( cmp->getOperand(1) == phi or cmp->getOperand(1) == increment )
+    end = dynamic_cast<ConstantInt*>(cmp->getOperand(0));
+  if( !end )
+    return false;
+  //the variable leaves the loop at the first value past the end, which is
+  //  never more than one step beyond it
+  long long s = start->getSExtValue();
+  long long e = end->getSExtValue();
+  if( step > 0 )
+  {
+    low = s;
+    high = (e + step > s) ? e + step : s;
+  }
+  else
+  {
+    low = (e + step < s) ? e + step : s;
+    high = s;
+  }
+  return true;
+}
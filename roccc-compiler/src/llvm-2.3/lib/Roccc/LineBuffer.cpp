@@ -0,0 +1,111 @@
+#include "rocccLibrary/VHDLComponents/LineBuffer.h"
+
+#include "rocccLibrary/VHDLComponents/VHDLComponents.h"
+#include "rocccLibrary/VHDLComponents/ArraySignal.h"
+#include <assert.h>
+#include <sstream>
+#include <fstream>
+
+LineBuffer::LineBuffer(std::string n) : DATA_WIDTH(0), DEPTH(0), rst(NULL), clk(NULL), enable_in(NULL), last_address_in(NULL), data_in(NULL), data_out(NULL), name(n)
+{
+}
+int LineBuffer::getAddressWidth()
+{
+  int width = 1;
+  while( (1 << width) < DEPTH )
+    ++width;
+  return width;
+}
+void LineBuffer::mapDataWidth(int dw)
+{
+  DATA_WIDTH = dw;
+}
+void LineBuffer::mapDepth(int d)
+{
+  DEPTH = d;
+}
+void LineBuffer::mapRst(VHDLInterface::Variable* r)
+{
+  rst = r;
+}
+void LineBuffer::mapClk(VHDLInterface::Variable* c)
+{
+  clk = c;
+}
+void LineBuffer::mapEnableIn(VHDLInterface::Variable* e)
+{
+  enable_in = e;
+}
+void LineBuffer::mapLastAddressIn(VHDLInterface::Variable* l)
+{
+  last_address_in = l;
+  assert( last_address_in );
+}
+void LineBuffer::mapDataIn(VHDLInterface::Variable* dat)
+{
+  data_in = dat;
+  assert( data_in );
+  assert( data_in->getSize() == DATA_WIDTH );
+}
+void LineBuffer::mapDataOut(VHDLInterface::Variable* dat)
+{
+  data_out = dat;
+  assert( data_out );
+  assert( data_out->getSize() == DATA_WIDTH );
+}
+void LineBuffer::generateCode(VHDLInterface::Entity* e)
+{
+  assert( rst );
+  assert( clk );
+  assert( enable_in );
+  assert( last_address_in );
+  assert( data_in );
+  assert( data_out );
+  assert( data_in->getSize() == data_out->getSize() );
+  assert( DEPTH > 0 );
+  assert( e );
+#ifndef INLINE_VHDL
+  //instead of using the values directly, lets create a LineBuffer component and output it
+  std::stringstream ss;
+  ss << "LineBuffer" << DATA_WIDTH << "_" << DEPTH;
+  VHDLInterface::Entity* ent = new VHDLInterface::Entity(ss.str());
+  VHDLInterface::ComponentDeclaration* dec = ent->getDeclaration();
+  dec->getPorts().clear();
+  VHDLInterface::ComponentDefinition* def = e->createComponent(name, dec);
+  VHDLInterface::Port* tmp;
+  tmp = dec->addPort("clk", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(clk, tmp); clk = tmp;
+  tmp = dec->addPort("rst", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(rst, tmp); rst = tmp;
+  tmp = dec->addPort("enable_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(enable_in, tmp); enable_in = tmp;
+  tmp = dec->addPort("last_address_in", last_address_in->getSize(), VHDLInterface::Port::INPUT, NULL, false);
+  def->map(last_address_in, tmp); last_address_in = tmp;
+  tmp = dec->addPort("data_in", data_in->getSize(), VHDLInterface::Port::INPUT, data_in->getLLVMValue(), false);
+  def->map(data_in, tmp); data_in = tmp;
+  tmp = dec->addPort("data_out", data_out->getSize(), VHDLInterface::Port::OUTPUT, data_out->getLLVMValue(), false);
+  def->map(data_out, tmp); data_out = tmp;
+  e = ent;
+#endif
+  VHDLInterface::Signal* address = e->createSignal<VHDLInterface::Signal>(name+"_address", getAddressWidth());
+  Array* ram = e->createSignal<Array>(name+"_ram", DATA_WIDTH);
+  ram->setNumElements(DEPTH);
+  //read before write, so the ram is inferred as a block ram, and the
+  //  element read out is the one written a full row ago
+  VHDLInterface::MultiStatementProcess* p = e->createProcess<VHDLInterface::MultiStatementProcess>(clk);
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(enable_in) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(data_out, ram->getElement(address), p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(ram->getElement(address), data_in, p)
+                    )->addStatement(
+                         (new VHDLInterface::AssignmentStatement(address, p))
+                              ->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(address) >= VHDLInterface::Wrap(last_address_in))
+                              ->addCase(VHDLInterface::Wrap(address) + VHDLInterface::ConstantInt::get(1))
+                    )
+                 ));
+#ifndef INLINE_VHDL
+  std::ofstream fout((e->getDeclaration()->getName()+".vhdl").c_str());
+  fout << e->generateCode();
+#endif
+}
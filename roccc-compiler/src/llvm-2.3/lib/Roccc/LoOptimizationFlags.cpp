@@ -0,0 +1,53 @@
+#include "rocccLibrary/LoOptimizationFlags.h"
+
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+
+namespace ROCCC {
+
+/*
+Read in .ROCCC/.optlo once, storing the values that were given to each
+optimization. Comment lines are skipped in the same way the timing
+information file allows.
+*/
+static std::map<std::string, std::vector<float> >& getLoOptimizations()
+{
+  static bool hasRead = false;
+  static std::map<std::string, std::vector<float> > optimizations;
+  if( hasRead )
+    return optimizations;
+  hasRead = true;
+  std::ifstream file(".ROCCC/.optlo");
+  while( file.good() )
+  {
+    std::string l;
+    std::getline(file, l);
+    std::stringstream line(l);
+    std::string name;
+    line >> name;
+    if( name == "" or name.find("#") == 0 or name.find("//") == 0 or name.find("--") == 0 )
+      continue;
+    std::vector<float>& values = optimizations[name];
+    float value;
+    while( line >> value )
+      values.push_back(value);
+  }
+  return optimizations;
+}
+
+bool isLoOptimizationSelected(std::string name)
+{
+  return getLoOptimizations().find(name) != getLoOptimizations().end();
+}
+
+float getLoOptimizationValue(std::string name, float defaultValue, unsigned int n)
+{
+  std::map<std::string, std::vector<float> >::iterator opt = getLoOptimizations().find(name);
+  if( opt == getLoOptimizations().end() or n >= opt->second.size() )
+    return defaultValue;
+  return opt->second[n];
+}
+
+}
@@ -1,93 +1,12 @@
 #include "rocccLibrary/VHDLComponents/MicroFifo.h"
 
 #include "rocccLibrary/VHDLComponents/VHDLComponents.h"
+#include "rocccLibrary/VHDLComponents/ArraySignal.h"
 #include <sstream>
 #include <cmath>
 #include "rocccLibrary/InternalWarning.h"
 #include <fstream>
 
-class Array : public VHDLInterface::Signal {
-  int array_size;
-  int element_size;
-  class ArrayElement : public VHDLInterface::Variable {
-    Array* parent;
-    VHDLInterface::Value* index;
-  protected:
-    virtual void setOwner(VHDLInterface::ValueOwner* v) //from Value
-    {
-    }
-    virtual VHDLInterface::ValueOwner* getOwner() //from Value
-    {
-      return NULL;
-    }
-  public:
-    ArrayElement(Array* p, VHDLInterface::Value* i) : VHDLInterface::Variable(p->element_size), parent(p), index(i) {}
-    virtual std::string getInternalName(){return parent->getName();} //from Value
-    virtual int getSize(){return parent->element_size;} //from Value
-    virtual std::string generateCode(int size) //from Value
-    {
-      assert( size == getSize() );
-      std::stringstream ss;
-      int width = std::ceil(std::log(parent->array_size)/std::log(2));
-      ss << parent->getName() << "(conv_integer(" << index->generateCode(width) << "))";
-      return ss.str();
-    }
-    virtual std::string generateDeclarationCode() //from Value
-    {
-      return "";
-    }
-    virtual void setReadFrom() //from Value
-    {
-      parent->setReadFrom();
-      index->setReadFrom();
-     }
-    virtual void setWrittenTo() //from Value
-    {
-      parent->setWrittenTo();
-      index->setReadFrom();
-    }
-  };
-public:
-  Array(std::string n, int s, llvm::Value* v=NULL) : VHDLInterface::Signal(n, 1, v), array_size(0), element_size(s) {}
-  void setNumElements(int n){array_size=n;}
-  virtual std::string generateCode(int size){assert(0 and "Cannot generate array code!");} //from Value
-  virtual Value* generateResetValue(){assert(0 and "Cannot reset array code!");} //from Variable
-  virtual std::string generateDeclarationCode() //from Signal
-  {
-    if( !isReadFrom() )
-    {
-      if( !isWrittenTo() )
-      {
-        return "";
-      }
-      else
-      {
-        INTERNAL_WARNING("Generating declaration for array " << getName() << ", which is never read!\n");
-      }
-    }
-    Variable::declare();
-    std::stringstream ss;
-    ss << "type " << getName() << "_type is array (0 to " << array_size-1 << ") of ";
-    if(element_size == 1)
-      ss << " STD_LOGIC ;";
-    else
-      ss << " STD_LOGIC_VECTOR(" << element_size-1 << " downto 0) ;";
-    ss << "\nsignal " << getName() << " : " << getName() << "_type := (others=>(others=>'0'));";
-  #if ROCCC_DEBUG >= SOURCE_WARNINGS
-     if( getLLVMValue() != NULL )
-    {
-      ss << " --" << getLLVMValue()->getName();
-    }
-  #endif
-    ss << "\n"; 
-    return ss.str();
-  }
-  Variable* getElement(VHDLInterface::Value* i)
-  {
-    return new ArrayElement(this, i);
-  }
-};
-
 MicroFifo::MicroFifo(std::string n) : ADDRESS_WIDTH(0), DATA_WIDTH(0), ALMOST_FULL_COUNT(0), ALMOST_EMPTY_COUNT(0), clk(NULL), rst(NULL), data_in(NULL), valid_in(NULL), full_out(NULL), data_out(NULL), read_enable_in(NULL), empty_out(NULL), name(n)
 {
 }
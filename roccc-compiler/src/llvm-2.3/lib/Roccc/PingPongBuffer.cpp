@@ -0,0 +1,401 @@
+#include "rocccLibrary/VHDLComponents/PingPongBuffer.h"
+
+#include "rocccLibrary/VHDLComponents/VHDLComponents.h"
+#include "rocccLibrary/VHDLComponents/ArraySignal.h"
+#include "rocccLibrary/VHDLComponents/MicroFifo.h"
+#include <assert.h>
+#include <sstream>
+#include <fstream>
+
+PingPongBuffer::PingPongBuffer(std::string n) : DATA_WIDTH(0), DEPTH(0), clk(NULL), rst(NULL), producer_done_in(NULL),
+  input_empty_in(NULL), input_read_enable_out(NULL), input_data_in(NULL), input_address_rdy_in(NULL), input_address_stall_out(NULL), input_address_base_in(NULL), input_address_count_in(NULL),
+  output_full_in(NULL), output_write_enable_out(NULL), output_data_out(NULL), output_address_rdy_in(NULL), output_address_stall_out(NULL), output_address_base_in(NULL), output_address_count_in(NULL),
+  name(n)
+{
+}
+int PingPongBuffer::getAddressWidth()
+{
+  int width = 1;
+  while( (1 << width) < DEPTH )
+    ++width;
+  return width;
+}
+void PingPongBuffer::mapDataWidth(int dw)
+{
+  DATA_WIDTH = dw;
+}
+//each bank is addressed by the offset of the element from the start of its
+//  block, so any number of elements can be handed over at once
+void PingPongBuffer::mapDepth(int d)
+{
+  assert( d > 0 );
+  DEPTH = d;
+}
+void PingPongBuffer::mapClk(VHDLInterface::Variable* c)
+{
+  clk = c;
+}
+void PingPongBuffer::mapRst(VHDLInterface::Variable* r)
+{
+  rst = r;
+}
+void PingPongBuffer::mapProducerDoneIn(VHDLInterface::Variable* d)
+{
+  producer_done_in = d;
+}
+void PingPongBuffer::mapInputEmptyIn(VHDLInterface::Variable* e)
+{
+  input_empty_in = e;
+}
+void PingPongBuffer::mapInputReadEnableOut(VHDLInterface::Variable* r)
+{
+  input_read_enable_out = r;
+}
+void PingPongBuffer::mapInputDataIn(VHDLInterface::Variable* dat)
+{
+  input_data_in = dat;
+  assert( input_data_in );
+  assert( input_data_in->getSize() == DATA_WIDTH );
+}
+void PingPongBuffer::mapInputAddressRdyIn(VHDLInterface::Variable* r)
+{
+  input_address_rdy_in = r;
+}
+void PingPongBuffer::mapInputAddressStallOut(VHDLInterface::Variable* s)
+{
+  input_address_stall_out = s;
+}
+void PingPongBuffer::mapInputAddressIn(VHDLInterface::Variable* base, VHDLInterface::Variable* count)
+{
+  input_address_base_in = base;
+  input_address_count_in = count;
+}
+void PingPongBuffer::mapOutputFullIn(VHDLInterface::Variable* f)
+{
+  output_full_in = f;
+}
+void PingPongBuffer::mapOutputWriteEnableOut(VHDLInterface::Variable* w)
+{
+  output_write_enable_out = w;
+}
+void PingPongBuffer::mapOutputDataOut(VHDLInterface::Variable* dat)
+{
+  output_data_out = dat;
+  assert( output_data_out );
+  assert( output_data_out->getSize() == DATA_WIDTH );
+}
+void PingPongBuffer::mapOutputAddressRdyIn(VHDLInterface::Variable* r)
+{
+  output_address_rdy_in = r;
+}
+void PingPongBuffer::mapOutputAddressStallOut(VHDLInterface::Variable* s)
+{
+  output_address_stall_out = s;
+}
+void PingPongBuffer::mapOutputAddressIn(VHDLInterface::Variable* base, VHDLInterface::Variable* count)
+{
+  output_address_base_in = base;
+  output_address_count_in = count;
+}
+void PingPongBuffer::generateCode(VHDLInterface::Entity* e)
+{
+  assert( clk );
+  assert( rst );
+  assert( producer_done_in );
+  assert( input_empty_in and input_read_enable_out and input_data_in );
+  assert( input_address_rdy_in and input_address_stall_out and input_address_base_in and input_address_count_in );
+  assert( output_full_in and output_write_enable_out and output_data_out );
+  assert( output_address_rdy_in and output_address_stall_out and output_address_base_in and output_address_count_in );
+  assert( DEPTH > 0 );
+  assert( e );
+#ifndef INLINE_VHDL
+  //instead of using the values directly, lets create a PingPongBuffer component and output it
+  std::stringstream ss;
+  ss << "PingPongBuffer" << DATA_WIDTH << "_" << DEPTH;
+  VHDLInterface::Entity* ent = new VHDLInterface::Entity(ss.str());
+  VHDLInterface::ComponentDeclaration* dec = ent->getDeclaration();
+  dec->getPorts().clear();
+  VHDLInterface::ComponentDefinition* def = e->createComponent(name, dec);
+  VHDLInterface::Port* tmp;
+  tmp = dec->addPort("clk", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(clk, tmp); clk = tmp;
+  tmp = dec->addPort("rst", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(rst, tmp); rst = tmp;
+  tmp = dec->addPort("producer_done_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(producer_done_in, tmp); producer_done_in = tmp;
+  tmp = dec->addPort("input_empty_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(input_empty_in, tmp); input_empty_in = tmp;
+  tmp = dec->addPort("input_read_enable_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(input_read_enable_out, tmp); input_read_enable_out = tmp;
+  tmp = dec->addPort("input_data_in", DATA_WIDTH, VHDLInterface::Port::INPUT, input_data_in->getLLVMValue(), false);
+  def->map(input_data_in, tmp); input_data_in = tmp;
+  tmp = dec->addPort("input_address_rdy_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(input_address_rdy_in, tmp); input_address_rdy_in = tmp;
+  tmp = dec->addPort("input_address_stall_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(input_address_stall_out, tmp); input_address_stall_out = tmp;
+  tmp = dec->addPort("input_address_base_in", input_address_base_in->getSize(), VHDLInterface::Port::INPUT, NULL, false);
+  def->map(input_address_base_in, tmp); input_address_base_in = tmp;
+  tmp = dec->addPort("input_address_count_in", input_address_count_in->getSize(), VHDLInterface::Port::INPUT, NULL, false);
+  def->map(input_address_count_in, tmp); input_address_count_in = tmp;
+  tmp = dec->addPort("output_full_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(output_full_in, tmp); output_full_in = tmp;
+  tmp = dec->addPort("output_write_enable_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(output_write_enable_out, tmp); output_write_enable_out = tmp;
+  tmp = dec->addPort("output_data_out", DATA_WIDTH, VHDLInterface::Port::OUTPUT, output_data_out->getLLVMValue(), false);
+  def->map(output_data_out, tmp); output_data_out = tmp;
+  tmp = dec->addPort("output_address_rdy_in", 1, VHDLInterface::Port::INPUT, NULL, false);
+  def->map(output_address_rdy_in, tmp); output_address_rdy_in = tmp;
+  tmp = dec->addPort("output_address_stall_out", 1, VHDLInterface::Port::OUTPUT, NULL, false);
+  def->map(output_address_stall_out, tmp); output_address_stall_out = tmp;
+  tmp = dec->addPort("output_address_base_in", output_address_base_in->getSize(), VHDLInterface::Port::INPUT, NULL, false);
+  def->map(output_address_base_in, tmp); output_address_base_in = tmp;
+  tmp = dec->addPort("output_address_count_in", output_address_count_in->getSize(), VHDLInterface::Port::INPUT, NULL, false);
+  def->map(output_address_count_in, tmp); output_address_count_in = tmp;
+  e = ent;
+#endif
+  int aw = getAddressWidth();
+  //both banks share one ram; the second bank starts DEPTH elements in
+  Array* ram = e->createSignal<Array>(name+"_ram", DATA_WIDTH);
+  ram->setNumElements(2 * DEPTH);
+  VHDLInterface::Signal* write_bank = e->createSignal<VHDLInterface::Signal>(name+"_write_bank", 1);
+  VHDLInterface::Signal* read_bank = e->createSignal<VHDLInterface::Signal>(name+"_read_bank", 1);
+  //a bank is full from when the producer hands it over until the consumer
+  //  has read it; count is the number of elements the producer wrote to it
+  VHDLInterface::Signal* full0 = e->createSignal<VHDLInterface::Signal>(name+"_full0", 1);
+  VHDLInterface::Signal* full1 = e->createSignal<VHDLInterface::Signal>(name+"_full1", 1);
+  VHDLInterface::Signal* count0 = e->createSignal<VHDLInterface::Signal>(name+"_count0", aw+1);
+  VHDLInterface::Signal* count1 = e->createSignal<VHDLInterface::Signal>(name+"_count1", aw+1);
+  //the producer side; the element read from the producer's fifo arrives the
+  //  cycle after it is read
+  VHDLInterface::Signal* w_addr = e->createSignal<VHDLInterface::Signal>(name+"_write_address", input_address_base_in->getSize());
+  VHDLInterface::Signal* w_remaining = e->createSignal<VHDLInterface::Signal>(name+"_write_remaining", input_address_count_in->getSize());
+  VHDLInterface::Signal* w_count = e->createSignal<VHDLInterface::Signal>(name+"_write_count", aw+1);
+  VHDLInterface::Signal* arriving = e->createSignal<VHDLInterface::Signal>(name+"_arriving", 1);
+  VHDLInterface::Signal* w_block_base = e->createSignal<VHDLInterface::Signal>(name+"_write_block_base", input_address_base_in->getSize());
+  VHDLInterface::Signal* w_started = e->createSignal<VHDLInterface::Signal>(name+"_write_started", 1);
+  VHDLInterface::Signal* w_offset = e->createSignal<VHDLInterface::Signal>(name+"_write_offset", input_address_base_in->getSize());
+  VHDLInterface::Signal* arriving_offset = e->createSignal<VHDLInterface::Signal>(name+"_arriving_offset", aw+1);
+  VHDLInterface::Signal* write_free = e->createSignal<VHDLInterface::Signal>(name+"_write_free", 1);
+  VHDLInterface::Signal* block_done = e->createSignal<VHDLInterface::Signal>(name+"_block_done", 1);
+  VHDLInterface::Signal* w_index = e->createSignal<VHDLInterface::Signal>(name+"_write_index", aw+1);
+  //the consumer side
+  VHDLInterface::Signal* r_addr = e->createSignal<VHDLInterface::Signal>(name+"_read_address", output_address_base_in->getSize());
+  VHDLInterface::Signal* r_remaining = e->createSignal<VHDLInterface::Signal>(name+"_read_remaining", output_address_count_in->getSize());
+  VHDLInterface::Signal* r_block_base = e->createSignal<VHDLInterface::Signal>(name+"_read_block_base", output_address_base_in->getSize());
+  VHDLInterface::Signal* r_started = e->createSignal<VHDLInterface::Signal>(name+"_read_started", 1);
+  VHDLInterface::Signal* r_offset = e->createSignal<VHDLInterface::Signal>(name+"_read_offset", output_address_base_in->getSize());
+  VHDLInterface::Signal* r_bank_offset = e->createSignal<VHDLInterface::Signal>(name+"_read_bank_offset", aw+1);
+  VHDLInterface::Signal* r_count = e->createSignal<VHDLInterface::Signal>(name+"_read_count", aw+1);
+  VHDLInterface::Signal* r_total = e->createSignal<VHDLInterface::Signal>(name+"_read_total", aw+1);
+  VHDLInterface::Signal* read_ready = e->createSignal<VHDLInterface::Signal>(name+"_read_ready", 1);
+  VHDLInterface::Signal* read_element = e->createSignal<VHDLInterface::Signal>(name+"_read_element", 1);
+  VHDLInterface::Signal* block_read = e->createSignal<VHDLInterface::Signal>(name+"_block_read", 1);
+  VHDLInterface::Signal* r_index = e->createSignal<VHDLInterface::Signal>(name+"_read_index", aw+1);
+  //the requests of each side are queued, so its address generator is only
+  //  stalled once the queue is almost full; the next request is taken from
+  //  the queue once the last one is used up, and arrives the cycle after
+  VHDLInterface::Signal* w_req_base = e->createSignal<VHDLInterface::Signal>(name+"_write_request_base", input_address_base_in->getSize());
+  VHDLInterface::Signal* w_req_count = e->createSignal<VHDLInterface::Signal>(name+"_write_request_count", input_address_count_in->getSize());
+  VHDLInterface::Signal* w_req_read = e->createSignal<VHDLInterface::Signal>(name+"_write_request_read", 1);
+  VHDLInterface::Signal* w_req_empty = e->createSignal<VHDLInterface::Signal>(name+"_write_request_empty", 1);
+  VHDLInterface::Signal* w_req_arriving = e->createSignal<VHDLInterface::Signal>(name+"_write_request_arriving", 1);
+  VHDLInterface::Signal* r_req_base = e->createSignal<VHDLInterface::Signal>(name+"_read_request_base", output_address_base_in->getSize());
+  VHDLInterface::Signal* r_req_count = e->createSignal<VHDLInterface::Signal>(name+"_read_request_count", output_address_count_in->getSize());
+  VHDLInterface::Signal* r_req_read = e->createSignal<VHDLInterface::Signal>(name+"_read_request_read", 1);
+  VHDLInterface::Signal* r_req_empty = e->createSignal<VHDLInterface::Signal>(name+"_read_request_empty", 1);
+  VHDLInterface::Signal* r_req_arriving = e->createSignal<VHDLInterface::Signal>(name+"_read_request_arriving", 1);
+  MicroFifo w_requests(name+"_write_requests");
+  w_requests.mapAddressWidth(4);
+  w_requests.mapAlmostFullCount(3);
+  w_requests.mapAlmostEmptyCount(0);
+  w_requests.mapClk(clk);
+  w_requests.mapRst(rst);
+  w_requests.mapValidIn(input_address_rdy_in);
+  w_requests.mapFullOut(input_address_stall_out);
+  std::vector<VHDLInterface::Variable*> w_req_in, w_req_out;
+  w_req_in.push_back(input_address_base_in);
+  w_req_in.push_back(input_address_count_in);
+  w_req_out.push_back(w_req_base);
+  w_req_out.push_back(w_req_count);
+  w_requests.mapInputAndOutputVector(w_req_in, w_req_out, e);
+  w_requests.mapReadEnableIn(w_req_read);
+  w_requests.mapEmptyOut(w_req_empty);
+  w_requests.generateCode(e);
+  MicroFifo r_requests(name+"_read_requests");
+  r_requests.mapAddressWidth(4);
+  r_requests.mapAlmostFullCount(3);
+  r_requests.mapAlmostEmptyCount(0);
+  r_requests.mapClk(clk);
+  r_requests.mapRst(rst);
+  r_requests.mapValidIn(output_address_rdy_in);
+  r_requests.mapFullOut(output_address_stall_out);
+  std::vector<VHDLInterface::Variable*> r_req_in, r_req_out;
+  r_req_in.push_back(output_address_base_in);
+  r_req_in.push_back(output_address_count_in);
+  r_req_out.push_back(r_req_base);
+  r_req_out.push_back(r_req_count);
+  r_requests.mapInputAndOutputVector(r_req_in, r_req_out, e);
+  r_requests.mapReadEnableIn(r_req_read);
+  r_requests.mapEmptyOut(r_req_empty);
+  r_requests.generateCode(e);
+  VHDLInterface::AssignmentStatement* w_req_read_ass = e->createSynchronousStatement(w_req_read);
+  w_req_read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(w_req_empty) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(w_remaining) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(w_req_arriving) == VHDLInterface::ConstantInt::get(0));
+  w_req_read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::AssignmentStatement* r_req_read_ass = e->createSynchronousStatement(r_req_read);
+  r_req_read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(r_req_empty) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(r_remaining) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(r_req_arriving) == VHDLInterface::ConstantInt::get(0));
+  r_req_read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //the bank the producer writes to must have been read by the consumer,
+  //  and the bank the consumer reads from must have been written
+  VHDLInterface::AssignmentStatement* write_free_ass = e->createSynchronousStatement(write_free);
+  write_free_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(write_bank) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(full0) == VHDLInterface::ConstantInt::get(0));
+  write_free_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(write_bank) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(full1) == VHDLInterface::ConstantInt::get(0));
+  write_free_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::AssignmentStatement* read_ready_ass = e->createSynchronousStatement(read_ready);
+  read_ready_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(read_bank) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(full0) == VHDLInterface::ConstantInt::get(1));
+  read_ready_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(read_bank) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(full1) == VHDLInterface::ConstantInt::get(1));
+  read_ready_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::AssignmentStatement* r_total_ass = e->createSynchronousStatement(r_total);
+  r_total_ass->addCase(count0, VHDLInterface::Wrap(read_bank) == VHDLInterface::ConstantInt::get(0));
+  r_total_ass->addCase(count1);
+  //read from the producer while there is an address to write the element to,
+  //  and room left in the bank for it and the one arriving
+  VHDLInterface::AssignmentStatement* read_in_ass = e->createSynchronousStatement(input_read_enable_out);
+  read_in_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(input_empty_in) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(write_free) == VHDLInterface::ConstantInt::get(0));
+  read_in_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(w_remaining) == VHDLInterface::ConstantInt::get(0));
+  read_in_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(w_count) < VHDLInterface::ConstantInt::get(DEPTH));
+  read_in_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(w_count) < VHDLInterface::ConstantInt::get(DEPTH-1));
+  read_in_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //a bank is handed over when it is full, or when the producer is done and
+  //  nothing more can arrive
+  VHDLInterface::AssignmentStatement* block_done_ass = e->createSynchronousStatement(block_done);
+  block_done_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(w_count) == VHDLInterface::ConstantInt::get(DEPTH-1));
+  block_done_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(producer_done_in) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(input_empty_in) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(w_count) != VHDLInterface::ConstantInt::get(0));
+  block_done_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //read an element for the consumer while there is an address to read, and
+  //  elements left in the bank
+  VHDLInterface::AssignmentStatement* read_element_ass = e->createSynchronousStatement(read_element);
+  read_element_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(read_ready) == VHDLInterface::ConstantInt::get(0) or VHDLInterface::Wrap(output_full_in) == VHDLInterface::ConstantInt::get(1));
+  read_element_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(r_remaining) != VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(r_count) < VHDLInterface::Wrap(r_total));
+  read_element_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::AssignmentStatement* block_read_ass = e->createSynchronousStatement(block_read);
+  block_read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(read_element) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(r_count) + VHDLInterface::ConstantInt::get(1) == VHDLInterface::Wrap(r_total));
+  block_read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //block k of each side holds the DEPTH elements starting DEPTH * k
+  //  elements after the first address that side was given, and is placed
+  //  in its bank by its offset from the start of the block
+  e->createSynchronousStatement(w_offset, VHDLInterface::Wrap(w_addr) - VHDLInterface::Wrap(w_block_base));
+  e->createSynchronousStatement(r_offset, VHDLInterface::Wrap(r_addr) - VHDLInterface::Wrap(r_block_base));
+  e->createSynchronousStatement(r_bank_offset, VHDLInterface::BitRange::get(r_offset, aw, 0));
+  VHDLInterface::AssignmentStatement* w_index_ass = e->createSynchronousStatement(w_index);
+  w_index_ass->addCase(VHDLInterface::Wrap(arriving_offset) + VHDLInterface::ConstantInt::get(DEPTH), VHDLInterface::Wrap(write_bank) == VHDLInterface::ConstantInt::get(1));
+  w_index_ass->addCase(arriving_offset);
+  VHDLInterface::AssignmentStatement* r_index_ass = e->createSynchronousStatement(r_index);
+  r_index_ass->addCase(VHDLInterface::Wrap(r_bank_offset) + VHDLInterface::ConstantInt::get(DEPTH), VHDLInterface::Wrap(read_bank) == VHDLInterface::ConstantInt::get(1));
+  r_index_ass->addCase(r_bank_offset);
+  VHDLInterface::MultiStatementProcess* p = e->createProcess<VHDLInterface::MultiStatementProcess>(clk);
+  //the producer side
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(w_req_arriving) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_addr, w_req_base, p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_remaining, w_req_count, p)
+                    ),
+                    new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(input_read_enable_out) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_addr, VHDLInterface::Wrap(w_addr) + VHDLInterface::ConstantInt::get(1), p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_remaining, VHDLInterface::Wrap(w_remaining) - VHDLInterface::ConstantInt::get(1), p)
+                    ))
+                 ));
+  p->addStatement(new VHDLInterface::AssignmentStatement(arriving, input_read_enable_out, p));
+  p->addStatement(new VHDLInterface::AssignmentStatement(w_req_arriving, w_req_read, p));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(w_req_arriving) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(w_started) == VHDLInterface::ConstantInt::get(0),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_block_base, w_req_base, p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_started, VHDLInterface::ConstantInt::get(1), p)
+                    )
+                 ));
+  p->addStatement(new VHDLInterface::AssignmentStatement(arriving_offset, VHDLInterface::BitRange::get(w_offset, aw, 0), p));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1),
+                    new VHDLInterface::AssignmentStatement(ram->getElement(w_index), input_data_in, p)
+                 ));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(block_done) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_count, VHDLInterface::ConstantInt::get(0), p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(w_block_base, VHDLInterface::Wrap(w_block_base) + VHDLInterface::ConstantInt::get(DEPTH), p)
+                    )->addStatement(
+                         (new VHDLInterface::AssignmentStatement(write_bank, p))
+                              ->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(write_bank) == VHDLInterface::ConstantInt::get(0))
+                              ->addCase(VHDLInterface::ConstantInt::get(0))
+                    )->addStatement(
+                         new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(write_bank) == VHDLInterface::ConstantInt::get(0),
+                              (new VHDLInterface::MultiStatement(p))->addStatement(
+                                   new VHDLInterface::AssignmentStatement(full0, VHDLInterface::ConstantInt::get(1), p)
+                              )->addStatement(
+                                   (new VHDLInterface::AssignmentStatement(count0, p))
+                                        ->addCase(VHDLInterface::Wrap(w_count) + VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1))
+                                        ->addCase(w_count)
+                              ),
+                              (new VHDLInterface::MultiStatement(p))->addStatement(
+                                   new VHDLInterface::AssignmentStatement(full1, VHDLInterface::ConstantInt::get(1), p)
+                              )->addStatement(
+                                   (new VHDLInterface::AssignmentStatement(count1, p))
+                                        ->addCase(VHDLInterface::Wrap(w_count) + VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1))
+                                        ->addCase(w_count)
+                              )
+                         )
+                    ),
+                    new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1),
+                         new VHDLInterface::AssignmentStatement(w_count, VHDLInterface::Wrap(w_count) + VHDLInterface::ConstantInt::get(1), p)
+                    )
+                 ));
+  //the consumer side; the bank being read is never the one being handed over
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(r_req_arriving) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_addr, r_req_base, p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_remaining, r_req_count, p)
+                    ),
+                    new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(read_element) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_addr, VHDLInterface::Wrap(r_addr) + VHDLInterface::ConstantInt::get(1), p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_remaining, VHDLInterface::Wrap(r_remaining) - VHDLInterface::ConstantInt::get(1), p)
+                    ))
+                 ));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(r_req_arriving) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(r_started) == VHDLInterface::ConstantInt::get(0),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_block_base, r_req_base, p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_started, VHDLInterface::ConstantInt::get(1), p)
+                    )
+                 ));
+  p->addStatement(new VHDLInterface::AssignmentStatement(r_req_arriving, r_req_read, p));
+  p->addStatement(new VHDLInterface::AssignmentStatement(output_data_out, ram->getElement(r_index), p));
+  p->addStatement(new VHDLInterface::AssignmentStatement(output_write_enable_out, read_element, p));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(block_read) == VHDLInterface::ConstantInt::get(1),
+                    (new VHDLInterface::MultiStatement(p))->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_count, VHDLInterface::ConstantInt::get(0), p)
+                    )->addStatement(
+                         new VHDLInterface::AssignmentStatement(r_block_base, VHDLInterface::Wrap(r_block_base) + VHDLInterface::ConstantInt::get(DEPTH), p)
+                    )->addStatement(
+                         (new VHDLInterface::AssignmentStatement(read_bank, p))
+                              ->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(read_bank) == VHDLInterface::ConstantInt::get(0))
+                              ->addCase(VHDLInterface::ConstantInt::get(0))
+                    )->addStatement(
+                         new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(read_bank) == VHDLInterface::ConstantInt::get(0),
+                              new VHDLInterface::AssignmentStatement(full0, VHDLInterface::ConstantInt::get(0), p),
+                              new VHDLInterface::AssignmentStatement(full1, VHDLInterface::ConstantInt::get(0), p)
+                         )
+                    ),
+                    new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(read_element) == VHDLInterface::ConstantInt::get(1),
+                         new VHDLInterface::AssignmentStatement(r_count, VHDLInterface::Wrap(r_count) + VHDLInterface::ConstantInt::get(1), p)
+                    )
+                 ));
+#ifndef INLINE_VHDL
+  std::ofstream fout((e->getDeclaration()->getName()+".vhdl").c_str());
+  fout << e->generateCode();
+#endif
+}
@@ -101,7 +101,8 @@ bool ROCCCNames::isROCCCFunction(llvm::CallInst* CI)
           isROCCCFunctionCall(CI, InfiniteLoopCondition) or
           isROCCCFunctionCall(CI, NumberOfOutstandingMemoryRequests) or
           isROCCCFunctionCall(CI, NumberOfDataChannels) or
-          isROCCCFunctionCall(CI, NumberOfAddressChannels)
+          isROCCCFunctionCall(CI, NumberOfAddressChannels) or
+          isROCCCFunctionCall(CI, GatherIndex)
         );
 }
 const std::string ROCCCNames::FunctionType = "ROCCCFunctionType";
@@ -152,4 +153,5 @@ const std::string ROCCCNames::InfiniteLoopCondition = "ROCCCInfinity";
 const std::string ROCCCNames::NumberOfOutstandingMemoryRequests = "ROCCCNumMemReq";
 const std::string ROCCCNames::NumberOfDataChannels = "ROCCCNumDataChannels";
 const std::string ROCCCNames::NumberOfAddressChannels = "ROCCCNumAddressChannels";
+const std::string ROCCCNames::GatherIndex = "ROCCCGatherIndex";
 
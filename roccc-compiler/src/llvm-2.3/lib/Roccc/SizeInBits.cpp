@@ -205,6 +205,23 @@ void setSizeInBits(Value* val, int size)
   assert(II->getParent()->getParent()->getParent());
   Function* sizeFunc = II->getParent()->getParent()->getParent()->getFunction(ROCCCNames::VariableSize);
   assert(sizeFunc);
+  //if the value already has its size set, change those calls instead of
+  //  adding another one
+  bool updated = false;
+  for(Value::use_iterator UI = val->use_begin(); UI != val->use_end(); ++UI)
+  {
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( CI and isROCCCFunctionCall(CI, ROCCCNames::VariableSize) and CI->getOperand(2) == val )
+    {
+      CI->setOperand(1, llvm::ConstantInt::get(llvm::IntegerType::get(32), size));
+      updated = true;
+    }
+  }
+  if( updated )
+  {
+    resetSizeMap();
+    return;
+  }
   //create the insertion point
   DFBasicBlock* dfbb = new DFBasicBlock("", II->getParent()->getParent());
 	//now create the actual call instruction
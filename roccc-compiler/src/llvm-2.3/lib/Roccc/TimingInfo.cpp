@@ -0,0 +1,123 @@
+#include "rocccLibrary/TimingInfo.h"
+
+#include <fstream>
+#include <cassert>
+
+#include "rocccLibrary/InternalWarning.h"
+
+namespace ROCCC {
+
+int TimingInfo::getDelayOfType(std::string type)
+{
+  std::map<std::string, int>::iterator t = timing.find(type);
+  if( t == timing.end() )
+  {
+    timing[type] = 1;
+    assert(timing.find(type) != timing.end());
+    INTERNAL_WARNING("Could not find " << type << " delay! Setting to " << timing[type] << "!\n");
+    return timing[type];
+  }
+  return t->second;
+}
+
+TimingInfo::TimingInfo() : operationsPerPipelineStage(1.0)
+{
+  std::ifstream f(".ROCCC/.timingInfo");
+  if (!f)
+  {
+    INTERNAL_SERIOUS_WARNING("Could not open timing information!\n");
+    return;
+  }
+  while( !f.eof() )
+  {
+    std::string name;
+    int value = -1;
+    f >> name;
+    //allow comments
+    if( name.find("#") == 0 or name.find("//") == 0 or name.find("--") == 0 )
+    {
+      std::string temp;
+      std::getline(f, temp);
+    }
+    else if( name.find("OperationsPerPipelineStage") == 0 )
+    {
+      f >> operationsPerPipelineStage;
+    }
+    else
+    {
+      f >> value;
+    }
+    if( name != "" and value >= 0 )
+    {
+      timing[name] = value;
+    }
+  }
+}
+
+int TimingInfo::getCopyDelay()
+{
+  return getDelayOfType("Copy");
+}
+
+int TimingInfo::getAddDelay()
+{
+  return getDelayOfType("Add");
+}
+
+int TimingInfo::getSubDelay()
+{
+  return getDelayOfType("Sub");
+}
+
+int TimingInfo::getMulDelay()
+{
+  return getDelayOfType("Mult");
+}
+
+int TimingInfo::getShiftDelay()
+{
+  return getDelayOfType("Shift");
+}
+
+int TimingInfo::getAndDelay()
+{
+  return getDelayOfType("AND");
+}
+
+int TimingInfo::getOrDelay()
+{
+  return getDelayOfType("OR");
+}
+
+int TimingInfo::getXorDelay()
+{
+  return getDelayOfType("XOR");
+}
+
+int TimingInfo::getCmpDelay()
+{
+  return getDelayOfType("Compare");
+}
+
+int TimingInfo::getMuxDelay()
+{
+  return getDelayOfType("Mux");
+}
+
+int TimingInfo::getMaximumDelay()
+{
+  int max = 0;
+  for(std::map<std::string, int>::iterator TMI = timing.begin(); TMI != timing.end(); ++TMI)
+  {
+    if( TMI->second > max and TMI->first != "MaxFanoutRegistered" )
+      max = TMI->second;
+  }
+  return max;
+}
+
+float TimingInfo::getOperationsPerPipelineStage()
+{
+  return operationsPerPipelineStage;
+}
+
+}
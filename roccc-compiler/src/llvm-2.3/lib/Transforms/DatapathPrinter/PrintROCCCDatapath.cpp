@@ -160,15 +160,23 @@ class Node : public Connectible {
   std::string name_id;
   std::map<std::string,ConnectionPoint*> connection_points;
   Subgraph* parent;
+  std::string annotation;
 protected:
   virtual std::string getBodyText()=0;
   virtual std::string getShape()=0;
+  //extra text printed outside of the node, such as its timing
+  std::string getAnnotationAttribute()
+  {
+    if( annotation == "" )
+      return "";
+    return ",xlabel=\"" + annotation + "\"";
+  }
   virtual std::string printImpl()
   {
     std::stringstream ss;
     ss << this->getNameID() << " [shape=" << this->getShape() << ",color=\"" << this->getColor() << "\",label=\"";
     ss << this->getBodyText();
-    ss << "\",group=\"" << this->getGroup() << "\"];\n";
+    ss << "\",group=\"" << this->getGroup() << "\"" << this->getAnnotationAttribute() << "];\n";
     for(std::map<std::string,ConnectionPoint*>::iterator CPI = this->connectionBegin(); CPI != this->connectionEnd(); ++CPI)
     {
       ss << CPI->second->print();
@@ -190,6 +198,7 @@ public:
   virtual Connectible* getConnectionPoint(llvm::Value* v)=0;
   Subgraph* getParent(){return parent;}
   virtual std::string getGroup(){return name_id;}
+  void setAnnotation(std::string a){annotation = a;}
 };
 
 class TextNode : public Node {
@@ -217,7 +226,7 @@ protected:
     std::stringstream ss;
     ss << this->getNameID() << " [shape=" << this->getShape() << ",color=" << this->getColor() << ",label=<";
     ss << this->getBodyText();
-    ss << ">];\n";
+    ss << ">" << this->getAnnotationAttribute() << "];\n";
     for(std::map<std::string,ConnectionPoint*>::iterator CPI = this->connectionBegin(); CPI != this->connectionEnd(); ++CPI)
     {
       ss << CPI->second->print();
@@ -355,7 +364,8 @@ bool shouldDisplayInstruction(Instruction* II)
       isROCCCFunctionCall(CI, ROCCCNames::InfiniteLoopCondition) or
       isROCCCFunctionCall(CI, ROCCCNames::NumberOfOutstandingMemoryRequests) or
       isROCCCFunctionCall(CI, ROCCCNames::NumberOfDataChannels) or
-      isROCCCFunctionCall(CI, ROCCCNames::NumberOfAddressChannels)
+      isROCCCFunctionCall(CI, ROCCCNames::NumberOfAddressChannels) or
+      isROCCCFunctionCall(CI, ROCCCNames::GatherIndex)
   )
   {
     return false;
@@ -1400,6 +1410,13 @@ struct PrintROCCCDatapathPass : public FunctionPass
           if( shouldDisplayInstruction(II) )
           {
             ROCCCGraph::Node* n = getNodeFromInstruction(&*II, pipelineLevelGraph, &graph);
+            //annotate with the timing, if the timing report has been run
+            if( BB->getDFBasicBlock()->getArrivalTime() >= 0 )
+            {
+              std::stringstream timing;
+              timing << "a=" << BB->getDFBasicBlock()->getArrivalTime() << " r=" << BB->getDFBasicBlock()->getRequiredTime() << " s=" << BB->getDFBasicBlock()->getRequiredTime() - BB->getDFBasicBlock()->getArrivalTime();
+              n->setAnnotation(timing.str());
+            }
             pipelineLevelGraph->setElement(&*II, n);
           }
         }
@@ -9,6 +9,7 @@
 #include "llvm/Module.h"
 
 #include <vector>
+#include <map>
 #include <assert.h>
 #include <sstream>
 #include <algorithm>
@@ -20,6 +21,7 @@
 #include "rocccLibrary/DatabaseInterface.h"
 #include "rocccLibrary/CopyValue.h"
 #include "rocccLibrary/GetValueName.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
 
 using namespace llvm ;
 using namespace Database;
@@ -538,6 +540,22 @@ public:
   }
 };
 
+class FilterCoreNumPortsIsEqual : public Filter {
+  unsigned num_ports;
+public:
+  FilterCoreNumPortsIsEqual(unsigned n):num_ports(n){}
+  virtual bool operator()(LibraryEntry* c)
+  {
+    return (c->getNonStreamPorts().size() == num_ports);
+  }
+  virtual std::string getDescription()
+  {
+    std::stringstream ret;
+    ret << "(numPorts() == " << num_ports << ")";
+    return ret.str();
+  }
+};
+
 class FilterCoreStreamIsNumAddressChannels : public Filter {
   int stream_num;
   int num_channels;
@@ -889,6 +907,147 @@ void addDebugCall(Value* val, Instruction* insertBefore)
           			    insertBefore);
 }
 
+/*
+Find a fused multiply-add core whose three inputs and output are all size
+bits wide, or return "" if the database does not have one.
+*/
+std::string getFusedMultiplyAddCore(int size)
+{
+  static std::map<int, std::string> found;
+  std::map<int, std::string>::iterator FI = found.find(size);
+  if( FI != found.end() )
+    return FI->second;
+  DatabaseInterface* dbInterface = DatabaseInterface::getInstance();
+  MultiFilterAnd mf;
+  mf.add( new FilterCoreIsType(LibraryEntry::FP_FMA) );
+  //check the number of ports first, so the size filters never run off the end
+  mf.add( new FilterCoreNumPortsIsEqual(4) );
+  for(int p = 0; p < 4; ++p)
+  {
+    mf.add( new FilterCorePortSizeIsEqual(p, size) );
+  }
+  std::list<LibraryEntry*> cores = filterIntrinsics(dbInterface->getCores(), &mf);
+  found[size] = ( cores.empty() ? "" : (*cores.begin())->getName() );
+  return found[size];
+}
+
+/*
+Returns true if the only real use of mul is use, ignoring the calls that
+carry its name, size, and signedness.
+*/
+bool isOnlyUsedBy(Instruction* mul, Instruction* use)
+{
+  for(Value::use_iterator UI = mul->use_begin(); UI != mul->use_end(); ++UI)
+  {
+    if( *UI == use )
+      continue;
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( !isROCCCFunctionCall(CI, ROCCCNames::VariableName) and
+        !isROCCCFunctionCall(CI, ROCCCNames::VariableSize) and
+        !isROCCCFunctionCall(CI, ROCCCNames::VariableSigned) )
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*
+Replace the floating point a*b+c, where add is the addition and mul is the
+multiplication feeding it, with a single call to the fused core.  The 
+intermediate product is never rounded and normalized on its own, so the 
+fused core saves both the latency and the normalization logic of one core.
+*/
+void fuseMultiplyAdd(Module& M, BinaryOperator* mul, BinaryOperator* add, std::string core)
+{
+  Value* addend = ( add->getOperand(0) == mul ) ? add->getOperand(1) : add->getOperand(0);
+  int size = getSizeInBits(add);
+  GlobalValue* name = getOrCreateNamedGlobalString(M, core);
+  std::vector<Value*> valArgs;
+  std::vector<const Type*> valTypes;
+  valArgs.push_back( name );
+  valArgs.push_back( mul->getOperand(0) );
+  valArgs.push_back( mul->getOperand(1) );
+  valArgs.push_back( addend );
+  //the destination of the fused operation is the last argument
+  Value* ptr = new AllocaInst(add->getType(), 0, "", add);
+  Value* result = new LoadInst(ptr, add->getName(), add);
+  valArgs.push_back( result );
+  for(std::vector<Value*>::iterator VI = valArgs.begin()+1; VI != valArgs.end(); ++VI)
+  {
+    valTypes.push_back( (*VI)->getType() );
+  }
+  Function* rocccInHw = create_RocccInvokeHardware_for(name, valTypes, &M);
+  CallInst::Create( rocccInHw,
+                    valArgs.begin(),
+                    valArgs.end(),
+                    "" ,
+                    add);
+  LOG_MESSAGE1("Intrinsic Replacement", "Fusing \'" << printInstruction(mul) << "\' and \'" << printInstruction(add) << "\' into intrinsic \'" << core << "\'.\n");
+  std::string oldName = getValueName(add);
+  add->replaceAllUsesWith(result);
+  setSizeInBits(result, size);
+  setValueName(result, oldName);
+  add->eraseFromParent();
+  //the only uses left on the product are its name and size
+  while( !mul->use_empty() )
+  {
+    Instruction* use = dynamic_cast<Instruction*>(*mul->use_begin());
+    assert( use and "Fused multiply has a use that is not an instruction!" );
+    use->eraseFromParent();
+  }
+  mul->eraseFromParent();
+}
+
+/*
+Look for floating point additions fed by a multiplication that is used
+nowhere else and fuse the pair whenever the database has a fused 
+multiply-add core of the right size.  Subtractions are left alone, as 
+negating the addend would need a core of its own.
+*/
+bool fuseMultiplyAdds(Module& M, BasicBlock* BB)
+{
+  //find all of the pairs first, as fusing erases the name and size calls,
+  //  which can be anywhere in the block
+  std::vector<std::pair<BinaryOperator*, BinaryOperator*> > pairs;
+  bool warned = false;
+  for( BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II )
+  {
+    BinaryOperator* add = dynamic_cast<BinaryOperator*>(&*II);
+    if( !add or add->getOpcode() != Instruction::Add or !add->getType()->isFloatingPoint() )
+      continue;
+    BinaryOperator* mul = NULL;
+    for(int op = 0; op < 2 and !mul; ++op)
+    {
+      BinaryOperator* BO = dynamic_cast<BinaryOperator*>(add->getOperand(op));
+      if( BO and BO->getOpcode() == Instruction::Mul and 
+          BO->getParent() == BB and
+          getSizeInBits(BO) == getSizeInBits(add) and
+          isOnlyUsedBy(BO, add) )
+      {
+        mul = BO;
+      }
+    }
+    if( !mul )
+      continue;
+    if( getFusedMultiplyAddCore(getSizeInBits(add)) == "" )
+    {
+      if( !warned )
+      {
+        LOG_MESSAGE1("Intrinsic Replacement", "No " << getSizeInBits(add) << " bit fused multiply-add intrinsic is available; \'" << printInstruction(add) << "\' will use separate multiply and add intrinsics.\n");
+        warned = true;
+      }
+      continue;
+    }
+    pairs.push_back( std::pair<BinaryOperator*, BinaryOperator*>(mul, add) );
+  }
+  for(std::vector<std::pair<BinaryOperator*, BinaryOperator*> >::iterator PI = pairs.begin(); PI != pairs.end(); ++PI)
+  {
+    fuseMultiplyAdd(M, PI->first, PI->second, getFusedMultiplyAddCore(getSizeInBits(PI->second)));
+  }
+  return !pairs.empty();
+}
+
 // This is the entry point to our pass and where all of our work gets done
 bool ROCCCIntrinsicPass::runOnModule(Module& M)
 {
@@ -896,6 +1055,18 @@ bool ROCCCIntrinsicPass::runOnModule(Module& M)
   //resetSizeMap();
   bool changed = false;
   
+  //fuse multiply-add chains first, so the pairs are never given separate cores
+  if( ROCCC::isLoOptimizationSelected("FusedMultiplyAdd") )
+  {
+    for( Module::iterator f = M.begin(); f != M.end(); ++f )
+    {
+      for( Function::iterator BB = f->begin(); BB != f->end(); ++BB )
+      {
+        changed |= fuseMultiplyAdds(M, &*BB);
+      }
+    }
+  }
+
   for( Module::iterator f = M.begin(); f != M.end(); ++f )
   {
     for( Function::iterator BB = f->begin(); BB != f->end(); ++BB )
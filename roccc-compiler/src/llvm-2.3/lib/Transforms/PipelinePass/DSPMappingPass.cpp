@@ -0,0 +1,101 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+Places the pipeline registers around multiplies the way a DSP block expects
+them. Synthesis tools only absorb registers into a DSP block when they sit
+directly on its inputs, between the multiplier and the post-adder, and on its
+output; when retiming places a register in the middle of other logic, the
+DSP is built from the combinational multiplier alone and misses its Fmax.
+
+Every multiply that fits in a DSP block is given its own pipeline stage, so
+its operands are registered right before it and its product right after it.
+An add or subtract that only feeds such a multiply becomes the pre-adder and
+an add or subtract of a multiply that is used nowhere else becomes the
+post-adder of a multiply-accumulate; each of these also gets its own stage,
+so the register between it and the multiply is the DSP's internal register.
+
+*/
+
+#include "llvm/Pass.h"
+#include "rocccLibrary/DFFunction.h"
+
+#include <map>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/PipelineBlocks.h"
+#include "rocccLibrary/GetValueName.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/DSPMapping.h"
+#include "TimingRequirements.h"
+
+namespace llvm
+{
+  class DSPMappingPass : public FunctionPass
+  {
+  public:
+    static char ID ;
+    DSPMappingPass() ;
+    ~DSPMappingPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char DSPMappingPass::ID = 0 ;
+
+static RegisterPass<DSPMappingPass> X ("dspMapping", 
+					"Registers multiplies the way DSP blocks expect.");
+
+DSPMappingPass::DSPMappingPass() : FunctionPass((intptr_t)&ID) 
+{
+  ; // Nothing in here
+}
+
+DSPMappingPass::~DSPMappingPass()
+{
+  ; // Nothing to delete either
+}
+
+bool DSPMappingPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  if (f.isDeclaration() || f.getDFFunction() == NULL)
+  {
+    return false ;
+  }
+  if( !ROCCC::isLoOptimizationSelected("DSPMapping") )
+  {
+    return false ;
+  }
+  Pipelining::TimingRequirements* timing = Pipelining::TimingRequirements::getCurrentRequirements(&f);
+  int multiplies = 0;
+  int preAdders = 0;
+  int postAdders = 0;
+  std::map<DFBasicBlock*, bool> allBlocks = getPipelineBlocks(f);
+  for(std::map<DFBasicBlock*,bool>::iterator BBI = allBlocks.begin(); BBI != allBlocks.end(); ++BBI)
+  {
+    if( !BBI->second )
+      continue;
+    for( BasicBlock::iterator II = BBI->first->begin(); II != BBI->first->end(); ++II )
+    {
+      if( ROCCC::isDSPMultiply(II) )
+        ++multiplies;
+      else if( ROCCC::isDSPPreAdder(II) )
+        ++preAdders;
+      else if( ROCCC::isDSPPostAdder(II) )
+        ++postAdders;
+      else
+        continue;
+      LOG_MESSAGE2("Pipelining", "DSP Mapping", "Putting " << getValueName(II) << " into own pipeline stage so its registers are absorbed into a DSP block.\n");
+      timing->setBasicBlockDelay(BBI->first, timing->getDesiredDelay());
+      break;
+    }
+  }
+  LOG_MESSAGE2("Pipelining", "DSP Mapping", f.getName() << " maps " << multiplies << " multiplies onto DSP blocks, with " << preAdders << " pre-adders and " << postAdders << " multiply-accumulates.\n");
+  return false ;
+}
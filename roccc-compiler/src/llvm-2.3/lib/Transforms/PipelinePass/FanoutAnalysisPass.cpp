@@ -27,6 +27,7 @@ saves for the future. This pass is responsible.
 #include "rocccLibrary/GetValueName.h"
 #include "rocccLibrary/DefinitionInst.h"
 #include "rocccLibrary/CopyValue.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
 
 namespace llvm
 {
@@ -169,34 +170,10 @@ bool FanoutTreePass::runOnFunction(Function& f)
     return changed ;
   }
   unsigned int MAX_FANOUT = 50;
-  std::ifstream file(".ROCCC/.optlo");
-  if (!file)
+  int value = static_cast<int>(ROCCC::getLoOptimizationValue("FanoutTreeGeneration", MAX_FANOUT));
+  if( value >= 0 )
   {
-    INTERNAL_SERIOUS_WARNING("Could not open timing information file for max tree fanout!\n");
-  }
-  else
-  {
-    while( !file.eof() )
-    {
-      std::stringstream line;
-      {
-        std::string l2;
-        getline(file, l2);
-        line << l2;
-      }
-      std::string name;
-      int value = -1;
-      line >> name;
-      //allow comments
-      if( name.find("#") != 0 and name.find("//") != 0 and name.find("--") != 0 )
-      {
-        line >> value;
-      }
-      if( name == "FanoutTreeGeneration" and value >= 0 )
-      {
-        MAX_FANOUT = value;
-      }
-    }
+    MAX_FANOUT = value;
   }
   LOG_MESSAGE2("Pipelining", "Fanout Analysis", "In order to reduce the negative effect on frequency that a high fanout can have, operations with a fanout greater than " << MAX_FANOUT << " will have a tree of copies created.\n");
   
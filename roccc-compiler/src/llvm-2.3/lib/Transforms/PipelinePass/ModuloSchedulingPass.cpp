@@ -0,0 +1,353 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+This pass schedules the recurrences of datapaths that carry values from one
+loop iteration to the next. Only the loadPrevious() and storeNext() blocks
+move; every other operation keeps the level the pipelining gave it. A loop carried value shows up in the DFG as a loadPrevious() and a
+storeNext() on the same variable; the edge between the two is removed when
+the DFG is built, so the rest of the pipelining passes see an acyclic graph
+and are free to pull the loadPrevious() to the top of the pipeline and push
+the storeNext() to the bottom.
+
+Iteration i+1 reads the variable in the loadPrevious() level, and iteration
+i writes it in the storeNext() level, where it is registered and can only be
+read the cycle after. If a new iteration enters the pipeline every II cycles,
+the write has to happen before the next read, which gives the recurrence
+constraint
+
+  II >= level(loadPrevious) - level(storeNext) + 1
+
+This is the same as the systolic feedback counter of the inputController,
+which waits one cycle more than the levels the feedback spans.
+
+Because every operation in the datapath gets its own hardware, the resource
+constrained minimum II is always 1, and the minimum II of the function is
+the largest recurrence constraint. The scheduling is done iteratively:
+  1) move each loadPrevious() down to just above its earliest use, and each
+       storeNext() up to just below the value it is storing. This does not
+       change the depth of the pipeline, only how long the recurrence is.
+  2) repeat 1) until no level changes, as moving one recurrence can open up
+       room for another that uses it.
+  3) compute the minimum II from the compacted recurrences and store it in
+       the DFFunction, where the inputController uses it to throttle how often
+       new values are pushed onto the datapath.
+
+When the OperatorSharing optimization is selected, the user gives a target
+throughput of one result every N cycles instead. The initiation interval is
+raised to N, and before the recurrences are compacted, multiplies that share
+a pipeline level are spread over the levels they are free to move between.
+Multiplies in the same level are always active at the same time, so this is
+what lets VHDL generation bind them onto fewer shared multipliers.
+
+This pass needs to run after the pipeline levels are final (after -retime and
+-minimizeCopies) and before any copies are inserted.
+
+*/
+
+#include "llvm/Pass.h"
+#include "llvm/Instructions.h"
+#include "llvm/Constants.h"
+#include "rocccLibrary/DFFunction.h"
+#include "llvm/Support/CFG.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/FunctionType.h"
+#include "rocccLibrary/PipelineBlocks.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+
+namespace llvm
+{
+  class ModuloSchedulingPass : public FunctionPass
+  {
+  private:
+  public:
+    static char ID ;
+    ModuloSchedulingPass() ;
+    ~ModuloSchedulingPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char ModuloSchedulingPass::ID = 0 ;
+
+static RegisterPass<ModuloSchedulingPass> X ("moduloSchedule",
+					"Compact loop carried values and calculate the initiation interval of the pipeline.");
+
+ModuloSchedulingPass::ModuloSchedulingPass() : FunctionPass((intptr_t)&ID)
+{
+  ; // Nothing in here
+}
+
+ModuloSchedulingPass::~ModuloSchedulingPass()
+{
+  ; // Nothing to delete either
+}
+
+namespace MODULO_SCHEDULING_LOCAL {
+
+/*
+A recurrence is the pair of blocks that read and write the same loop carried
+variable.
+*/
+struct Recurrence {
+  Value* variable;
+  DFBasicBlock* load;
+  DFBasicBlock* store;
+  Recurrence() : variable(NULL), load(NULL), store(NULL) {}
+  int getLength()
+  {
+    return load->getPipelineLevel() - store->getPipelineLevel();
+  }
+  //the written value is registered, so the next read is a cycle later
+  int getInterval()
+  {
+    return getLength() + 1;
+  }
+};
+
+/*
+Find every loadPrevious() that has a matching storeNext().
+*/
+std::vector<Recurrence> getRecurrences(std::map<DFBasicBlock*, bool>& pipeBlocks)
+{
+  std::map<Value*, Recurrence> recurrenceMap;
+  for(std::map<DFBasicBlock*, bool>::iterator BB = pipeBlocks.begin(); BB != pipeBlocks.end(); ++BB)
+  {
+    if( BB->second == false )
+      continue;
+    for(BasicBlock::iterator II = BB->first->begin(); II != BB->first->end(); ++II)
+    {
+      CallInst* CI = dynamic_cast<CallInst*>(&*II);
+      if( isROCCCFunctionCall(CI, ROCCCNames::LoadPrevious) )
+      {
+        assert( CI->getNumOperands() >= 2 and "Incorrect number of arguments to loadPrevious!" );
+        recurrenceMap[CI->getOperand(1)].variable = CI->getOperand(1);
+        recurrenceMap[CI->getOperand(1)].load = BB->first;
+      }
+      else if( isROCCCFunctionCall(CI, ROCCCNames::StoreNext) )
+      {
+        assert( CI->getNumOperands() == 3 and "Incorrect number of arguments to storeNext!" );
+        recurrenceMap[CI->getOperand(1)].variable = CI->getOperand(1);
+        recurrenceMap[CI->getOperand(1)].store = BB->first;
+      }
+    }
+  }
+  std::vector<Recurrence> ret;
+  for(std::map<Value*, Recurrence>::iterator RI = recurrenceMap.begin(); RI != recurrenceMap.end(); ++RI)
+  {
+    if( RI->second.load and RI->second.store )
+      ret.push_back(RI->second);
+  }
+  return ret;
+}
+
+/*
+The lowest level a loadPrevious can be placed at is one above the highest of
+its uses, taking into account the delay of those uses.
+*/
+bool sinkLoad(DFBasicBlock* load, std::map<DFBasicBlock*, bool>& pipeBlocks)
+{
+  int latest = -1;
+  for(succ_iterator succ = succ_begin(load); succ != succ_end(load); ++succ)
+  {
+    DFBasicBlock* dfsucc = (*succ)->getDFBasicBlock();
+    assert( dfsucc );
+    if( pipeBlocks.find(dfsucc) == pipeBlocks.end() or pipeBlocks[dfsucc] == false )
+      continue;
+    int level = dfsucc->getPipelineLevel() + dfsucc->getDelay();
+    if( level > latest )
+      latest = level;
+  }
+  if( latest < 0 or latest >= load->getPipelineLevel() )
+    return false;
+  load->setPipelineLevel(latest);
+  load->setDataflowLevel(latest);
+  return true;
+}
+
+/*
+The highest level a storeNext can be placed at is one below the lowest of
+the values it depends on.
+*/
+bool hoistStore(DFBasicBlock* store, DFBasicBlock* source, std::map<DFBasicBlock*, bool>& pipeBlocks)
+{
+  int earliest = -1;
+  bool found = false;
+  for(pred_iterator pred = pred_begin(store); pred != pred_end(store); ++pred)
+  {
+    DFBasicBlock* dfpred = (*pred)->getDFBasicBlock();
+    assert( dfpred );
+    if( dfpred == source or pipeBlocks.find(dfpred) == pipeBlocks.end() or pipeBlocks[dfpred] == false )
+      continue;
+    int level = dfpred->getPipelineLevel() - store->getDelay();
+    if( !found or level < earliest )
+      earliest = level;
+    found = true;
+  }
+  if( !found or earliest <= store->getPipelineLevel() )
+    return false;
+  store->setPipelineLevel(earliest);
+  store->setDataflowLevel(earliest);
+  return true;
+}
+
+/*
+Only multiplies between two variables end up in multiplier blocks; anything
+with a constant is turned into shifts and adds by synthesis.
+*/
+bool isSharableMultiply(DFBasicBlock* BB)
+{
+  BinaryOperator* bo = dynamic_cast<BinaryOperator*>(BB->getFirstNonPHI());
+  if( !bo or bo->getOpcode() != BinaryOperator::Mul )
+    return false;
+  return !dynamic_cast<Constant*>(bo->getOperand(0)) and !dynamic_cast<Constant*>(bo->getOperand(1));
+}
+
+bool compareLevel(DFBasicBlock* a, DFBasicBlock* b)
+{
+  return a->getPipelineLevel() > b->getPipelineLevel();
+}
+
+/*
+Move each multiply that shares its level with another multiply to the least
+crowded level it can legally sit at. A block can move anywhere strictly
+between its uses and its definitions, so moving it never puts it in the same
+combinational path as a neighbor, and never changes the depth of the pipeline.
+*/
+int spreadMultiplies(std::map<DFBasicBlock*, bool>& pipeBlocks, DFBasicBlock* source)
+{
+  std::vector<DFBasicBlock*> multiplies;
+  std::map<int, int> levelCount;
+  for(std::map<DFBasicBlock*, bool>::iterator BB = pipeBlocks.begin(); BB != pipeBlocks.end(); ++BB)
+  {
+    if( BB->second == false or !isSharableMultiply(BB->first) )
+      continue;
+    multiplies.push_back(BB->first);
+    ++levelCount[BB->first->getPipelineLevel()];
+  }
+  std::stable_sort(multiplies.begin(), multiplies.end(), compareLevel);
+  int moved = 0;
+  for(std::vector<DFBasicBlock*>::iterator MI = multiplies.begin(); MI != multiplies.end(); ++MI)
+  {
+    int current = (*MI)->getPipelineLevel();
+    if( levelCount[current] <= 1 )
+      continue;
+    int lowest = -1;
+    for(succ_iterator succ = succ_begin(*MI); succ != succ_end(*MI); ++succ)
+    {
+      DFBasicBlock* dfsucc = (*succ)->getDFBasicBlock();
+      if( pipeBlocks.find(dfsucc) == pipeBlocks.end() or pipeBlocks[dfsucc] == false )
+        continue;
+      lowest = std::max(lowest, dfsucc->getPipelineLevel() + dfsucc->getDelay());
+    }
+    int highest = -1;
+    bool found = false;
+    for(pred_iterator pred = pred_begin(*MI); pred != pred_end(*MI); ++pred)
+    {
+      DFBasicBlock* dfpred = (*pred)->getDFBasicBlock();
+      if( dfpred == source or pipeBlocks.find(dfpred) == pipeBlocks.end() or pipeBlocks[dfpred] == false )
+        continue;
+      int level = dfpred->getPipelineLevel() - (*MI)->getDelay();
+      if( !found or level < highest )
+        highest = level;
+      found = true;
+    }
+    if( lowest < 0 or !found )
+      continue;
+    int best = current;
+    for(int level = highest; level >= lowest; --level)
+    {
+      if( levelCount[level] + 1 < levelCount[best] )
+        best = level;
+    }
+    if( best == current )
+      continue;
+    --levelCount[current];
+    ++levelCount[best];
+    (*MI)->setPipelineLevel(best);
+    (*MI)->setDataflowLevel(best);
+    ++moved;
+  }
+  return moved;
+}
+
+}
+using namespace MODULO_SCHEDULING_LOCAL;
+
+bool ModuloSchedulingPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+  if (f.isDeclaration() || f.getDFFunction() == NULL)
+  {
+    return changed ;
+  }
+  DFFunction* df = f.getDFFunction();
+  std::map<DFBasicBlock*, bool> pipeBlocks = getPipelineBlocks(f);
+  std::vector<Recurrence> recurrences = getRecurrences(pipeBlocks);
+  df->setInitiationInterval(1);
+  int targetInterval = 1;
+  if( ROCCC::isLoOptimizationSelected("OperatorSharing") )
+  {
+    targetInterval = static_cast<int>(ROCCC::getLoOptimizationValue("OperatorSharing", 1));
+    if( targetInterval < 1 )
+      targetInterval = 1;
+  }
+  if( targetInterval > 1 )
+  {
+    int moved = spreadMultiplies(pipeBlocks, df->getSource());
+    changed = changed or moved > 0;
+    LOG_MESSAGE2("Pipelining", "Modulo Scheduling", "Target throughput of " << f.getName() << " is one result every " << targetInterval << " cycles; " << moved << " multiplies were moved to less crowded pipeline levels so they can share hardware.\n");
+  }
+  std::map<Value*, int> originalLength;
+  for(std::vector<Recurrence>::iterator RI = recurrences.begin(); RI != recurrences.end(); ++RI)
+  {
+    originalLength[RI->variable] = RI->getLength();
+  }
+  //every move is monotonic (loads only move down, stores only move up), so
+  //  this is guaranteed to reach a fixed point
+  bool moved = true;
+  while( moved )
+  {
+    moved = false;
+    for(std::vector<Recurrence>::iterator RI = recurrences.begin(); RI != recurrences.end(); ++RI)
+    {
+      moved = sinkLoad(RI->load, pipeBlocks) or moved;
+      moved = hoistStore(RI->store, df->getSource(), pipeBlocks) or moved;
+    }
+    changed = changed or moved;
+  }
+  int ii = targetInterval;
+  for(std::vector<Recurrence>::iterator RI = recurrences.begin(); RI != recurrences.end(); ++RI)
+  {
+    assert( RI->getLength() >= 0 and "storeNext scheduled before its loadPrevious!" );
+    if( RI->getInterval() > ii )
+    {
+      if( targetInterval > 1 )
+        LOG_MESSAGE2("Pipelining", "Modulo Scheduling", "Loop carried value " << RI->variable->getName() << " limits the throughput to one result every " << RI->getInterval() << " cycles, below the requested target.\n");
+      ii = RI->getInterval();
+    }
+    LOG_MESSAGE2("Pipelining", "Modulo Scheduling", "Loop carried value " << RI->variable->getName() << " spans " << RI->getLength() << " pipeline stages (was " << originalLength[RI->variable] << ").\n");
+  }
+  df->setInitiationInterval(ii);
+  if( ii > 1 )
+  {
+    LOG_MESSAGE2("Pipelining", "Modulo Scheduling", "Initiation interval of " << f.getName() << " set to " << ii << "; a new iteration enters the pipeline every " << ii << " clock cycles.\n");
+    if( df->getFunctionType() != ROCCC::MODULE )
+    {
+      INTERNAL_WARNING(f.getName() << " requires an initiation interval of " << ii << "; inputs must not be supplied more often than once every " << ii << " clock cycles!\n");
+    }
+  }
+  return changed ;
+}
@@ -0,0 +1,238 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+The stage merging pass removes pipeline registers that are not needed to meet
+the desired clock period. Retiming only guarantees that no pipeline stage is
+slower than the desired delay; it does not try to use as few stages as
+possible, so neighboring stages often both finish well under the target.
+
+Using the same per operation delays as retiming (from TimingRequirements),
+the pass walks the pipeline from the inputs toward the outputs and merges
+each pair of neighboring stages whose combined critical path still fits in
+the desired delay. The critical path of a merged stage is the longest chain
+of operations that are connected inside of the two stages, as values passed
+between blocks of the same stage are not registered.
+
+Merging a stage lowers the pipeline level of every block above it by one, so
+the structure of the pipeline is otherwise unchanged. The input and output
+stages, and any stage holding a component, a lookup table, feedback, or a
+systolic array, are never merged, as those depend on having their own
+pipeline level.
+
+The latency and an estimate of the pipeline register bits (every value is
+registered once for each level between its definition and its last use)
+before and after merging are reported for each module.
+
+This needs to run right after retiming, before copies are inserted.
+
+*/
+
+#include "llvm/Pass.h"
+#include "llvm/Instructions.h"
+#include "rocccLibrary/DFFunction.h"
+#include "llvm/Support/CFG.h"
+
+#include <map>
+#include <vector>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/DefinitionInst.h"
+#include "rocccLibrary/SizeInBits.h"
+#include "rocccLibrary/PipelineBlocks.h"
+#include "TimingRequirements.h"
+
+namespace llvm
+{
+  class StageMergingPass : public FunctionPass
+  {
+  private:
+  public:
+    static char ID ;
+    StageMergingPass() ;
+    ~StageMergingPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char StageMergingPass::ID = 0 ;
+
+static RegisterPass<StageMergingPass> X ("mergeStages",
+					"Merge neighboring pipeline stages whose combined delay meets the desired clock period.");
+
+StageMergingPass::StageMergingPass() : FunctionPass((intptr_t)&ID)
+{
+  ; // Nothing in here
+}
+
+StageMergingPass::~StageMergingPass()
+{
+  ; // Nothing to delete either
+}
+
+namespace STAGE_MERGING_LOCAL {
+
+/*
+A stage can only be merged if all of its blocks are plain operations that
+take a single pipeline level.
+*/
+bool isMergeableBlock(DFBasicBlock* BB)
+{
+  if( BB->getDelay() != 1 )
+    return false;
+  for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+  {
+    if( dynamic_cast<PHINode*>(&*II) )
+      return false;
+    CallInst* CI = dynamic_cast<CallInst*>(&*II);
+    if( CI and !isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+      return false;
+  }
+  return true;
+}
+
+/*
+The arrival time of a block inside of a set of blocks that are not separated
+by registers is its own delay plus the latest arrival time of its
+predecessors in the same set.
+*/
+int getArrivalTime(DFBasicBlock* BB, std::map<DFBasicBlock*, bool>& stage, std::map<DFBasicBlock*, int>& arrival, Pipelining::TimingRequirements* timing)
+{
+  std::map<DFBasicBlock*, int>::iterator AI = arrival.find(BB);
+  if( AI != arrival.end() )
+    return AI->second;
+  int latest = 0;
+  for(pred_iterator pred = pred_begin(BB); pred != pred_end(BB); ++pred)
+  {
+    DFBasicBlock* dfpred = (*pred)->getDFBasicBlock();
+    if( stage.find(dfpred) == stage.end() )
+      continue;
+    int predArrival = getArrivalTime(dfpred, stage, arrival, timing);
+    if( predArrival > latest )
+      latest = predArrival;
+  }
+  return (arrival[BB] = latest + timing->getBasicBlockDelay(BB));
+}
+
+/*
+Return the critical path of the stage made by merging the given levels, or
+-1 if the levels cannot be merged at all.
+*/
+int getMergedStageDelay(std::map<DFBasicBlock*, bool>& pipeBlocks, int upper, int lower, Pipelining::TimingRequirements* timing)
+{
+  std::map<DFBasicBlock*, bool> stage;
+  for(std::map<DFBasicBlock*, bool>::iterator BB = pipeBlocks.begin(); BB != pipeBlocks.end(); ++BB)
+  {
+    if( BB->second == false )
+      continue;
+    int level = BB->first->getPipelineLevel();
+    if( level != upper and level != lower )
+      continue;
+    if( !isMergeableBlock(BB->first) )
+      return -1;
+    stage[BB->first] = true;
+  }
+  std::map<DFBasicBlock*, int> arrival;
+  int critical = 0;
+  for(std::map<DFBasicBlock*, bool>::iterator SI = stage.begin(); SI != stage.end(); ++SI)
+  {
+    int a = getArrivalTime(SI->first, stage, arrival, timing);
+    if( a > critical )
+      critical = a;
+  }
+  return critical;
+}
+
+/*
+Each value is registered once for every pipeline level between the block
+that defines it and its lowest use.
+*/
+int getPipelineRegisterBits(std::map<DFBasicBlock*, bool>& pipeBlocks)
+{
+  std::map<Instruction*, std::pair<int,int> > span;
+  for(std::map<DFBasicBlock*, bool>::iterator BB = pipeBlocks.begin(); BB != pipeBlocks.end(); ++BB)
+  {
+    if( BB->second == false )
+      continue;
+    for(BasicBlock::iterator II = BB->first->begin(); II != BB->first->end(); ++II)
+    {
+      for(User::op_iterator OP = II->op_begin(); OP != II->op_end(); ++OP)
+      {
+        Instruction* inst = dynamic_cast<Instruction*>(OP->get());
+        if( !inst )
+          continue;
+        Instruction* def = getDefinitionInstruction(inst, BB->first);
+        if( !def or !def->getParent() or !def->getParent()->getDFBasicBlock() )
+          continue;
+        int defLevel = def->getParent()->getDFBasicBlock()->getPipelineLevel();
+        int useLevel = BB->first->getPipelineLevel();
+        if( span.find(inst) == span.end() )
+          span[inst] = std::pair<int,int>(defLevel, useLevel);
+        else if( useLevel < span[inst].second )
+          span[inst].second = useLevel;
+      }
+    }
+  }
+  int bits = 0;
+  for(std::map<Instruction*, std::pair<int,int> >::iterator SI = span.begin(); SI != span.end(); ++SI)
+  {
+    if( SI->second.first > SI->second.second )
+      bits += (SI->second.first - SI->second.second) * getSizeInBits(SI->first);
+  }
+  return bits;
+}
+
+}
+using namespace STAGE_MERGING_LOCAL;
+
+bool StageMergingPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+  if (f.isDeclaration() || f.getDFFunction() == NULL)
+  {
+    return changed ;
+  }
+  DFFunction* df = f.getDFFunction();
+  Pipelining::TimingRequirements* timing = Pipelining::TimingRequirements::getCurrentRequirements(&f);
+  std::map<DFBasicBlock*, bool> pipeBlocks = getPipelineBlocks(f);
+  int originalDelay = df->getDelay();
+  int originalBits = getPipelineRegisterBits(pipeBlocks);
+  int merged = 0;
+  //the top level holds the inputs, and level 0 the outputs; neither is merged
+  int top = df->getSource()->getPipelineLevel() - 1;
+  for(int upper = top - 1; upper - 1 > 0; --upper)
+  {
+    int stageDelay = getMergedStageDelay(pipeBlocks, upper, upper - 1, timing);
+    if( stageDelay < 0 or stageDelay > timing->getDesiredDelay() )
+      continue;
+    //merge by moving everything at or above the upper level down one
+    for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+    {
+      DFBasicBlock* dfbb = BB->getDFBasicBlock();
+      if( !dfbb or dfbb->getPipelineLevel() < upper )
+        continue;
+      dfbb->setPipelineLevel(dfbb->getPipelineLevel() - 1);
+      dfbb->setDataflowLevel(dfbb->getPipelineLevel());
+    }
+    ++merged;
+    changed = true;
+  }
+  if( !changed )
+  {
+    LOG_MESSAGE2("Pipelining", "Stage Merging", "No pipeline stages of " << f.getName() << " could be merged within the desired delay of " << timing->getDesiredDelay() << ".\n");
+    return changed;
+  }
+  df->setDelay( df->getSource()->getPipelineLevel() - df->getSink()->getPipelineLevel() - 1 );
+  int mergedBits = getPipelineRegisterBits(pipeBlocks);
+  LOG_MESSAGE2("Pipelining", "Stage Merging", "Merged " << merged << " pipeline stages of " << f.getName() << ". "
+               << "Latency reduced from " << originalDelay << " to " << df->getDelay() << " cycles; "
+               << "pipeline registers reduced from approximately " << originalBits << " to " << mergedBits << " bits.\n");
+  return changed ;
+}
@@ -0,0 +1,352 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+The timing report pass computes, for every operation in the pipelined
+datapath, when its result arrives inside of its pipeline stage, when it is
+required by, and the slack between the two. Nothing else in the low end says
+which chain of blocks set the clock period or where there is room left, so
+this is what should be looked at when tuning the timing information.
+
+The delays are the same per block delays that retiming and stage merging use
+(from TimingRequirements). Values are registered at the end of every
+pipeline level, so a stage starts at time 0 and the arrival time of a block
+is its own delay plus the latest arrival time of its predecessors in the same
+stage. The required time of a block is the desired delay if nothing in its
+stage uses it, and otherwise the earliest required time of its users minus
+their delays. Slack is the required time minus the arrival time; a negative
+slack means the stage does not meet the desired delay.
+
+Two files are written next to the compilation report:
+  <name>_timing.txt  - the stages sorted from slowest to fastest, each with
+                       the chain of operations that set its delay, followed
+                       by every operation sorted by slack.
+  <name>_timing.json - the same information for scripts.
+
+The arrival and required times are also stored in each DFBasicBlock so the
+datapath printer can annotate the dot graph with them.
+
+The pass only runs when the TimingReport low level optimization is selected.
+It needs to run after every pass that moves blocks between pipeline levels,
+and before copies are inserted.
+
+*/
+
+#include "llvm/Pass.h"
+#include "llvm/Instructions.h"
+#include "llvm/Function.h"
+#include "rocccLibrary/DFFunction.h"
+#include "llvm/Support/CFG.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <assert.h>
+#include <unistd.h>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/GetValueName.h"
+#include "rocccLibrary/PipelineBlocks.h"
+#include "rocccLibrary/FileInfo.h"
+#include "rocccLibrary/DatabaseHelpers.h"
+#include "TimingRequirements.h"
+
+namespace llvm
+{
+  class TimingReportPass : public FunctionPass
+  {
+  private:
+  public:
+    static char ID ;
+    TimingReportPass() ;
+    ~TimingReportPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char TimingReportPass::ID = 0 ;
+
+static RegisterPass<TimingReportPass> X ("timingReport",
+					"Report the arrival time, required time, and slack of every operation in the datapath.");
+
+TimingReportPass::TimingReportPass() : FunctionPass((intptr_t)&ID)
+{
+  ; // Nothing in here
+}
+
+TimingReportPass::~TimingReportPass()
+{
+  ; // Nothing to delete either
+}
+
+namespace TIMING_REPORT_LOCAL {
+
+bool isInSameStage(DFBasicBlock* a, DFBasicBlock* b, std::map<DFBasicBlock*, bool>& pipeBlocks)
+{
+  if( pipeBlocks.find(b) == pipeBlocks.end() or pipeBlocks[b] == false )
+    return false;
+  return a->getPipelineLevel() == b->getPipelineLevel();
+}
+
+int getArrivalTime(DFBasicBlock* BB, std::map<DFBasicBlock*, bool>& pipeBlocks, Pipelining::TimingRequirements* timing)
+{
+  if( BB->getArrivalTime() >= 0 )
+    return BB->getArrivalTime();
+  //guard against cycles through feedback inside of a stage
+  BB->setArrivalTime(timing->getBasicBlockDelay(BB));
+  int latest = 0;
+  for(pred_iterator pred = pred_begin(BB); pred != pred_end(BB); ++pred)
+  {
+    DFBasicBlock* dfpred = (*pred)->getDFBasicBlock();
+    if( !isInSameStage(BB, dfpred, pipeBlocks) )
+      continue;
+    int predArrival = getArrivalTime(dfpred, pipeBlocks, timing);
+    if( predArrival > latest )
+      latest = predArrival;
+  }
+  BB->setArrivalTime(latest + timing->getBasicBlockDelay(BB));
+  return BB->getArrivalTime();
+}
+
+int getRequiredTime(DFBasicBlock* BB, std::map<DFBasicBlock*, bool>& pipeBlocks, Pipelining::TimingRequirements* timing)
+{
+  if( BB->getRequiredTime() >= 0 )
+    return BB->getRequiredTime();
+  BB->setRequiredTime(timing->getDesiredDelay());
+  int earliest = timing->getDesiredDelay();
+  for(succ_iterator succ = succ_begin(BB); succ != succ_end(BB); ++succ)
+  {
+    DFBasicBlock* dfsucc = (*succ)->getDFBasicBlock();
+    if( !isInSameStage(BB, dfsucc, pipeBlocks) )
+      continue;
+    int succRequired = getRequiredTime(dfsucc, pipeBlocks, timing) - timing->getBasicBlockDelay(dfsucc);
+    if( succRequired < earliest )
+      earliest = succRequired;
+  }
+  BB->setRequiredTime(earliest);
+  return BB->getRequiredTime();
+}
+
+int getSlack(DFBasicBlock* BB)
+{
+  return BB->getRequiredTime() - BB->getArrivalTime();
+}
+
+/*
+Walk backwards from the latest block of a stage, always following the
+predecessor whose result arrived last.
+*/
+std::vector<DFBasicBlock*> getCriticalPath(DFBasicBlock* last, std::map<DFBasicBlock*, bool>& pipeBlocks, Pipelining::TimingRequirements* timing)
+{
+  std::vector<DFBasicBlock*> path;
+  DFBasicBlock* current = last;
+  while( current and std::find(path.begin(), path.end(), current) == path.end() )
+  {
+    path.insert(path.begin(), current);
+    DFBasicBlock* next = NULL;
+    for(pred_iterator pred = pred_begin(current); pred != pred_end(current); ++pred)
+    {
+      DFBasicBlock* dfpred = (*pred)->getDFBasicBlock();
+      if( !isInSameStage(current, dfpred, pipeBlocks) )
+        continue;
+      if( dfpred->getArrivalTime() == current->getArrivalTime() - timing->getBasicBlockDelay(current) )
+        next = dfpred;
+    }
+    current = next;
+  }
+  return path;
+}
+
+std::string getOperationName(Instruction* II)
+{
+  if( CallInst* CI = dynamic_cast<CallInst*>(II) )
+  {
+    if( CI->getCalledFunction() )
+      return CI->getCalledFunction()->getName();
+  }
+  return II->getOpcodeName();
+}
+
+/*
+The operations of a block, ignoring the terminator and phis, as
+"name = operation" separated by commas.
+*/
+std::string describeBlock(DFBasicBlock* BB)
+{
+  std::stringstream ss;
+  bool first = true;
+  for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+  {
+    if( dynamic_cast<TerminatorInst*>(&*II) or dynamic_cast<PHINode*>(&*II) )
+      continue;
+    if( !first )
+      ss << ", ";
+    first = false;
+    if( II->getType() != Type::VoidTy )
+      ss << getValueName(II) << " = ";
+    ss << getOperationName(II);
+  }
+  if( first )
+    ss << BB->getName();
+  return ss.str();
+}
+
+std::string escapeJSON(std::string s)
+{
+  std::string ret;
+  for(std::string::iterator C = s.begin(); C != s.end(); ++C)
+  {
+    if( *C == '\"' or *C == '\\' )
+      ret += '\\';
+    if( *C == '\n' )
+      ret += "\\n";
+    else
+      ret += *C;
+  }
+  return ret;
+}
+
+struct StageTiming {
+  int level;
+  int delay;
+  std::vector<DFBasicBlock*> path;
+};
+
+bool compareStageDelay(const StageTiming& a, const StageTiming& b)
+{
+  if( a.delay != b.delay )
+    return a.delay > b.delay;
+  return a.level > b.level;
+}
+
+bool compareBlockSlack(DFBasicBlock* a, DFBasicBlock* b)
+{
+  if( getSlack(a) != getSlack(b) )
+    return getSlack(a) < getSlack(b);
+  return a->getPipelineLevel() > b->getPipelineLevel();
+}
+
+}
+using namespace TIMING_REPORT_LOCAL;
+
+bool TimingReportPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+  if (f.isDeclaration() || f.getDFFunction() == NULL)
+  {
+    return changed ;
+  }
+  DFFunction* df = f.getDFFunction();
+  Pipelining::TimingRequirements* timing = Pipelining::TimingRequirements::getCurrentRequirements(&f);
+  std::map<DFBasicBlock*, bool> pipeBlocks = getPipelineBlocks(f);
+  std::vector<DFBasicBlock*> blocks;
+  for(std::map<DFBasicBlock*, bool>::iterator BB = pipeBlocks.begin(); BB != pipeBlocks.end(); ++BB)
+  {
+    if( BB->second == false )
+      continue;
+    BB->first->setArrivalTime(-1);
+    BB->first->setRequiredTime(-1);
+    blocks.push_back(BB->first);
+  }
+  //find the latest block of every stage
+  std::map<int, DFBasicBlock*> latest;
+  for(std::vector<DFBasicBlock*>::iterator BB = blocks.begin(); BB != blocks.end(); ++BB)
+  {
+    getArrivalTime(*BB, pipeBlocks, timing);
+    getRequiredTime(*BB, pipeBlocks, timing);
+    int level = (*BB)->getPipelineLevel();
+    if( latest.find(level) == latest.end() or latest[level]->getArrivalTime() < (*BB)->getArrivalTime() )
+      latest[level] = *BB;
+  }
+  std::vector<StageTiming> stages;
+  for(std::map<int, DFBasicBlock*>::iterator LI = latest.begin(); LI != latest.end(); ++LI)
+  {
+    StageTiming s;
+    s.level = LI->first;
+    s.delay = LI->second->getArrivalTime();
+    s.path = getCriticalPath(LI->second, pipeBlocks, timing);
+    stages.push_back(s);
+  }
+  std::sort(stages.begin(), stages.end(), compareStageDelay);
+  std::sort(blocks.begin(), blocks.end(), compareBlockSlack);
+
+  std::string baseName = f.getName() + "_timing";
+  char buff[1024];
+  if( !getcwd(buff, 1024) ) //getcwd returns 0 if the path is too long
+  {
+    llvm::cout << "Could not get current directory!\n";
+    assert(0);
+    exit(0);
+  }
+
+  std::ofstream text((baseName + ".txt").c_str());
+  text << "Timing report for " << f.getName() << "\n";
+  text << "Desired delay: " << timing->getDesiredDelay() << "\n";
+  text << "Pipeline latency: " << df->getDelay() << " cycles\n\n";
+  text << "Pipeline stages, slowest first:\n";
+  for(std::vector<StageTiming>::iterator SI = stages.begin(); SI != stages.end(); ++SI)
+  {
+    text << "  level " << SI->level << ": delay " << SI->delay << ", slack " << timing->getDesiredDelay() - SI->delay << "\n";
+    for(std::vector<DFBasicBlock*>::iterator PI = SI->path.begin(); PI != SI->path.end(); ++PI)
+    {
+      text << "    " << (*PI)->getArrivalTime() << "\t" << describeBlock(*PI) << "\n";
+    }
+  }
+  text << "\nOperations, least slack first:\n";
+  text << "  level\tarrival\trequired\tslack\toperation\n";
+  for(std::vector<DFBasicBlock*>::iterator BB = blocks.begin(); BB != blocks.end(); ++BB)
+  {
+    text << "  " << (*BB)->getPipelineLevel() << "\t" << (*BB)->getArrivalTime() << "\t" << (*BB)->getRequiredTime() << "\t" << getSlack(*BB) << "\t" << describeBlock(*BB) << "\n";
+  }
+  text.close();
+
+  std::ofstream json((baseName + ".json").c_str());
+  json << "{\n";
+  json << "  \"function\": \"" << escapeJSON(f.getName()) << "\",\n";
+  json << "  \"desiredDelay\": " << timing->getDesiredDelay() << ",\n";
+  json << "  \"latency\": " << df->getDelay() << ",\n";
+  json << "  \"stages\": [";
+  for(std::vector<StageTiming>::iterator SI = stages.begin(); SI != stages.end(); ++SI)
+  {
+    json << (SI == stages.begin() ? "\n" : ",\n");
+    json << "    { \"level\": " << SI->level << ", \"delay\": " << SI->delay << ", \"slack\": " << timing->getDesiredDelay() - SI->delay << ", \"criticalPath\": [";
+    for(std::vector<DFBasicBlock*>::iterator PI = SI->path.begin(); PI != SI->path.end(); ++PI)
+    {
+      if( PI != SI->path.begin() )
+        json << ", ";
+      json << "\"" << escapeJSON(describeBlock(*PI)) << "\"";
+    }
+    json << "] }";
+  }
+  json << "\n  ],\n";
+  json << "  \"operations\": [";
+  for(std::vector<DFBasicBlock*>::iterator BB = blocks.begin(); BB != blocks.end(); ++BB)
+  {
+    json << (BB == blocks.begin() ? "\n" : ",\n");
+    json << "    { \"operation\": \"" << escapeJSON(describeBlock(*BB)) << "\", \"level\": " << (*BB)->getPipelineLevel()
+         << ", \"arrival\": " << (*BB)->getArrivalTime() << ", \"required\": " << (*BB)->getRequiredTime() << ", \"slack\": " << getSlack(*BB) << " }";
+  }
+  json << "\n  ]\n";
+  json << "}\n";
+  json.close();
+
+  llvm::cout << "Writing timing report to \'" << buff << "/" << baseName << ".txt\'\n";
+  Database::FileInfoInterface::addFileInfo(Database::getCurrentID(), Database::FileInfo(baseName + ".txt", Database::FileInfo::REPORT, std::string(buff)+"/"));
+  Database::FileInfoInterface::addFileInfo(Database::getCurrentID(), Database::FileInfo(baseName + ".json", Database::FileInfo::REPORT, std::string(buff)+"/"));
+  if( !stages.empty() )
+  {
+    LOG_MESSAGE2("Pipelining", "Timing Report", "The slowest pipeline stage of " << f.getName() << " is level " << stages.begin()->level
+                 << " with a delay of " << stages.begin()->delay << " against a desired delay of " << timing->getDesiredDelay()
+                 << ". See <a href='" << baseName << ".txt'>" << baseName << ".txt</a> for the critical path of every stage.\n");
+  }
+  return changed ;
+}
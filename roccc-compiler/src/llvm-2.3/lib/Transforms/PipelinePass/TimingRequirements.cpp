@@ -8,118 +8,11 @@
 #include "rocccLibrary/CopyValue.h"
 #include "rocccLibrary/PipelineBlocks.h"
 #include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/TimingInfo.h"
 
 using namespace Pipelining;
 using namespace llvm;
-
-/*
-TimingInfo is a class that provides an easy interface to a timing
-configuration file.
-*/
-class TimingInfo {
-  std::map<std::string, int> timing;
-  float operationsPerPipelineStage;
-  int getDelayOfType(std::string type)
-  {
-    std::map<std::string, int>::iterator t = timing.find(type);
-    if( t == timing.end() )
-    {
-      timing[type] = 1;
-      assert(timing.find(type) != timing.end());
-      INTERNAL_WARNING("Could not find " << type << " delay! Setting to " << timing[type] << "!\n");
-      return timing[type];
-    }
-    return t->second;
-  }
-public:
-  TimingInfo() : operationsPerPipelineStage(1.0)
-  {
-    std::ifstream f(".ROCCC/.timingInfo");
-    if (!f)
-    {
-      INTERNAL_SERIOUS_WARNING("Could not open timing information!\n");
-      return;
-    }
-    while( !f.eof() )
-    {
-      std::string name;
-      int value = -1;
-      f >> name;
-      //allow comments
-      if( name.find("#") == 0 or name.find("//") == 0 or name.find("--") == 0 )
-      {
-        std::string temp;
-        std::getline(f, temp);
-      }
-      else if( name.find("OperationsPerPipelineStage") == 0 )
-      {
-        f >> operationsPerPipelineStage;
-      }
-      else
-      {
-        f >> value;
-      }
-      if( name != "" and value >= 0 )
-      {
-        timing[name] = value;
-      }
-    }
-  }
-  int getCopyDelay()
-  {
-    return getDelayOfType("Copy");
-  }
-  int getAddDelay()
-  {
-    return getDelayOfType("Add");
-  }
-  int getSubDelay()
-  {
-    return getDelayOfType("Sub");
-  }
-  int getMulDelay()
-  {
-    return getDelayOfType("Mult");
-  }
-  int getShiftDelay()
-  {
-    return getDelayOfType("Shift");
-  }
-  int getAndDelay()
-  {
-    return getDelayOfType("AND");
-  }
-  int getOrDelay()
-  {
-    return getDelayOfType("OR");
-  }
-  int getXorDelay()
-  {
-    return getDelayOfType("XOR");
-  }
-  int getCmpDelay()
-  {
-    return getDelayOfType("Compare");
-  }
-  int getMuxDelay()
-  {
-    return getDelayOfType("Mux");
-  }
-  int getMaximumDelay()
-  {
-    int max = 0;
-    for(std::map<std::string, int>::iterator TMI = timing.begin(); TMI != timing.end(); ++TMI)
-    {
-      if( TMI->second > max and TMI->first != "MaxFanoutRegistered" )
-        max = TMI->second;
-    }
-    return max;
-  }
-  float getOperationsPerPipelineStage()
-  {
-    return operationsPerPipelineStage;
-  }
-};
+using ROCCC::TimingInfo;
 
 /*
 Sum up the delay of each instruction in a BasicBlock, given a desiredDelay
@@ -0,0 +1,359 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+  If conversion computes both sides of every branch and selects between
+  them with a BoolSelect, which duplicates any operator that appears on
+  both sides. When the two sides of a BoolSelect are the same expensive
+  operation and are used nowhere else, only one of them is ever needed, so
+  this pass moves the BoolSelect in front of the operation instead:
+
+    sel(a*b, c*d, p)   becomes   sel(a,c,p) * sel(b,d,p)
+
+  Operands that are the same on both sides need no mux. The choice is made
+  per BoolSelect, for multiplies and library cores (floating point
+  operations, integer divides) alike, with two checks, one for area and one
+  for delay. For area, the operation and the output mux that go away must
+  be larger than the input muxes that are added, counting a mux as its
+  width. A multiplier counts as the product of its operand widths. A
+  library core counts as the registers of its pipeline, its latency in the
+  component database times the width of its ports, which is the least it
+  can be. The input muxes sit side by side, so for delay they cost one
+  mux, the same as the output mux they replace, as long as the condition
+  arrives no later than the operands.
+  The delays come from the same timing information the pipelining uses.
+
+ */
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+#include "llvm/DerivedTypes.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/IsValueSigned.h"
+#include "rocccLibrary/SizeInBits.h"
+#include "rocccLibrary/GetValueName.h"
+#include "rocccLibrary/CopyValue.h"
+#include "rocccLibrary/ArrivalTime.h"
+#include "rocccLibrary/DatabaseInterface.h"
+
+//from FlattenOperations.cpp
+int getRealNumUses(llvm::Instruction* II);
+
+namespace llvm
+{
+  class BranchSharingPass : public FunctionPass
+  {
+  private:
+    ROCCC::ArrivalTime* arrival;
+    CallInst* getHardwareCall(Value* v);
+    Instruction* getOperation(Value* v);
+    bool isExclusive(Instruction* I, CallInst* select);
+    CallInst* createSelect(Value* t, Value* f, Value* cond, Instruction* insertBefore);
+    void eraseWithBookkeeping(Instruction* I);
+    bool shareOperation(CallInst* select);
+  public:
+    static char ID ;
+    BranchSharingPass() ;
+    ~BranchSharingPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char BranchSharingPass::ID = 0 ;
+
+static RegisterPass<BranchSharingPass> X ("shareBranchOperators",
+					"Share operators between the two sides of a BoolSelect.");
+
+BranchSharingPass::BranchSharingPass() : FunctionPass((intptr_t)&ID), arrival(NULL)
+{
+  ; // Nothing in here
+}
+
+BranchSharingPass::~BranchSharingPass()
+{
+  delete arrival;
+}
+
+//the results of library cores are loads that the InvokeHardware call writes
+//  as its last argument
+CallInst* BranchSharingPass::getHardwareCall(Value* v)
+{
+  if( !dynamic_cast<LoadInst*>(v) )
+    return NULL;
+  for(Value::use_iterator UI = v->use_begin(); UI != v->use_end(); ++UI)
+  {
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( isROCCCFunctionCall(CI, ROCCCNames::InvokeHardware) and
+        CI->getOperand(CI->getNumOperands()-1) == v )
+      return CI;
+  }
+  return NULL;
+}
+
+//the instruction that computes v, if it is an operation worth sharing
+Instruction* BranchSharingPass::getOperation(Value* v)
+{
+  if( CallInst* CI = getHardwareCall(v) )
+    return CI;
+  BinaryOperator* BO = dynamic_cast<BinaryOperator*>(v);
+  //multiplies by constants are turned into shifts and adds
+  if( BO and BO->getOpcode() == Instruction::Mul and !isCopyValue(BO) and
+      !dynamic_cast<Constant*>(BO->getOperand(0)) and
+      !dynamic_cast<Constant*>(BO->getOperand(1)) )
+    return BO;
+  return NULL;
+}
+
+//only one side of a BoolSelect is ever used, so an operation that feeds
+//  nothing but the select is mutually exclusive with the other side
+bool BranchSharingPass::isExclusive(Instruction* I, CallInst* select)
+{
+  Value* result = I;
+  if( isROCCCFunctionCall(dynamic_cast<CallInst*>(I), ROCCCNames::InvokeHardware) )
+    result = I->getOperand(I->getNumOperands()-1);
+  Instruction* resultInst = dynamic_cast<Instruction*>(result);
+  assert(resultInst);
+  int uses = getRealNumUses(resultInst);
+  //the InvokeHardware call itself counts as a use of its result
+  if( result != I )
+    --uses;
+  return (uses == 1 and resultInst->getParent() == select->getParent());
+}
+
+CallInst* BranchSharingPass::createSelect(Value* t, Value* f, Value* cond, Instruction* insertBefore)
+{
+  Module* M = insertBefore->getParent()->getParent()->getParent();
+  std::vector<const Type*> paramTypes;
+  paramTypes.push_back(t->getType());
+  paramTypes.push_back(f->getType());
+  paramTypes.push_back(cond->getType());
+  llvm::FunctionType* ft = llvm::FunctionType::get(t->getType(), paramTypes, false);
+  Function* boolSelect = Function::Create(ft,
+				                      (GlobalValue::LinkageTypes)0,
+				                       ROCCCNames::BoolSelect,
+				                       M );
+  std::vector<Value*> valArgs;
+  valArgs.push_back( t );
+  valArgs.push_back( f );
+  valArgs.push_back( cond );
+  CallInst* ret = CallInst::Create( boolSelect,
+			                     valArgs.begin(),
+			                     valArgs.end(),
+			                     "",
+			                     insertBefore);
+  int size = getSizeInBits(t);
+  if( getSizeInBits(f) > size )
+    size = getSizeInBits(f);
+  setSizeInBits(ret, size);
+  setValueSigned(ret, isValueSigned(t) or isValueSigned(f));
+  return ret;
+}
+
+//erase an instruction along with the calls that carry its name, size, and
+//  signedness
+void BranchSharingPass::eraseWithBookkeeping(Instruction* I)
+{
+  arrival->erase(I);
+  while( !I->use_empty() )
+  {
+    Instruction* use = dynamic_cast<Instruction*>(*I->use_begin());
+    assert( use and "Shared operation has a use that is not an instruction!" );
+    use->eraseFromParent();
+  }
+  I->eraseFromParent();
+}
+
+bool BranchSharingPass::shareOperation(CallInst* select)
+{
+  assert( select->getNumOperands() == 4 and "Incorrect number of arguments to BoolSelect!" );
+  Value* cond = select->getOperand(3);
+  Instruction* t = getOperation(select->getOperand(1));
+  Instruction* f = getOperation(select->getOperand(2));
+  if( !t or !f or t == f or !isExclusive(t, select) or !isExclusive(f, select) )
+    return false;
+  CallInst* tCall = dynamic_cast<CallInst*>(t);
+  CallInst* fCall = dynamic_cast<CallInst*>(f);
+  std::vector<std::pair<Value*,Value*> > inputs;
+  if( tCall or fCall )
+  {
+    //both sides must be the same library core, with its result last
+    if( !tCall or !fCall or
+        tCall->getNumOperands() != fCall->getNumOperands() or
+        tCall->getCalledFunction()->getFunctionType() != fCall->getCalledFunction()->getFunctionType() or
+        getComponentNameFromCallInst(tCall) != getComponentNameFromCallInst(fCall) )
+      return false;
+    for(unsigned op = 2; op + 1 < tCall->getNumOperands(); ++op)
+      inputs.push_back(std::pair<Value*,Value*>(tCall->getOperand(op), fCall->getOperand(op)));
+  }
+  else
+  {
+    BinaryOperator* tBO = dynamic_cast<BinaryOperator*>(t);
+    BinaryOperator* fBO = dynamic_cast<BinaryOperator*>(f);
+    assert(tBO and fBO);
+    if( tBO->getType() != fBO->getType() or
+        getSizeInBits(tBO) != getSizeInBits(fBO) or
+        isValueSigned(tBO) != isValueSigned(fBO) )
+      return false;
+    //multiplication is commutative, so line up any operand the two sides
+    //  have in common to save its mux
+    Value* fa = fBO->getOperand(0);
+    Value* fb = fBO->getOperand(1);
+    if( tBO->getOperand(0) == fb or tBO->getOperand(1) == fa )
+      std::swap(fa, fb);
+    inputs.push_back(std::pair<Value*,Value*>(tBO->getOperand(0), fa));
+    inputs.push_back(std::pair<Value*,Value*>(tBO->getOperand(1), fb));
+  }
+  int muxes = 0;
+  int muxBits = 0;
+  int operands = 0;
+  for(std::vector<std::pair<Value*,Value*> >::iterator II = inputs.begin(); II != inputs.end(); ++II)
+  {
+    if( II->first->getType() != II->second->getType() )
+      return false;
+    if( II->first != II->second )
+    {
+      ++muxes;
+      muxBits += std::max(getSizeInBits(II->first), getSizeInBits(II->second));
+    }
+    operands = std::max(operands, std::max(arrival->get(II->first), arrival->get(II->second)));
+  }
+  //the operation and the select at the output go away, and the muxes in
+  //  front of the shared operation are added
+  std::string what = "multiplies";
+  int operationBits = 0;
+  int latency = 0;
+  if( !tCall )
+  {
+    operationBits = getSizeInBits(t->getOperand(0)) * getSizeInBits(t->getOperand(1));
+  }
+  else
+  {
+    what = getComponentNameFromCallInst(tCall) + " cores";
+    latency = Database::DatabaseInterface::getInstance()->LookupEntry(getComponentNameFromCallInst(tCall)).getDelay();
+    int portBits = getSizeInBits(tCall->getOperand(tCall->getNumOperands()-1));
+    for(std::vector<std::pair<Value*,Value*> >::iterator II = inputs.begin(); II != inputs.end(); ++II)
+      portBits += std::max(getSizeInBits(II->first), getSizeInBits(II->second));
+    operationBits = std::max(latency, 1) * portBits;
+  }
+  int removed = operationBits + getSizeInBits(select);
+  if( removed <= muxBits )
+  {
+    LOG_MESSAGE2("Arithmetic", "Branch Sharing", "Not sharing the " << what << " of " << getValueName(select) << ", as their muxes are larger than one of them.\n");
+    return false;
+  }
+  //the muxes are in parallel, so they only lengthen the path if the
+  //  condition is what arrives last
+  if( arrival->get(cond) > operands )
+  {
+    LOG_MESSAGE2("Arithmetic", "Branch Sharing", "Not sharing the " << what << " of " << getValueName(select) << ", as its condition arrives after their operands.\n");
+    return false;
+  }
+  //the selects go right before the select being replaced, where everything
+  //  both sides depend on has already been computed
+  std::vector<Value*> selected;
+  for(std::vector<std::pair<Value*,Value*> >::iterator II = inputs.begin(); II != inputs.end(); ++II)
+  {
+    if( II->first == II->second )
+      selected.push_back(II->first);
+    else
+      selected.push_back(createSelect(II->first, II->second, cond, select));
+  }
+  Value* shared = NULL;
+  if( tCall )
+  {
+    Value* tResult = tCall->getOperand(tCall->getNumOperands()-1);
+    Value* ptr = new AllocaInst(tResult->getType(), 0, "", select);
+    Value* result = new LoadInst(ptr, select->getName(), select);
+    std::vector<Value*> valArgs;
+    valArgs.push_back( tCall->getOperand(1) );
+    valArgs.insert( valArgs.end(), selected.begin(), selected.end() );
+    valArgs.push_back( result );
+    CallInst::Create( tCall->getCalledFunction(),
+                      valArgs.begin(),
+                      valArgs.end(),
+                      "" ,
+                      select);
+    shared = result;
+  }
+  else
+  {
+    shared = BinaryOperator::create(Instruction::Mul, selected[0], selected[1], select->getName(), select);
+  }
+  if( tCall )
+  {
+    LOG_MESSAGE2("Arithmetic", "Branch Sharing", "Sharing one " << getComponentNameFromCallInst(tCall) << " with a latency of " << latency << " between both sides of " << getValueName(select) << " behind " << muxes << " muxes.\n");
+  }
+  else
+  {
+    LOG_MESSAGE2("Arithmetic", "Branch Sharing", "Sharing one multiply between both sides of " << getValueName(select) << " behind " << muxes << " muxes.\n");
+  }
+  //the shared value takes over the name, size, and sign of the select
+  select->replaceAllUsesWith(shared);
+  select->eraseFromParent();
+  //erase the two sides, which were only used by the select
+  if( tCall )
+  {
+    Instruction* tResult = dynamic_cast<Instruction*>(tCall->getOperand(tCall->getNumOperands()-1));
+    Instruction* fResult = dynamic_cast<Instruction*>(fCall->getOperand(fCall->getNumOperands()-1));
+    tCall->eraseFromParent();
+    fCall->eraseFromParent();
+    eraseWithBookkeeping(tResult);
+    eraseWithBookkeeping(fResult);
+  }
+  else
+  {
+    eraseWithBookkeeping(t);
+    eraseWithBookkeeping(f);
+  }
+  return true;
+}
+
+bool BranchSharingPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+  if (f.isDeclaration() || f.getDFFunction() != NULL) //only process before its a dffunction
+  {
+    return changed ;
+  }
+  if( !arrival )
+    arrival = new ROCCC::ArrivalTime();
+  arrival->clear();
+
+  std::vector<CallInst*> selects;
+  for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+  {
+    for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+    {
+      CallInst* CI = dynamic_cast<CallInst*>(&*II);
+      if( isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+        selects.push_back(CI);
+    }
+  }
+  //sharing an operation erases only the select it feeds and the two sides,
+  //  neither of which is another select, so the list stays valid
+  int shared = 0;
+  for(std::vector<CallInst*>::iterator SI = selects.begin(); SI != selects.end(); ++SI)
+  {
+    if( shareOperation(*SI) )
+    {
+      ++shared;
+      changed = true;
+    }
+  }
+  LOG_MESSAGE2("Arithmetic", "Branch Sharing", "Shared the operators of " << shared << " of " << selects.size() << " selects.\n");
+  return changed ;
+}
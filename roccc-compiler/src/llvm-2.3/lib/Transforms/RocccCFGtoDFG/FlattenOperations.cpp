@@ -24,6 +24,7 @@
 #include "rocccLibrary/IsValueSigned.h"
 #include "rocccLibrary/SizeInBits.h"
 #include "rocccLibrary/GetValueName.h"
+#include "rocccLibrary/ArrivalTime.h"
 
 namespace llvm
 {
@@ -104,41 +105,74 @@ public:
   }
 };
 
-int calculateWeight(BinaryOperator* root, std::vector<BinaryOperator*>& roots)
+//simulates adding the operands two at a time, earliest first
+int estimateAdderTreeDelay(std::vector<int> times, int adderDelay)
 {
-  assert(root);
-  INTERNAL_MESSAGE("Calculating weight of " << root->getName() << ":\n");
-  std::list<Value*> worklist;
-  worklist.push_back( root->getOperand(0) );
-  worklist.push_back( root->getOperand(1) );
-  int weight = 0;
-  while( !worklist.empty() )
+  std::sort(times.begin(), times.end());
+  while( times.size() > 1 )
   {
-    Value* v = worklist.front();
-    worklist.pop_front();
-    assert(v);
-    BinaryOperator* T = dynamic_cast<BinaryOperator*>(v);
-    if( T and std::find(roots.begin(), roots.end(), T) != roots.end() )
-    {
-      INTERNAL_MESSAGE("  need to calculate weight of child root.\n");
-      weight += calculateWeight(T, roots);
-    }
-    else if( T and T->getOpcode() == root->getOpcode() )
-    {
-      worklist.push_back( T->getOperand(0) );
-      worklist.push_back( T->getOperand(1) );
-    }
-    else
-    {
-      Instruction* I = dynamic_cast<Instruction*>(v);
-      if( I )
-      {
-        weight += 1;
-      }
-    }
+    int t = std::max(times[0], times[1]) + adderDelay;
+    times.erase(times.begin(), times.begin() + 2);
+    times.insert(std::lower_bound(times.begin(), times.end(), t), t);
   }
-  INTERNAL_MESSAGE("  Weight is " << weight << "\n");
-  return weight;
+  return times.empty() ? 0 : times[0];
+}
+
+/*
+The pipelining counts every add as one Add delay, whatever its width, but a
+carry chain gets slower as it gets wider, while the logic of a 3:2
+compressor does not depend on the width at all. Choosing between the two
+counts an xor delay for every CARRY_BITS_PER_LEVEL bits the carry crosses.
+*/
+static const int CARRY_BITS_PER_LEVEL = 8;
+
+int getAdderDelay(ROCCC::TimingInfo& timing, int width)
+{
+  return timing.getAddDelay() + ((width - 1) / CARRY_BITS_PER_LEVEL) * timing.getXorDelay();
+}
+
+/*
+A 3:2 compressor is built from six operations: the sum goes through two
+xors, and the slowest path to the carry goes through an xor, an and, and an
+or. The shift of the carry by one is only wiring.
+*/
+int getCompressorSumDelay(ROCCC::TimingInfo& timing)
+{
+  return 2 * timing.getXorDelay();
+}
+
+int getCompressorCarryDelay(ROCCC::TimingInfo& timing)
+{
+  return timing.getXorDelay() + timing.getAndDelay() + timing.getOrDelay();
+}
+
+//simulates reducing the operands three at a time to a sum and a carry, with
+//  a single adder at the end
+int estimateCarrySaveDelay(std::vector<int> times, ROCCC::TimingInfo& timing, int width)
+{
+  int sumDelay = getCompressorSumDelay(timing);
+  int carryDelay = getCompressorCarryDelay(timing);
+  std::sort(times.begin(), times.end());
+  while( times.size() > 2 )
+  {
+    int latest = std::max(times[0], std::max(times[1], times[2]));
+    times.erase(times.begin(), times.begin() + 3);
+    times.insert(std::lower_bound(times.begin(), times.end(), latest + sumDelay), latest + sumDelay);
+    times.insert(std::lower_bound(times.begin(), times.end(), latest + carryDelay), latest + carryDelay);
+  }
+  return estimateAdderTreeDelay(times, getAdderDelay(timing, width));
+}
+
+//creates an operation of the tree, the same size and sign as the root
+BinaryOperator* createTreeOperation(Instruction::BinaryOps op, Value* a, Value* b, BinaryOperator* root)
+{
+  //workaround to create a binary instruction with different operand types; create with undefs, then replace
+  BinaryOperator* T = BinaryOperator::create(op, UndefValue::get(root->getType()), UndefValue::get(root->getType()), "tmp", root);
+  T->setOperand(0, a);
+  T->setOperand(1, b);
+  setSizeInBits(T, getSizeInBits(root));
+  setValueSigned(T, isValueSigned(root));
+  return T;
 }
 
 bool isDifferentOperation(BinaryOperator* BO, Value* UI);
@@ -162,7 +196,7 @@ BalanceTree(root I)
       // add uses to worklist
       Push(worklist, Ra1, Rb1)
 */
-BinaryOperator* balanceTree(BinaryOperator* root, std::map<Instruction*,bool>& visitMap, std::vector<BinaryOperator*>& roots)
+BinaryOperator* balanceTree(BinaryOperator* root, std::map<Instruction*,bool>& visitMap, std::vector<BinaryOperator*>& roots, ROCCC::ArrivalTime& arrival)
 {
   assert(root);
   if(visitMap[root])
@@ -182,14 +216,14 @@ BinaryOperator* balanceTree(BinaryOperator* root, std::map<Instruction*,bool>& v
     {
       if( !visitMap[T] ) //if we havent visited it, replace it with its balanced version
       {
-        T = balanceTree(T, visitMap, roots);
+        T = balanceTree(T, visitMap, roots, arrival);
       }
       if( !T )
       {
         INTERNAL_ERROR("balanceTree(" << *root << ") failed while attempting to balance leaf node " << *v << "; balance returned NULL!\n");
       }
       assert( T and "Balancing operation that was a root resulted in NULL being returned from balance function!" );
-      leaves.insert(std::pair<int,Instruction*>(calculateWeight(T, roots), T));
+      leaves.insert(std::pair<int,Instruction*>(arrival.get(T), T));
     }
     else if( T and !isDifferentOperation(T, root) ) //if T isnt a root, and isnt a different operation than our root, we need to process it
     {
@@ -212,7 +246,45 @@ BinaryOperator* balanceTree(BinaryOperator* root, std::map<Instruction*,bool>& v
     }
     else //T isnt a BinaryOperator, or isn't a root, or is a different operation than our root - just add it as a single leaf
     {
-      leaves.insert(std::pair<int,Value*>(1, v));
+      leaves.insert(std::pair<int,Value*>(arrival.get(v), v));
+    }
+  }
+  //carry save compressors reduce three operands to a sum and a carry without
+  //  propagating the carry, leaving a single adder at the end, but each one
+  //  is six operations in place of one add, so they are only used when the
+  //  whole sum is ready sooner, which takes wide adds
+  ROCCC::TimingInfo& timing = arrival.getTimingInfo();
+  bool isAdd = (root->getOpcode() == BinaryOperator::Add);
+  int adderDelay = getAdderDelay(timing, getSizeInBits(root));
+  if( isAdd and leaves.size() > 2 )
+  {
+    std::vector<int> times;
+    for(std::set<std::pair<int,Value*>,weight_less_than>::iterator LI = leaves.begin(); LI != leaves.end(); ++LI)
+      times.push_back(LI->first);
+    if( estimateCarrySaveDelay(times, timing, getSizeInBits(root)) < estimateAdderTreeDelay(times, adderDelay) )
+    {
+      INTERNAL_MESSAGE("Using carry save compressors for " << root->getName() << ".\n");
+      while( leaves.size() > 2 )
+      {
+        std::pair<int,Value*> a = *leaves.begin();
+        leaves.erase(leaves.begin());
+        std::pair<int,Value*> b = *leaves.begin();
+        leaves.erase(leaves.begin());
+        std::pair<int,Value*> c = *leaves.begin();
+        leaves.erase(leaves.begin());
+        int latest = std::max(a.first, std::max(b.first, c.first));
+        //sum = a ^ b ^ c, carry = ((a & b) | (c & (a ^ b))) << 1
+        BinaryOperator* halfSum = createTreeOperation(BinaryOperator::Xor, a.second, b.second, root);
+        BinaryOperator* sum = createTreeOperation(BinaryOperator::Xor, halfSum, c.second, root);
+        BinaryOperator* generate = createTreeOperation(BinaryOperator::And, a.second, b.second, root);
+        BinaryOperator* propagate = createTreeOperation(BinaryOperator::And, c.second, halfSum, root);
+        BinaryOperator* majority = createTreeOperation(BinaryOperator::Or, generate, propagate, root);
+        BinaryOperator* carry = createTreeOperation(BinaryOperator::Shl, majority, ConstantInt::get(root->getType(), 1), root);
+        arrival.set(sum, latest + getCompressorSumDelay(timing));
+        arrival.set(carry, latest + getCompressorCarryDelay(timing));
+        leaves.insert(std::pair<int,Value*>(arrival.get(sum), sum));
+        leaves.insert(std::pair<int,Value*>(arrival.get(carry), carry));
+      }
     }
   }
   /*
@@ -231,13 +303,11 @@ BinaryOperator* balanceTree(BinaryOperator* root, std::map<Instruction*,bool>& v
     leaves.erase(leaves.begin());
     std::pair<int,Value*> Rb1 = *leaves.begin();
     leaves.erase(leaves.begin());
-    int weight = Ra1.first + Rb1.first;
-    //workaround to create a binary instruction with different operand types; create with undefs, then replace
-    BinaryOperator* T = BinaryOperator::create(root->getOpcode(), UndefValue::get(root->getType()), UndefValue::get(root->getType()), "tmp", root);
-    T->setOperand(0, Ra1.second);
-    T->setOperand(1, Rb1.second);
-    setSizeInBits(T, getSizeInBits(root));
-    setValueSigned(T, isValueSigned(root));
+    BinaryOperator* T = createTreeOperation(root->getOpcode(), Ra1.second, Rb1.second, root);
+    //operands are paired earliest first, so the latest ones go through the
+    //  fewest operations
+    int weight = std::max(Ra1.first, Rb1.first) + (isAdd ? adderDelay : arrival.getDelay(T));
+    arrival.set(T, weight);
     leaves.insert(std::pair<int,Value*>(weight, T));
   }
   BinaryOperator* last_inserted = NULL;
@@ -248,6 +318,7 @@ BinaryOperator* balanceTree(BinaryOperator* root, std::map<Instruction*,bool>& v
     setValueName(last_inserted, getValueName(root));
     root->uncheckedReplaceAllUsesWith(last_inserted);
     std::string name = root->getName();
+    arrival.erase(root);
     root->eraseFromParent();
     last_inserted->setName(name);
     roots.erase(std::find(roots.begin(), roots.end(), root));
@@ -359,12 +430,13 @@ bool findRoots(Function* f)
   root_queue.resize(roots.size());
   std::copy(roots.begin(), roots.end(), root_queue.begin());
   std::map<Instruction*,bool> visitMap;
+  ROCCC::ArrivalTime arrival;
   int roots_balanced = 0;
   while( !root_queue.empty() )
   {
     BinaryOperator* BO = root_queue.front();
     root_queue.pop_front();
-    bool root_changed = balanceTree(BO, visitMap, roots);
+    bool root_changed = balanceTree(BO, visitMap, roots, arrival);
     if( root_changed )
       ++roots_balanced;
     changed = root_changed or changed;
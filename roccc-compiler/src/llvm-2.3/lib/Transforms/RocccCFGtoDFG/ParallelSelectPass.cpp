@@ -0,0 +1,379 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+  A switch statement is lowered into nested if statements, which predication
+  and if conversion turn into a chain of BoolSelects, one per case:
+
+    v1 = sel(a1, v0, q1)
+    v2 = sel(a2, v1, q2)
+    v3 = sel(a3, v2, q3)
+
+  The chain is a priority mux whose depth is the number of cases. The case
+  conditions can never be true at the same time, though, so the priority
+  does not matter and the chain can be rebuilt as a balanced tree that
+  selects between halves of the cases on whether any case in the first half
+  is taken:
+
+    v3 = sel(sel(a1, a2, q1), sel(a3, v0, q3), q1|q2)
+
+  This gives a parallel mux with a depth of log2 of the number of cases,
+  with a tree of ORs beside it. Conditions are known to be exclusive when
+  one requires a predicate the other forbids, or when they compare the same
+  value against different constants.
+
+ */
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+#include "llvm/DerivedTypes.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/IsValueSigned.h"
+#include "rocccLibrary/SizeInBits.h"
+#include "rocccLibrary/GetValueName.h"
+
+//from FlattenOperations.cpp
+int getRealNumUses(llvm::Instruction* II);
+
+namespace llvm
+{
+  // One term of a condition: either the truth of a value, or the value
+  //  being equal to a constant, and whether the term is required or forbidden
+  class SelectLiteral
+  {
+  public:
+    Value* value;
+    ConstantInt* equals;
+    bool positive;
+    SelectLiteral(Value* v, ConstantInt* e, bool p) : value(v), equals(e), positive(p) { ; }
+  };
+
+  class ParallelSelectPass : public FunctionPass
+  {
+  private:
+    std::map<Value*, std::vector<SelectLiteral> > literals;
+    std::map<std::pair<int,int>, Value*> anyTaken;
+    bool isBoolean(Value* v);
+    void getLiterals(Value* cond, bool positive, std::vector<SelectLiteral>& lits);
+    std::vector<SelectLiteral>& getLiterals(Value* cond);
+    bool isExclusive(SelectLiteral& a, SelectLiteral& b);
+    bool isExclusive(Value* condA, Value* condB);
+    CallInst* getChainLink(Value* v, BasicBlock* BB);
+    CallInst* createSelect(Value* t, Value* f, Value* cond, Instruction* insertBefore);
+    Value* getAnyTaken(std::vector<CallInst*>& chain, int low, int high, Instruction* insertBefore);
+    Value* buildTree(std::vector<CallInst*>& chain, int low, int high, Value* base, Instruction* insertBefore);
+    void eraseWithBookkeeping(Instruction* I);
+    bool balanceChain(CallInst* root);
+  public:
+    static char ID ;
+    ParallelSelectPass() ;
+    ~ParallelSelectPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char ParallelSelectPass::ID = 0 ;
+
+static RegisterPass<ParallelSelectPass> X ("parallelSelects",
+					"Balance chains of exclusive BoolSelects into parallel muxes.");
+
+ParallelSelectPass::ParallelSelectPass() : FunctionPass((intptr_t)&ID)
+{
+  ; // Nothing in here
+}
+
+ParallelSelectPass::~ParallelSelectPass()
+{
+  ; // Nothing in here
+}
+
+//values that can only be 0 or 1, so that a bitwise AND of them is a logical AND
+bool ParallelSelectPass::isBoolean(Value* v)
+{
+  if( v->getType() == Type::Int1Ty )
+    return true;
+  if( dynamic_cast<CmpInst*>(v) )
+    return true;
+  if( ZExtInst* ZI = dynamic_cast<ZExtInst*>(v) )
+    return isBoolean(ZI->getOperand(0));
+  BinaryOperator* BO = dynamic_cast<BinaryOperator*>(v);
+  if( BO and (BO->getOpcode() == Instruction::And or
+              BO->getOpcode() == Instruction::Or or
+              BO->getOpcode() == Instruction::Xor) )
+    return isBoolean(BO->getOperand(0)) and isBoolean(BO->getOperand(1));
+  return false;
+}
+
+//llvm-gcc builds the predicates out of extended compares, compares against
+//  zero for logical nots, and bitwise ANDs, so look through all of those
+void ParallelSelectPass::getLiterals(Value* cond, bool positive, std::vector<SelectLiteral>& lits)
+{
+  if( ZExtInst* ZI = dynamic_cast<ZExtInst*>(cond) )
+    return getLiterals(ZI->getOperand(0), positive, lits);
+  BinaryOperator* BO = dynamic_cast<BinaryOperator*>(cond);
+  if( BO and BO->getOpcode() == Instruction::And and positive and isBoolean(BO) )
+  {
+    getLiterals(BO->getOperand(0), positive, lits);
+    getLiterals(BO->getOperand(1), positive, lits);
+    return;
+  }
+  if( BO and BO->getOpcode() == Instruction::Xor and BO->getType() == Type::Int1Ty )
+  {
+    ConstantInt* one = dynamic_cast<ConstantInt*>(BO->getOperand(1));
+    if( one and !one->isZero() )
+      return getLiterals(BO->getOperand(0), !positive, lits);
+  }
+  ICmpInst* CI = dynamic_cast<ICmpInst*>(cond);
+  if( CI and (CI->getPredicate() == ICmpInst::ICMP_EQ or
+              CI->getPredicate() == ICmpInst::ICMP_NE) )
+  {
+    Value* other = CI->getOperand(0);
+    ConstantInt* constant = dynamic_cast<ConstantInt*>(CI->getOperand(1));
+    if( !constant )
+    {
+      other = CI->getOperand(1);
+      constant = dynamic_cast<ConstantInt*>(CI->getOperand(0));
+    }
+    if( constant )
+    {
+      bool equal = (CI->getPredicate() == ICmpInst::ICMP_EQ);
+      if( constant->isZero() )
+        return getLiterals(other, equal ? !positive : positive, lits);
+      if( isBoolean(other) and constant->isOne() )
+        return getLiterals(other, equal ? positive : !positive, lits);
+      lits.push_back(SelectLiteral(other, constant, equal ? positive : !positive));
+      return;
+    }
+  }
+  lits.push_back(SelectLiteral(cond, NULL, positive));
+}
+
+std::vector<SelectLiteral>& ParallelSelectPass::getLiterals(Value* cond)
+{
+  std::map<Value*, std::vector<SelectLiteral> >::iterator found = literals.find(cond);
+  if( found != literals.end() )
+    return found->second;
+  std::vector<SelectLiteral>& lits = literals[cond];
+  getLiterals(cond, true, lits);
+  return lits;
+}
+
+bool ParallelSelectPass::isExclusive(SelectLiteral& a, SelectLiteral& b)
+{
+  if( a.value != b.value )
+    return false;
+  //p and !p, or x==c and x!=c
+  if( a.equals == b.equals )
+    return a.positive != b.positive;
+  //x==c1 and x==c2
+  if( a.equals and b.equals )
+    return a.positive and b.positive and a.equals->getValue() != b.equals->getValue();
+  //x==c for a nonzero c, and !x
+  SelectLiteral& compare = a.equals ? a : b;
+  SelectLiteral& truth = a.equals ? b : a;
+  return compare.positive and !truth.positive;
+}
+
+//both conditions are ANDs of literals, so they can never both be true when
+//  any literal of one contradicts a literal of the other
+bool ParallelSelectPass::isExclusive(Value* condA, Value* condB)
+{
+  std::vector<SelectLiteral>& a = getLiterals(condA);
+  std::vector<SelectLiteral>& b = getLiterals(condB);
+  for(std::vector<SelectLiteral>::iterator AI = a.begin(); AI != a.end(); ++AI)
+  {
+    for(std::vector<SelectLiteral>::iterator BI = b.begin(); BI != b.end(); ++BI)
+    {
+      if( isExclusive(*AI, *BI) )
+        return true;
+    }
+  }
+  return false;
+}
+
+//a BoolSelect that is used by nothing but the next select in a chain
+CallInst* ParallelSelectPass::getChainLink(Value* v, BasicBlock* BB)
+{
+  CallInst* CI = dynamic_cast<CallInst*>(v);
+  if( !isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+    return NULL;
+  assert( CI->getNumOperands() == 4 and "Incorrect number of arguments to BoolSelect!" );
+  if( CI->getParent() != BB or getRealNumUses(CI) != 1 )
+    return NULL;
+  return CI;
+}
+
+CallInst* ParallelSelectPass::createSelect(Value* t, Value* f, Value* cond, Instruction* insertBefore)
+{
+  Module* M = insertBefore->getParent()->getParent()->getParent();
+  std::vector<const Type*> paramTypes;
+  paramTypes.push_back(t->getType());
+  paramTypes.push_back(f->getType());
+  paramTypes.push_back(cond->getType());
+  llvm::FunctionType* ft = llvm::FunctionType::get(t->getType(), paramTypes, false);
+  Function* boolSelect = Function::Create(ft,
+				                      (GlobalValue::LinkageTypes)0,
+				                       ROCCCNames::BoolSelect,
+				                       M );
+  std::vector<Value*> valArgs;
+  valArgs.push_back( t );
+  valArgs.push_back( f );
+  valArgs.push_back( cond );
+  CallInst* ret = CallInst::Create( boolSelect,
+			                     valArgs.begin(),
+			                     valArgs.end(),
+			                     "",
+			                     insertBefore);
+  int size = getSizeInBits(t);
+  if( getSizeInBits(f) > size )
+    size = getSizeInBits(f);
+  setSizeInBits(ret, size);
+  setValueSigned(ret, isValueSigned(t) or isValueSigned(f));
+  return ret;
+}
+
+//whether any of the cases in [low, high) is taken; the halves are shared
+//  with the conditions of the selects below
+Value* ParallelSelectPass::getAnyTaken(std::vector<CallInst*>& chain, int low, int high, Instruction* insertBefore)
+{
+  assert( low < high );
+  if( high - low == 1 )
+    return chain[low]->getOperand(3);
+  std::map<std::pair<int,int>, Value*>::iterator found = anyTaken.find(std::pair<int,int>(low, high));
+  if( found != anyTaken.end() )
+    return found->second;
+  int mid = (low + high) / 2;
+  Value* first = getAnyTaken(chain, low, mid, insertBefore);
+  Value* second = getAnyTaken(chain, mid, high, insertBefore);
+  Instruction* ret = BinaryOperator::create(Instruction::Or, first, second, "", insertBefore);
+  int size = getSizeInBits(first);
+  if( getSizeInBits(second) > size )
+    size = getSizeInBits(second);
+  setSizeInBits(ret, size);
+  setValueSigned(ret, false);
+  return (anyTaken[std::pair<int,int>(low, high)] = ret);
+}
+
+//selects the value of whichever case in [low, high) is taken, where the
+//  value from before the first case is the last leaf and is taken when no
+//  case is
+Value* ParallelSelectPass::buildTree(std::vector<CallInst*>& chain, int low, int high, Value* base, Instruction* insertBefore)
+{
+  assert( low < high );
+  if( high - low == 1 )
+    return (low == (int)chain.size()) ? base : chain[low]->getOperand(1);
+  int mid = (low + high) / 2;
+  Value* first = buildTree(chain, low, mid, base, insertBefore);
+  Value* second = buildTree(chain, mid, high, base, insertBefore);
+  return createSelect(first, second, getAnyTaken(chain, low, mid, insertBefore), insertBefore);
+}
+
+//erase an instruction along with the calls that carry its name, size, and
+//  signedness
+void ParallelSelectPass::eraseWithBookkeeping(Instruction* I)
+{
+  while( !I->use_empty() )
+  {
+    Instruction* use = dynamic_cast<Instruction*>(*I->use_begin());
+    assert( use and "Select in a chain has a use that is not an instruction!" );
+    use->eraseFromParent();
+  }
+  I->eraseFromParent();
+}
+
+bool ParallelSelectPass::balanceChain(CallInst* root)
+{
+  //walk down the false sides, which hold the value from before each case
+  std::vector<CallInst*> chain;
+  chain.push_back(root);
+  while( CallInst* next = getChainLink(chain.back()->getOperand(2), root->getParent()) )
+    chain.push_back(next);
+  //balancing a chain of two saves nothing
+  if( chain.size() < 3 )
+    return false;
+  Value* base = chain.back()->getOperand(2);
+  for(std::vector<CallInst*>::iterator CI = chain.begin(); CI != chain.end(); ++CI)
+  {
+    if( (*CI)->getType() != root->getType() or
+        (*CI)->getOperand(1)->getType() != root->getType() or
+        (*CI)->getOperand(3)->getType() != root->getOperand(3)->getType() )
+      return false;
+    for(std::vector<CallInst*>::iterator PI = chain.begin(); PI != CI; ++PI)
+    {
+      if( !isExclusive((*PI)->getOperand(3), (*CI)->getOperand(3)) )
+      {
+        LOG_MESSAGE2("Arithmetic", "Parallel Selects", "Not balancing the chain of " << chain.size() << " selects ending in " << getValueName(root) << ", as its conditions are not exclusive.\n");
+        return false;
+      }
+    }
+  }
+  //the tree goes right before the root, where every case has been computed
+  anyTaken.clear();
+  Value* tree = buildTree(chain, 0, chain.size() + 1, base, root);
+  int depth = 0;
+  while( (1u << depth) < chain.size() + 1 )
+    ++depth;
+  LOG_MESSAGE2("Arithmetic", "Parallel Selects", "Balanced the chain of " << chain.size() << " selects ending in " << getValueName(root) << " into a tree of depth " << depth << ".\n");
+  //the tree takes over the name, size, and sign of the root
+  root->replaceAllUsesWith(tree);
+  root->eraseFromParent();
+  //each of the rest was only used by the select above it
+  for(std::vector<CallInst*>::iterator CI = chain.begin() + 1; CI != chain.end(); ++CI)
+    eraseWithBookkeeping(*CI);
+  return true;
+}
+
+bool ParallelSelectPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+  if (f.isDeclaration() || f.getDFFunction() != NULL) //only process before its a dffunction
+  {
+    return changed ;
+  }
+  literals.clear();
+
+  //find the selects that end a chain, which are the ones that are not
+  //  themselves a link in a longer chain
+  std::set<CallInst*> links;
+  std::vector<CallInst*> selects;
+  for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+  {
+    for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+    {
+      CallInst* CI = dynamic_cast<CallInst*>(&*II);
+      if( isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+      {
+        selects.push_back(CI);
+        if( CallInst* link = getChainLink(CI->getOperand(2), &*BB) )
+          links.insert(link);
+      }
+    }
+  }
+  //balancing a chain erases only selects in that chain, none of which end
+  //  another chain, so the roots stay valid
+  int balanced = 0;
+  for(std::vector<CallInst*>::iterator SI = selects.begin(); SI != selects.end(); ++SI)
+  {
+    if( links.find(*SI) == links.end() and balanceChain(*SI) )
+    {
+      ++balanced;
+      changed = true;
+    }
+  }
+  LOG_MESSAGE2("Arithmetic", "Parallel Selects", "Balanced " << balanced << " chains of selects.\n");
+  return changed ;
+}
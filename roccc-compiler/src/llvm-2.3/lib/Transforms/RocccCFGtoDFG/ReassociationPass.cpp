@@ -0,0 +1,292 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+  Reduces the height of chains of additions and subtractions, which
+  FlattenOperations leaves in source order because subtraction is not
+  associative. Each chain is gathered into the values it adds and the
+  values it subtracts, and both are rebuilt as trees in which the operands
+  that are ready last, according to the delays in the timing information,
+  enter nearest the root. Integer chains are exact in any order; floating
+  point chains, including chains of multiplications, are only reassociated
+  when the Reassociation optimization is given a value of 1, since rounding
+  depends on the order.
+
+ */
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Constants.h"
+#include "llvm/Instructions.h"
+
+#include <map>
+#include <vector>
+#include <algorithm>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/IsValueSigned.h"
+#include "rocccLibrary/SizeInBits.h"
+#include "rocccLibrary/GetValueName.h"
+#include "rocccLibrary/CopyValue.h"
+#include "rocccLibrary/ArrivalTime.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+
+//from FlattenOperations.cpp
+int getRealNumUses(llvm::Instruction* II);
+llvm::BinaryOperator* createTreeOperation(llvm::Instruction::BinaryOps op, llvm::Value* a, llvm::Value* b, llvm::BinaryOperator* root);
+
+namespace llvm
+{
+  class ReassociationPass : public FunctionPass
+  {
+  private:
+    ROCCC::ArrivalTime* arrival;
+    bool allowFloatingPoint;
+    bool isReassociable(BinaryOperator* BO);
+    bool isSameChain(BinaryOperator* BO, BinaryOperator* user);
+    bool isInterior(BinaryOperator* BO);
+    void gatherLeaves(Value* v, bool negated, BinaryOperator* root, std::vector<Value*>& added, std::vector<Value*>& subtracted, std::vector<BinaryOperator*>& interior);
+    int estimateTree(std::vector<Value*>& leaves, int delay);
+    std::pair<Value*,int> buildTree(Instruction::BinaryOps op, std::vector<Value*>& leaves, BinaryOperator* root);
+    bool reassociate(BinaryOperator* root);
+  public:
+    static char ID ;
+    ReassociationPass() ;
+    ~ReassociationPass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char ReassociationPass::ID = 0 ;
+
+static RegisterPass<ReassociationPass> X ("rocccReassociate",
+					"Reduce the height of chains of additions and subtractions.");
+
+ReassociationPass::ReassociationPass() : FunctionPass((intptr_t)&ID), arrival(NULL), allowFloatingPoint(false)
+{
+  ; // Nothing in here
+}
+
+ReassociationPass::~ReassociationPass()
+{
+  delete arrival;
+}
+
+bool ReassociationPass::isReassociable(BinaryOperator* BO)
+{
+  if( !BO or isCopyValue(BO) )
+    return false;
+  bool isFloat = BO->getType()->isFloatingPoint();
+  if( isFloat and !allowFloatingPoint )
+    return false;
+  if( BO->getOpcode() == BinaryOperator::Add or BO->getOpcode() == BinaryOperator::Sub )
+    return true;
+  //integer multiplication is already balanced by FlattenOperations
+  return isFloat and BO->getOpcode() == BinaryOperator::Mul;
+}
+
+bool ReassociationPass::isSameChain(BinaryOperator* BO, BinaryOperator* user)
+{
+  if( !isReassociable(BO) or !isReassociable(user) )
+    return false;
+  bool boIsMul = (BO->getOpcode() == BinaryOperator::Mul);
+  bool userIsMul = (user->getOpcode() == BinaryOperator::Mul);
+  if( boIsMul != userIsMul )
+    return false;
+  return BO->getType() == user->getType() and
+         getSizeInBits(BO) == getSizeInBits(user) and
+         isValueSigned(BO) == isValueSigned(user);
+}
+
+//an operation that only feeds the next operation of its chain is folded
+//  into that operation's tree instead of being kept as a value of its own
+bool ReassociationPass::isInterior(BinaryOperator* BO)
+{
+  if( getRealNumUses(BO) != 1 )
+    return false;
+  for(Value::use_iterator UI = BO->use_begin(); UI != BO->use_end(); ++UI)
+  {
+    BinaryOperator* user = dynamic_cast<BinaryOperator*>(*UI);
+    if( user and isSameChain(BO, user) )
+      return true;
+  }
+  return false;
+}
+
+void ReassociationPass::gatherLeaves(Value* v, bool negated, BinaryOperator* root, std::vector<Value*>& added, std::vector<Value*>& subtracted, std::vector<BinaryOperator*>& interior)
+{
+  BinaryOperator* BO = dynamic_cast<BinaryOperator*>(v);
+  if( BO == root or (BO and isSameChain(BO, root) and isInterior(BO)) )
+  {
+    if( BO != root )
+      interior.push_back(BO);
+    gatherLeaves(BO->getOperand(0), negated, root, added, subtracted, interior);
+    bool negateSecond = (BO->getOpcode() == BinaryOperator::Sub) ? !negated : negated;
+    gatherLeaves(BO->getOperand(1), negateSecond, root, added, subtracted, interior);
+    return;
+  }
+  if( negated )
+    subtracted.push_back(v);
+  else
+    added.push_back(v);
+}
+
+class arrival_less_than {
+public:
+  bool operator()(const std::pair<Value*,int>& a, const std::pair<Value*,int>& b)
+  {
+    return a.second < b.second;
+  }
+};
+
+//the time the tree built by buildTree would be ready, if each operation in
+//  it takes the given delay
+int ReassociationPass::estimateTree(std::vector<Value*>& leaves, int delay)
+{
+  std::vector<int> times;
+  for(std::vector<Value*>::iterator LI = leaves.begin(); LI != leaves.end(); ++LI)
+    times.push_back(arrival->get(*LI));
+  std::sort(times.begin(), times.end());
+  while( times.size() > 1 )
+  {
+    int t = std::max(times[0], times[1]) + delay;
+    times.erase(times.begin(), times.begin() + 2);
+    times.insert(std::upper_bound(times.begin(), times.end(), t), t);
+  }
+  return times.empty() ? 0 : times[0];
+}
+
+//combines the two earliest values until only one is left, so the values
+//  that arrive last pass through the fewest operations
+std::pair<Value*,int> ReassociationPass::buildTree(Instruction::BinaryOps op, std::vector<Value*>& leaves, BinaryOperator* root)
+{
+  std::vector<std::pair<Value*,int> > ready;
+  for(std::vector<Value*>::iterator LI = leaves.begin(); LI != leaves.end(); ++LI)
+    ready.push_back(std::pair<Value*,int>(*LI, arrival->get(*LI)));
+  std::stable_sort(ready.begin(), ready.end(), arrival_less_than());
+  while( ready.size() > 1 )
+  {
+    std::pair<Value*,int> a = ready[0];
+    std::pair<Value*,int> b = ready[1];
+    ready.erase(ready.begin(), ready.begin() + 2);
+    BinaryOperator* T = createTreeOperation(op, a.first, b.first, root);
+    int t = std::max(a.second, b.second) + arrival->getDelay(T);
+    arrival->set(T, t);
+    std::pair<Value*,int> combined(T, t);
+    ready.insert(std::upper_bound(ready.begin(), ready.end(), combined, arrival_less_than()), combined);
+  }
+  if( ready.empty() )
+    return std::pair<Value*,int>(NULL, 0);
+  return ready[0];
+}
+
+bool ReassociationPass::reassociate(BinaryOperator* root)
+{
+  std::vector<Value*> added;
+  std::vector<Value*> subtracted;
+  std::vector<BinaryOperator*> interior;
+  gatherLeaves(root, false, root, added, subtracted, interior);
+  if( added.size() + subtracted.size() < 3 )
+    return false;
+  //only rebuild the chain if it will be ready sooner
+  int before = arrival->get(root);
+  int after = 0;
+  ROCCC::TimingInfo& timing = arrival->getTimingInfo();
+  if( root->getOpcode() == BinaryOperator::Mul )
+    after = estimateTree(added, timing.getMulDelay());
+  else
+  {
+    after = estimateTree(added, timing.getAddDelay());
+    if( !subtracted.empty() )
+      after = std::max(after, estimateTree(subtracted, timing.getAddDelay())) + timing.getSubDelay();
+  }
+  if( after >= before )
+    return false;
+
+  Value* result = NULL;
+  if( root->getOpcode() == BinaryOperator::Mul )
+  {
+    result = buildTree(BinaryOperator::Mul, added, root).first;
+  }
+  else
+  {
+    Value* sum = buildTree(BinaryOperator::Add, added, root).first;
+    Value* difference = buildTree(BinaryOperator::Add, subtracted, root).first;
+    if( !sum )
+      sum = Constant::getNullValue(root->getType());
+    if( difference )
+      result = createTreeOperation(BinaryOperator::Sub, sum, difference, root);
+    else
+      result = sum;
+  }
+  BinaryOperator* last_inserted = dynamic_cast<BinaryOperator*>(result);
+  assert( last_inserted and "Reassociating a chain did not produce an operation!" );
+  //remove all of the signed, name, and size call uses of the operations that
+  //  were folded into the tree, so they can be removed
+  for(std::vector<BinaryOperator*>::iterator II = interior.begin(); II != interior.end(); ++II)
+  {
+    for(Value::use_iterator UI = (*II)->use_begin(); UI != (*II)->use_end();)
+    {
+      CallInst* CI = dynamic_cast<CallInst*>(*UI);
+      if( isROCCCFunctionCall(CI, ROCCCNames::VariableName) or
+          isROCCCFunctionCall(CI, ROCCCNames::VariableSize) or
+          isROCCCFunctionCall(CI, ROCCCNames::VariableSigned) )
+      {
+        CI->eraseFromParent();
+        UI = (*II)->use_begin();
+      }
+      else
+        ++UI;
+    }
+  }
+  setValueName(last_inserted, getValueName(root));
+  root->uncheckedReplaceAllUsesWith(last_inserted);
+  std::string name = root->getName();
+  arrival->erase(root);
+  root->eraseFromParent();
+  last_inserted->setName(name);
+  LOG_MESSAGE2("Balancing", "Reassociation", "Reduced the delay of " << name << " from " << before << " to " << after << ".\n");
+  return true;
+}
+
+bool ReassociationPass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+  if (f.isDeclaration() || f.getDFFunction() != NULL) //only process before its a dffunction
+  {
+    return changed ;
+  }
+  if( !arrival )
+    arrival = new ROCCC::ArrivalTime();
+  allowFloatingPoint = (ROCCC::getLoOptimizationValue("Reassociation", 0) == 1);
+  arrival->clear();
+
+  std::vector<BinaryOperator*> roots;
+  for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+  {
+    for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+    {
+      BinaryOperator* BO = dynamic_cast<BinaryOperator*>(&*II);
+      if( isReassociable(BO) and !isInterior(BO) )
+        roots.push_back(BO);
+    }
+  }
+  int reassociated = 0;
+  for(std::vector<BinaryOperator*>::iterator RI = roots.begin(); RI != roots.end(); ++RI)
+  {
+    if( reassociate(*RI) )
+    {
+      ++reassociated;
+      changed = true;
+    }
+  }
+  LOG_MESSAGE2("Balancing", "Reassociation", "Reassociated " << reassociated << " of " << roots.size() << " chains.\n");
+  return changed ;
+}
@@ -0,0 +1,610 @@
+// The ROCCC Compiler Infrastructure
+//  This file is distributed under the University of California Open Source
+//  License.  See ROCCCLICENSE.TXT for details.
+
+/*
+
+  Finds the range of values every integer operation can take, starting from
+  constants, the bounds of the loop induction variables, and the initial
+  values of feedback variables, and shrinks each operation and copy to the
+  number of bits that range needs. Operations whose widths are fixed by
+  something outside the datapath (ports, feedback registers, phis, dividers,
+  comparisons) keep the size they were declared with, but their ranges are
+  still passed on to the operations that use them.
+
+ */
+
+#include "llvm/Pass.h"
+#include "llvm/Function.h"
+#include "llvm/Module.h"
+#include "llvm/Instructions.h"
+#include "llvm/Constants.h"
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/ROCCCNames.h"
+#include "rocccLibrary/SizeInBits.h"
+#include "rocccLibrary/IsValueSigned.h"
+#include "rocccLibrary/CopyValue.h"
+#include "rocccLibrary/InductionVariableInfo.h"
+
+namespace llvm
+{
+  class ValueRangePass : public FunctionPass
+  {
+  private:
+    class ValueRange {
+    public:
+      long long low;
+      long long high;
+      bool bounded;
+      ValueRange() : low(0), high(0), bounded(false) {}
+      ValueRange(long long l, long long h) : low(l), high(h), bounded(true) {}
+      bool operator==(const ValueRange& r) const;
+      bool operator!=(const ValueRange& r) const {return !(*this == r);}
+    };
+    std::map<Value*, int> declaredSize;
+    std::map<Value*, ValueRange> ranges;
+    std::set<Value*> pinned;
+    std::map<Value*, int> width;
+    //set when a range depends on a value that has not been computed yet
+    bool incomplete;
+    ValueRange getRange(Value* v);
+    ValueRange join(ValueRange a, ValueRange b);
+    ValueRange fit(Value* v, ValueRange r);
+    ValueRange computeRange(Instruction* i);
+    ValueRange computeBinaryRange(BinaryOperator* BO);
+    ValueRange computeFeedbackRange(Value* v);
+    int bitsNeeded(Value* v, ValueRange r);
+    bool isAnalyzed(Value* v);
+    bool isBookkeeping(CallInst* CI);
+    bool isFeedback(CallInst* CI);
+    bool isWrittenByCall(Value* v);
+    void pin(Value* v);
+    void findPinnedValues(Function& f);
+    void propagateRanges(Function& f);
+    void tieShifts(Function& f);
+  public:
+    static char ID ;
+    ValueRangePass() ;
+    ~ValueRangePass() ;
+    virtual bool runOnFunction(Function& b) ;
+  } ;
+}
+
+using namespace llvm ;
+
+char ValueRangePass::ID = 0 ;
+
+static RegisterPass<ValueRangePass> X ("valueRange",
+					"Shrinks operations to the bits needed by the range of values they can take.");
+
+//the number of times every value is visited before the values whose ranges
+//  are still growing, which only happens through loops, are given up on
+static const int MAX_SWEEPS = 16;
+//ranges are kept in a long long, so only values well inside of that are
+//  analyzed
+static const int MAX_ANALYZED_BITS = 62;
+
+ValueRangePass::ValueRangePass() : FunctionPass((intptr_t)&ID)
+{
+  ; // Nothing in here
+}
+
+ValueRangePass::~ValueRangePass()
+{
+  ; // Nothing to delete either
+}
+
+bool ValueRangePass::ValueRange::operator==(const ValueRange& r) const
+{
+  if( !bounded or !r.bounded )
+    return bounded == r.bounded;
+  return low == r.low and high == r.high;
+}
+
+bool ValueRangePass::isAnalyzed(Value* v)
+{
+  return declaredSize.find(v) != declaredSize.end();
+}
+
+//calls that only describe a value, rather than read or write it
+bool ValueRangePass::isBookkeeping(CallInst* CI)
+{
+  return isROCCCFunctionCall(CI, ROCCCNames::VariableSize) or
+         isROCCCFunctionCall(CI, ROCCCNames::VariableSigned) or
+         isROCCCFunctionCall(CI, ROCCCNames::VariableName) or
+         isROCCCFunctionCall(CI, ROCCCNames::LoadPreviousInitValue) or
+         isROCCCFunctionCall(CI, ROCCCNames::InductionVariableStartValue) or
+         isROCCCFunctionCall(CI, ROCCCNames::InductionVariableEndValue) or
+         isROCCCFunctionCall(CI, ROCCCNames::OutputInductionVariableEndValue) or
+         isROCCCFunctionCall(CI, ROCCCNames::InductionVariableStepSize);
+}
+
+bool ValueRangePass::isFeedback(CallInst* CI)
+{
+  return isROCCCFunctionCall(CI, ROCCCNames::SystolicPrevious) or
+         isROCCCFunctionCall(CI, ROCCCNames::StoreNext) or
+         isROCCCFunctionCall(CI, ROCCCNames::SystolicNext) or
+         isROCCCFunctionCall(CI, ROCCCNames::LoadPrevious) or
+         isROCCCFunctionCall(CI, ROCCCNames::SummationFeedback);
+}
+
+//feedback calls write their first argument; other calls, apart from the ones
+//  that only send values out, may write any of their arguments
+bool ValueRangePass::isWrittenByCall(Value* v)
+{
+  for(Value::use_iterator UI = v->use_begin(); UI != v->use_end(); ++UI)
+  {
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( !CI or isBookkeeping(CI) or isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+      continue;
+    if( isFeedback(CI) )
+    {
+      if( CI->getNumOperands() > 1 and CI->getOperand(1) == v )
+        return true;
+      continue;
+    }
+    if( isROCCCFunctionCall(CI, ROCCCNames::OutputScalar) or
+        isROCCCFunctionCall(CI, ROCCCNames::DebugScalarOutput) or
+        isROCCCOutputStream(CI) )
+      continue;
+    return true;
+  }
+  return false;
+}
+
+void ValueRangePass::pin(Value* v)
+{
+  if( isAnalyzed(v) )
+    pinned.insert(v);
+}
+
+ValueRangePass::ValueRange ValueRangePass::getRange(Value* v)
+{
+  if( ConstantInt* CI = dynamic_cast<ConstantInt*>(v) )
+  {
+    if( CI->getBitWidth() > MAX_ANALYZED_BITS )
+      return ValueRange();
+    long long c = CI->getSExtValue();
+    return ValueRange(c, c);
+  }
+  std::map<Value*, ValueRange>::iterator found = ranges.find(v);
+  if( found != ranges.end() )
+    return found->second;
+  if( isAnalyzed(v) )
+    incomplete = true;
+  return ValueRange();
+}
+
+ValueRangePass::ValueRange ValueRangePass::join(ValueRange a, ValueRange b)
+{
+  if( !a.bounded or !b.bounded )
+    return ValueRange();
+  return ValueRange((a.low < b.low) ? a.low : b.low, (a.high > b.high) ? a.high : b.high);
+}
+
+//a value that does not fit in its declared size wraps around, and after that
+//  could be anything its declared size can hold
+ValueRangePass::ValueRange ValueRangePass::fit(Value* v, ValueRange r)
+{
+  if( !isAnalyzed(v) )
+    return ValueRange();
+  int size = declaredSize[v];
+  long long low = 0;
+  long long high = (1LL << size) - 1;
+  if( isValueSigned(v) )
+  {
+    low = -(1LL << (size - 1));
+    high = (1LL << (size - 1)) - 1;
+  }
+  if( r.bounded and r.low >= low and r.high <= high )
+    return r;
+  return ValueRange(low, high);
+}
+
+//the register a feedback call writes holds either its initial value or one
+//  of the values written to it
+ValueRangePass::ValueRange ValueRangePass::computeFeedbackRange(Value* v)
+{
+  ValueRange ret;
+  bool found = false;
+  for(Value::use_iterator UI = v->use_begin(); UI != v->use_end(); ++UI)
+  {
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( !CI or isBookkeeping(CI) or isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+      continue;
+    if( isFeedback(CI) and (CI->getNumOperands() < 2 or CI->getOperand(1) != v) )
+      continue;
+    if( isROCCCFunctionCall(CI, ROCCCNames::OutputScalar) or
+        isROCCCFunctionCall(CI, ROCCCNames::DebugScalarOutput) or
+        isROCCCOutputStream(CI) )
+      continue;
+    //anything other than a register that is loaded with known values is
+    //  assumed to be able to hold anything
+    if( !isROCCCFunctionCall(CI, ROCCCNames::SystolicPrevious) and
+        !isROCCCFunctionCall(CI, ROCCCNames::StoreNext) and
+        !isROCCCFunctionCall(CI, ROCCCNames::SystolicNext) )
+      return ValueRange();
+    assert( CI->getNumOperands() == 3 );
+    Value* written = CI->getOperand(2);
+    if( isAnalyzed(written) and ranges.find(written) == ranges.end() )
+      continue; //not computed yet
+    //the initial value of the register
+    ValueRange init;
+    if( isROCCCFunctionCall(CI, ROCCCNames::StoreNext) )
+      init = ValueRange(0, 0);
+    Value* reg = isROCCCFunctionCall(CI, ROCCCNames::SystolicPrevious) ? written : v;
+    for(Value::use_iterator RI = reg->use_begin(); RI != reg->use_end(); ++RI)
+    {
+      CallInst* initCall = dynamic_cast<CallInst*>(*RI);
+      if( initCall and isROCCCFunctionCall(initCall, ROCCCNames::LoadPreviousInitValue) and
+          dynamic_cast<ConstantInt*>(initCall->getOperand(2)) )
+        init = getRange(initCall->getOperand(2));
+    }
+    ValueRange r = join(getRange(written), init);
+    ret = found ? join(ret, r) : r;
+    found = true;
+  }
+  if( !found )
+    incomplete = true;
+  return ret;
+}
+
+ValueRangePass::ValueRange ValueRangePass::computeBinaryRange(BinaryOperator* BO)
+{
+  ValueRange lhs = getRange(BO->getOperand(0));
+  ValueRange rhs = getRange(BO->getOperand(1));
+  if( isCopyValue(BO) )
+    return lhs;
+  if( !lhs.bounded or !rhs.bounded )
+    return ValueRange();
+  switch( BO->getOpcode() )
+  {
+    case BinaryOperator::Add:
+      return ValueRange(lhs.low + rhs.low, lhs.high + rhs.high);
+    case BinaryOperator::Sub:
+      return ValueRange(lhs.low - rhs.high, lhs.high - rhs.low);
+    case BinaryOperator::Mul:
+    {
+      long double corners[4] = { (long double)lhs.low * rhs.low, (long double)lhs.low * rhs.high,
+                                 (long double)lhs.high * rhs.low, (long double)lhs.high * rhs.high };
+      long double low = corners[0], high = corners[0];
+      for(int c = 1; c < 4; ++c)
+      {
+        if( corners[c] < low )
+          low = corners[c];
+        if( corners[c] > high )
+          high = corners[c];
+      }
+      long double limit = (long double)(1LL << MAX_ANALYZED_BITS);
+      if( low < -limit or high > limit )
+        return ValueRange();
+      return ValueRange((long long)low, (long long)high);
+    }
+    case BinaryOperator::And:
+    {
+      if( lhs.low < 0 or rhs.low < 0 )
+        return ValueRange();
+      return ValueRange(0, (lhs.high < rhs.high) ? lhs.high : rhs.high);
+    }
+    case BinaryOperator::Or:
+    case BinaryOperator::Xor:
+    {
+      if( lhs.low < 0 or rhs.low < 0 )
+        return ValueRange();
+      long long high = (lhs.high > rhs.high) ? lhs.high : rhs.high;
+      long long mask = 1;
+      while( mask <= high )
+        mask <<= 1;
+      return ValueRange(0, mask - 1);
+    }
+    case BinaryOperator::Shl:
+    case BinaryOperator::LShr:
+    case BinaryOperator::AShr:
+    {
+      if( rhs.low != rhs.high or rhs.low < 0 or rhs.low >= MAX_ANALYZED_BITS )
+        return ValueRange();
+      int amount = (int)rhs.low;
+      if( BO->getOpcode() == BinaryOperator::Shl )
+      {
+        long long limit = 1LL << (MAX_ANALYZED_BITS - amount);
+        if( lhs.low < -limit or lhs.high > limit )
+          return ValueRange();
+        return ValueRange(lhs.low * (1LL << amount), lhs.high * (1LL << amount));
+      }
+      if( lhs.low < 0 )
+        return ValueRange();
+      return ValueRange(lhs.low >> amount, lhs.high >> amount);
+    }
+    default:
+      return ValueRange();
+  }
+}
+
+ValueRangePass::ValueRange ValueRangePass::computeRange(Instruction* i)
+{
+  //values written by calls are given their range by the call
+  if( isWrittenByCall(i) )
+    return computeFeedbackRange(i);
+  if( BinaryOperator* BO = dynamic_cast<BinaryOperator*>(i) )
+    return computeBinaryRange(BO);
+  if( dynamic_cast<ICmpInst*>(i) )
+    return ValueRange(0, 1);
+  if( CastInst* cast = dynamic_cast<CastInst*>(i) )
+  {
+    ValueRange r = getRange(cast->getOperand(0));
+    if( dynamic_cast<ZExtInst*>(i) and r.bounded and r.low < 0 )
+      return ValueRange();
+    return r;
+  }
+  if( PHINode* phi = dynamic_cast<PHINode*>(i) )
+  {
+    long long low, high;
+    if( getIVRange(phi, low, high) )
+      return ValueRange(low, high);
+    ValueRange ret;
+    bool found = false;
+    for(unsigned n = 0; n < phi->getNumIncomingValues(); ++n)
+    {
+      Value* in = phi->getIncomingValue(n);
+      if( isAnalyzed(in) and ranges.find(in) == ranges.end() )
+        continue; //not computed yet
+      ret = found ? join(ret, getRange(in)) : getRange(in);
+      found = true;
+    }
+    if( !found )
+      incomplete = true;
+    return ret;
+  }
+  if( CallInst* CI = dynamic_cast<CallInst*>(i) )
+  {
+    if( isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+    {
+      assert( CI->getNumOperands() == 4 and "Incorrect number of arguments to BoolSelect!" );
+      return join(getRange(CI->getOperand(1)), getRange(CI->getOperand(2)));
+    }
+  }
+  return ValueRange();
+}
+
+//values whose size is fixed by something other than the operations that
+//  use them keep the size they were declared with
+void ValueRangePass::findPinnedValues(Function& f)
+{
+  for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+  {
+    for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+    {
+      if( CallInst* CI = dynamic_cast<CallInst*>(&*II) )
+      {
+        if( isBookkeeping(CI) or isROCCCFunctionCall(CI, ROCCCNames::BoolSelect) )
+          continue;
+        pin(CI);
+        for(unsigned n = 1; n < CI->getNumOperands(); ++n)
+          pin(CI->getOperand(n));
+      }
+      else if( BinaryOperator* BO = dynamic_cast<BinaryOperator*>(&*II) )
+      {
+        switch( BO->getOpcode() )
+        {
+          case BinaryOperator::UDiv:
+          case BinaryOperator::SDiv:
+          case BinaryOperator::URem:
+          case BinaryOperator::SRem:
+          {
+            pin(BO);
+            pin(BO->getOperand(0));
+            pin(BO->getOperand(1));
+          }
+          break;
+          default:
+          break;
+        }
+      }
+      else if( dynamic_cast<ICmpInst*>(&*II) )
+      {
+        //comparisons reinterpret their operands by the predicate, not by the
+        //  signedness of the operands
+        pin(II->getOperand(0));
+        pin(II->getOperand(1));
+      }
+      else if( dynamic_cast<CastInst*>(&*II) )
+      {
+        ;
+      }
+      else
+      {
+        pin(&*II);
+        for(unsigned n = 0; n < II->getNumOperands(); ++n)
+          pin(II->getOperand(n));
+      }
+    }
+  }
+}
+
+void ValueRangePass::propagateRanges(Function& f)
+{
+  bool changed = true;
+  for(int sweep = 0; changed; ++sweep)
+  {
+    changed = false;
+    for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+    {
+      for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+      {
+        if( !isAnalyzed(&*II) )
+          continue;
+        incomplete = false;
+        ValueRange r = computeRange(&*II);
+        if( incomplete )
+          continue;
+        r = fit(&*II, r);
+        std::map<Value*, ValueRange>::iterator old = ranges.find(&*II);
+        if( old != ranges.end() )
+        {
+          r = join(old->second, r);
+          //the range is still growing, so stop following it
+          if( sweep >= MAX_SWEEPS and r != old->second )
+            r = fit(&*II, ValueRange());
+        }
+        if( old == ranges.end() or r != old->second )
+        {
+          ranges[&*II] = r;
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+int ValueRangePass::bitsNeeded(Value* v, ValueRange r)
+{
+  int size = declaredSize[v];
+  if( !r.bounded )
+    return size;
+  int bits = 1;
+  if( isValueSigned(v) )
+  {
+    bits = 2;
+    while( bits < size and (r.low < -(1LL << (bits - 1)) or r.high > (1LL << (bits - 1)) - 1) )
+      ++bits;
+  }
+  else
+  {
+    if( r.low < 0 )
+      return size;
+    while( bits < size and r.high > (1LL << bits) - 1 )
+      ++bits;
+  }
+  return (bits < size) ? bits : size;
+}
+
+//shifts are generated as a slice of their left hand side, so the result of
+//  a shift must be the same size as the value shifted
+void ValueRangePass::tieShifts(Function& f)
+{
+  bool changed = true;
+  while( changed )
+  {
+    changed = false;
+    for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+    {
+      for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+      {
+        BinaryOperator* BO = dynamic_cast<BinaryOperator*>(&*II);
+        if( !BO or isCopyValue(BO) or !isAnalyzed(BO) )
+          continue;
+        if( BO->getOpcode() != BinaryOperator::Shl and
+            BO->getOpcode() != BinaryOperator::LShr and
+            BO->getOpcode() != BinaryOperator::AShr )
+          continue;
+        Value* lhs = BO->getOperand(0);
+        ConstantInt* amount = dynamic_cast<ConstantInt*>(BO->getOperand(1));
+        bool pinBoth = pinned.find(BO) != pinned.end() or pinned.find(lhs) != pinned.end();
+        pinBoth = pinBoth or !isAnalyzed(lhs) or !amount;
+        pinBoth = pinBoth or declaredSize[lhs] != declaredSize[BO];
+        pinBoth = pinBoth or (getRange(lhs).bounded and getRange(lhs).low < 0);
+        if( !pinBoth )
+        {
+          int w = (width[BO] > width[lhs]) ? width[BO] : width[lhs];
+          if( amount->getSExtValue() + 1 > w )
+            w = amount->getSExtValue() + 1;
+          if( w >= declaredSize[BO] )
+            pinBoth = true;
+          else if( width[BO] != w or width[lhs] != w )
+          {
+            width[BO] = width[lhs] = w;
+            changed = true;
+          }
+        }
+        if( pinBoth and (pinned.find(BO) == pinned.end() or (isAnalyzed(lhs) and pinned.find(lhs) == pinned.end())) )
+        {
+          pin(BO);
+          pin(lhs);
+          width[BO] = declaredSize[BO];
+          if( isAnalyzed(lhs) )
+            width[lhs] = declaredSize[lhs];
+          changed = true;
+        }
+      }
+    }
+  }
+}
+
+bool ValueRangePass::runOnFunction(Function& f)
+{
+  CurrentFile::set(__FILE__);
+  bool changed = false ;
+
+  if( !f.getParent()->getFunction(ROCCCNames::VariableSize) )
+    return changed;
+  declaredSize.clear();
+  ranges.clear();
+  pinned.clear();
+  width.clear();
+  //only integers that have a size are analyzed
+  for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+  {
+    for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+    {
+      if( !II->getType()->isInteger() )
+        continue;
+      int size = getSizeInBits(&*II);
+      if( size >= 1 and size <= MAX_ANALYZED_BITS )
+        declaredSize[&*II] = size;
+    }
+  }
+  findPinnedValues(f);
+  propagateRanges(f);
+  for(std::map<Value*, int>::iterator DI = declaredSize.begin(); DI != declaredSize.end(); ++DI)
+  {
+    if( pinned.find(DI->first) != pinned.end() )
+      width[DI->first] = DI->second;
+    else
+      width[DI->first] = bitsNeeded(DI->first, getRange(DI->first));
+  }
+  tieShifts(f);
+  //setting the size of one value can change the size that is inferred for the
+  //  values that use it, so keep going until every size is what we want
+  int operatorsNarrowed = 0;
+  int bitsSaved = 0;
+  for(std::map<Value*, int>::iterator DI = declaredSize.begin(); DI != declaredSize.end(); ++DI)
+  {
+    if( width[DI->first] < DI->second )
+    {
+      ++operatorsNarrowed;
+      bitsSaved += DI->second - width[DI->first];
+    }
+  }
+  bool resized = true;
+  for(unsigned int pass = 0; resized and pass <= declaredSize.size(); ++pass)
+  {
+    resized = false;
+    for(Function::iterator BB = f.begin(); BB != f.end(); ++BB)
+    {
+      for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+      {
+        if( !isAnalyzed(&*II) )
+          continue;
+        if( getSizeInBits(&*II) != width[&*II] )
+        {
+          setSizeInBits(&*II, width[&*II]);
+          resized = true;
+          changed = true;
+        }
+      }
+    }
+  }
+  if( resized )
+  {
+    INTERNAL_WARNING("Sizes of values did not settle after bit width minimization!\n");
+  }
+  LOG_MESSAGE2("Datapath", "Bit Width Minimization", "Narrowed " << operatorsNarrowed << " of " << declaredSize.size() << " integer operations, saving " << bitsSaved << " bits.\n");
+
+  return changed ;
+}
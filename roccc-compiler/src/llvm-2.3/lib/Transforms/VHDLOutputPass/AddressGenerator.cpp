@@ -2,8 +2,11 @@
 #include "rocccLibrary/MultiForVar.hpp"
 #include <cassert>
 #include <sstream>
+#include <algorithm>
 #include "rocccLibrary/GetValueName.h"
 #include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
 
 std::string getIntAsString(int a)
 {
@@ -54,6 +57,13 @@ class AddressGenerator::AddressCalculationDatapath {
   VHDLInterface::Variable* input_valid;
   //outgoing valid signal
   VHDLInterface::Variable* output_valid;
+  //longest burst that contiguous requests are combined into; 1 disables
+  int max_burst_length;
+  //elements in each word of a packed stream; 1 requests single elements
+  int word_elements;
+  //the element offset and count of each word request
+  VHDLInterface::Variable* request_offset;
+  VHDLInterface::Variable* request_count;
   //gets a vector of the livs used
   std::vector<VHDLInterface::Variable*> getLIVsUsed()
   {
@@ -77,7 +87,7 @@ class AddressGenerator::AddressCalculationDatapath {
     return ret;
   }
 public:
-  AddressCalculationDatapath() : input_valid(NULL), output_valid(NULL) {}
+  AddressCalculationDatapath() : input_valid(NULL), output_valid(NULL), max_burst_length(1), word_elements(1), request_offset(NULL), request_count(NULL) {}
   void setPartialMultiply(VHDLInterface::Variable* liv, VHDLInterface::Variable* mult)
   {
     partial_multiply[liv] = mult;
@@ -126,6 +136,92 @@ public:
   {
     return output_valid;
   }
+  void setMaxBurstLength(int length)
+  {
+    max_burst_length = length;
+  }
+  int getMaxBurstLength()
+  {
+    return max_burst_length;
+  }
+  void setWordRequests(int elements, VHDLInterface::Variable* offset, VHDLInterface::Variable* count)
+  {
+    assert( elements > 1 and (elements & (elements - 1)) == 0 and "Words must hold a power of two elements!" );
+    assert( offset and count );
+    word_elements = elements;
+    request_offset = offset;
+    request_count = count;
+  }
+  //write a request out to the base/count ports; when whole words are
+  //  requested, the base is rounded down and the count up to whole words,
+  //  and the element offset and count are written out alongside
+  VHDLInterface::Statement* createRequestOutput(VHDLInterface::Process* p, std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*>& base, std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*>& count)
+  {
+    VHDLInterface::MultiStatement* ms = new VHDLInterface::MultiStatement(p);
+    std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > address_channels = getAddressChannelsUsed();
+    for(std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> >::iterator ACI = address_channels.begin(); ACI != address_channels.end(); ++ACI)
+    {
+      if( word_elements > 1 )
+      {
+        assert( address_channels.size() == 1 and "Only streams with one address channel are requested in words!" );
+        ms->addStatement(new VHDLInterface::AssignmentStatement(ACI->first, VHDLInterface::Wrap(base[*ACI]) & VHDLInterface::ConstantInt::get(-word_elements), p));
+        ms->addStatement(new VHDLInterface::AssignmentStatement(ACI->second, ((VHDLInterface::Wrap(base[*ACI]) & VHDLInterface::ConstantInt::get(word_elements-1)) + VHDLInterface::Wrap(count[*ACI]) + VHDLInterface::ConstantInt::get(word_elements-1)) & VHDLInterface::ConstantInt::get(-word_elements), p));
+        ms->addStatement(new VHDLInterface::AssignmentStatement(request_offset, VHDLInterface::Wrap(base[*ACI]) & VHDLInterface::ConstantInt::get(word_elements-1), p));
+        ms->addStatement(new VHDLInterface::AssignmentStatement(request_count, count[*ACI], p));
+      }
+      else
+      {
+        ms->addStatement(new VHDLInterface::AssignmentStatement(ACI->first, base[*ACI], p));
+        ms->addStatement(new VHDLInterface::AssignmentStatement(ACI->second, count[*ACI], p));
+      }
+    }
+    return ms;
+  }
+  //write a pending burst out to the base/count ports
+  VHDLInterface::Statement* createBurstOutput(VHDLInterface::Process* p, std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*>& pending_base, std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*>& pending_count)
+  {
+    VHDLInterface::MultiStatement* ms = new VHDLInterface::MultiStatement(p);
+    ms->addStatement(createRequestOutput(p, pending_base, pending_count));
+    ms->addStatement(new VHDLInterface::AssignmentStatement(output_valid, VHDLInterface::ConstantInt::get(1), p));
+    return ms;
+  }
+  //Coalesce requests that continue exactly where the pending burst ends, for
+  //  every channel at once, into a single burst of at most max_burst_length.
+  //  A pending burst is written out as soon as a request cannot be added to
+  //  it, or as soon as a cycle passes without a request, so the end of the
+  //  stream is always flushed.
+  VHDLInterface::Statement* createBurstCoalescing(VHDLInterface::Process* p, VHDLInterface::Variable* request_valid, std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*>& request_base, std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*>& request_count)
+  {
+    std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > address_channels = getAddressChannelsUsed();
+    std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*> pending_base;
+    std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*> pending_count;
+    VHDLInterface::Variable* pending_valid = new VHDLInterface::ProcessVariable("burst_pending_valid", 1);
+    for(std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> >::iterator ACI = address_channels.begin(); ACI != address_channels.end(); ++ACI)
+    {
+      pending_base[*ACI] = new VHDLInterface::ProcessVariable(ACI->first->getName()+"_burst_base", ACI->first->getSize());
+      pending_count[*ACI] = new VHDLInterface::ProcessVariable(ACI->second->getName()+"_burst_count", ACI->second->getSize());
+    }
+    VHDLInterface::CWrap contiguous = VHDLInterface::Wrap(pending_valid) == VHDLInterface::ConstantInt::get(1);
+    VHDLInterface::MultiStatement* extend = new VHDLInterface::MultiStatement(p);
+    VHDLInterface::MultiStatement* restart = new VHDLInterface::MultiStatement(p);
+    restart->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(pending_valid) == VHDLInterface::ConstantInt::get(1), createBurstOutput(p, pending_base, pending_count)));
+    for(std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> >::iterator ACI = address_channels.begin(); ACI != address_channels.end(); ++ACI)
+    {
+      contiguous = contiguous and (VHDLInterface::Wrap(request_base[*ACI]) == VHDLInterface::Wrap(pending_base[*ACI]) + VHDLInterface::Wrap(pending_count[*ACI]));
+      contiguous = contiguous and (VHDLInterface::Wrap(pending_count[*ACI]) + VHDLInterface::Wrap(request_count[*ACI]) <= VHDLInterface::ConstantInt::get(max_burst_length));
+      extend->addStatement(new VHDLInterface::AssignmentStatement(pending_count[*ACI], VHDLInterface::Wrap(pending_count[*ACI]) + VHDLInterface::Wrap(request_count[*ACI]), p));
+      restart->addStatement(new VHDLInterface::AssignmentStatement(pending_base[*ACI], request_base[*ACI], p));
+      restart->addStatement(new VHDLInterface::AssignmentStatement(pending_count[*ACI], request_count[*ACI], p));
+    }
+    restart->addStatement(new VHDLInterface::AssignmentStatement(pending_valid, VHDLInterface::ConstantInt::get(1), p));
+    VHDLInterface::MultiStatement* flush = new VHDLInterface::MultiStatement(p);
+    flush->addStatement(createBurstOutput(p, pending_base, pending_count));
+    flush->addStatement(new VHDLInterface::AssignmentStatement(pending_valid, VHDLInterface::ConstantInt::get(0), p));
+    return new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(request_valid) == VHDLInterface::ConstantInt::get(1),
+                                          new VHDLInterface::IfStatement(p, contiguous, extend, restart),
+                                          new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(pending_valid) == VHDLInterface::ConstantInt::get(1), flush)
+                                          );
+  }
   VHDLInterface::Statement* createAddressGenerationDatapath(VHDLInterface::Process* p)
   {
     VHDLInterface::MultiStatement* ret = new VHDLInterface::MultiStatement(p);
@@ -169,7 +265,13 @@ public:
       dp2_counts[*ACI] = new VHDLInterface::ProcessVariable(counts[*ACI]->getName()+"_temp2", counts[*ACI]->getSize());
       ms_dp2->addStatement(new VHDLInterface::AssignmentStatement(dp2_counts[*ACI], dp1_counts[*ACI], p));
     }
-    //sum the multiplies and set the base_out, set the count_out, and set output valid
+    //sum the multiplies and set the base_out, set the count_out, and set output valid;
+    //  when bursting, these go to one more stage that coalesces them instead
+    bool bursting = (max_burst_length > 1);
+    bool staged = (bursting or word_elements > 1);
+    std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*> dp3_bases;
+    std::map<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>,VHDLInterface::Variable*> dp3_counts;
+    VHDLInterface::Variable* dp3_valid = new VHDLInterface::ProcessVariable("dp3_valid", 1);
     VHDLInterface::MultiStatement* ms_dp3 = new VHDLInterface::MultiStatement(p);
     for(std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> >::iterator ACI = address_channels.begin(); ACI != address_channels.end(); ++ACI)
     {
@@ -178,13 +280,27 @@ public:
       {
         sum = sum + VHDLInterface::Wrap(temp_muls[*LUI][*ACI]);
       }
-      ms_dp3->addStatement(new VHDLInterface::AssignmentStatement(ACI->first, sum, p));
-      ms_dp3->addStatement(new VHDLInterface::AssignmentStatement(ACI->second, dp2_counts[*ACI], p));
+      dp3_bases[*ACI] = ACI->first;
+      dp3_counts[*ACI] = ACI->second;
+      if( staged )
+      {
+        dp3_bases[*ACI] = new VHDLInterface::ProcessVariable(ACI->first->getName()+"_temp3", ACI->first->getSize());
+        dp3_counts[*ACI] = new VHDLInterface::ProcessVariable(counts[*ACI]->getName()+"_temp3", ACI->second->getSize());
+      }
+      ms_dp3->addStatement(new VHDLInterface::AssignmentStatement(dp3_bases[*ACI], sum, p));
+      ms_dp3->addStatement(new VHDLInterface::AssignmentStatement(dp3_counts[*ACI], dp2_counts[*ACI], p));
     }
+    if( staged and not bursting )
+      ms_dp3->addStatement(createRequestOutput(p, dp3_bases, dp3_counts));
+    if( bursting )
+      ret->addStatement(createBurstCoalescing(p, dp3_valid, dp3_bases, dp3_counts));
     ret->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(dp2_valid) == VHDLInterface::ConstantInt::get(1), ms_dp3));
     ret->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(dp1_valid) == VHDLInterface::ConstantInt::get(1), ms_dp2));
     ret->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(input_valid) == VHDLInterface::ConstantInt::get(1), ms_dp1));
-    ret->addStatement(new VHDLInterface::AssignmentStatement(output_valid, dp2_valid, p));
+    if( bursting )
+      ret->addStatement(new VHDLInterface::AssignmentStatement(dp3_valid, dp2_valid, p));
+    else
+      ret->addStatement(new VHDLInterface::AssignmentStatement(output_valid, dp2_valid, p));
     ret->addStatement(new VHDLInterface::AssignmentStatement(dp2_valid, dp1_valid, p));
     ret->addStatement(new VHDLInterface::AssignmentStatement(dp1_valid, input_valid, p));
     return ret;
@@ -201,6 +317,18 @@ void AddressGenerator::initializeVHDLInterface(VHDLInterface::Variable* rdy, VHD
   address_rdy_out = rdy;
   address_stall_in = stall;
 }
+//The valid signal is written by the address process in place of the ready
+//  port, which cannot be read back, and drives the port.
+void AddressGenerator::setWordRequests(int elements, VHDLInterface::Variable* valid, VHDLInterface::Variable* offset, VHDLInterface::Variable* count)
+{
+  assert( valid );
+  addressCalcImpl->setWordRequests(elements, offset, count);
+  addressCalcImpl->setOutputValid(valid);
+}
+void AddressGenerator::setMaxBurstLength(int length)
+{
+  addressCalcImpl->setMaxBurstLength(length);
+}
 
 VHDLInterface::State* getStateNamed(VHDLInterface::StateVar* state, std::string name)
 {
@@ -245,7 +373,17 @@ VHDLInterface::CaseStatement* AddressGenerator::createInitializationVHDL(VHDLInt
   }
   //add the valid signals
   addressCalcImpl->setInputValid(new VHDLInterface::ProcessVariable(getValueName(stream_value)+"_address_calc_valid", 1));
-  addressCalcImpl->setOutputValid(address_rdy_out);
+  if( addressCalcImpl->getOutputValid() )
+    parent->createSynchronousStatement(address_rdy_out, addressCalcImpl->getOutputValid());
+  else
+    addressCalcImpl->setOutputValid(address_rdy_out);
+  //combine contiguous requests into longer bursts if asked to
+  int max_burst_length = addressCalcImpl->getMaxBurstLength();
+  if( ROCCC::isLoOptimizationSelected("MaxBurstLength") )
+    max_burst_length = std::max(max_burst_length, static_cast<int>(ROCCC::getLoOptimizationValue("MaxBurstLength", 1)));
+  addressCalcImpl->setMaxBurstLength(max_burst_length);
+  if( max_burst_length > 1 )
+    LOG_MESSAGE2("VHDL Generation", "Burst Addresses", "Contiguous address requests of " << getValueName(stream_value) << " are combined into bursts of up to " << max_burst_length << " elements.\n");
   //go through the livs and set the partials
   VHDLInterface::Value* mult = VHDLInterface::ConstantInt::get(1);
   for(Window::LocationIterator::ACCESS_ORDER_TYPE::reverse_iterator AOI = access_order.rbegin(); AOI != access_order.rend(); ++AOI)
@@ -297,7 +435,7 @@ void InputAddressGenerator::createVHDL(VHDLInterface::Entity* parent, LoopInduct
   VHDLInterface::State* last_init_state = getLastState(state);
   assert(last_init_state);
   //assign the steady state, and the stall check
-  p->addStatement(new VHDLInterface::AssignmentStatement(address_rdy_out, VHDLInterface::ConstantInt::get(0), p));
+  p->addStatement(new VHDLInterface::AssignmentStatement(addressCalcImpl->getOutputValid(), VHDLInterface::ConstantInt::get(0), p));
   VHDLInterface::MultiStatement* ms = new VHDLInterface::MultiStatement(p);
   ms->addStatement(addressCalcImpl->createAddressGenerationDatapath(p));
   ms->addStatement(new VHDLInterface::AssignmentStatement(addressCalcImpl->getInputValid(), VHDLInterface::ConstantInt::get(0), p));
@@ -361,7 +499,7 @@ OutputAddressGenerator::createVHDL(VHDLInterface::Entity* parent,
   assert(last_init_state);
 
   //assign the steady state, and the stall check
-  p->addStatement(new VHDLInterface::AssignmentStatement(address_rdy_out, VHDLInterface::ConstantInt::get(0), p));
+  p->addStatement(new VHDLInterface::AssignmentStatement(addressCalcImpl->getOutputValid(), VHDLInterface::ConstantInt::get(0), p));
 
   VHDLInterface::MultiStatement* ms = new VHDLInterface::MultiStatement(p);
   ms->addStatement(addressCalcImpl->createAddressGenerationDatapath(p));
@@ -30,8 +30,11 @@ the datapath when all incoming elements are ready.
 #include "rocccLibrary/DefinitionInst.h"
 #include "rocccLibrary/FileInfo.h"
 #include "rocccLibrary/DatabaseHelpers.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/FifoSizing.h"
 #include "rocccLibrary/VHDLComponents/BRAMFifo.h"
 #include "rocccLibrary/VHDLComponents/InputSmartBuffer.h"
+#include "rocccLibrary/VHDLComponents/GatherStream.h"
 #include "rocccLibrary/VHDLComponents/ShiftBuffer.h"
 #include "rocccLibrary/VHDLComponents/LoopInductionVariableHandler.h"
 
@@ -143,6 +146,101 @@ int getNumDataChannels(llvm::Value* v)
   return requestMap.find(v)->second;
 }
 
+/*
+A gathered stream, A[B[i]], is read at the addresses held in the elements of
+its index stream B, one element of A for each element of B. Both are named
+by a GatherIndex call. Returns B for A, or NULL if the stream is not gathered.
+*/
+std::map<llvm::Value*, llvm::Value*>& getGatherIndexMap(llvm::Value* v)
+{
+  assert( v );
+  static std::map<llvm::Value*, llvm::Value*> gatherMap;
+  static bool found = false;
+  if( !found )
+  {
+    if(Instruction* II = dynamic_cast<Instruction*>(v))
+    {
+      found = true;
+      Function* f = II->getParent()->getParent();
+      for(Function::iterator BB = f->begin(); BB != f->end(); ++BB)
+      {
+        for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+        {
+          if(CallInst* CI = dynamic_cast<CallInst*>(&*II))
+          {
+            if( isROCCCFunctionCall(CI, ROCCCNames::GatherIndex) )
+            {
+              assert( CI->getNumOperands() == 4 );
+              llvm::ConstantInt* constInt = dynamic_cast<llvm::ConstantInt*>( CI->getOperand(1));
+              assert( constInt and constInt->getValue().getSExtValue() == 1 and "Gathered streams must have exactly one index stream!" );
+              gatherMap[CI->getOperand(2)] = CI->getOperand(3);
+            }
+          }
+        }
+      }
+    }
+  }
+  return gatherMap;
+}
+llvm::Value* getGatherIndexStream(llvm::Value* v)
+{
+  std::map<llvm::Value*, llvm::Value*>& gatherMap = getGatherIndexMap(v);
+  if( gatherMap.find(v) == gatherMap.end() )
+    return NULL;
+  return gatherMap.find(v)->second;
+}
+bool isGatherIndexStream(llvm::Value* v)
+{
+  std::map<llvm::Value*, llvm::Value*>& gatherMap = getGatherIndexMap(v);
+  for(std::map<llvm::Value*, llvm::Value*>::iterator GI = gatherMap.begin(); GI != gatherMap.end(); ++GI)
+  {
+    if( GI->second == v )
+      return true;
+  }
+  return false;
+}
+
+/*
+The number of lines of the cache in front of each gathered stream, from the
+GatherCacheLines optimization; 0 when the stream is not cached.
+*/
+int getGatherCacheLines()
+{
+  if( !ROCCC::isLoOptimizationSelected("GatherCacheLines") )
+    return 0;
+  return std::max(static_cast<int>(ROCCC::getLoOptimizationValue("GatherCacheLines", 0)), 0);
+}
+
+/*
+When StreamPackingWidth is selected, the memory bus of each stream is that
+many bits wide, and one bus word carries as many elements as fit in it,
+rounded down to a power of two. The stream's external data channels and fifo
+are widened to a whole word, and memory is requested in whole, aligned words;
+the smart buffers unpack the elements of each request from its words and
+repack them, with an enable for every element written. Only streams with a
+single data channel and a single address channel are packed, and only when
+at least two elements fit in a word; gathered streams and their index
+streams are read an element at a time and are never packed.
+*/
+int getStreamPackingFactor(llvm::Value* v)
+{
+  assert( v );
+  if( !ROCCC::isLoOptimizationSelected("StreamPackingWidth") )
+    return 1;
+  if( getGatherIndexStream(v) or isGatherIndexStream(v) )
+    return 1;
+  if( getNumDataChannels(v) != 1 or getNumAddressChannels(v) != 1 )
+    return 1;
+  int bus_width = static_cast<int>(ROCCC::getLoOptimizationValue("StreamPackingWidth", 0));
+  int element_width = getSizeInBits(v);
+  if( element_width <= 0 or bus_width < 2 * element_width )
+    return 1;
+  int factor = 2;
+  while( factor * 2 * element_width <= bus_width )
+    factor *= 2;
+  return factor;
+}
+
 class CounterProcess : public Process {
   VHDLInterface::Statement* steadyState;
 protected:
@@ -296,6 +394,45 @@ int getNumOutstandingMemoryRequests(llvm::Value* v)
   return requestMap.find(v)->second;
 }
 
+//The number of cycles between two iterations that the datapath can accept,
+//  as throttled by systolic feedback and the initiation interval.
+int getIssueInterval(DFFunction* df)
+{
+  int interval = std::max(df->getInitiationInterval(), 1);
+  if( getFeedbackLengthIfItExists(df).first )
+    interval = std::max(interval, getFeedbackLengthIfItExists(df).second + 1);
+  return interval;
+}
+
+//The longest burst, in elements, that the memory side of a stream moves at once.
+int getStreamBurstLength(llvm::Value* v)
+{
+  assert( v );
+  if( !ROCCC::isLoOptimizationSelected("MaxBurstLength") )
+    return 1;
+  return std::max(static_cast<int>(ROCCC::getLoOptimizationValue("MaxBurstLength", 1)), 1);
+}
+
+/*
+The fifo on each stream decouples the module from whatever is on the other
+side of the stream, which in a system is another module. Instead of a fixed
+size, it is sized from the rates and pipeline latencies of its producer and
+consumer (see FifoSizing.h), in fifo words and in cycles per fifo word.
+*/
+int getStreamFifoDepth(llvm::Value* v, const ROCCC::FifoRates& rates, int& full_slack)
+{
+  assert( v );
+  full_slack = ROCCC::getFifoFullSlack(rates);
+  int depth = ROCCC::getFifoDepth(rates);
+  if( depth > VHDLInterface::BRAMFifo::getMaximumDepth() )
+  {
+    INTERNAL_WARNING("The fifo of stream " << getValueName(v) << " needs " << depth << " words, but fifos can be at most " << VHDLInterface::BRAMFifo::getMaximumDepth() << " deep; the stream may stall.\n");
+    depth = VHDLInterface::BRAMFifo::getMaximumDepth();
+  }
+  LOG_MESSAGE2("VHDL Generation", "Stream Fifo Sizing", "The fifo of " << getValueName(v) << " holds " << depth << " words of " << getNumDataChannels(v) * getStreamPackingFactor(v) << " elements, and raises full with " << full_slack << " words free.\n");
+  return depth;
+}
+
 bool InputControllerPass::runOnFunction(Function& f)
 {
   CurrentFile::set(__FILE__);
@@ -342,6 +479,11 @@ bool InputControllerPass::runOnFunction(Function& f)
   InputSmartBuffer isb;
   ROCCCLoopInformation loopInfo = df->getROCCCLoopInfo();
   std::vector<VHDLInterface::Variable*> dat_out;
+  //the gathered streams, and the fifos holding the elements of each index
+  //  stream for the stream it gathers
+  std::map<llvm::Value*, GatherStream*> gatherStreams;
+  std::map<llvm::Value*, VHDLInterface::Port*> gatherAddressClks;
+  std::map<llvm::Value*, std::pair<VHDLInterface::BRAMFifo*, ComponentDefinition*> > indexFifos;
   for(std::vector<Value*>::iterator BI = loopInfo.inputBuffers.begin(); BI != loopInfo.inputBuffers.end(); ++BI)
   {
     //create an inputstream struct so that any classes that instantiate the inputcontroller will be able to find the streams connected
@@ -350,17 +492,31 @@ bool InputControllerPass::runOnFunction(Function& f)
     stream.stream->readableName = getValueName(*BI);
     stream.stream->value = *BI;
     //create the bram fifo that will be feeding the stream of the inputsmartbuffer component
-    VHDLInterface::BRAMFifo* bramDecl = new VHDLInterface::BRAMFifo(getSizeInBits(*BI) * getNumDataChannels(*BI), 512);
+    //  each fifo word holds a group of data channels for every packed element
+    int numDataChannels = getNumDataChannels(*BI) * getStreamPackingFactor(*BI);
+    //memory fills the fifo a word a cycle, with every outstanding burst in
+    //  flight, and the smart buffer drains it no faster than the datapath
+    //  issues, through the whole pipeline; gathered streams request a single
+    //  element at a time
+    int burstWords = (getStreamBurstLength(*BI) + numDataChannels - 1) / numDataChannels;
+    if( getGatherIndexStream(*BI) )
+      burstWords = 1;
+    int fullSlack = 0;
+    ROCCC::FifoRates rates(burstWords, getNumOutstandingMemoryRequests(*BI) * burstWords, 0, 1, df->getDelay(), getIssueInterval(df), VHDLInterface::BRAMFifo::getFullFlagLatency());
+    int fifoDepth = getStreamFifoDepth(*BI, rates, fullSlack);
+    VHDLInterface::BRAMFifo* bramDecl = new VHDLInterface::BRAMFifo(getSizeInBits(*BI) * numDataChannels, fifoDepth, fullSlack);
     ComponentDefinition* bramDef = bramDecl->getInstantiation(inputEntity);
     inputEntity->mapPortToSubComponentPort(inputEntity->getStandardPorts().rst, bramDef, bramDecl->getRst());
     //connect the writing side of the fifo to the outside
     inputEntity->mapPortToSubComponentPort(inputEntity->addPort(getValueName(*BI)+"_WClk", 1, VHDLInterface::Port::INPUT), bramDef, bramDecl->getWClk());
     stream.stream->cross_clk = inputEntity->getVariableMappedTo(bramDef, bramDecl->getWClk());
-    inputEntity->mapPortToSubComponentPort(inputEntity->addPort(getValueName(*BI)+"_full", 1, VHDLInterface::Port::OUTPUT), bramDef, bramDecl->getFullOut());
-    stream.stream->stop_access = inputEntity->getVariableMappedTo(bramDef, bramDecl->getFullOut());
+    VHDLInterface::Port* full = inputEntity->addPort(getValueName(*BI)+"_full", 1, VHDLInterface::Port::OUTPUT);
+    if( !isGatherIndexStream(*BI) )
+      inputEntity->mapPortToSubComponentPort(full, bramDef, bramDecl->getFullOut());
+    stream.stream->stop_access = full;
     inputEntity->mapPortToSubComponentPort(inputEntity->addPort(getValueName(*BI)+"_writeEn", 1, VHDLInterface::Port::INPUT), bramDef, bramDecl->getWriteEnIn());
     stream.stream->enable_access = inputEntity->getVariableMappedTo(bramDef, bramDecl->getWriteEnIn());
-    for(int count = 0; count < getNumDataChannels(*BI); ++count)
+    for(int count = 0; count < numDataChannels; ++count)
     {
       //and also the fifo data in
       VHDLInterface::Variable* val = inputEntity->getVariableMappedTo(bramDef, bramDecl->getDataIn());
@@ -371,6 +527,26 @@ bool InputControllerPass::runOnFunction(Function& f)
       inputEntity->createSynchronousStatement(val, channel);
       stream.stream->data_channels.push_back(channel);
     }
+    //the elements of an index stream are also written to an index fifo for
+    //  the stream it gathers, and the stream is full when either fifo is
+    if( isGatherIndexStream(*BI) )
+    {
+      if( numDataChannels != 1 )
+      {
+        INTERNAL_ERROR("Index stream " << getValueName(*BI) << " must have a single data channel!\n");
+        assert(0 and "Index streams must have a single data channel!");
+      }
+      VHDLInterface::BRAMFifo* indexDecl = new VHDLInterface::BRAMFifo(getSizeInBits(*BI), fifoDepth, fullSlack);
+      ComponentDefinition* indexDef = indexDecl->getInstantiation(inputEntity);
+      inputEntity->mapPortToSubComponentPort(inputEntity->getStandardPorts().rst, indexDef, indexDecl->getRst());
+      inputEntity->mapPortToSubComponentPort(dynamic_cast<VHDLInterface::Port*>(stream.stream->cross_clk), indexDef, indexDecl->getWClk());
+      inputEntity->mapPortToSubComponentPort(dynamic_cast<VHDLInterface::Port*>(stream.stream->enable_access), indexDef, indexDecl->getWriteEnIn());
+      inputEntity->mapPortToSubComponentPort(dynamic_cast<VHDLInterface::Port*>(stream.stream->data_channels.at(0)), indexDef, indexDecl->getDataIn());
+      VHDLInterface::AssignmentStatement* full_ass = inputEntity->createSynchronousStatement(full);
+      full_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(inputEntity->getVariableMappedTo(bramDef, bramDecl->getFullOut())) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(inputEntity->getVariableMappedTo(indexDef, indexDecl->getFullOut())) == VHDLInterface::ConstantInt::get(1));
+      full_ass->addCase(VHDLInterface::ConstantInt::get(0));
+      indexFifos[*BI] = std::pair<VHDLInterface::BRAMFifo*, ComponentDefinition*>(indexDecl, indexDef);
+    }
     //also connect the address ports to the outside
     stream.stream->address_stall = inputEntity->addPort(getValueName(*BI)+"_address_stall", 1, VHDLInterface::Port::INPUT);
     stream.stream->address_rdy = inputEntity->addPort(getValueName(*BI)+"_address_rdy", 1, VHDLInterface::Port::OUTPUT);
@@ -386,31 +562,105 @@ bool InputControllerPass::runOnFunction(Function& f)
                     );
     }
     stream.stream->address_clk = inputEntity->addPort(getValueName(*BI)+"_address_clk", 1, VHDLInterface::Port::INPUT);
-    isb.setAddressVariables(*BI,
-                    stream.stream->address_rdy,
-                    stream.stream->address_stall,
-                    stream.stream->address_channels,
-                    stream.stream->address_clk);
     //then set the output of the fifo to the smartbuffer
     inputEntity->mapPortToSubComponentPort(inputEntity->getStandardPorts().clk, bramDef, bramDecl->getRClk());
     std::vector<VHDLInterface::Variable*> fifo_data_outs;
-    for(int count = 0; count < getNumDataChannels(*BI); ++count)
+    for(int count = 0; count < numDataChannels; ++count)
     {
       //map the fifo data out
       VHDLInterface::Variable* val = inputEntity->getVariableMappedTo(bramDef, bramDecl->getDataOut());
       val = VHDLInterface::BitRange::get(val, (count+1) * getSizeInBits(*BI) - 1, count * getSizeInBits(*BI));
       fifo_data_outs.push_back(val);
     }
-    isb.initializeInputInterfacePorts(*BI,
+    if( llvm::Value* index = getGatherIndexStream(*BI) )
+    {
+      if( numDataChannels != 1 or getNumAddressChannels(*BI) != 1 )
+      {
+        INTERNAL_ERROR("Gathered stream " << getValueName(*BI) << " must have a single data channel and a single address channel!\n");
+        assert(0 and "Gathered streams must have a single data and address channel!");
+      }
+      //the addresses of a gathered stream come from its indexes, so the
+      //  address generator of the smart buffer is left stalled
+      VHDLInterface::Signal* unused_rdy = inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_unused_address_rdy", 1);
+      VHDLInterface::Signal* unused_stall = inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_unused_address_stall", 1);
+      inputEntity->createSynchronousStatement(unused_stall, VHDLInterface::ConstantInt::get(1));
+      std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > unused_channels;
+      unused_channels.push_back(std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*>(
+                             inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_unused_address_base", 32),
+                             inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_unused_address_count", 32)
+                         ));
+      isb.setAddressVariables(*BI, unused_rdy, unused_stall, unused_channels, stream.stream->address_clk);
+      GatherStream* gather = new GatherStream(getValueName(*BI)+"_gather");
+      gather->mapIndexWidth(getSizeInBits(index));
+      gather->mapDataWidth(getSizeInBits(*BI));
+      gather->mapDepth(getNumOutstandingMemoryRequests(*BI));
+      gather->mapCacheLines(getGatherCacheLines());
+      gather->mapClk(inputEntity->getStandardPorts().clk);
+      gather->mapRst(inputEntity->getStandardPorts().rst);
+      gather->mapAddressClk(stream.stream->address_clk);
+      gather->mapAddressRdyOut(stream.stream->address_rdy);
+      gather->mapAddressStallIn(stream.stream->address_stall);
+      gather->mapAddressOut(stream.stream->address_channels.at(0).first, stream.stream->address_channels.at(0).second);
+      gather->mapDataEmptyIn(inputEntity->getVariableMappedTo(bramDef, bramDecl->getEmptyOut()));
+      gather->mapDataReadEnableOut(inputEntity->getVariableMappedTo(bramDef, bramDecl->getReadEnIn()));
+      gather->mapDataIn(inputEntity->getVariableMappedTo(bramDef, bramDecl->getDataOut()));
+      VHDLInterface::Signal* gather_read = inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_gather_read_enable", 1);
+      VHDLInterface::Signal* gather_empty = inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_gather_empty", 1);
+      VHDLInterface::Signal* gather_data = inputEntity->createSignal<VHDLInterface::Signal>(getValueName(*BI)+"_gather_data", getSizeInBits(*BI));
+      gather->mapOutputReadEnableIn(gather_read);
+      gather->mapOutputEmptyOut(gather_empty);
+      gather->mapOutputDataOut(gather_data);
+      isb.initializeInputInterfacePorts(*BI,
+                    gather_read,
+                    gather_empty,
+                    std::vector<VHDLInterface::Variable*>(1, gather_data));
+      gatherStreams[*BI] = gather;
+      gatherAddressClks[*BI] = dynamic_cast<VHDLInterface::Port*>(stream.stream->address_clk);
+      LOG_MESSAGE2("VHDL Generation", "Gather Streams", getValueName(*BI) << " is gathered at the elements of " << getValueName(index) << ", with up to " << getNumOutstandingMemoryRequests(*BI) << " requests in flight" << (getGatherCacheLines() > 0 ? " behind a direct mapped cache" : "") << ".\n");
+    }
+    else
+    {
+      isb.setAddressVariables(*BI,
+                    stream.stream->address_rdy,
+                    stream.stream->address_stall,
+                    stream.stream->address_channels,
+                    stream.stream->address_clk);
+      isb.initializeInputInterfacePorts(*BI,
                     inputEntity->getVariableMappedTo(bramDef, bramDecl->getReadEnIn()),
                     inputEntity->getVariableMappedTo(bramDef, bramDecl->getEmptyOut()),
                     fifo_data_outs);
+    }
+    isb.setPackingFactor(*BI, getStreamPackingFactor(*BI));
     for(std::vector<std::pair<Value*,std::vector<int> > >::iterator BII = loopInfo.inputBufferIndexes[*BI].begin(); BII != loopInfo.inputBufferIndexes[*BI].end(); ++BII)
     {
       dat_out.push_back(inputEntity->addPort(getValueName(BII->first), getSizeInBits(BII->first), VHDLInterface::Port::OUTPUT, BII->first));
     }
     this->input_streams.push_back(stream);
   }
+  //each gathered stream reads its indexes from the index fifo of its index
+  //  stream, on its own address clock
+  for(std::map<llvm::Value*, GatherStream*>::iterator GI = gatherStreams.begin(); GI != gatherStreams.end(); ++GI)
+  {
+    llvm::Value* index = getGatherIndexStream(GI->first);
+    if( indexFifos.find(index) == indexFifos.end() )
+    {
+      INTERNAL_ERROR("Index stream " << getValueName(index) << " of gathered stream " << getValueName(GI->first) << " is not an input stream!\n");
+      assert(0 and "Index stream of gathered stream is not an input stream!");
+    }
+    if( indexFifos[index].second == NULL )
+    {
+      INTERNAL_ERROR("Index stream " << getValueName(index) << " indexes more than one gathered stream!\n");
+      assert(0 and "Index stream indexes more than one gathered stream!");
+    }
+    VHDLInterface::BRAMFifo* indexDecl = indexFifos[index].first;
+    ComponentDefinition* indexDef = indexFifos[index].second;
+    inputEntity->mapPortToSubComponentPort(gatherAddressClks[GI->first], indexDef, indexDecl->getRClk());
+    GI->second->mapIndexEmptyIn(inputEntity->getVariableMappedTo(indexDef, indexDecl->getEmptyOut()));
+    GI->second->mapIndexReadEnableOut(inputEntity->getVariableMappedTo(indexDef, indexDecl->getReadEnIn()));
+    GI->second->mapIndexDataIn(inputEntity->getVariableMappedTo(indexDef, indexDecl->getDataOut()));
+    GI->second->generateCode(inputEntity);
+    indexFifos[index].second = NULL;
+  }
   {//create the standard fifo reader
     VHDLInterface::Variable* inputValueValid = inputEntity->getSignalMappedToPort(inputEntity->getDeclaration()->getStandardPorts().outputReady);
     VHDLInterface::Variable* outputStallIn = inputEntity->getStandardPorts().stall;
@@ -422,6 +672,15 @@ bool InputControllerPass::runOnFunction(Function& f)
     //if there are any systolics, make a counter and only read when the counter is at 0
     unsigned systolicLength = getFeedbackLengthIfItExists(df).second;
     bool has_systolics = getFeedbackLengthIfItExists(df).first;
+    //loop carried values that were modulo scheduled need the same throttling;
+    //  the counter runs from 0 to its max, so an interval of II is a max of II-1
+    if( df->getInitiationInterval() > 1 )
+    {
+      unsigned intervalLength = df->getInitiationInterval() - 1;
+      if( !has_systolics or intervalLength > systolicLength )
+        systolicLength = intervalLength;
+      has_systolics = true;
+    }
     if( has_systolics )
     {
       Signal* counter = inputEntity->createSignal<Signal>("counter", 32);
@@ -1,5 +1,7 @@
 #include "rocccLibrary/VHDLComponents/InputSmartBuffer.h"
 
+#include "llvm/Constants.h"
+
 #include <sstream>
 #include <vector>
 #include <map>
@@ -13,9 +15,14 @@
 #include "rocccLibrary/VHDLComponents/LoopInductionVariableHandler.h"
 #include "rocccLibrary/VHDLComponents/ShiftBuffer.h"
 #include "rocccLibrary/VHDLComponents/MicroFifo.h"
+#include "rocccLibrary/VHDLComponents/LineBuffer.h"
 #include "rocccLibrary/VHDLComponents/AddressGenerator.h"
+#include "rocccLibrary/VHDLComponents/BRAMFifo.h"
 
 #include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/InductionVariableInfo.h"
 
 #include "rocccLibrary/Window/RelativeLocation.h"
 
@@ -137,11 +144,78 @@ S& operator << (S& st, const std::map<T,D> m)
 VHDLInterface::State* getStateNamed(VHDLInterface::StateVar* state, std::string name);
 std::string getLocationAsString(CountingPointer<Window::Location> loc, Window::LocationIterator::ACCESS_ORDER_TYPE ao);
 
+//How the elements of a window that fall outside of the image are filled in
+//  when the smart buffer pads the borders itself, selected by the value of
+//  BoundaryPadding.
+enum BorderMode {
+  BORDER_NONE = 0,
+  BORDER_ZERO = 1,
+  BORDER_CLAMP = 2,
+  BORDER_MIRROR = 3,
+  BORDER_WRAP = 4
+};
+
+//Along one dimension of a window of the given size, returns which element of
+//  the window holds the value for element c, when the window is the
+//  amount'th window from the low edge of the image (edge == 0) or from the
+//  high edge (edge == 1). The window is centered on its output, so lo_pad
+//  elements of the window hang off of the low edge of the first window.
+int getBorderSource(int c, int size, int lo_pad, int edge, int amount, int mode)
+{
+  assert( mode == BORDER_CLAMP or mode == BORDER_MIRROR );
+  int ret = c;
+  if( edge == 0 )
+  {
+    int outside = lo_pad - amount - c;
+    if( outside > 0 )
+      ret = (mode == BORDER_CLAMP) ? c + outside : c + 2 * outside - 1;
+  }
+  else
+  {
+    int outside = c - lo_pad - amount;
+    if( outside > 0 )
+      ret = (mode == BORDER_CLAMP) ? c - outside : c - 2 * outside + 1;
+  }
+  assert( ret >= 0 and ret < size and "Border element is not inside of the window!" );
+  return ret;
+}
+
+//The condition that the window is the amount'th window from the given edge,
+//  where pos is the position of the newest element of the window in the
+//  padded rows, and last is the last position in the padded rows.
+VHDLInterface::CWrap getBorderCondition(VHDLInterface::Variable* pos, VHDLInterface::Variable* last, int size, int edge, int amount)
+{
+  if( edge == 0 )
+    return VHDLInterface::Wrap(pos) == VHDLInterface::ConstantInt::get(size-1+amount);
+  return VHDLInterface::Wrap(pos) == VHDLInterface::Wrap(last) - VHDLInterface::ConstantInt::get(amount);
+}
+
 class InputSmartBufferImpl : public FifoInterfaceBlock<llvm::Value*,llvm::Value*> {
   typedef llvm::Value* INPUT_TYPE;
   typedef llvm::Value* OUTPUT_TYPE;
   //what stream is this, anyways?!
   llvm::Value* stream_value;
+  //read from the incoming fifo whenever it has data and the outgoing fifo is
+  //  not full, and return the signal that is high the cycle the data arrives
+  VHDLInterface::Signal* createInputValid(VHDLInterface::Entity* parent, VHDLInterface::Signal* outputStallIn)
+  {
+    llvm::Value* index = stream_value;
+    VHDLInterface::Signal* inputValueValid = parent->createSignal<VHDLInterface::Signal>(getValueName(stream_value)+"_valid0", 1);
+    VHDLInterface::Signal* readEnable = parent->createSignal<VHDLInterface::Signal>(getValueName(stream_value)+"_read_enable_t", 1);
+    parent->createSynchronousStatement(inputs[index].read_enable_out, readEnable);
+    VHDLInterface::AssignmentStatement* read_ass = parent->createSynchronousStatement(readEnable);
+    read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(outputStallIn) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(inputs[index].empty_in) == VHDLInterface::ConstantInt::get(1));
+    read_ass->addCase(VHDLInterface::ConstantInt::get(1));
+    ShiftBuffer sb(getValueName(stream_value)+"_inputShiftBuffer");
+    sb.mapDataWidth(1);
+    sb.mapShiftDepth(1);
+    sb.mapRst(parent->getStandardPorts().rst);
+    sb.mapClk(parent->getStandardPorts().clk);
+    sb.mapDataIn(readEnable);
+    sb.mapDataOut(inputValueValid);
+    sb.generateCode(parent);
+    return inputValueValid;
+  }
 public:
   InputSmartBufferImpl(llvm::Value* v) : FifoInterfaceBlock<INPUT_TYPE,OUTPUT_TYPE>(), stream_value(v)
   {
@@ -197,23 +271,8 @@ public:
     else
     {
       //create the input valid signal
-      VHDLInterface::Signal* inputValueValid = parent->createSignal<VHDLInterface::Signal>(getValueName(stream_value)+"_valid0", 1);
       VHDLInterface::Signal* outputStallIn = parent->createSignal<VHDLInterface::Signal>(getValueName(stream_value)+"_output_stall", 1);
-      {//none of this needs to be exposed to the rest of the body
-        VHDLInterface::Signal* readEnable = parent->createSignal<VHDLInterface::Signal>(getValueName(stream_value)+"_read_enable_t", 1);
-        parent->createSynchronousStatement(inputs[index].read_enable_out, readEnable);
-        VHDLInterface::AssignmentStatement* read_ass = parent->createSynchronousStatement(readEnable);
-        read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(outputStallIn) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(inputs[index].empty_in) == VHDLInterface::ConstantInt::get(1));
-        read_ass->addCase(VHDLInterface::ConstantInt::get(1));
-        ShiftBuffer sb(getValueName(stream_value)+"_inputShiftBuffer");
-        sb.mapDataWidth(1);
-        sb.mapShiftDepth(1);
-        sb.mapRst(parent->getStandardPorts().rst);
-        sb.mapClk(parent->getStandardPorts().clk);
-        sb.mapDataIn(readEnable);
-        sb.mapDataOut(inputValueValid);
-        sb.generateCode(parent);
-      }
+      VHDLInterface::Signal* inputValueValid = createInputValid(parent, outputStallIn);
       //create the smart buffering stage
       VHDLInterface::MultiStatementProcess* p = parent->createProcess<VHDLInterface::MultiStatementProcess>();
       std::map<std::vector<int>,VHDLInterface::Variable*> buffers;
@@ -445,14 +504,479 @@ public:
       mfifo.generateCode(parent);
     }
   }  
+  //Instead of reading a whole column of the window every step, the data
+  //  arrives one element at a time in row order. Each of the height-1 rows
+  //  above the newest one is delayed by a line buffer in block ram, and only
+  //  the window itself is kept in registers, shifting left one column per
+  //  element read.
+  //When the borders are padded by the smart buffer, the windows that hang off
+  //  of the edges of the image have the padding substituted from the elements
+  //  of the window that are inside of the image.
+  void createLineBufferVHDL(VHDLInterface::Entity* parent, std::map<llvm::Value*,int> window_dimensions, std::vector<llvm::Value*> window_order, llvm::Value* inner_liv, llvm::Value* outer_liv, VHDLInterface::Value* inner_end, VHDLInterface::Value* outer_end, int depth, int border_mode)
+  {
+    llvm::Value* index = stream_value;
+    assert( inputs[index].data_in.size() == 1 );
+    assert( outputs.size() == 1 );
+    int width = window_dimensions[inner_liv];
+    int height = window_dimensions[outer_liv];
+    int inner_pos = std::find(window_order.begin(), window_order.end(), inner_liv) - window_order.begin();
+    int outer_pos = std::find(window_order.begin(), window_order.end(), outer_liv) - window_order.begin();
+    assert( inner_pos < (int)window_order.size() and outer_pos < (int)window_order.size() );
+    int bits = getSizeInBits(stream_value);
+    std::string name = getValueName(stream_value);
+    VHDLInterface::Signal* outputStallIn = parent->createSignal<VHDLInterface::Signal>(name+"_output_stall", 1);
+    VHDLInterface::Signal* inputValueValid = createInputValid(parent, outputStallIn);
+    //the position of the element arriving in the rows being read; the rows
+    //  are width-1 elements longer than the inner loop
+    VHDLInterface::Signal* col = parent->createSignal<VHDLInterface::Signal>(name+"_line_col", getSizeInBits(inner_liv));
+    VHDLInterface::Signal* row = parent->createSignal<VHDLInterface::Signal>(name+"_line_row", getSizeInBits(outer_liv));
+    VHDLInterface::Signal* last_col = parent->createSignal<VHDLInterface::Signal>(name+"_line_last_col", getSizeInBits(inner_liv));
+    parent->createSynchronousStatement(last_col, VHDLInterface::Wrap(inner_end) + VHDLInterface::ConstantInt::get(width-2));
+    //the last column of the window is a register, so each line buffer holds
+    //  one less element than a row
+    VHDLInterface::Signal* last_address = parent->createSignal<VHDLInterface::Signal>(name+"_line_last_address", getSizeInBits(inner_liv));
+    if( width >= 3 )
+      parent->createSynchronousStatement(last_address, VHDLInterface::Wrap(inner_end) + VHDLInterface::ConstantInt::get(width-3));
+    else
+      parent->createSynchronousStatement(last_address, VHDLInterface::Wrap(inner_end) - VHDLInterface::ConstantInt::get(3-width));
+    //the newest row comes straight from the input, and every row above it
+    //  comes out of one more line buffer
+    std::vector<VHDLInterface::Variable*> rows(height);
+    rows[height-1] = inputs[index].data_in.at(0);
+    for(int r = height-2; r >= 0; --r)
+    {
+      std::stringstream line_name;
+      line_name << name << "_line" << height-2-r;
+      VHDLInterface::Signal* line_out = parent->createSignal<VHDLInterface::Signal>(line_name.str()+"_out", bits);
+      LineBuffer lb(line_name.str());
+      lb.mapDataWidth(bits);
+      lb.mapDepth(depth);
+      lb.mapRst(parent->getStandardPorts().rst);
+      lb.mapClk(parent->getStandardPorts().clk);
+      lb.mapEnableIn(inputValueValid);
+      lb.mapLastAddressIn(last_address);
+      lb.mapDataIn(rows[r+1]);
+      lb.mapDataOut(line_out);
+      lb.generateCode(parent);
+      rows[r] = line_out;
+    }
+    //create the window registers, in the same order as the outputs
+    std::map<std::vector<int>,VHDLInterface::Variable*> window;
+    std::vector<VHDLInterface::Variable*> micro_data_in;
+    for(llvm::MultiForVar<int> i = getMultiForVarForWindow(window_dimensions, window_order); !i.done(); ++i)
+    {
+      window[i.getRaw()] = parent->createSignal<VHDLInterface::Signal>(name+getVectorAsString(i.getRaw()), bits);
+      micro_data_in.push_back(window[i.getRaw()]);
+    }
+    VHDLInterface::MultiStatementProcess* p = parent->createProcess<VHDLInterface::MultiStatementProcess>();
+    VHDLInterface::Variable* outputValueValid = parent->createSignal<VHDLInterface::Signal>(name+"_valid1",1);
+    p->addStatement(new VHDLInterface::AssignmentStatement(outputValueValid, VHDLInterface::ConstantInt::get(0), p));
+    VHDLInterface::MultiStatement* ms = new VHDLInterface::MultiStatement(p);
+    p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(inputValueValid) == VHDLInterface::ConstantInt::get(1), ms));
+    for(std::map<std::vector<int>,VHDLInterface::Variable*>::iterator WI = window.begin(); WI != window.end(); ++WI)
+    {
+      std::vector<int> next = WI->first;
+      if( next[inner_pos] == width-1 )
+      {
+        ms->addStatement(new VHDLInterface::AssignmentStatement(WI->second, rows[next[outer_pos]], p));
+      }
+      else
+      {
+        ++next[inner_pos];
+        ms->addStatement(new VHDLInterface::AssignmentStatement(WI->second, window[next], p));
+      }
+    }
+    //the window is complete once it has been shifted entirely inside of the rows
+    ms->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(row) >= VHDLInterface::ConstantInt::get(height-1) and VHDLInterface::Wrap(col) >= VHDLInterface::ConstantInt::get(width-1),
+                       new VHDLInterface::AssignmentStatement(outputValueValid, VHDLInterface::ConstantInt::get(1), p)
+                     ));
+    ms->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(col) >= VHDLInterface::Wrap(last_col),
+                       (new VHDLInterface::MultiStatement(p))->addStatement(
+                            new VHDLInterface::AssignmentStatement(col, VHDLInterface::ConstantInt::get(0), p)
+                       )->addStatement(
+                            new VHDLInterface::AssignmentStatement(row, VHDLInterface::Wrap(row) + VHDLInterface::ConstantInt::get(1), p)
+                       ),
+                       new VHDLInterface::AssignmentStatement(col, VHDLInterface::Wrap(col) + VHDLInterface::ConstantInt::get(1), p)
+                     ));
+    if( border_mode == BORDER_CLAMP or border_mode == BORDER_MIRROR )
+    {
+      //the position of the window being pushed onto the fifo
+      VHDLInterface::Signal* win_col = parent->createSignal<VHDLInterface::Signal>(name+"_border_col", getSizeInBits(inner_liv));
+      VHDLInterface::Signal* win_row = parent->createSignal<VHDLInterface::Signal>(name+"_border_row", getSizeInBits(outer_liv));
+      VHDLInterface::Signal* last_row = parent->createSignal<VHDLInterface::Signal>(name+"_border_last_row", getSizeInBits(outer_liv));
+      parent->createSynchronousStatement(last_row, VHDLInterface::Wrap(outer_end) + VHDLInterface::ConstantInt::get(height-2));
+      ms->addStatement(new VHDLInterface::AssignmentStatement(win_col, col, p));
+      ms->addStatement(new VHDLInterface::AssignmentStatement(win_row, row, p));
+      //the windows along each edge, with (-1,0) standing for every window
+      //  that is not along an edge of that dimension
+      std::vector<std::pair<int,int> > col_cases, row_cases;
+      for(int k = 0; k < (width-1)/2; ++k)
+        col_cases.push_back(std::pair<int,int>(0, k));
+      for(int k = 0; k < width-1-(width-1)/2; ++k)
+        col_cases.push_back(std::pair<int,int>(1, k));
+      col_cases.push_back(std::pair<int,int>(-1, 0));
+      for(int k = 0; k < (height-1)/2; ++k)
+        row_cases.push_back(std::pair<int,int>(0, k));
+      for(int k = 0; k < height-1-(height-1)/2; ++k)
+        row_cases.push_back(std::pair<int,int>(1, k));
+      row_cases.push_back(std::pair<int,int>(-1, 0));
+      micro_data_in.clear();
+      for(llvm::MultiForVar<int> i = getMultiForVarForWindow(window_dimensions, window_order); !i.done(); ++i)
+      {
+        VHDLInterface::Signal* padded = parent->createSignal<VHDLInterface::Signal>(name+"_padded"+getVectorAsString(i.getRaw()), bits);
+        VHDLInterface::AssignmentStatement* pad_ass = parent->createSynchronousStatement(padded);
+        //corners first, so that they are not taken by either edge alone
+        for(std::vector<std::pair<int,int> >::iterator RCI = row_cases.begin(); RCI != row_cases.end(); ++RCI)
+        {
+          for(std::vector<std::pair<int,int> >::iterator CCI = col_cases.begin(); CCI != col_cases.end(); ++CCI)
+          {
+            if( RCI->first == -1 and CCI->first == -1 )
+              continue;
+            std::vector<int> source = i.getRaw();
+            if( RCI->first != -1 )
+              source[outer_pos] = getBorderSource(source[outer_pos], height, (height-1)/2, RCI->first, RCI->second, border_mode);
+            if( CCI->first != -1 )
+              source[inner_pos] = getBorderSource(source[inner_pos], width, (width-1)/2, CCI->first, CCI->second, border_mode);
+            if( source == i.getRaw() )
+              continue;
+            if( RCI->first == -1 )
+              pad_ass->addCase(window[source], getBorderCondition(win_col, last_col, width, CCI->first, CCI->second));
+            else if( CCI->first == -1 )
+              pad_ass->addCase(window[source], getBorderCondition(win_row, last_row, height, RCI->first, RCI->second));
+            else
+              pad_ass->addCase(window[source], getBorderCondition(win_row, last_row, height, RCI->first, RCI->second) and getBorderCondition(win_col, last_col, width, CCI->first, CCI->second));
+          }
+        }
+        pad_ass->addCase(window[i.getRaw()]);
+        micro_data_in.push_back(padded);
+      }
+    }
+    //push the window onto the fifo
+    MicroFifo mfifo(name+"_micro_fifo");
+    mfifo.mapAddressWidth(3);
+    mfifo.mapAlmostFullCount(2);
+    mfifo.mapAlmostEmptyCount(0);
+    mfifo.mapClk(parent->getStandardPorts().clk);
+    mfifo.mapRst(parent->getStandardPorts().rst);
+    mfifo.mapValidIn(outputValueValid);
+    mfifo.mapFullOut(outputStallIn);
+    mfifo.mapInputAndOutputVector(micro_data_in, outputs[index].data_out, parent);
+    mfifo.mapReadEnableIn(outputs[index].read_enable_in);
+    mfifo.mapEmptyOut(outputs[index].empty_out);
+    mfifo.generateCode(parent);
+  }
 };
 
+//Smart buffers for windows that are taller than a single row will, by
+//  default, read every column of the window again when the window steps.
+//  Once the rows between the lines of the window get large enough to fill a
+//  block ram, the rows are instead read once, in order, and kept in line
+//  buffers.
+static const int LINE_BUFFER_THRESHOLD_BITS = 1024;
+
+//Returns the number of elements each line buffer must hold, or 0 if the
+//  window should not use line buffers.
+int getLineBufferDepth(llvm::Value* stream, llvm::ROCCCLoopInformation &loopInfo, std::map<llvm::Value*,int> window_dimensions, std::vector<llvm::Value*> writtenIndexesUsed, LoopInductionVariableHandler* livHandler, int num_address_channels, int num_data_channels)
+{
+  //only two dimensional windows, read a single element at a time
+  if( writtenIndexesUsed.size() != 2 or loopInfo.indexes.size() != 2 )
+    return 0;
+  if( num_address_channels != 1 or num_data_channels != 1 )
+    return 0;
+  llvm::Value* inner = livHandler->getInnermostLIV();
+  llvm::Value* outer = (writtenIndexesUsed[0] == inner) ? writtenIndexesUsed[1] : writtenIndexesUsed[0];
+  if( window_dimensions.find(inner) == window_dimensions.end() or window_dimensions.find(outer) == window_dimensions.end() )
+    return 0;
+  if( window_dimensions[outer] <= 1 )
+    return 0;
+  //the window has to move across every element of the rows
+  if( loopInfo.inputBufferNumInvalidated[stream] != 1 or getIVStepSize(inner) != 1 or getIVStepSize(outer) != 1 )
+    return 0;
+  if( livHandler->isEndValueInfinity(inner) or livHandler->isEndValueInfinity(outer) )
+    return 0;
+  int row_length = 0;
+  if( llvm::ConstantInt* end = dynamic_cast<llvm::ConstantInt*>(loopInfo.endValues[inner]) )
+    row_length = end->getValue().getSExtValue() + window_dimensions[inner] - 1;
+  else
+    row_length = static_cast<int>(ROCCC::getLoOptimizationValue("LineBufferMaxWidth", 0));
+  if( row_length <= 0 )
+  {
+    LOG_MESSAGE2("VHDL Generation", "Line Buffers", "The rows of " << getValueName(stream) << " are not a constant length; set LineBufferMaxWidth to buffer them in block ram.\n");
+    return 0;
+  }
+  if( row_length < 3 or (window_dimensions[outer] - 1) * row_length * getSizeInBits(stream) < LINE_BUFFER_THRESHOLD_BITS )
+    return 0;
+  return row_length - 1;
+}
+
+//Packed streams are requested in whole words, and the element offset into
+//  the first word and the element count of every request are written, on the
+//  address clock, to a small fifo that the smart buffer reads on its own
+//  clock. The address generator stalls while the fifo is nearly full, as well
+//  as when the stall port is raised. The read enable, empty, and the offset
+//  and count of the fifo's read side are returned through req_read_out,
+//  req_empty_in, req_offset_in, and req_count_in.
+void createWordRequestQueue(VHDLInterface::Entity* parent, llvm::Value* stream, int factor, AddressGenerator* ag, VHDLInterface::Variable* address_rdy_out, VHDLInterface::Variable* address_stall_in, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > address_out, VHDLInterface::Variable* address_clk, VHDLInterface::Variable*& req_read_out, VHDLInterface::Variable*& req_empty_in, VHDLInterface::Variable*& req_offset_in, VHDLInterface::Variable*& req_count_in)
+{
+  std::string name = getValueName(stream);
+  VHDLInterface::Port* rclk = dynamic_cast<VHDLInterface::Port*>(parent->getStandardPorts().clk);
+  VHDLInterface::Port* wclk = dynamic_cast<VHDLInterface::Port*>(address_clk);
+  assert( rclk and wclk and "Request queue clocks must be ports!" );
+  //the address generator writes at most one request a cycle, and only sees
+  //  full the cycle after the fifo raises it
+  VHDLInterface::BRAMFifo* reqDecl = new VHDLInterface::BRAMFifo(64, 32, VHDLInterface::BRAMFifo::getFullFlagLatency() + 1);
+  VHDLInterface::ComponentDefinition* reqDef = reqDecl->getInstantiation(parent);
+  parent->mapPortToSubComponentPort(parent->getStandardPorts().rst, reqDef, reqDecl->getRst());
+  parent->mapPortToSubComponentPort(wclk, reqDef, reqDecl->getWClk());
+  parent->mapPortToSubComponentPort(rclk, reqDef, reqDecl->getRClk());
+  VHDLInterface::Signal* valid = parent->createSignal<VHDLInterface::Signal>(name+"_request_valid", 1);
+  VHDLInterface::Signal* offset = parent->createSignal<VHDLInterface::Signal>(name+"_request_offset", 32);
+  VHDLInterface::Signal* count = parent->createSignal<VHDLInterface::Signal>(name+"_request_count", 32);
+  VHDLInterface::Signal* stall = parent->createSignal<VHDLInterface::Signal>(name+"_request_stall", 1);
+  VHDLInterface::Variable* data_in = parent->getVariableMappedTo(reqDef, reqDecl->getDataIn());
+  parent->createSynchronousStatement(parent->getVariableMappedTo(reqDef, reqDecl->getWriteEnIn()), valid);
+  parent->createSynchronousStatement(VHDLInterface::BitRange::get(data_in, 63, 32), offset);
+  parent->createSynchronousStatement(VHDLInterface::BitRange::get(data_in, 31, 0), count);
+  VHDLInterface::AssignmentStatement* stall_ass = parent->createSynchronousStatement(stall);
+  stall_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(address_stall_in) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(parent->getVariableMappedTo(reqDef, reqDecl->getFullOut())) == VHDLInterface::ConstantInt::get(1));
+  stall_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  ag->initializeVHDLInterface(address_rdy_out, stall, address_out);
+  ag->setWordRequests(factor, valid, offset, count);
+  VHDLInterface::Variable* data_out = parent->getVariableMappedTo(reqDef, reqDecl->getDataOut());
+  req_read_out = parent->getVariableMappedTo(reqDef, reqDecl->getReadEnIn());
+  req_empty_in = parent->getVariableMappedTo(reqDef, reqDecl->getEmptyOut());
+  req_offset_in = VHDLInterface::BitRange::get(data_out, 63, 32);
+  req_count_in = VHDLInterface::BitRange::get(data_out, 31, 0);
+}
+
+//Each word of a packed stream holds factor elements, and each request covers
+//  whole words, from the word holding its first element to the word holding
+//  its last. The request queue says which elements of those words were asked
+//  for; they are handed to the smart buffer one element per read, as if they
+//  came from a fifo a single element wide, and the elements of the first and
+//  last words outside the request are skipped. The next word is read while
+//  the last element of the current word is handed out.
+//  The narrow read enable, empty, and data the smart buffer should use are
+//  returned through read_in, empty_out, and data_out.
+void createStreamUnpacker(VHDLInterface::Entity* parent, llvm::Value* stream, int factor, VHDLInterface::Variable* word_read_out, VHDLInterface::Variable* word_empty_in, std::vector<VHDLInterface::Variable*> word_data_in, VHDLInterface::Variable* req_read_out, VHDLInterface::Variable* req_empty_in, VHDLInterface::Variable* req_offset_in, VHDLInterface::Variable* req_count_in, VHDLInterface::Variable*& read_in, VHDLInterface::Variable*& empty_out, std::vector<VHDLInterface::Variable*>& data_out)
+{
+  assert( factor > 1 and (factor & (factor - 1)) == 0 and "Packed words must hold a power of two elements!" );
+  assert( static_cast<int>(word_data_in.size()) == factor and "Packed streams must have a single data channel!" );
+  std::string name = getValueName(stream);
+  int bits = getSizeInBits(stream);
+  int lane_bits = 1;
+  while( (1 << lane_bits) < factor )
+    ++lane_bits;
+  read_in = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_read", 1);
+  empty_out = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_empty", 1);
+  data_out.clear();
+  data_out.push_back(parent->createSignal<VHDLInterface::Signal>(name+"_unpack_data0", bits));
+  //the word being handed out, which of its elements is next, and which
+  //  element of the next word to arrive is the first one asked for
+  std::vector<VHDLInterface::Variable*> word;
+  for(unsigned w = 0; w < word_data_in.size(); ++w)
+  {
+    std::stringstream ss;
+    ss << name << "_unpack_word" << w;
+    word.push_back(parent->createSignal<VHDLInterface::Signal>(ss.str(), bits));
+  }
+  VHDLInterface::Signal* lane = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_lane", lane_bits);
+  VHDLInterface::Signal* start = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_start", lane_bits);
+  VHDLInterface::Signal* has_word = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_has_word", 1);
+  VHDLInterface::Signal* arriving = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_arriving", 1);
+  VHDLInterface::Signal* word_read = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_word_read", 1);
+  //the elements of the current request still to be handed out, and the
+  //  elements from the start of its first word still to be read
+  VHDLInterface::Signal* left = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_left", 32);
+  VHDLInterface::Signal* fetch_left = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_fetch_left", 32);
+  VHDLInterface::Signal* req_read = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_request_read", 1);
+  VHDLInterface::Signal* req_arriving = parent->createSignal<VHDLInterface::Signal>(name+"_unpack_request_arriving", 1);
+  //read the next request once every element of the current one is handed out
+  parent->createSynchronousStatement(req_read_out, req_read);
+  VHDLInterface::AssignmentStatement* req_ass = parent->createSynchronousStatement(req_read);
+  req_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(req_empty_in) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(req_arriving) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(0));
+  req_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  ShiftBuffer req_sb(name+"_unpackRequestShiftBuffer");
+  req_sb.mapDataWidth(1);
+  req_sb.mapShiftDepth(1);
+  req_sb.mapRst(parent->getStandardPorts().rst);
+  req_sb.mapClk(parent->getStandardPorts().clk);
+  req_sb.mapDataIn(req_read);
+  req_sb.mapDataOut(req_arriving);
+  req_sb.generateCode(parent);
+  //read a word of the current request when there is no word, or the last
+  //  element of the current one is being read
+  parent->createSynchronousStatement(word_read_out, word_read);
+  VHDLInterface::AssignmentStatement* read_ass = parent->createSynchronousStatement(word_read);
+  read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(word_empty_in) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(fetch_left) == VHDLInterface::ConstantInt::get(0));
+  read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(has_word) == VHDLInterface::ConstantInt::get(0));
+  read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(read_in) == VHDLInterface::ConstantInt::get(1) and (VHDLInterface::Wrap(lane) == VHDLInterface::ConstantInt::get(factor-1) or VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(1)));
+  read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  ShiftBuffer sb(name+"_unpackShiftBuffer");
+  sb.mapDataWidth(1);
+  sb.mapShiftDepth(1);
+  sb.mapRst(parent->getStandardPorts().rst);
+  sb.mapClk(parent->getStandardPorts().clk);
+  sb.mapDataIn(word_read);
+  sb.mapDataOut(arriving);
+  sb.generateCode(parent);
+  //the first element of an arriving word can be read the cycle it arrives
+  VHDLInterface::AssignmentStatement* empty_ass = parent->createSynchronousStatement(empty_out);
+  empty_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(has_word) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(0));
+  empty_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  VHDLInterface::MultiStatementProcess* p = parent->createProcess<VHDLInterface::MultiStatementProcess>();
+  //a new request starts at its offset into its first word
+  VHDLInterface::MultiStatement* request = new VHDLInterface::MultiStatement(p);
+  request->addStatement(new VHDLInterface::AssignmentStatement(left, req_count_in, p));
+  request->addStatement(new VHDLInterface::AssignmentStatement(fetch_left, VHDLInterface::Wrap(req_offset_in) + VHDLInterface::Wrap(req_count_in), p));
+  request->addStatement(new VHDLInterface::AssignmentStatement(start, req_offset_in, p));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(req_arriving) == VHDLInterface::ConstantInt::get(1), request));
+  //every word read takes a word's worth of elements off of the request
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(word_read) == VHDLInterface::ConstantInt::get(1),
+                    new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(fetch_left) > VHDLInterface::ConstantInt::get(factor),
+                      new VHDLInterface::AssignmentStatement(fetch_left, VHDLInterface::Wrap(fetch_left) - VHDLInterface::ConstantInt::get(factor), p),
+                      new VHDLInterface::AssignmentStatement(fetch_left, VHDLInterface::ConstantInt::get(0), p)
+                    )
+                 ));
+  //a word arriving is stored, and its first element asked for is handed out
+  //  if it is read
+  VHDLInterface::MultiStatement* arrive = new VHDLInterface::MultiStatement(p);
+  for(unsigned w = 0; w < word.size(); ++w)
+  {
+    arrive->addStatement(new VHDLInterface::AssignmentStatement(word[w], word_data_in[w], p));
+  }
+  arrive->addStatement(new VHDLInterface::AssignmentStatement(has_word, VHDLInterface::ConstantInt::get(1), p));
+  VHDLInterface::MultiStatement* first = new VHDLInterface::MultiStatement(p);
+  for(int e = 0; e < factor; ++e)
+  {
+    first->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(start) == VHDLInterface::ConstantInt::get(e), new VHDLInterface::AssignmentStatement(data_out[0], word_data_in[e], p)));
+  }
+  first->addStatement(new VHDLInterface::AssignmentStatement(left, VHDLInterface::Wrap(left) - VHDLInterface::ConstantInt::get(1), p));
+  first->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(start) == VHDLInterface::ConstantInt::get(factor-1) or VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(1),
+                        new VHDLInterface::AssignmentStatement(has_word, VHDLInterface::ConstantInt::get(0), p),
+                        new VHDLInterface::AssignmentStatement(lane, VHDLInterface::Wrap(start) + VHDLInterface::ConstantInt::get(1), p)
+                      ));
+  arrive->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(read_in) == VHDLInterface::ConstantInt::get(1), first, new VHDLInterface::AssignmentStatement(lane, start, p)));
+  arrive->addStatement(new VHDLInterface::AssignmentStatement(start, VHDLInterface::ConstantInt::get(0), p));
+  //otherwise, hand out the next element of the stored word
+  VHDLInterface::MultiStatement* next = new VHDLInterface::MultiStatement(p);
+  for(int e = 0; e < factor; ++e)
+  {
+    next->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(lane) == VHDLInterface::ConstantInt::get(e), new VHDLInterface::AssignmentStatement(data_out[0], word[e], p)));
+  }
+  next->addStatement(new VHDLInterface::AssignmentStatement(left, VHDLInterface::Wrap(left) - VHDLInterface::ConstantInt::get(1), p));
+  next->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(lane) == VHDLInterface::ConstantInt::get(factor-1) or VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(1),
+                       (new VHDLInterface::MultiStatement(p))->addStatement(
+                            new VHDLInterface::AssignmentStatement(lane, VHDLInterface::ConstantInt::get(0), p)
+                       )->addStatement(
+                            new VHDLInterface::AssignmentStatement(has_word, VHDLInterface::ConstantInt::get(0), p)
+                       ),
+                       new VHDLInterface::AssignmentStatement(lane, VHDLInterface::Wrap(lane) + VHDLInterface::ConstantInt::get(1), p)
+                     ));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1),
+                    arrive,
+                    new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(read_in) == VHDLInterface::ConstantInt::get(1), next)
+                 ));
+}
+
+//Returns how the smart buffer of the given stream should pad the borders of
+//  its window, or BORDER_NONE if the stream is already padded in memory.
+int getBorderMode(llvm::Value* stream)
+{
+  if( !ROCCC::isLoOptimizationSelected("BoundaryPadding") )
+    return BORDER_NONE;
+  int mode = static_cast<int>(ROCCC::getLoOptimizationValue("BoundaryPadding", BORDER_ZERO));
+  if( mode == BORDER_WRAP )
+  {
+    LOG_MESSAGE2("VHDL Generation", "Boundary Padding", "Wrapping the borders of " << getValueName(stream) << " needs the far edge of the image before it has been read; " << getValueName(stream) << " must be padded in memory.\n");
+    return BORDER_NONE;
+  }
+  if( mode != BORDER_ZERO and mode != BORDER_CLAMP and mode != BORDER_MIRROR )
+  {
+    INTERNAL_WARNING("Unknown BoundaryPadding mode " << mode << "; " << getValueName(stream) << " must be padded in memory.\n");
+    return BORDER_NONE;
+  }
+  return mode;
+}
+
+//When the smart buffer pads the borders of a stream, the fifo only holds the
+//  image itself, row after row. The rows are handed to the smart buffer as if
+//  they had been padded in memory: (width-1)/2 elements before each row and
+//  the rest of the width-1 elements after it, and (height-1)/2 rows before
+//  the image and the rest of the height-1 rows after it. The padding is read
+//  without touching the fifo, and is always zero; the smart buffer replaces
+//  it in windows that need something else.
+//  The read enable, empty, and data the smart buffer should use are returned
+//  through read_in, empty_out, and data_out.
+void createBorderInserter(VHDLInterface::Entity* parent, llvm::Value* stream, llvm::Value* inner_liv, llvm::Value* outer_liv, VHDLInterface::Value* inner_end, VHDLInterface::Value* outer_end, int width, int height, VHDLInterface::Variable* fifo_read_out, VHDLInterface::Variable* fifo_empty_in, VHDLInterface::Variable* fifo_data_in, VHDLInterface::Variable*& read_in, VHDLInterface::Variable*& empty_out, VHDLInterface::Variable*& data_out)
+{
+  std::string name = getValueName(stream);
+  int left = (width-1)/2;
+  int top = (height-1)/2;
+  read_in = parent->createSignal<VHDLInterface::Signal>(name+"_pad_read", 1);
+  empty_out = parent->createSignal<VHDLInterface::Signal>(name+"_pad_empty", 1);
+  data_out = parent->createSignal<VHDLInterface::Signal>(name+"_pad_data", getSizeInBits(stream));
+  //the position of the next element in the padded rows
+  VHDLInterface::Signal* col = parent->createSignal<VHDLInterface::Signal>(name+"_pad_col", getSizeInBits(inner_liv));
+  VHDLInterface::Signal* row = parent->createSignal<VHDLInterface::Signal>(name+"_pad_row", getSizeInBits(outer_liv));
+  VHDLInterface::Signal* col_end = parent->createSignal<VHDLInterface::Signal>(name+"_pad_col_end", getSizeInBits(inner_liv));
+  VHDLInterface::Signal* row_end = parent->createSignal<VHDLInterface::Signal>(name+"_pad_row_end", getSizeInBits(outer_liv));
+  VHDLInterface::Signal* last_col = parent->createSignal<VHDLInterface::Signal>(name+"_pad_last_col", getSizeInBits(inner_liv));
+  VHDLInterface::Signal* last_row = parent->createSignal<VHDLInterface::Signal>(name+"_pad_last_row", getSizeInBits(outer_liv));
+  parent->createSynchronousStatement(col_end, VHDLInterface::Wrap(inner_end) + VHDLInterface::ConstantInt::get(left));
+  parent->createSynchronousStatement(row_end, VHDLInterface::Wrap(outer_end) + VHDLInterface::ConstantInt::get(top));
+  parent->createSynchronousStatement(last_col, VHDLInterface::Wrap(inner_end) + VHDLInterface::ConstantInt::get(width-2));
+  parent->createSynchronousStatement(last_row, VHDLInterface::Wrap(outer_end) + VHDLInterface::ConstantInt::get(height-2));
+  VHDLInterface::Signal* is_pad = parent->createSignal<VHDLInterface::Signal>(name+"_pad_is_pad", 1);
+  VHDLInterface::Signal* pad_read = parent->createSignal<VHDLInterface::Signal>(name+"_pad_was_pad", 1);
+  VHDLInterface::Signal* done = parent->createSignal<VHDLInterface::Signal>(name+"_pad_done", 1);
+  VHDLInterface::AssignmentStatement* pad_ass = parent->createSynchronousStatement(is_pad);
+  if( top > 0 )
+    pad_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(row) < VHDLInterface::ConstantInt::get(top));
+  pad_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(row) >= VHDLInterface::Wrap(row_end));
+  if( left > 0 )
+    pad_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(col) < VHDLInterface::ConstantInt::get(left));
+  pad_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(col) >= VHDLInterface::Wrap(col_end));
+  pad_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //padding is always there to be read, and the image comes from the fifo
+  VHDLInterface::AssignmentStatement* empty_ass = parent->createSynchronousStatement(empty_out);
+  empty_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(done) == VHDLInterface::ConstantInt::get(1));
+  empty_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(is_pad) == VHDLInterface::ConstantInt::get(1));
+  empty_ass->addCase(fifo_empty_in);
+  VHDLInterface::AssignmentStatement* read_ass = parent->createSynchronousStatement(fifo_read_out);
+  read_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(read_in) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(is_pad) == VHDLInterface::ConstantInt::get(0));
+  read_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  //the data arrives the cycle after it is read, like the data of the fifo
+  VHDLInterface::AssignmentStatement* data_ass = parent->createSynchronousStatement(data_out);
+  data_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(pad_read) == VHDLInterface::ConstantInt::get(1));
+  data_ass->addCase(fifo_data_in);
+  VHDLInterface::MultiStatementProcess* p = parent->createProcess<VHDLInterface::MultiStatementProcess>();
+  VHDLInterface::MultiStatement* advance = new VHDLInterface::MultiStatement(p);
+  advance->addStatement(new VHDLInterface::AssignmentStatement(pad_read, is_pad, p));
+  advance->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(col) == VHDLInterface::Wrap(last_col),
+                          (new VHDLInterface::MultiStatement(p))->addStatement(
+                               new VHDLInterface::AssignmentStatement(col, VHDLInterface::ConstantInt::get(0), p)
+                          )->addStatement(
+                               new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(row) == VHDLInterface::Wrap(last_row),
+                                 new VHDLInterface::AssignmentStatement(done, VHDLInterface::ConstantInt::get(1), p),
+                                 new VHDLInterface::AssignmentStatement(row, VHDLInterface::Wrap(row) + VHDLInterface::ConstantInt::get(1), p)
+                               )
+                          ),
+                          new VHDLInterface::AssignmentStatement(col, VHDLInterface::Wrap(col) + VHDLInterface::ConstantInt::get(1), p)
+                        ));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(read_in) == VHDLInterface::ConstantInt::get(1), advance));
+}
+
 InputSmartBuffer::AddressVariables::AddressVariables() : address_rdy_out(NULL), address_stall_in(NULL), clk(NULL)
 {
 }
 InputSmartBuffer::InputSmartBuffer() : FifoInterfaceBlock<llvm::Value*,int>()
 {
 }
+void InputSmartBuffer::setPackingFactor(llvm::Value* stream, int factor)
+{
+  packingFactors[stream] = factor;
+}
 void InputSmartBuffer::setAddressVariables(llvm::Value* stream, VHDLInterface::Variable* rdy, VHDLInterface::Variable* stall, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > base_count_pair, VHDLInterface::Variable* clk)
 {
   addressVariables[stream].address_rdy_out = rdy;
@@ -477,17 +1001,28 @@ void InputSmartBuffer::generateVHDL(VHDLInterface::Entity* liv, llvm::ROCCCLoopI
     address_livHandler.setEndValues(loopInfo.endValues);
     InputSmartBufferImpl* isb = new InputSmartBufferImpl(*II);
     inputBuffers.push_back(isb);
-    isb->initializeInputInterfacePorts(*II,
-                         this->getInputReadEnableOut(*II),
-                         this->getInputEmptyIn(*II),
-                         this->getInputDataIn(*II)
-                                     );
+    VHDLInterface::Variable* fifo_read = this->getInputReadEnableOut(*II);
+    VHDLInterface::Variable* fifo_empty = this->getInputEmptyIn(*II);
+    std::vector<VHDLInterface::Variable*> fifo_data = this->getInputDataIn(*II);
     AddressGenerator* ag = new InputAddressGenerator(*II);
-    ag->initializeVHDLInterface(
+    if( packingFactors.find(*II) != packingFactors.end() and packingFactors[*II] > 1 )
+    {
+      VHDLInterface::Variable* req_read = NULL;
+      VHDLInterface::Variable* req_empty = NULL;
+      VHDLInterface::Variable* req_offset = NULL;
+      VHDLInterface::Variable* req_count = NULL;
+      createWordRequestQueue(liv, *II, packingFactors[*II], ag, addressVariables[*II].address_rdy_out, addressVariables[*II].address_stall_in, addressVariables[*II].address_out, addressVariables[*II].clk, req_read, req_empty, req_offset, req_count);
+      createStreamUnpacker(liv, *II, packingFactors[*II], this->getInputReadEnableOut(*II), this->getInputEmptyIn(*II), this->getInputDataIn(*II), req_read, req_empty, req_offset, req_count, fifo_read, fifo_empty, fifo_data);
+      LOG_MESSAGE2("VHDL Generation", "Stream Packing", getValueName(*II) << " is read in aligned words of " << packingFactors[*II] << " elements; the elements each request asks for are unpacked before the smart buffer, and the rest are skipped.\n");
+    }
+    else
+    {
+      ag->initializeVHDLInterface(
                         addressVariables[*II].address_rdy_out,
                         addressVariables[*II].address_stall_in,
                         addressVariables[*II].address_out
                                      );
+    }
     std::vector<llvm::Value*> indexes = loopInfo.inputBufferLoopIndexes[*II];
     for(std::vector<llvm::Value*>::iterator LIVI = loopInfo.indexes.begin(); LIVI != loopInfo.indexes.end(); ++LIVI)
     {
@@ -569,12 +1104,61 @@ void InputSmartBuffer::generateVHDL(VHDLInterface::Entity* liv, llvm::ROCCCLoopI
     {
       step_dimensions[livHandler.getInnermostLIV()] = loopInfo.inputBufferNumInvalidated[*II];
     }
-    BufferSpaceAccesser window_accesser = getWindowBufferSpaceAccessor(window_dimensions, std::vector<llvm::Value*>(indexes.rbegin(),indexes.rend()), writtenIndexesUsed, addressVariables[*II].address_out.size());
-    BufferSpaceAccesser step_accesser = getStepBufferSpaceAccessor(window_dimensions, std::vector<llvm::Value*>(indexes.rbegin(),indexes.rend()), writtenIndexesUsed, addressVariables[*II].address_out.size());
+    //the space the address generator walks through; with line buffers, the
+    //  rows are read once each, so the window is a single row tall and the
+    //  outer loop runs height-1 more times to read the rows below the last window
+    std::map<llvm::Value*,int> address_dimensions = window_dimensions;
+    int lineBufferDepth = getLineBufferDepth(*II, loopInfo, window_dimensions, writtenIndexesUsed, &livHandler, addressVariables[*II].address_out.size(), fifo_data.size());
+    llvm::Value* inner = livHandler.getInnermostLIV();
+    llvm::Value* outer = NULL;
+    int borderMode = BORDER_NONE;
+    if( lineBufferDepth > 0 )
+    {
+      outer = (writtenIndexesUsed.front() == inner) ? writtenIndexesUsed.back() : writtenIndexesUsed.front();
+      borderMode = getBorderMode(*II);
+    }
+    else if( ROCCC::isLoOptimizationSelected("BoundaryPadding") )
+    {
+      LOG_MESSAGE2("VHDL Generation", "Boundary Padding", "The borders of " << getValueName(*II) << " can only be padded by the smart buffer when its window is kept in line buffers; " << getValueName(*II) << " must be padded in memory.\n");
+    }
+    if( borderMode != BORDER_NONE )
+    {
+      //only the image itself is read, one element at a time
+      address_dimensions[inner] = 1;
+      address_dimensions[outer] = 1;
+      VHDLInterface::Variable* pad_read = NULL;
+      VHDLInterface::Variable* pad_empty = NULL;
+      VHDLInterface::Variable* pad_data = NULL;
+      createBorderInserter(liv, *II, inner, outer, livHandler.getEndValueVHDLValue(inner), livHandler.getEndValueVHDLValue(outer), window_dimensions[inner], window_dimensions[outer], fifo_read, fifo_empty, fifo_data.at(0), pad_read, pad_empty, pad_data);
+      fifo_read = pad_read;
+      fifo_empty = pad_empty;
+      fifo_data = std::vector<VHDLInterface::Variable*>(1, pad_data);
+      LOG_MESSAGE2("VHDL Generation", "Boundary Padding", "The borders of " << getValueName(*II) << " are padded by the smart buffer; the " << window_dimensions[inner]-1 << " columns and " << window_dimensions[outer]-1 << " rows of padding around the image are not read from memory.\n");
+    }
+    else if( lineBufferDepth > 0 )
+    {
+      address_dimensions[outer] = 1;
+      address_livHandler.setVHDLInterface(outer, address_livHandler.getLIVVHDLValue(outer), VHDLInterface::Wrap(address_livHandler.getEndValueVHDLValue(outer)) + VHDLInterface::ConstantInt::get(window_dimensions[outer]-1));
+    }
+    isb->initializeInputInterfacePorts(*II,
+                         fifo_read,
+                         fifo_empty,
+                         fifo_data
+                                     );
+    BufferSpaceAccesser window_accesser = getWindowBufferSpaceAccessor(address_dimensions, std::vector<llvm::Value*>(indexes.rbegin(),indexes.rend()), writtenIndexesUsed, addressVariables[*II].address_out.size());
+    BufferSpaceAccesser step_accesser = getStepBufferSpaceAccessor(address_dimensions, std::vector<llvm::Value*>(indexes.rbegin(),indexes.rend()), writtenIndexesUsed, addressVariables[*II].address_out.size());
     //move the step space over a number of elements equal to the size of the buffer space along the innermost written LIV
     step_accesser.getBufferSpace()->getTopLeft()->setAbsolute(writtenIndexesUsed.back(), 
                                                   step_accesser.getBufferSpace()->getTopLeft()->getAbsolute(writtenIndexesUsed.back()) + window_accesser.getBufferSpace()->getBottomRight()->getAbsolute(writtenIndexesUsed.back()) ); 
-    isb->createVHDL(liv, &livHandler, window_accesser, step_accesser, writtenIndexesUsed);
+    if( lineBufferDepth > 0 )
+    {
+      isb->createLineBufferVHDL(liv, window_dimensions, std::vector<llvm::Value*>(indexes.rbegin(),indexes.rend()), inner, outer, livHandler.getEndValueVHDLValue(inner), livHandler.getEndValueVHDLValue(outer), lineBufferDepth, borderMode);
+      LOG_MESSAGE2("VHDL Generation", "Line Buffers", "The " << window_dimensions[outer]-1 << " rows between the lines of the window of " << getValueName(*II) << " are kept in block ram line buffers of " << lineBufferDepth << " elements; each element is read once.\n");
+    }
+    else
+    {
+      isb->createVHDL(liv, &livHandler, window_accesser, step_accesser, writtenIndexesUsed);
+    }
     ag->createVHDL(liv, &address_livHandler, window_accesser, step_accesser, addressVariables[*II].clk);
   }
   {//assign to the empty port
@@ -30,6 +30,8 @@ are ready.
 #include "rocccLibrary/FunctionType.h"
 #include "rocccLibrary/FileInfo.h"
 #include "rocccLibrary/DatabaseHelpers.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/FifoSizing.h"
 #include "rocccLibrary/VHDLComponents/BRAMFifo.h"
 #include "rocccLibrary/VHDLComponents/MicroFifo.h"
 #include "rocccLibrary/VHDLComponents/OutputSmartBuffer.h"
@@ -58,7 +60,11 @@ llvm::Value* getLastCopiedValue(llvm::Value* v)
 //DEFINED IN InputController.cpp - @TODO - lump these together
 int getNumDataChannels(llvm::Value* v);
 int getNumAddressChannels(llvm::Value* v);
+int getStreamPackingFactor(llvm::Value* v);
 int getNumOutstandingMemoryRequests(llvm::Value* v);
+int getIssueInterval(DFFunction* df);
+int getStreamBurstLength(llvm::Value* v);
+int getStreamFifoDepth(llvm::Value* v, const ROCCC::FifoRates& rates, int& full_slack);
 
 OutputControllerPass::OutputControllerPass() : FunctionPass((intptr_t)&ID)//, stall_internal(NULL), outputEntity(NULL)
 {
@@ -133,10 +139,18 @@ bool OutputControllerPass::runOnFunction(Function& f)
   {
     //create the bram fifo that will be fed from the datapath
     //and then connect it to the input ports of the output smart buffer
+    //  The datapath writes it once per issue, and its full flag stalls the
+    //  datapath through the inputController and the registered stall of the
+    //  pipeline. A stalled pipeline holds its values, so only the cycles of
+    //  that stall path are written after full; the output smart buffer
+    //  drains it a word a cycle.
+    const int DATAPATH_STALL_LATENCY = 5;
+    ROCCC::FifoRates rates(1, 0, 0, getIssueInterval(df), 0, 1, DATAPATH_STALL_LATENCY);
     MicroFifo mf("outputController_datapath_micro_fifo");
-    mf.mapAddressWidth(3);
-    mf.mapAlmostFullCount(5);
+    mf.mapAddressWidth(ROCCC::getFifoAddressWidth(ROCCC::getFifoDepth(rates)));
+    mf.mapAlmostFullCount(ROCCC::getFifoFullSlack(rates));
     mf.mapAlmostEmptyCount(0);
+    LOG_MESSAGE2("VHDL Generation", "Stream Fifo Sizing", "The datapath output fifo holds " << mf.getNumElements() << " words, and stalls the datapath with " << ROCCC::getFifoFullSlack(rates) << " words free.\n");
     mf.mapClk(outputEntity->getStandardPorts().clk);
     mf.mapRst(outputEntity->getStandardPorts().rst);
     mf.mapValidIn(outputEntity->getStandardPorts().inputReady);
@@ -169,7 +183,22 @@ bool OutputControllerPass::runOnFunction(Function& f)
     stream.stream->readableName = getValueName(*BI);
     stream.stream->value = *BI;
     //create the BRAM fifo
-    VHDLInterface::BRAMFifo* bramDecl = new VHDLInterface::BRAMFifo(getSizeInBits(*BI) * getNumDataChannels(*BI), 512);
+    //  each fifo word holds a group of data channels for every packed element,
+    //  and packed words also hold an enable for each of their elements
+    int numDataChannels = getNumDataChannels(*BI) * getStreamPackingFactor(*BI);
+    int enableBits = (getStreamPackingFactor(*BI) > 1) ? numDataChannels : 0;
+    //the datapath fills the fifo no faster than it issues, through the whole
+    //  pipeline, and stops the cycle it sees full; memory drains it a word a
+    //  cycle, in bursts that are as long as the write combiner's when writes
+    //  are combined
+    int burstLength = getStreamBurstLength(*BI);
+    if( ROCCC::isLoOptimizationSelected("OutputWriteCombining") )
+      burstLength = std::max(burstLength, static_cast<int>(ROCCC::getLoOptimizationValue("OutputWriteCombining", burstLength)));
+    int burstWords = (burstLength + numDataChannels - 1) / numDataChannels;
+    int fullSlack = 0;
+    ROCCC::FifoRates rates(burstWords, 0, df->getDelay(), getIssueInterval(df), 0, 1, VHDLInterface::BRAMFifo::getFullFlagLatency());
+    int fifoDepth = getStreamFifoDepth(*BI, rates, fullSlack);
+    VHDLInterface::BRAMFifo* bramDecl = new VHDLInterface::BRAMFifo(getSizeInBits(*BI) * numDataChannels + enableBits, fifoDepth, fullSlack);
     ComponentDefinition* bramDef = bramDecl->getInstantiation(outputEntity);
     outputEntity->mapPortToSubComponentPort(outputEntity->getStandardPorts().rst, bramDef, bramDecl->getRst());
     //connect the reading side of the fifo to the outside
@@ -201,7 +230,7 @@ bool OutputControllerPass::runOnFunction(Function& f)
     }
     //base this off of number of incoming data channels?
     std::vector<VHDLInterface::Variable*> dat;
-    for(int count = 0; count < getNumDataChannels(*BI); ++count)
+    for(int count = 0; count < numDataChannels; ++count)
     {
       //map the fifo data in
       VHDLInterface::Variable* val = outputEntity->getVariableMappedTo(bramDef, bramDecl->getDataIn());
@@ -216,11 +245,25 @@ bool OutputControllerPass::runOnFunction(Function& f)
       outputEntity->createSynchronousStatement(channel, val);
       stream.stream->data_channels.push_back(channel);
     }
+    //the enables sit above the data, and are handed to the smart buffer after it
+    if( enableBits > 0 )
+    {
+      int enableBase = getSizeInBits(*BI) * numDataChannels;
+      for(int count = 0; count < enableBits; ++count)
+      {
+        VHDLInterface::Variable* val = outputEntity->getVariableMappedTo(bramDef, bramDecl->getDataIn());
+        dat.push_back(VHDLInterface::BitRange::get(val, enableBase + count, enableBase + count));
+      }
+      VHDLInterface::Port* enable = outputEntity->addPort(getValueName(*BI)+"_element_enable", enableBits, VHDLInterface::Port::OUTPUT);
+      outputEntity->createSynchronousStatement(enable, VHDLInterface::BitRange::get(outputEntity->getVariableMappedTo(bramDef, bramDecl->getDataOut()), enableBase + enableBits - 1, enableBase));
+      stream.stream->element_enable = enable;
+    }
     osb.initializeOutputInterfacePorts(*BI,
                            readEnable,
                            inputEmptyIn,
                            dat
                                      );
+    osb.setPackingFactor(*BI, getStreamPackingFactor(*BI));
     //also connect the address ports to the outside
     stream.stream->address_stall = outputEntity->addPort(getValueName(*BI)+"_address_stall", 1, VHDLInterface::Port::INPUT);
     stream.stream->address_rdy = outputEntity->addPort(getValueName(*BI)+"_address_rdy", 1, VHDLInterface::Port::OUTPUT);
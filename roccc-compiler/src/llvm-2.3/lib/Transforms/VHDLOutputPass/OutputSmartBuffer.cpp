@@ -16,6 +16,8 @@
 #include "rocccLibrary/VHDLComponents/AddressGenerator.h"
 
 #include "rocccLibrary/InternalWarning.h"
+#include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
 
 //FIXME: From InputSmartBuffer.cpp - organize!
 //helper function to get a vector's worth of values from a map
@@ -464,12 +466,163 @@ public:
   }
 };
 
+//DEFINED IN InputSmartBuffer.cpp
+void createWordRequestQueue(VHDLInterface::Entity* parent, llvm::Value* stream, int factor, AddressGenerator* ag, VHDLInterface::Variable* address_rdy_out, VHDLInterface::Variable* address_stall_in, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > address_out, VHDLInterface::Variable* address_clk, VHDLInterface::Variable*& req_read_out, VHDLInterface::Variable*& req_empty_in, VHDLInterface::Variable*& req_offset_in, VHDLInterface::Variable*& req_count_in);
+
+//Each word of a packed stream holds factor elements, followed by an enable
+//  for each of them, and each request covers whole words, from the word
+//  holding its first element to the word holding its last. The elements the
+//  smart buffer hands out are collected into the words of the request at
+//  their offset, and a word is pushed onto a small fifo once its last element
+//  has arrived, or once the last element of the request has; only the
+//  enables of the elements that arrived are set, so memory outside of the
+//  request is left alone.
+//  The narrow read enable, empty, and data the smart buffer should use are
+//  returned through read_out, empty_in, and data_in; idle_out is high once
+//  every element has been pushed and read.
+void createStreamPacker(VHDLInterface::Entity* parent, llvm::Value* stream, int factor, VHDLInterface::Variable* word_read_in, VHDLInterface::Variable* word_empty_out, std::vector<VHDLInterface::Variable*> word_data_out, VHDLInterface::Variable* req_read_out, VHDLInterface::Variable* req_empty_in, VHDLInterface::Variable* req_offset_in, VHDLInterface::Variable* req_count_in, VHDLInterface::Variable*& read_out, VHDLInterface::Variable*& empty_in, std::vector<VHDLInterface::Variable*>& data_in, VHDLInterface::Variable*& idle_out)
+{
+  assert( factor > 1 and (factor & (factor - 1)) == 0 and "Packed words must hold a power of two elements!" );
+  assert( static_cast<int>(word_data_out.size()) == 2 * factor and "Packed streams must have a single data channel, and an enable for each element!" );
+  std::string name = getValueName(stream);
+  int bits = getSizeInBits(stream);
+  int lane_bits = 1;
+  while( (1 << lane_bits) < factor )
+    ++lane_bits;
+  read_out = parent->createSignal<VHDLInterface::Signal>(name+"_pack_read", 1);
+  empty_in = parent->createSignal<VHDLInterface::Signal>(name+"_pack_empty", 1);
+  data_in.clear();
+  data_in.push_back(parent->createSignal<VHDLInterface::Signal>(name+"_pack_data0", bits));
+  //the word being collected, which of its elements have arrived, and where
+  //  the next element goes
+  std::vector<VHDLInterface::Variable*> word;
+  std::vector<VHDLInterface::Variable*> enable;
+  for(int e = 0; e < factor; ++e)
+  {
+    std::stringstream ss;
+    ss << name << "_pack_word" << e;
+    word.push_back(parent->createSignal<VHDLInterface::Signal>(ss.str(), bits));
+    std::stringstream ens;
+    ens << name << "_pack_enable" << e;
+    enable.push_back(parent->createSignal<VHDLInterface::Signal>(ens.str(), 1));
+  }
+  VHDLInterface::Signal* lane = parent->createSignal<VHDLInterface::Signal>(name+"_pack_lane", lane_bits);
+  VHDLInterface::Signal* arriving = parent->createSignal<VHDLInterface::Signal>(name+"_pack_arriving", 1);
+  VHDLInterface::Signal* word_valid = parent->createSignal<VHDLInterface::Signal>(name+"_pack_word_valid", 1);
+  VHDLInterface::Signal* word_full = parent->createSignal<VHDLInterface::Signal>(name+"_pack_word_full", 1);
+  //the elements of the current request that have not been read yet
+  VHDLInterface::Signal* left = parent->createSignal<VHDLInterface::Signal>(name+"_pack_left", 32);
+  VHDLInterface::Signal* req_read = parent->createSignal<VHDLInterface::Signal>(name+"_pack_request_read", 1);
+  VHDLInterface::Signal* req_arriving = parent->createSignal<VHDLInterface::Signal>(name+"_pack_request_arriving", 1);
+  idle_out = parent->createSignal<VHDLInterface::Signal>(name+"_pack_idle", 1);
+  //read the next request once every element of the current one is collected
+  parent->createSynchronousStatement(req_read_out, req_read);
+  VHDLInterface::AssignmentStatement* req_ass = parent->createSynchronousStatement(req_read);
+  req_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(req_empty_in) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(req_arriving) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(0));
+  req_ass->addCase(VHDLInterface::ConstantInt::get(0));
+  ShiftBuffer req_sb(name+"_packRequestShiftBuffer");
+  req_sb.mapDataWidth(1);
+  req_sb.mapShiftDepth(1);
+  req_sb.mapRst(parent->getStandardPorts().rst);
+  req_sb.mapClk(parent->getStandardPorts().clk);
+  req_sb.mapDataIn(req_read);
+  req_sb.mapDataOut(req_arriving);
+  req_sb.generateCode(parent);
+  //only read the elements the current request still needs
+  VHDLInterface::Signal* readEnable = parent->createSignal<VHDLInterface::Signal>(name+"_pack_read_enable_t", 1);
+  parent->createSynchronousStatement(read_out, readEnable);
+  VHDLInterface::AssignmentStatement* read_ass = parent->createSynchronousStatement(readEnable);
+  read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(word_full) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(empty_in) == VHDLInterface::ConstantInt::get(1) or VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(0));
+  read_ass->addCase(VHDLInterface::ConstantInt::get(0), VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1));
+  read_ass->addCase(VHDLInterface::ConstantInt::get(1));
+  ShiftBuffer sb(name+"_packShiftBuffer");
+  sb.mapDataWidth(1);
+  sb.mapShiftDepth(1);
+  sb.mapRst(parent->getStandardPorts().rst);
+  sb.mapClk(parent->getStandardPorts().clk);
+  sb.mapDataIn(readEnable);
+  sb.mapDataOut(arriving);
+  sb.generateCode(parent);
+  VHDLInterface::MultiStatementProcess* p = parent->createProcess<VHDLInterface::MultiStatementProcess>();
+  //a pushed word starts over with no elements
+  p->addStatement(new VHDLInterface::AssignmentStatement(word_valid, VHDLInterface::ConstantInt::get(0), p));
+  VHDLInterface::MultiStatement* clear = new VHDLInterface::MultiStatement(p);
+  for(int e = 0; e < factor; ++e)
+  {
+    clear->addStatement(new VHDLInterface::AssignmentStatement(enable[e], VHDLInterface::ConstantInt::get(0), p));
+  }
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(word_valid) == VHDLInterface::ConstantInt::get(1), clear));
+  //a new request starts at its offset into its first word
+  VHDLInterface::MultiStatement* request = new VHDLInterface::MultiStatement(p);
+  request->addStatement(new VHDLInterface::AssignmentStatement(left, req_count_in, p));
+  request->addStatement(new VHDLInterface::AssignmentStatement(lane, req_offset_in, p));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(req_arriving) == VHDLInterface::ConstantInt::get(1), request));
+  //an arriving element is stored in its lane, and the word is pushed once
+  //  it is complete or the request is
+  VHDLInterface::MultiStatement* arrive = new VHDLInterface::MultiStatement(p);
+  for(int e = 0; e < factor; ++e)
+  {
+    VHDLInterface::MultiStatement* store = new VHDLInterface::MultiStatement(p);
+    store->addStatement(new VHDLInterface::AssignmentStatement(word[e], data_in[0], p));
+    store->addStatement(new VHDLInterface::AssignmentStatement(enable[e], VHDLInterface::ConstantInt::get(1), p));
+    arrive->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(lane) == VHDLInterface::ConstantInt::get(e), store));
+  }
+  arrive->addStatement(new VHDLInterface::AssignmentStatement(left, VHDLInterface::Wrap(left) - VHDLInterface::ConstantInt::get(1), p));
+  arrive->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(lane) == VHDLInterface::ConstantInt::get(factor-1) or VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(1),
+                         (new VHDLInterface::MultiStatement(p))->addStatement(
+                              new VHDLInterface::AssignmentStatement(word_valid, VHDLInterface::ConstantInt::get(1), p)
+                         )->addStatement(
+                              new VHDLInterface::AssignmentStatement(lane, VHDLInterface::ConstantInt::get(0), p)
+                         ),
+                         new VHDLInterface::AssignmentStatement(lane, VHDLInterface::Wrap(lane) + VHDLInterface::ConstantInt::get(1), p)
+                       ));
+  p->addStatement(new VHDLInterface::IfStatement(p, VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(1), arrive));
+  //push the collected words, and their enables, onto the fifo
+  std::vector<VHDLInterface::Variable*> word_in(word.begin(), word.end());
+  word_in.insert(word_in.end(), enable.begin(), enable.end());
+  MicroFifo wordfifo(name+"_pack_fifo");
+  wordfifo.mapAddressWidth(3);
+  wordfifo.mapAlmostFullCount(2);
+  wordfifo.mapAlmostEmptyCount(0);
+  wordfifo.mapClk(parent->getStandardPorts().clk);
+  wordfifo.mapRst(parent->getStandardPorts().rst);
+  wordfifo.mapValidIn(word_valid);
+  wordfifo.mapFullOut(word_full);
+  wordfifo.mapReadEnableIn(word_read_in);
+  wordfifo.mapEmptyOut(word_empty_out);
+  wordfifo.mapInputAndOutputVector(word_in, word_data_out, parent);
+  wordfifo.generateCode(parent);
+  VHDLInterface::AssignmentStatement* idle_ass = parent->createSynchronousStatement(idle_out);
+  idle_ass->addCase(VHDLInterface::ConstantInt::get(1), VHDLInterface::Wrap(empty_in) == VHDLInterface::ConstantInt::get(1) and VHDLInterface::Wrap(left) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(arriving) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(word_valid) == VHDLInterface::ConstantInt::get(0) and VHDLInterface::Wrap(word_empty_out) == VHDLInterface::ConstantInt::get(1));
+  idle_ass->addCase(VHDLInterface::ConstantInt::get(0));
+}
+
+//Returns the number of elements the write requests of the given stream may be
+//  merged into, or 0 if writes should not be combined. The length defaults to
+//  the longest burst the address generator makes.
+int getWriteCombiningLength(llvm::Value* stream)
+{
+  if( !ROCCC::isLoOptimizationSelected("OutputWriteCombining") )
+    return 0;
+  int length = static_cast<int>(ROCCC::getLoOptimizationValue("OutputWriteCombining", ROCCC::getLoOptimizationValue("MaxBurstLength", 16)));
+  if( length <= 1 )
+  {
+    LOG_MESSAGE2("VHDL Generation", "Write Combining", "Writes of " << getValueName(stream) << " are not combined; the burst length must be at least 2.\n");
+    return 0;
+  }
+  return length;
+}
+
 OutputSmartBuffer::AddressVariables::AddressVariables() : address_rdy_out(NULL), address_stall_in(NULL), clk(NULL)
 {
 }
 OutputSmartBuffer::OutputSmartBuffer() : FifoInterfaceBlock<int,llvm::Value*>()
 {
 }
+void OutputSmartBuffer::setPackingFactor(llvm::Value* stream, int factor)
+{
+  packingFactors[stream] = factor;
+}
 void OutputSmartBuffer::setAddressVariables(llvm::Value* stream, VHDLInterface::Variable* rdy, VHDLInterface::Variable* stall, std::vector<std::pair<VHDLInterface::Variable*,VHDLInterface::Variable*> > base_count_pair, VHDLInterface::Variable* clk)
 {
   addressVariables[stream].address_rdy_out = rdy;
@@ -669,13 +822,17 @@ void OutputSmartBuffer::generateVHDL(VHDLInterface::Entity* parent, llvm::ROCCCL
                          micro_empty,
                          data_ins
                                      );
-    //create the address generator
+    //create the address generator; packed streams connect theirs through a
+    //  request queue instead
     AddressGenerator* ag = new OutputAddressGenerator(*II);
-    ag->initializeVHDLInterface(
+    if( packingFactors.find(*II) == packingFactors.end() or packingFactors[*II] <= 1 )
+    {
+      ag->initializeVHDLInterface(
                         addressVariables[*II].address_rdy_out,
                         addressVariables[*II].address_stall_in,
                         addressVariables[*II].address_out
                                      );
+    }
     //set the loop induction variables
     isb->setAccessedLIV(indexes);
     isb->setWrittenLIV(loopInfo.indexes);
@@ -706,10 +863,39 @@ void OutputSmartBuffer::generateVHDL(VHDLInterface::Entity* parent, llvm::ROCCCL
     isb->setStepDimensions(step_dimensions);                           
     //attach the output ports
     assert(this->getOutputReadEnableIn(*II));
+    VHDLInterface::Variable* fifo_read = this->getOutputReadEnableIn(*II);
+    VHDLInterface::Variable* fifo_empty = this->getOutputEmptyOut(*II);
+    std::vector<VHDLInterface::Variable*> fifo_data = this->getOutputDataOut(*II);
+    //the stages between the smart buffer and the stream's fifo must be empty
+    //  before we are done
+    std::vector<VHDLInterface::Variable*> stage_idle;
+    int packing_factor = 1;
+    if( packingFactors.find(*II) != packingFactors.end() )
+      packing_factor = packingFactors[*II];
+    //contiguous writes are merged into burst requests by the address generator,
+    //  so the memory side writes them out back to back
+    int combine_length = getWriteCombiningLength(*II);
+    if( combine_length > 0 )
+    {
+      ag->setMaxBurstLength(combine_length);
+      LOG_MESSAGE2("VHDL Generation", "Write Combining", "Contiguous writes of " << getValueName(*II) << " are requested in bursts of up to " << combine_length << " elements.\n");
+    }
+    if( packing_factor > 1 )
+    {
+      VHDLInterface::Variable* req_read = NULL;
+      VHDLInterface::Variable* req_empty = NULL;
+      VHDLInterface::Variable* req_offset = NULL;
+      VHDLInterface::Variable* req_count = NULL;
+      createWordRequestQueue(parent, *II, packing_factor, ag, addressVariables[*II].address_rdy_out, addressVariables[*II].address_stall_in, addressVariables[*II].address_out, addressVariables[*II].clk, req_read, req_empty, req_offset, req_count);
+      VHDLInterface::Variable* idle = NULL;
+      createStreamPacker(parent, *II, packing_factor, fifo_read, fifo_empty, fifo_data, req_read, req_empty, req_offset, req_count, fifo_read, fifo_empty, fifo_data, idle);
+      stage_idle.push_back(idle);
+      LOG_MESSAGE2("VHDL Generation", "Stream Packing", getValueName(*II) << " is written in aligned words of " << packing_factor << " elements; the elements each request writes are packed after the smart buffer, and only their enables are set.\n");
+    }
     isb->initializeOutputInterfacePorts(*II,
-                         this->getOutputReadEnableIn(*II),
-                         this->getOutputEmptyOut(*II),
-                         this->getOutputDataOut(*II)
+                         fifo_read,
+                         fifo_empty,
+                         fifo_data
                                      );
     isb->createVHDL(parent, &livHandler);
     BufferSpaceAccesser window_accesser = getWindowBufferSpaceAccessor(window_dimensions, std::vector<llvm::Value*>(indexes.rbegin(),indexes.rend()), writtenIndexesUsed, addressVariables[*II].address_out.size());
@@ -720,6 +906,10 @@ void OutputSmartBuffer::generateVHDL(VHDLInterface::Entity* parent, llvm::ROCCCL
     ag->createVHDL(parent, &address_livHandler, window_accesser, step_accesser, addressVariables[*II].clk);
     //set the done condition
     done_condition = done_condition and isb->getDoneCondition();
+    for(std::vector<VHDLInterface::Variable*>::iterator SII = stage_idle.begin(); SII != stage_idle.end(); ++SII)
+    {
+      done_condition = done_condition and VHDLInterface::Wrap(*SII) == VHDLInterface::ConstantInt::get(1);
+    }
   }
   VHDLInterface::Signal* temp_done = parent->createSignal<VHDLInterface::Signal>("done_temp", 1);
   VHDLInterface::AssignmentStatement* done_assign = parent->createSynchronousStatement(temp_done);
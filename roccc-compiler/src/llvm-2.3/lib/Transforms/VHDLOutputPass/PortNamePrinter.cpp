@@ -151,6 +151,8 @@ bool PortNamePrinterPass::runOnFunction(Function& f)
     portMap[dynamic_cast<VHDLInterface::Port*>(SVI->address_rdy)] = std::pair<std::string,std::string>(readableName, "STREAM_ADDRESS_RDY");
     portMap[dynamic_cast<VHDLInterface::Port*>(SVI->address_stall)] = std::pair<std::string,std::string>(readableName, "STREAM_ADDRESS_STALL");
     portMap[dynamic_cast<VHDLInterface::Port*>(SVI->address_clk)] = std::pair<std::string,std::string>(readableName, "STREAM_ADDRESS_CLK");
+    if( SVI->element_enable )
+      portMap[dynamic_cast<VHDLInterface::Port*>(SVI->element_enable)] = std::pair<std::string,std::string>(readableName, "STREAM_ELEMENT_ENABLE");
   }
   
   std::list<Port*> ports;
@@ -15,6 +15,7 @@
 #include <assert.h>
 #include <sstream>
 #include <map>
+#include <algorithm>
 
 #include "rocccLibrary/SizeInBits.h"
 #include "rocccLibrary/GetValueName.h"
@@ -27,6 +28,10 @@
 #include "rocccLibrary/FileInfo.h"
 #include "rocccLibrary/DatabaseHelpers.h"
 #include "rocccLibrary/MessageLogger.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/FifoSizing.h"
+#include "rocccLibrary/VHDLComponents/BRAMFifo.h"
+#include "rocccLibrary/VHDLComponents/PingPongBuffer.h"
 
 using namespace llvm ;
 using namespace VHDLInterface;
@@ -109,7 +114,8 @@ bool isOperandOfCallAnInput(CallInst* CI, User::op_iterator OP)
            isROCCCFunctionCall(CI, ROCCCNames::VariableSigned) or
            isROCCCFunctionCall(CI, ROCCCNames::NumberOfDataChannels) or
            isROCCCFunctionCall(CI, ROCCCNames::NumberOfAddressChannels) or
-           isROCCCFunctionCall(CI, ROCCCNames::NumberOfOutstandingMemoryRequests) )
+           isROCCCFunctionCall(CI, ROCCCNames::NumberOfOutstandingMemoryRequests) or
+           isROCCCFunctionCall(CI, ROCCCNames::GatherIndex) )
   {
     return false;
   }
@@ -328,6 +334,9 @@ void connectStreamInterface(/*stream variable ports*/StreamVariable svp, /*strea
   }
 }
 
+//defined below
+int getInternalStreamFifoDepth(llvm::Value* stream);
+
 class StreamAccessIntrinsic : public VHDLInterface::ComponentDefinition {
   StreamVariable inputAccess, outputAccess;
   VHDLInterface::ComponentDeclaration* getDecl(llvm::Value* streamValue)
@@ -342,6 +351,10 @@ public:
   {
     ComponentDeclaration* ret = this->getDeclaration();
     rst = ret->addPort("rst", 1, VHDLInterface::Port::INPUT);
+    //tell whatever implements the intrinsic how much it has to buffer
+    VHDLInterface::Generic* depth = new VHDLInterface::IntegerGeneric(ret, "FIFO_DEPTH", NULL);
+    ret->addGeneric(depth);
+    this->mapGeneric(VHDLInterface::IntegerGeneric::getTypeMatchedInteger(getInternalStreamFifoDepth(streamValue)), depth);
     inputAccess.cross_clk = ret->addPort("input_RClk", 1, VHDLInterface::Port::INPUT);
     inputAccess.stop_access = ret->addPort("input_Empty", 1, VHDLInterface::Port::INPUT);
     inputAccess.enable_access = ret->addPort("input_ReadEn", 1, VHDLInterface::Port::OUTPUT);
@@ -441,6 +454,80 @@ bool isInternalStream(llvm::Value* stream)
   return true;
 }
 
+//from InputController.cpp
+int getStreamBurstLength(llvm::Value* v);
+
+/*
+When PingPongBuffers is selected, internal streams are connected through a
+ping-pong buffer with banks of that many elements instead of the stream
+intrinsic, so the consumer can read a whole block of the producer's output
+in any order while the producer fills the next one. The buffer keeps a
+single bank address per element, so streams with more than one data or
+address channel still use the intrinsic. So do streams requested in bursts
+longer than a bank, whose requests would run past the two blocks in use.
+Returns the bank size, or 0 if the stream is not ping-pong buffered.
+*/
+int getPingPongBankSize(llvm::Value* stream)
+{
+  if( !ROCCC::isLoOptimizationSelected("PingPongBuffers") )
+    return 0;
+  int bank_size = static_cast<int>(ROCCC::getLoOptimizationValue("PingPongBuffers", 0));
+  if( bank_size < 2 )
+    return 0;
+  if( S2SgetNumDataChannels(stream) != 1 or S2SgetNumAddressChannels(stream) != 1 )
+  {
+    LOG_MESSAGE2("VHDL Generation", "Ping Pong Buffers", "Stream " << getValueName(stream) << " has more than one channel, and is connected as a stream.\n");
+    return 0;
+  }
+  //a request that starts in the block being filled or read must end before
+  //  the block after it, so no request may be longer than a bank
+  int request_length = getStreamBurstLength(stream);
+  if( ROCCC::isLoOptimizationSelected("OutputWriteCombining") )
+    request_length = std::max(request_length, static_cast<int>(ROCCC::getLoOptimizationValue("OutputWriteCombining", request_length)));
+  if( request_length > bank_size )
+  {
+    LOG_MESSAGE2("VHDL Generation", "Ping Pong Buffers", "Stream " << getValueName(stream) << " is requested in bursts of up to " << request_length << " elements, which do not fit in banks of " << bank_size << ", and is connected as a stream.\n");
+    return 0;
+  }
+  return bank_size;
+}
+
+/*
+Internal streams that are not ping-pong buffered are carried by the stream
+intrinsic, from the output fifo of the component that produces the stream
+to the input fifo of the component that consumes it. Those fifos were sized
+when each component was compiled, without knowing what is on the other side
+of the stream, so the intrinsic has to hold the rest. Its depth is computed
+from the pipeline latencies of both components, which are in the database,
+and the burst length of the stream.
+Returns the depth, in elements.
+*/
+int getInternalStreamFifoDepth(llvm::Value* stream)
+{
+  int producer_latency = 0;
+  int consumer_latency = 0;
+  for(llvm::Value::use_iterator UI = stream->use_begin(); UI != stream->use_end(); ++UI)
+  {
+    CallInst* CI = dynamic_cast<CallInst*>(*UI);
+    if( !isROCCCFunctionCall(CI, ROCCCNames::InvokeHardware) )
+      continue;
+    int latency = DatabaseInterface::getInstance()->LookupEntry(getComponentNameFromCallInst(CI)).getDelay();
+    for(User::op_iterator OP = CI->op_begin()+2; OP != CI->op_end(); ++OP)
+    {
+      if( *OP != stream )
+        continue;
+      if( isOperandOfCallAnInput(CI, OP) )
+        consumer_latency = std::max(consumer_latency, latency);
+      else
+        producer_latency = std::max(producer_latency, latency);
+    }
+  }
+  ROCCC::FifoRates rates(getStreamBurstLength(stream), 0, producer_latency, 1, consumer_latency, 1, VHDLInterface::BRAMFifo::getFullFlagLatency());
+  int depth = ROCCC::getFifoDepth(rates);
+  LOG_MESSAGE2("VHDL Generation", "Stream Fifo Sizing", "Stream " << getValueName(stream) << " connects a producer with a latency of " << producer_latency << " to a consumer with a latency of " << consumer_latency << ", and needs " << depth << " elements of buffering between them.\n");
+  return depth;
+}
+
 // This is the entry point to our pass and where all of our work gets done
 bool ROCCCSystemToSystemPass::runOnFunction(Function& F)
 {
@@ -470,11 +557,23 @@ bool ROCCCSystemToSystemPass::runOnFunction(Function& F)
   VHDLInterface::Wrap doneTrigger(entity->getStandardPorts().inputReady);
   //search for all internal streams, then create intrinsics for them
   std::map<llvm::Value*,StreamAccessIntrinsic*> internalIntrinsics;
+  //  or ping-pong buffers, if asked for
+  std::map<llvm::Value*,PingPongBuffer*> pingPongBuffers;
   for(Function::iterator BB = F.begin(); BB != F.end(); ++BB)
   {
     for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
     {
-      if( isInternalStream(&*II) )
+      if( isInternalStream(&*II) and getPingPongBankSize(&*II) > 0 )
+      {
+        PingPongBuffer* ppb = new PingPongBuffer(getValueName(&*II)+"_pingpong");
+        ppb->mapDataWidth(getSizeInBits(&*II));
+        ppb->mapDepth(getPingPongBankSize(&*II));
+        ppb->mapClk(entity->getStandardPorts().clk);
+        ppb->mapRst(entity->getStandardPorts().rst);
+        pingPongBuffers[&*II] = ppb;
+        LOG_MESSAGE2("VHDL Generation", "Ping Pong Buffers", "Stream " << getValueName(&*II) << " is connected through two banks of " << getPingPongBankSize(&*II) << " elements.\n");
+      }
+      else if( isInternalStream(&*II) )
       {
         internalIntrinsics[&*II] = new StreamAccessIntrinsic(&*II);
         INTERNAL_MESSAGE("Adding intrinsic component for internal stream " << getValueName(&*II) << "\n");
@@ -706,7 +805,35 @@ bool ROCCCSystemToSystemPass::runOnFunction(Function& F)
                 StreamVariable svp(getValueName(*OP), *OP);
                 svp = getStreamVHDLPortsFromDatabasePorts(*SI, cd);
                 StreamVariable sv(getValueName(*OP), *OP);
-                if( isInternalStream(*OP) )
+                if( pingPongBuffers.find(*OP) != pingPongBuffers.end() )
+                {
+                  //both modules are clocked with the ping-pong buffer
+                  sv = getStreamVariableSignalsFromPorts(svp, cd, entity);
+                  connectStreamInterface(svp, sv, cd);
+                  entity->createSynchronousStatement(sv.cross_clk, entity->getStandardPorts().clk);
+                  entity->createSynchronousStatement(sv.address_clk, entity->getStandardPorts().clk);
+                  PingPongBuffer* ppb = pingPongBuffers[*OP];
+                  if( isOperandOfCallAnInput(CI, OP) )
+                  {
+                    ppb->mapOutputFullIn(sv.stop_access);
+                    ppb->mapOutputWriteEnableOut(sv.enable_access);
+                    ppb->mapOutputDataOut(sv.data_channels.at(0));
+                    ppb->mapOutputAddressRdyIn(sv.address_rdy);
+                    ppb->mapOutputAddressStallOut(sv.address_stall);
+                    ppb->mapOutputAddressIn(sv.address_channels.at(0).first, sv.address_channels.at(0).second);
+                  }
+                  else
+                  {
+                    ppb->mapProducerDoneIn(entity->getVariableMappedTo(cd, cd->getDeclaration()->getStandardPorts().done));
+                    ppb->mapInputEmptyIn(sv.stop_access);
+                    ppb->mapInputReadEnableOut(sv.enable_access);
+                    ppb->mapInputDataIn(sv.data_channels.at(0));
+                    ppb->mapInputAddressRdyIn(sv.address_rdy);
+                    ppb->mapInputAddressStallOut(sv.address_stall);
+                    ppb->mapInputAddressIn(sv.address_channels.at(0).first, sv.address_channels.at(0).second);
+                  }
+                }
+                else if( isInternalStream(*OP) )
                 {
                   sv = getStreamVariableSignalsFromPorts(svp, cd, entity);
                   connectStreamInterface(svp, sv, cd);
@@ -784,6 +911,11 @@ bool ROCCCSystemToSystemPass::runOnFunction(Function& F)
     }
     assert( hasChanged and "Processing system iteratively, but nothing has changed since last iteration!" );
   } while( !isDone );
+  //every ping-pong buffer now has both its producer and its consumer
+  for(std::map<llvm::Value*,PingPongBuffer*>::iterator PPI = pingPongBuffers.begin(); PPI != pingPongBuffers.end(); ++PPI)
+  {
+    PPI->second->generateCode(entity);
+  }
   //map the done signal to the trigger we have been creating
   entity->createSynchronousStatement(entity->getStandardPorts().done, doneTrigger);
   
@@ -20,6 +20,7 @@
 #include <sstream>
 #include <fstream>
 #include <iomanip>
+#include <algorithm>
 
 #include "rocccLibrary/passes/InputController.h"
 #include "rocccLibrary/passes/OutputController.h"
@@ -34,6 +35,9 @@
 #include "rocccLibrary/FunctionType.h"
 #include "rocccLibrary/FileInfo.h"
 #include "rocccLibrary/DatabaseHelpers.h"
+#include "rocccLibrary/LoOptimizationFlags.h"
+#include "rocccLibrary/DSPMapping.h"
+#include "rocccLibrary/IsValueSigned.h"
 
 using namespace llvm ;
 using namespace Database;
@@ -54,7 +58,9 @@ void VHDLOutputPass::getAnalysisUsage(AnalysisUsage &AU) const
 
 VHDLOutputPass::VHDLOutputPass() : FunctionPass((intptr_t)&ID), 
 				   inputComponent(NULL), 
-				   outputComponent(NULL)
+				   outputComponent(NULL),
+				   elasticPipeline(false),
+				   elasticInputStall(NULL)
 {
 }
 
@@ -238,7 +244,17 @@ void VHDLOutputPass::setupVHDLInterface(DFFunction* f)
     inputComponent = entity->createComponent("inputController0", getAnalysis<InputControllerPass>().inputEntity->getDeclaration());
     entity->mapPortToSubComponentPort(entity->getStandardPorts().clk, inputComponent, inputComponent->getDeclaration()->getStandardPorts().clk);
     entity->mapPortToSubComponentPort(entity->getStandardPorts().rst, inputComponent, inputComponent->getDeclaration()->getStandardPorts().rst);
-    entity->createSynchronousStatement(entity->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().stall), VHDLInterface::Wrap(entity->getVariableMappedTo(outputComponent, getAnalysis<OutputControllerPass>().stall_internal)) | VHDLInterface::Wrap(entity->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().done)));
+    if( elasticPipeline )
+    {
+      //the first pipeline stage, not the outputController, decides when
+      //  the inputController must stop pushing data onto the datapath
+      elasticInputStall = entity->createSignal<VHDLInterface::Signal>("elastic_input_stall", 1);
+      entity->createSynchronousStatement(entity->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().stall), VHDLInterface::Wrap(elasticInputStall) | VHDLInterface::Wrap(entity->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().done)));
+    }
+    else
+    {
+      entity->createSynchronousStatement(entity->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().stall), VHDLInterface::Wrap(entity->getVariableMappedTo(outputComponent, getAnalysis<OutputControllerPass>().stall_internal)) | VHDLInterface::Wrap(entity->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().done)));
+    }
     entity->mapPortToSubComponentPort(entity->getStandardPorts().inputReady, inputComponent, inputComponent->getDeclaration()->getStandardPorts().inputReady);
     //connect the inputController ports
     CallInst* inputStreamOrderCall = NULL;
@@ -393,6 +409,13 @@ void VHDLOutputPass::setupVHDLInterface(DFFunction* f)
             sv.address_stall = entity->addPortCopy(address_stall, address_stall->getType());
             entity->mapPortToSubComponentPort(dynamic_cast<VHDLInterface::Port*>(sv.address_stall), outputComponent, address_stall);
           }
+          if( OSI->stream->element_enable )
+          {
+            VHDLInterface::Port* element_enable = dynamic_cast<VHDLInterface::Port*>(OSI->stream->element_enable);
+            assert(element_enable and "StreamVariable elements must be ports!");
+            sv.element_enable = entity->addPortCopy(element_enable, element_enable->getType());
+            entity->mapPortToSubComponentPort(dynamic_cast<VHDLInterface::Port*>(sv.element_enable), outputComponent, element_enable);
+          }
           streams.push_back(sv);
           found = true;
         }
@@ -532,6 +555,75 @@ int getActualPipelineLevel(DFBasicBlock* currentNode)
   return level;
 }
 
+/*
+The elastic pipeline replaces the global stall with a valid/ready handshake
+between neighboring pipeline stages, with a one element skid buffer in front
+of every stage. The skid buffers only duplicate the pipeline registers, so
+every pipeline stage other than the last one must consist solely of
+registered copies. Anything that keeps state across iterations or has its
+own internal pipeline (feedback, systolic arrays, LUTs, and instantiated
+components) is still controlled by the global stall.
+*/
+bool canUseElasticPipeline(DFFunction* f)
+{
+  assert(f);
+  if( f->getFunctionType() != ROCCC::MODULE )
+  {
+    LOG_MESSAGE2("VHDL Generation", "Elastic Pipeline", f->getName() << " is instantiated inside of other pipelines, and keeps the global stall port.\n");
+    return false;
+  }
+  for(Function::iterator BB = f->begin(); BB != f->end(); ++BB)
+  {
+    for(BasicBlock::iterator II = BB->begin(); II != BB->end(); ++II)
+    {
+      CallInst* CI = dynamic_cast<CallInst*>(&*II);
+      if( !CI )
+        continue;
+      if( isROCCCFunctionCall(CI, ROCCCNames::InvokeHardware) or
+          isROCCCFunctionCall(CI, ROCCCNames::LUTRead) or
+          isROCCCFunctionCall(CI, ROCCCNames::LUTWrite) or
+          isROCCCFunctionCall(CI, ROCCCNames::SystolicNext) or
+          isROCCCFunctionCall(CI, ROCCCNames::StoreNext) or
+          isROCCCFunctionCall(CI, ROCCCNames::LoadPrevious) or
+          isROCCCFunctionCall(CI, ROCCCNames::SystolicPrevious) or
+          isROCCCFunctionCall(CI, ROCCCNames::FeedbackScalar) or
+          isROCCCFunctionCall(CI, ROCCCNames::SummationFeedback) or
+          isROCCCFunctionCall(CI, ROCCCNames::DebugScalarOutput) )
+      {
+        LOG_MESSAGE2("VHDL Generation", "Elastic Pipeline", f->getName() << " contains " << CI->getCalledFunction()->getName() << "(), which cannot be placed behind a skid buffer; the global stall is used instead.\n");
+        return false;
+      }
+      if( (isROCCCFunctionCall(CI, ROCCCNames::OutputScalar) or isROCCCOutputStream(CI)) and
+          getActualPipelineLevel(BB->getDFBasicBlock()) != 0 )
+      {
+        LOG_MESSAGE2("VHDL Generation", "Elastic Pipeline", "Outputs of " << f->getName() << " are not written by the last pipeline stage; the global stall is used instead.\n");
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/*
+The operands and result of a shared multiplier stand in for several
+multiplies, so they have no llvm value of their own. They take the
+signedness of the multiplies bound to them, which all agree, so narrower
+operands are extended the same way the unshared multiply would extend them.
+*/
+class SharedMultiplierSignal : public VHDLInterface::Signal {
+  bool is_unsigned;
+public:
+  SharedMultiplierSignal(std::string n, int s, VHDLInterface::Variable::T* v) : VHDLInterface::Signal(n, s, v), is_unsigned(true) {}
+  void setUnsigned(bool u)
+  {
+    is_unsigned = u;
+  }
+  virtual bool isUnsigned() //from Variable
+  {
+    return is_unsigned;
+  }
+};
+
 class VHDLArray : public VHDLInterface::Signal {
   class ArrayElement : public VHDLInterface::Variable {
     std::string name;
@@ -733,6 +825,105 @@ class VHDLProcess : public VHDLInterface::Process {
   VHDLInterface::Port* outputComponent_stall_internal;
   VHDLInterface::Variable* internal_stall;
   VHDLInterface::Signal* activeStates;
+  //elastic pipeline state; the registers of each level are kept alongside
+  //  the value they load so that the skid buffers can load the same value
+  typedef std::vector<std::pair<VHDLInterface::Value*,VHDLInterface::Value*> > RegisterList;
+  VHDLInterface::Signal* elastic_input_stall;
+  RegisterList pending_registers;
+  std::map<int, VHDLInterface::MultiStatement*> elastic_level_statements;
+  std::map<int, RegisterList> elastic_level_registers;
+  std::map<int, VHDLInterface::Signal*> elastic_valid;
+  std::map<int, std::vector<VHDLInterface::Signal*> > elastic_skid_full;
+  void addRegister(VHDLInterface::Value* reg, VHDLInterface::Value* val)
+  {
+    pending_registers.push_back(std::pair<VHDLInterface::Value*,VHDLInterface::Value*>(reg, val));
+  }
+  //adds a statement that executes when the given pipeline level is triggered
+  void addLevelStatement(DFFunction* f, int level, VHDLInterface::Statement* inst)
+  {
+    if( !elastic_input_stall )
+    {
+      pending_registers.clear();
+      ms->addStatement(getConditionalLevelStatement(f, level, inst));
+      return;
+    }
+    if( level > f->getDelay() )
+      level = f->getDelay();
+    if( level < 0 )
+      level = 0;
+    if( elastic_level_statements.find(level) == elastic_level_statements.end() )
+      elastic_level_statements[level] = new VHDLInterface::MultiStatement(this);
+    elastic_level_statements[level]->addStatement(inst);
+    RegisterList& regs = elastic_level_registers[level];
+    regs.insert(regs.end(), pending_registers.begin(), pending_registers.end());
+    pending_registers.clear();
+  }
+  //a level has valid input when the level before it holds a value; the first
+  //  level gets its input from the inputController
+  VHDLInterface::CWrap getElasticInputValid(DFFunction* f, int level)
+  {
+    if( level == f->getDelay() )
+      return VHDLInterface::Wrap(getParent()->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().outputReady)) == VHDLInterface::ConstantInt::get(1);
+    return VHDLInterface::Wrap(elastic_valid[level+1]) == VHDLInterface::ConstantInt::get(1);
+  }
+  //a level is ready to accept a value as long as its skid buffer is empty;
+  //  the last level writes to the outputController, which has its own stall
+  VHDLInterface::CWrap getElasticReady(int level)
+  {
+    if( level == 0 )
+      return VHDLInterface::Wrap(internal_stall) != VHDLInterface::ConstantInt::get(1);
+    return VHDLInterface::Wrap(elastic_skid_full[level][0]) == VHDLInterface::ConstantInt::get(0);
+  }
+  VHDLInterface::CWrap isElasticSkidFull(int level, int slot)
+  {
+    return VHDLInterface::Wrap(elastic_skid_full[level][slot]) == VHDLInterface::ConstantInt::get(1);
+  }
+  //the oldest value in the skid buffer moves into the registers once they
+  //  are free
+  VHDLInterface::CWrap getElasticSkidUnload(int level)
+  {
+    return isElasticSkidFull(level, 0) and getElasticOutputFree(level);
+  }
+  //a value arrives at a level when the level before it hands one over; the
+  //  inputController does not wait for ready, so anything it sends arrives
+  VHDLInterface::CWrap getElasticArrival(DFFunction* f, int level)
+  {
+    if( level == f->getDelay() )
+      return getElasticInputValid(f, level);
+    return getElasticInputValid(f, level) and getElasticReady(level);
+  }
+  //the registers of a level may be overwritten when they are empty, or when
+  //  the next level is taking their value this cycle
+  VHDLInterface::CWrap getElasticOutputFree(int level)
+  {
+    return VHDLInterface::Wrap(elastic_valid[level]) == VHDLInterface::ConstantInt::get(0) or getElasticReady(level-1);
+  }
+  void finalizeElasticPipeline(DFFunction* f);
+  //operator sharing; multiplies are collected while the instructions are
+  //  processed and bound to shared multipliers once every level is known
+  struct SharedOperation {
+    BinaryOperator* inst;
+    VHDLInterface::AssignmentStatement* result;
+    VHDLInterface::Value* out;
+    VHDLInterface::Value* lhs;
+    VHDLInterface::Value* rhs;
+    int level;
+  };
+  bool operator_sharing;
+  std::vector<SharedOperation> shared_multiplies;
+  //a shared multiplier only has one signedness for each of its operands and
+  //  its result, so only multiplies that agree on all three can share one
+  static bool isSameSignedness(const SharedOperation& a, const SharedOperation& b)
+  {
+    return isValueUnsigned(a.inst->getOperand(0)) == isValueUnsigned(b.inst->getOperand(0)) and
+           isValueUnsigned(a.inst->getOperand(1)) == isValueUnsigned(b.inst->getOperand(1)) and
+           isValueUnsigned(a.inst) == isValueUnsigned(b.inst);
+  }
+  static bool compareSharedLevel(const SharedOperation& a, const SharedOperation& b)
+  {
+    return a.level > b.level;
+  }
+  void finalizeOperatorSharing(DFFunction* f);
   VHDLInterface::Wrap getLevelTriggerValue(DFFunction* f, int level)
   {
     VHDLInterface::Wrap trigger(NULL);
@@ -768,15 +959,19 @@ class VHDLProcess : public VHDLInterface::Process {
     return new VHDLInterface::IfStatement(this, getConditionForPipelineStage(f,level), inst);
   }
 public:
-  VHDLProcess(VHDLInterface::Entity* e) : Process(e), ms(NULL), stall_condition(NULL), outputComponent_stall_internal(NULL), internal_stall(NULL), activeStates(NULL) {}
-  void initialize(DFFunction* f, VHDLInterface::ComponentDefinition* ic, VHDLInterface::ComponentDefinition* oc, VHDLInterface::Port* ocsi)
+  VHDLProcess(VHDLInterface::Entity* e) : Process(e), ms(NULL), stall_condition(NULL), outputComponent_stall_internal(NULL), internal_stall(NULL), activeStates(NULL), elastic_input_stall(NULL), operator_sharing(false) {}
+  void initialize(DFFunction* f, VHDLInterface::ComponentDefinition* ic, VHDLInterface::ComponentDefinition* oc, VHDLInterface::Port* ocsi, VHDLInterface::Signal* eis)
   {
     ms = new VHDLInterface::MultiStatement(this);
     inputComponent = ic;
     outputComponent = oc;
     outputComponent_stall_internal = ocsi;
+    elastic_input_stall = eis;
+    //sharing relies on new values entering the pipeline no more often than
+    //  once every initiation interval, which the elastic pipeline does not
+    //  guarantee
+    operator_sharing = ROCCC::isLoOptimizationSelected("OperatorSharing") and f->getInitiationInterval() > 1 and !elastic_input_stall;
     
-    VHDLInterface::Signal* stall_previous = getParent()->createSignal<VHDLInterface::Signal>("stall_previous", 1, NULL); //FIXME: should the stall previous actually be a shift buffer, or is it correctly only stalling on the and of the previous and current stall?
     if( outputComponent )
     {
       internal_stall = getParent()->getVariableMappedTo(outputComponent, outputComponent_stall_internal);
@@ -785,25 +980,29 @@ public:
     {
       internal_stall = getParent()->getStandardPorts().stall;
     }
-    ms->addStatement(new VHDLInterface::AssignmentStatement(stall_previous, internal_stall, this));
-    stall_condition = (VHDLInterface::Wrap(internal_stall) != VHDLInterface::ConstantInt::get(1)) or (VHDLInterface::Wrap(stall_previous) == VHDLInterface::ConstantInt::get(0));
-    
     trigger_variables.push_back(getParent()->getStandardPorts().outputReady);
-    ms->addStatement(new VHDLInterface::CommentStatement(this, "BEGIN ACTIVESTATES SHIFT"));
     assert(f->getDelay() > 0 and "Error with graph. Are your outputs connected to your inputs?");
-    activeStates = getParent()->createSignal<VHDLInterface::Signal>("activeStates", f->getDelay(), NULL);
-    VHDLInterface::Value* input_ready = NULL;
-    VHDLInterface::AssignmentStatement* active_states_shift = new VHDLInterface::AssignmentStatement(activeStates, this);
-    if ( f->getFunctionType() == ROCCC::MODULE )
-      input_ready = getParent()->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().outputReady);
-    else
-      input_ready = getParent()->getStandardPorts().inputReady;
-    if( activeStates->getSize() > 1 )
-      active_states_shift->addCase(bitwise_concat(input_ready, VHDLInterface::BitRange::get(activeStates, activeStates->getSize()-1, 1)), stall_condition);
-    else
-      active_states_shift->addCase(input_ready, stall_condition);
-    ms->addStatement(active_states_shift);
-    ms->addStatement(new VHDLInterface::CommentStatement(this, "END ACTIVESTATES SHIFT"));
+    if( !elastic_input_stall )
+    {
+      VHDLInterface::Signal* stall_previous = getParent()->createSignal<VHDLInterface::Signal>("stall_previous", 1, NULL); //FIXME: should the stall previous actually be a shift buffer, or is it correctly only stalling on the and of the previous and current stall?
+      ms->addStatement(new VHDLInterface::AssignmentStatement(stall_previous, internal_stall, this));
+      stall_condition = (VHDLInterface::Wrap(internal_stall) != VHDLInterface::ConstantInt::get(1)) or (VHDLInterface::Wrap(stall_previous) == VHDLInterface::ConstantInt::get(0));
+    
+      ms->addStatement(new VHDLInterface::CommentStatement(this, "BEGIN ACTIVESTATES SHIFT"));
+      activeStates = getParent()->createSignal<VHDLInterface::Signal>("activeStates", f->getDelay(), NULL);
+      VHDLInterface::Value* input_ready = NULL;
+      VHDLInterface::AssignmentStatement* active_states_shift = new VHDLInterface::AssignmentStatement(activeStates, this);
+      if ( f->getFunctionType() == ROCCC::MODULE )
+        input_ready = getParent()->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getStandardPorts().outputReady);
+      else
+        input_ready = getParent()->getStandardPorts().inputReady;
+      if( activeStates->getSize() > 1 )
+        active_states_shift->addCase(bitwise_concat(input_ready, VHDLInterface::BitRange::get(activeStates, activeStates->getSize()-1, 1)), stall_condition);
+      else
+        active_states_shift->addCase(input_ready, stall_condition);
+      ms->addStatement(active_states_shift);
+      ms->addStatement(new VHDLInterface::CommentStatement(this, "END ACTIVESTATES SHIFT"));
+    }
     //This is TERRIBAD
     //add the init_inputscalars - this is done here because the input_scalar call may not connect to the
     //  sink, for example when the input scalars are only used as loop ending conditions, and they will
@@ -829,7 +1028,7 @@ public:
             int level = getActualPipelineLevel(dfbb);
             if( level == -1 )
               level = 1;
-            ms->addStatement(getConditionalLevelStatement(f, level, inst));
+            addLevelStatement(f, level, inst);
           }
         }
         else if( isROCCCFunctionCall(CI, ROCCCNames::InputScalar) )
@@ -838,7 +1037,7 @@ public:
           VHDLInterface::Statement* inst = ProcessCallInstruction(CI) ;
           if( inst != NULL )
           {
-            ms->addStatement(getConditionalLevelStatement(f, f->getDelay(), inst));
+            addLevelStatement(f, f->getDelay(), inst);
           }
         }
         else if( isROCCCFunctionCall(CI, ROCCCNames::DebugScalarOutput) )
@@ -953,7 +1152,7 @@ public:
           std::stringstream level_name;
           level_name << currentNode->getName() << "_" << level;
           currentNode->setName(level_name.str());
-          ms->addStatement(getConditionalLevelStatement(f, level, inst));
+          addLevelStatement(f, level, inst);
         }
       }
       // Get all of the others
@@ -976,8 +1175,12 @@ public:
     {
       assert( *LIV );
       VHDLInterface::Variable* port = getParent()->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getPort(*LIV).at(0));
-      ms->addStatement(getConditionalLevelStatement(f, activeStates->getSize(), new VHDLInterface::AssignmentStatement(getParent()->findSignal(*LIV).at(0), port, this)));
+      addRegister(getParent()->findSignal(*LIV).at(0), port);
+      addLevelStatement(f, f->getDelay(), new VHDLInterface::AssignmentStatement(getParent()->findSignal(*LIV).at(0), port, this));
     }
+    if( elastic_input_stall )
+      finalizeElasticPipeline(f);
+    finalizeOperatorSharing(f);
   }
   std::string generateSteadyState(int level)
   {
@@ -1003,6 +1206,194 @@ public:
   }
 };
 
+/*
+Generate the handshake between every pair of neighboring pipeline levels.
+Each level L > 0 has a valid flag for its registers and a skid buffer. The
+ready signal of a level is simply its skid buffer being empty, which is
+registered, so back-pressure travels one level per cycle instead of reaching
+every register in the same cycle. When a level receives a value while its
+registers are still waiting on the next level, the value is caught by the
+skid buffer and moved into the registers once they free up.
+
+Inside the pipeline a level only hands a value over when the next level is
+ready, so one slot is enough. The inputController does not look at ready:
+elastic_input_stall is registered, the stall port of the inputController is
+registered again, and the inputController registers its read enable and
+then its valid output. It keeps sending for ELASTIC_INPUT_SKID_DEPTH cycles
+after the first level runs out of room, and each of those values goes into
+the next free slot of the first level's skid buffer.
+*/
+const int ELASTIC_INPUT_SKID_DEPTH = 4;
+
+void VHDLProcess::finalizeElasticPipeline(DFFunction* f)
+{
+  int top = f->getDelay();
+  for(int level = 1; level <= top; ++level)
+  {
+    int slots = (level == top) ? ELASTIC_INPUT_SKID_DEPTH : 1;
+    std::stringstream valid_name;
+    valid_name << "elastic_valid" << level;
+    elastic_valid[level] = getParent()->createSignal<VHDLInterface::Signal>(valid_name.str(), 1);
+    for(int slot = 0; slot < slots; ++slot)
+    {
+      std::stringstream skid_name;
+      skid_name << "elastic_skid_full" << level;
+      if( slots > 1 )
+        skid_name << "_" << slot;
+      elastic_skid_full[level].push_back(getParent()->createSignal<VHDLInterface::Signal>(skid_name.str(), 1));
+    }
+  }
+  ms->addStatement(new VHDLInterface::CommentStatement(this, "BEGIN ELASTIC PIPELINE"));
+  if( elastic_level_statements.find(0) != elastic_level_statements.end() )
+  {
+    ms->addStatement(new VHDLInterface::IfStatement(this, getElasticInputValid(f, 0) and getElasticReady(0), elastic_level_statements[0]));
+  }
+  for(int level = 1; level <= top; ++level)
+  {
+    if( elastic_level_statements.find(level) != elastic_level_statements.end() )
+    {
+      ms->addStatement(new VHDLInterface::IfStatement(this, getElasticInputValid(f, level) and getElasticReady(level) and getElasticOutputFree(level), elastic_level_statements[level]));
+    }
+    int slots = elastic_skid_full[level].size();
+    RegisterList& regs = elastic_level_registers[level];
+    std::vector<VHDLInterface::MultiStatement*> load_skid;
+    for(int slot = 0; slot < slots; ++slot)
+      load_skid.push_back(new VHDLInterface::MultiStatement(this));
+    VHDLInterface::MultiStatement* unload_skid = new VHDLInterface::MultiStatement(this);
+    for(RegisterList::iterator RI = regs.begin(); RI != regs.end(); ++RI)
+    {
+      std::vector<VHDLInterface::Signal*> skid;
+      for(int slot = 0; slot < slots; ++slot)
+      {
+        std::stringstream name;
+        name << RI->first->getName() << "_skid";
+        if( slots > 1 )
+          name << slot;
+        skid.push_back(getParent()->createSignal<VHDLInterface::Signal>(name.str(), RI->first->getSize()));
+        load_skid[slot]->addStatement(new VHDLInterface::AssignmentStatement(skid[slot], RI->second, this));
+      }
+      unload_skid->addStatement(new VHDLInterface::AssignmentStatement(RI->first, skid[0], this));
+      for(int slot = 0; slot + 1 < slots; ++slot)
+        unload_skid->addStatement(new VHDLInterface::AssignmentStatement(skid[slot], skid[slot+1], this));
+    }
+    for(int slot = 0; slot + 1 < slots; ++slot)
+      unload_skid->addStatement(new VHDLInterface::AssignmentStatement(elastic_skid_full[level][slot], elastic_skid_full[level][slot+1], this));
+    unload_skid->addStatement(new VHDLInterface::AssignmentStatement(elastic_skid_full[level][slots-1], VHDLInterface::ConstantInt::get(0), this));
+    ms->addStatement(new VHDLInterface::IfStatement(this, getElasticSkidUnload(level), unload_skid));
+    //the slots fill up in order, so an arriving value goes right behind the
+    //  last full slot, one slot further up when the oldest is leaving; these
+    //  come after the unload so that they win over its shift
+    for(int slot = 0; slot < slots; ++slot)
+    {
+      load_skid[slot]->addStatement(new VHDLInterface::AssignmentStatement(elastic_skid_full[level][slot], VHDLInterface::ConstantInt::get(1), this));
+      VHDLInterface::CWrap staying = not getElasticSkidUnload(level) and not isElasticSkidFull(level, slot);
+      if( slot > 0 )
+        staying = staying and isElasticSkidFull(level, slot-1);
+      VHDLInterface::CWrap leaving = getElasticSkidUnload(level) and isElasticSkidFull(level, slot);
+      if( slot + 1 < slots )
+        leaving = leaving and not isElasticSkidFull(level, slot+1);
+      VHDLInterface::CWrap blocked = isElasticSkidFull(level, 0) or not getElasticOutputFree(level);
+      ms->addStatement(new VHDLInterface::IfStatement(this, getElasticArrival(f, level) and blocked and (staying or leaving), load_skid[slot]));
+    }
+    VHDLInterface::AssignmentStatement* valid_assign = new VHDLInterface::AssignmentStatement(elastic_valid[level], this);
+    valid_assign->addCase(VHDLInterface::ConstantInt::get(1), isElasticSkidFull(level, 0));
+    valid_assign->addCase(VHDLInterface::ConstantInt::get(1), getElasticInputValid(f, level));
+    valid_assign->addCase(VHDLInterface::ConstantInt::get(0));
+    ms->addStatement(new VHDLInterface::IfStatement(this, getElasticOutputFree(level), valid_assign));
+  }
+  ms->addStatement(new VHDLInterface::CommentStatement(this, "END ELASTIC PIPELINE"));
+  //stop the inputController as soon as the first level is holding a value
+  //  that is not being taken; the skid slots catch what it sends until then
+  VHDLInterface::AssignmentStatement* stall_assign = getParent()->createSynchronousStatement(elastic_input_stall);
+  stall_assign->addCase(VHDLInterface::ConstantInt::get(1), isElasticSkidFull(top, 0));
+  stall_assign->addCase(VHDLInterface::ConstantInt::get(1), not getElasticOutputFree(top));
+  stall_assign->addCase(VHDLInterface::ConstantInt::get(0));
+  LOG_MESSAGE2("VHDL Generation", "Elastic Pipeline", "The " << top << " pipeline levels of " << f->getName() << " are separated by skid buffers; the stall from the outputController only reaches the last level.\n");
+}
+
+/*
+Bind the multiplies collected during instruction processing onto shared
+multipliers. New values enter the pipeline at most once every initiation
+interval (II) cycles, so two operations whose pipeline levels are less than
+II apart never hold valid data at the same time and can use the same
+multiplier. A multiply at level L is only needed while level L-1 registers
+its result, so the trigger of level L-1 selects which operands go into the
+shared multiplier. Operations are bound first-fit, highest level first, and
+only multiplies whose operands and results agree in signedness are bound
+together.
+*/
+void VHDLProcess::finalizeOperatorSharing(DFFunction* f)
+{
+  if( shared_multiplies.empty() )
+    return;
+  int ii = f->getInitiationInterval();
+  std::stable_sort(shared_multiplies.begin(), shared_multiplies.end(), compareSharedLevel);
+  std::vector<std::vector<SharedOperation> > units;
+  for(std::vector<SharedOperation>::iterator SOI = shared_multiplies.begin(); SOI != shared_multiplies.end(); ++SOI)
+  {
+    std::vector<std::vector<SharedOperation> >::iterator UI = units.begin();
+    for(; UI != units.end(); ++UI)
+    {
+      bool fits = (UI->front().level - SOI->level < ii) and isSameSignedness(UI->front(), *SOI);
+      for(std::vector<SharedOperation>::iterator OI = UI->begin(); OI != UI->end(); ++OI)
+      {
+        if( OI->level == SOI->level )
+          fits = false;
+      }
+      if( fits )
+        break;
+    }
+    if( UI == units.end() )
+    {
+      units.push_back(std::vector<SharedOperation>());
+      UI = units.end() - 1;
+    }
+    UI->push_back(*SOI);
+  }
+  int count = 0;
+  for(std::vector<std::vector<SharedOperation> >::iterator UI = units.begin(); UI != units.end(); ++UI)
+  {
+    if( UI->size() == 1 )
+    {
+      UI->front().result->addCase( VHDLInterface::Wrap(UI->front().lhs) * VHDLInterface::Wrap(UI->front().rhs) );
+      continue;
+    }
+    int lhs_width = 0, rhs_width = 0, out_width = 0;
+    for(std::vector<SharedOperation>::iterator OI = UI->begin(); OI != UI->end(); ++OI)
+    {
+      out_width = std::max(out_width, OI->out->getSize());
+      lhs_width = std::max(lhs_width, OI->lhs->getSize());
+      rhs_width = std::max(rhs_width, OI->rhs->getSize());
+    }
+    std::stringstream ss;
+    ss << "shared_mult" << count++;
+    SharedMultiplierSignal* unit_lhs = getParent()->createSignal<SharedMultiplierSignal>(ss.str() + "_lhs", lhs_width);
+    SharedMultiplierSignal* unit_rhs = getParent()->createSignal<SharedMultiplierSignal>(ss.str() + "_rhs", rhs_width);
+    SharedMultiplierSignal* unit_out = getParent()->createSignal<SharedMultiplierSignal>(ss.str() + "_out", out_width);
+    unit_lhs->setUnsigned(isValueUnsigned(UI->front().inst->getOperand(0)));
+    unit_rhs->setUnsigned(isValueUnsigned(UI->front().inst->getOperand(1)));
+    unit_out->setUnsigned(isValueUnsigned(UI->front().inst));
+    VHDLInterface::AssignmentStatement* lhs_mux = getParent()->createSynchronousStatement(unit_lhs);
+    VHDLInterface::AssignmentStatement* rhs_mux = getParent()->createSynchronousStatement(unit_rhs);
+    for(std::vector<SharedOperation>::iterator OI = UI->begin(); OI != UI->end(); ++OI)
+    {
+      if( OI+1 == UI->end() )
+      {
+        lhs_mux->addCase(OI->lhs);
+        rhs_mux->addCase(OI->rhs);
+      }
+      else
+      {
+        lhs_mux->addCase(OI->lhs, getLevelTriggerValue(f, OI->level - 1) == VHDLInterface::ConstantInt::get(1));
+        rhs_mux->addCase(OI->rhs, getLevelTriggerValue(f, OI->level - 1) == VHDLInterface::ConstantInt::get(1));
+      }
+      OI->result->addCase(unit_out);
+    }
+    getParent()->createSynchronousStatement(unit_out, VHDLInterface::Wrap(unit_lhs) * VHDLInterface::Wrap(unit_rhs));
+  }
+  LOG_MESSAGE2("VHDL Generation", "Operator Sharing", "With an initiation interval of " << ii << ", the " << shared_multiplies.size() << " multiplies of " << f->getName() << " are bound to " << units.size() << " multipliers; " << count << " of them are shared.\n");
+}
+
 void VHDLOutputPass::OutputModule(DFFunction* f)
 {
   //output the generated entity
@@ -1030,9 +1421,11 @@ void VHDLOutputPass::OutputModule(DFFunction* f)
   Database::FileInfoInterface::addFileInfo(Database::getCurrentID(), Database::FileInfo(outputFileName, Database::FileInfo::VHDL_SOURCE, outputDirectory));
   LOG_MESSAGE2("VHDL Generation", "Datapath", "Datapath written to <a href=\'" << outputFullPath << "\'>" << outputFileName << "</a>.\n");
 
+  elasticPipeline = ROCCC::isLoOptimizationSelected("ElasticPipeline") and canUseElasticPipeline(f);
+  elasticInputStall = NULL;
   setupVHDLInterface(f);
   VHDLProcess* p = entity->createProcess<VHDLProcess>();
-  p->initialize(f, inputComponent, outputComponent, getAnalysis<OutputControllerPass>().stall_internal);
+  p->initialize(f, inputComponent, outputComponent, getAnalysis<OutputControllerPass>().stall_internal, elasticInputStall);
   finalizeVHDLInterface(f);
   fout << entity->generateCode();
   fout.close() ;
@@ -1151,10 +1544,16 @@ VHDLInterface::Statement* VHDLProcess::ProcessInstruction(Instruction* i)
     VHDLInterface::Value* loadSignal = LLVMValueToVHDLValue(load);
     if( loadSignal == NULL )
       loadSignal = getParent()->createSignal<VHDLInterface::Signal>(load->getName(), getSizeInBits(load), load);
-    if( !getParent()->getAttribute("syn_keep") )
-      getParent()->addAttribute(new VHDLInterface::VHDLAttribute("syn_keep", "boolean"));
-    if(dynamic_cast<VHDLInterface::Variable*>(loadSignal))
-      dynamic_cast<VHDLInterface::Variable*>(loadSignal)->addAttribute(getParent()->getAttribute("syn_keep"), "true");
+    //registers on the inputs and outputs of a DSP block must be free to be
+    //  absorbed into it, so only keep the others
+    if( !ROCCC::isDSPMapped(i) and !ROCCC::isDSPMapped(*VI) )
+    {
+      if( !getParent()->getAttribute("syn_keep") )
+        getParent()->addAttribute(new VHDLInterface::VHDLAttribute("syn_keep", "boolean"));
+      if(dynamic_cast<VHDLInterface::Variable*>(loadSignal))
+        dynamic_cast<VHDLInterface::Variable*>(loadSignal)->addAttribute(getParent()->getAttribute("syn_keep"), "true");
+    }
+    addRegister(loadSignal, LLVMValueToVHDLValue(*VI));
     ms->addStatement(new VHDLInterface::AssignmentStatement(loadSignal, LLVMValueToVHDLValue(*VI), this));
   }
   if (CallInst* CI = dynamic_cast<CallInst*>(i))
@@ -1380,6 +1779,7 @@ VHDLInterface::Statement* VHDLProcess::ProcessCallInstruction(CallInst* CI)
         p->addAttribute(allow_retiming, "false");
       if( allow_retiming )
         getParent()->findSignal(v).at(0)->addAttribute(allow_retiming, "false");
+      addRegister(getParent()->findSignal(v).at(0), p);
       ms->addStatement(new VHDLInterface::AssignmentStatement(getParent()->findSignal(v).at(0), p, this));
     }
     return ms;
@@ -1522,6 +1922,7 @@ VHDLInterface::Statement* VHDLProcess::ProcessCallInstruction(CallInst* CI)
       Value* v = CI->getOperand(j);
       assert( v );
       VHDLInterface::Variable* p = getParent()->getVariableMappedTo(inputComponent, inputComponent->getDeclaration()->getPort(v).at(0));
+      addRegister(getParent()->findSignal(v).at(0), p);
       ms->addStatement(new VHDLInterface::AssignmentStatement(getParent()->findSignal(v).at(0), p, this));
     }
     return ms;    
@@ -1757,7 +2158,32 @@ VHDLInterface::Statement* VHDLProcess::ProcessBinaryInstruction(BinaryOperator*
     break ;
     case BinaryOperator::Mul:
     {
-  	  ret->addCase( lhs * rhs );
+      //multiplies between two variables are the ones that take up multiplier
+      //  blocks; leave them to be bound to a shared multiplier later
+      int level = getActualPipelineLevel(i->getParent()->getDFBasicBlock());
+      if( operator_sharing and level >= 1 and
+          !dynamic_cast<llvm::Constant*>(i->getOperand(0)) and
+          !dynamic_cast<llvm::Constant*>(i->getOperand(1)) )
+      {
+        SharedOperation op;
+        op.inst = i;
+        op.result = ret;
+        op.out = LLVMValueToVHDLValue(i);
+        op.lhs = lhs;
+        op.rhs = rhs;
+        op.level = level;
+        shared_multiplies.push_back(op);
+      }
+      else
+  	    ret->addCase( lhs * rhs );
+      if( ROCCC::isDSPMultiply(i) )
+      {
+        if( !getParent()->getAttribute("use_dsp48") )
+          getParent()->addAttribute(new VHDLInterface::VHDLAttribute("use_dsp48", "string"));
+        VHDLInterface::Value* product = LLVMValueToVHDLValue(i);
+        if(dynamic_cast<VHDLInterface::Variable*>(product))
+          dynamic_cast<VHDLInterface::Variable*>(product)->addAttribute(getParent()->getAttribute("use_dsp48"), "\"yes\"");
+      }
     }
     break;
     case BinaryOperator::Shl:  // Shift left
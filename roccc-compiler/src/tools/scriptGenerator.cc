@@ -43,6 +43,12 @@ const int ComposedSystem             = 11 ;
 // Keep inlining everything for a certain depth
 const int InlineAllModules           = 12 ;
 
+// Split internal arrays into banks for unrolled loops
+const int ArrayPartitioning          = 13 ;
+
+// Limit the registers and block rams used to reuse stream elements
+const int ScalarReplacementBudget    = 14 ;
+
 // Redundancy Label DOUBLE/TRIPLE
 
 ScriptGenerator::ScriptGenerator() 
@@ -80,6 +86,10 @@ ScriptGenerator::ScriptGenerator()
   options.push_back("ComposedSystem") ;
 
   options.push_back("InlineAllModules") ;
+
+  options.push_back("ArrayPartitioning") ;
+
+  options.push_back("ScalarReplacementBudget") ;
 }
 
 ScriptGenerator::~ScriptGenerator()
@@ -148,6 +158,8 @@ void ScriptGenerator::ProcessOptimizationFile()
   temporalCSEStatements = "" ;
   inliningStatements = "" ;
   composedStatements = "" ;
+  arrayPartitioningStatements = "" ;
+  scalarReplacementBudget = "0 0" ;
   
   //intrinsicStatements = "" ;
   
@@ -308,6 +320,19 @@ void ScriptGenerator::ProcessOptimizationFile()
 	inliningStatements += " ; " ;
       }
       break ;      
+    case ArrayPartitioning:
+      {
+	arrayPartitioningStatements += "ArrayPartitioning ; " ;
+      }
+      break ;
+    case ScalarReplacementBudget:
+      {
+	std::string registerBits ;
+	std::string blockRams ;
+	fin >> registerBits >> std::ws >> blockRams >> std::ws ;
+	scalarReplacementBudget = registerBits + " " + blockRams ;
+      }
+      break ;
     default:
       {
 	std::cerr << "Unknown error!" << std::endl ;
@@ -620,7 +645,8 @@ void ScriptGenerator::CreateStandardSuifDriverCommand()
   // -------------------- Section 3 ----------------------
   //         Analysis and Information Collection
 
-  // Subsection 3.0 -> Lookup table Transformation
+  // Subsection 3.0 -> Lookup table partitioning and transformation
+  suifdriverCommand += arrayPartitioningStatements ;
   suifdriverCommand += "LookupTableTransformation ; " ;
   Normalize() ;
 
@@ -632,7 +658,9 @@ void ScriptGenerator::CreateStandardSuifDriverCommand()
   suifdriverCommand += "PreprocessingPass ; " ;
 
   // Subsection 3.2 -> Scalar replacement
-  suifdriverCommand += "ScalarReplacementPass2 ; " ;
+  suifdriverCommand += "ScalarReplacementPass2 " ;
+  suifdriverCommand += scalarReplacementBudget ;
+  suifdriverCommand += " ; " ;
   Normalize() ;
   ConstantPropagation() ;
   Normalize() ;
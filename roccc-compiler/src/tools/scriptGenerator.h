@@ -31,6 +31,8 @@ class ScriptGenerator
   std::string inliningStatements ;
   
   std::string composedStatements ;
+  std::string arrayPartitioningStatements ;
+  std::string scalarReplacementBudget ;
 
   std::string systolicArrayLabel ;
   